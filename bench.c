@@ -0,0 +1,1648 @@
+/*
+ *     bench.c
+ *     by nozden01 & bdioni01, 2/12/2024
+ *     iii
+ *
+ *     Function implementations for the benchmark program.
+ *     Times element access and the row-major and column-major maps of
+ *     UArray2, Bit2, Sparse2 and Rank2, and Morph2's filters, over grids
+ *     from a few kilobytes (cache resident) up to a configurable limit,
+ *     and prints one record per operation and grid.
+ *
+ *     Usage: benchmark [-f json|csv] [-r reps] [-m max_bytes] [-l label]
+ *                      [-o output] [-p pages]
+ *            -f format    output format, json (the default) or csv
+ *            -r reps      samples per measurement, 9 by default
+ *            -m max_bytes largest grid, with an optional K, M or G suffix;
+ *                         8M by default
+ *            -l label     label copied into every record, for example the
+ *                         name of the storage layout being measured
+ *            -o output    file to write to instead of stdout
+ *            -p pages     allocate the grids with pages.h instead of
+ *                         malloc, using a comma-separated list of thp,
+ *                         hugetlb, interleave and spread
+ *
+ *     Every sample repeats the operation enough times to take at least
+ *     MIN_SAMPLE seconds, and records the time per element. The median,
+ *     99th percentile (nearest rank) and minimum of the samples are printed,
+ *     all in nanoseconds per element.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "bench.h"
+
+#define MIN_SAMPLE 0.01
+#define KIB 1024L
+
+/* Grid sizes in bytes: L1, L2 and L3 resident, then main memory. */
+static const long SIZES[] = {
+        16 * KIB, 256 * KIB, 8 * KIB * KIB, 64 * KIB * KIB,
+        256 * KIB * KIB, KIB * KIB * KIB, 4 * KIB * KIB * KIB,
+        16 * KIB * KIB * KIB
+};
+
+/* Element sizes in bytes for UArray2. */
+static const int ELEM_SIZES[] = { 1, 4, 8, 16 };
+
+static const Bench_op UARRAY2_OPS[] = {
+        { "uarray2_at_row", at_row_major, NULL, NULL, NULL, NULL },
+        { "uarray2_at_col", at_col_major, NULL, NULL, NULL, NULL },
+        { "uarray2_at_fast_row", at_fast_row_major, NULL, NULL, NULL, NULL },
+        { "uarray2_at_fast_col", at_fast_col_major, NULL, NULL, NULL, NULL },
+        { "uarray2_map_row", map_row_major, NULL, NULL, NULL, NULL },
+        { "uarray2_map_col", map_col_major, NULL, NULL, NULL, NULL },
+        { "uarray2_fold_row", fold_rows, NULL, NULL, NULL, NULL }
+};
+
+static const Bench_op UARRAY2_INT_OPS[] = {
+        { "uarray2_int_at_fast_row", NULL, NULL, int_at_row_major, NULL,
+          NULL },
+        { "uarray2_int_map_row", NULL, NULL, int_map_row_major, NULL, NULL },
+        { "uarray2_int_sum", NULL, NULL, int_sum, NULL, NULL },
+        { "uarray2_int_sum_threads", NULL, NULL, int_sum_threads, NULL,
+          NULL },
+        { "uarray2_int_fill", NULL, NULL, int_fill, NULL, NULL }
+};
+
+static const Bench_op BIT2_OPS[] = {
+        { "bit2_get_row", NULL, get_row_major, NULL, NULL, NULL },
+        { "bit2_get_col", NULL, get_col_major, NULL, NULL, NULL },
+        { "bit2_put_row", NULL, put_row_major, NULL, NULL, NULL },
+        { "bit2_get_fast_row", NULL, get_fast_row_major, NULL, NULL, NULL },
+        { "bit2_put_fast_row", NULL, put_fast_row_major, NULL, NULL, NULL },
+        { "bit2_map_row", NULL, bit_map_row_major, NULL, NULL, NULL },
+        { "bit2_map_col", NULL, bit_map_col_major, NULL, NULL, NULL },
+        { "bit2_count", NULL, count_bits, NULL, NULL, NULL },
+        { "bit2_count_threads", NULL, count_bits_threads, NULL, NULL, NULL },
+        { "bit2_fill_bands", NULL, fill_bands, NULL, NULL, NULL },
+        { "bit2_fill_test_and_set", NULL, fill_test_and_set, NULL, NULL,
+          NULL },
+        { "bit2_fill_fetch_or", NULL, fill_fetch_or, NULL, NULL, NULL },
+        { "bit2_fill_shared", NULL, fill_shared, NULL, NULL, NULL }
+};
+
+static const Bench_op SPARSE2_OPS[] = {
+        { "sparse2_get_row", NULL, NULL, NULL, sparse_get_row_major, NULL },
+        { "sparse2_count", NULL, NULL, NULL, sparse_count, NULL },
+        { "sparse2_map_set", NULL, NULL, NULL, sparse_map_set, NULL },
+        { "sparse2_and", NULL, NULL, NULL, sparse_and_self, NULL }
+};
+
+static const Bench_op RANK2_OPS[] = {
+        { "rank2_build", NULL, rank_build, NULL, NULL, NULL },
+        { "rank2_scan_get", NULL, scan_get, NULL, NULL, NULL },
+        { "rank2_scan_next", NULL, NULL, NULL, NULL, rank_scan_next },
+        { "rank2_rank", NULL, NULL, NULL, NULL, rank_rows },
+        { "rank2_select", NULL, NULL, NULL, NULL, rank_select }
+};
+
+static const Bench_op MORPH2_OPS[] = {
+        { "morph2_dilate_square", NULL, dilate_square, NULL, NULL, NULL },
+        { "morph2_dilate_get", NULL, dilate_get, NULL, NULL, NULL },
+        { "morph2_erode_cross", NULL, erode_cross, NULL, NULL, NULL },
+        { "morph2_open_15x15", NULL, open_rect, NULL, NULL, NULL },
+        { "morph2_majority", NULL, majority, NULL, NULL, NULL }
+};
+
+static const Bench_op LABEL2_OPS[] = {
+        { "label2_label4", NULL, label4, NULL, NULL, NULL },
+        { "label2_label8", NULL, label8, NULL, NULL, NULL },
+        { "label2_grid", NULL, label_grid, NULL, NULL, NULL },
+        { "label2_specks", NULL, remove_specks, NULL, NULL, NULL }
+};
+
+/* Checksums are stored here so that no timed loop is dead code. */
+volatile unsigned long sink;
+
+/* Workers for the _threads operations, one per online CPU. */
+static Taskpool_T pool;
+
+/* Destination of the morphology operations, the size of their source. */
+static Bit2_T morph_dst;
+
+static long parse_bytes(const char *text);
+static int parse_pages(const char *text);
+
+/********** main ********
+ *
+ * Use:
+ *      Runs the benchmark program.
+ * Parameters:
+ *      int argc:     The number of arguments on the command line.
+ *      char *argv[]: Pointer to an array of arguments from the command line.
+ * Return:
+ *      EXIT_SUCCESS after printing every record, EXIT_FAILURE on bad usage.
+ * Expects:
+ *      Valid options (prints usage and returns EXIT_FAILURE if not).
+ * Notes:
+ *      Grids past 256M hold more than 2^31 elements; a 1G bitmap is a
+ *      multi-gigapixel image.
+ *
+ ************************/
+int main(int argc, char *argv[])
+{
+        struct Bench_config config = { 9, 8 * KIB * KIB, true, "", stdout,
+                                       0, 0 };
+        const char *output = NULL;
+        bool ok = true;
+        for (int i = 1; i < argc && ok; i++) {
+                if (i + 1 >= argc) {
+                        ok = false;
+                } else if (strcmp(argv[i], "-f") == 0) {
+                        config.json = strcmp(argv[++i], "json") == 0;
+                        ok = config.json || strcmp(argv[i], "csv") == 0;
+                } else if (strcmp(argv[i], "-r") == 0) {
+                        config.reps = atoi(argv[++i]);
+                } else if (strcmp(argv[i], "-m") == 0) {
+                        config.max_bytes = parse_bytes(argv[++i]);
+                } else if (strcmp(argv[i], "-l") == 0) {
+                        config.label = argv[++i];
+                } else if (strcmp(argv[i], "-o") == 0) {
+                        output = argv[++i];
+                } else if (strcmp(argv[i], "-p") == 0) {
+                        config.pages = parse_pages(argv[++i]);
+                        ok = config.pages > 0;
+                } else {
+                        ok = false;
+                }
+        }
+        if (!ok || config.reps < 1 || config.max_bytes <= 0) {
+                fprintf(stderr, "Usage: %s [-f json|csv] [-r reps] "
+                        "[-m max_bytes] [-l label] [-o output] "
+                        "[-p thp,hugetlb,interleave,spread]\n", argv[0]);
+                return EXIT_FAILURE;
+        }
+        if (output != NULL) {
+                config.out = fopen(output, "w");
+                if (config.out == NULL) {
+                        fprintf(stderr, "%s: cannot write %s\n", argv[0],
+                                output);
+                        return EXIT_FAILURE;
+                }
+        }
+
+        if (config.json) {
+                fprintf(config.out, "[\n");
+        } else {
+                fprintf(config.out, "label,op,width,height,elem_bits,bytes,"
+                        "reps,inner,median_ns,p99_ns,min_ns\n");
+        }
+        pool = Taskpool_new(0);
+        int nsizes = sizeof(SIZES) / sizeof(SIZES[0]);
+        int nelems = sizeof(ELEM_SIZES) / sizeof(ELEM_SIZES[0]);
+        for (int s = 0; s < nsizes && SIZES[s] <= config.max_bytes; s++) {
+                for (int e = 0; e < nelems; e++) {
+                        bench_uarray2(&config, SIZES[s], ELEM_SIZES[e]);
+                }
+                bench_uarray2_int(&config, SIZES[s]);
+                bench_bit2(&config, SIZES[s]);
+                bench_sparse2(&config, SIZES[s]);
+                bench_rank2(&config, SIZES[s]);
+                bench_morph2(&config, SIZES[s]);
+                bench_label2(&config, SIZES[s]);
+        }
+        Taskpool_free(&pool);
+        if (config.json) {
+                fprintf(config.out, "\n]\n");
+        }
+        if (output != NULL) {
+                fclose(config.out);
+        }
+        return EXIT_SUCCESS;
+}
+
+/********** bench_uarray2 ********
+ *
+ * Use:
+ *      Measures every UArray2 operation on a square-ish grid of the given
+ *      size in bytes and element size.
+ * Parameters:
+ *      Bench_config config: The benchmark options.
+ *      long bytes:          Size of the grid's elements in bytes.
+ *      int size:            Size of one element in bytes.
+ * Return:
+ *      None.
+ * Expects:
+ *      config is not NULL, bytes >= size > 0.
+ * Notes:
+ *      The grid is zeroed before timing so that every page is mapped. It
+ *      comes from pages.h when config->pages is set; if those pages cannot
+ *      be mapped, the size is skipped with a message on stderr.
+ *
+ ************************/
+void bench_uarray2(Bench_config config, long bytes, int size)
+{
+        long elems = bytes / size;
+        int width = (int)sqrt((double)elems);
+        int height = (int)(elems / width);
+        UArray2_T arr = config->pages != 0
+                        ? Pages_uarray2(width, height, size, config->pages)
+                        : UArray2_new(width, height, size);
+        if (arr == NULL) {
+                fprintf(stderr, "skipping uarray2 %ld bytes: cannot map "
+                        "pages\n", bytes);
+                return;
+        }
+        for (int row = 0; row < height; row++) {
+                for (int col = 0; col < width; col++) {
+                        memset(UArray2_at(arr, col, row), 0, size);
+                }
+        }
+
+        int nops = sizeof(UARRAY2_OPS) / sizeof(UARRAY2_OPS[0]);
+        for (int i = 0; i < nops; i++) {
+                Bench_result result = measure(config, &UARRAY2_OPS[i], arr,
+                                              (long)width * height);
+                result.width = width;
+                result.height = height;
+                result.elem_bits = 8 * size;
+                result.bytes = bytes;
+                print_result(config, &result);
+        }
+        if (config->pages != 0) {
+                Pages_free_uarray2(&arr);
+        } else {
+                UArray2_free(&arr);
+        }
+}
+
+/********** bench_uarray2_int ********
+ *
+ * Use:
+ *      Measures the typed UArray2_int operations on a square-ish grid of
+ *      the given size in bytes, for comparison with the 32-bit records of
+ *      bench_uarray2.
+ * Parameters:
+ *      Bench_config config: The benchmark options.
+ *      long bytes:          Size of the grid's elements in bytes.
+ * Return:
+ *      None.
+ * Expects:
+ *      config is not NULL, bytes >= sizeof(int).
+ * Notes:
+ *      With config->pages set, the array is a generic one from pages.h
+ *      used through the typed interface, which has the same layout.
+ *
+ ************************/
+void bench_uarray2_int(Bench_config config, long bytes)
+{
+        long elems = bytes / (long)sizeof(int);
+        int width = (int)sqrt((double)elems);
+        int height = (int)(elems / width);
+        UArray2_int arr;
+        if (config->pages != 0) {
+                arr = (UArray2_int)Pages_uarray2(width, height, sizeof(int),
+                                                 config->pages);
+                if (arr == NULL) {
+                        fprintf(stderr, "skipping uarray2_int %ld bytes: "
+                                "cannot map pages\n", bytes);
+                        return;
+                }
+        } else {
+                arr = UArray2_int_new(width, height);
+        }
+
+        int nops = sizeof(UARRAY2_INT_OPS) / sizeof(UARRAY2_INT_OPS[0]);
+        for (int i = 0; i < nops; i++) {
+                Bench_result result = measure(config, &UARRAY2_INT_OPS[i],
+                                              arr, (long)width * height);
+                result.width = width;
+                result.height = height;
+                result.elem_bits = 8 * sizeof(int);
+                result.bytes = bytes;
+                print_result(config, &result);
+        }
+        if (config->pages != 0) {
+                UArray2_T generic = UArray2_int_generic(arr);
+                Pages_free_uarray2(&generic);
+        } else {
+                UArray2_int_free(&arr);
+        }
+}
+
+/********** bench_bit2 ********
+ *
+ * Use:
+ *      Measures every Bit2 operation on a square-ish bitmap of the given
+ *      size in bytes.
+ * Parameters:
+ *      Bench_config config: The benchmark options.
+ *      long bytes:          Size of the bitmap in bytes.
+ * Return:
+ *      None.
+ * Expects:
+ *      config is not NULL, bytes > 0.
+ * Notes:
+ *      The bitmap comes from pages.h when config->pages is set.
+ *
+ ************************/
+void bench_bit2(Bench_config config, long bytes)
+{
+        long bits = 8 * bytes;
+        int width = (int)sqrt((double)bits);
+        int height = (int)(bits / width);
+        Bit2_T bitmap = config->pages != 0
+                        ? Pages_bit2(width, height, config->pages)
+                        : Bit2_new(width, height);
+        if (bitmap == NULL) {
+                fprintf(stderr, "skipping bit2 %ld bytes: cannot map "
+                        "pages\n", bytes);
+                return;
+        }
+
+        int nops = sizeof(BIT2_OPS) / sizeof(BIT2_OPS[0]);
+        for (int i = 0; i < nops; i++) {
+                Bench_result result = measure(config, &BIT2_OPS[i], bitmap,
+                                              (long)width * height);
+                result.width = width;
+                result.height = height;
+                result.elem_bits = 1;
+                result.bytes = bytes;
+                print_result(config, &result);
+        }
+        bench_bit2_mapped(config, bitmap, bytes);
+        if (config->pages != 0) {
+                Pages_free_bit2(&bitmap);
+        } else {
+                Bit2_free(&bitmap);
+        }
+}
+
+/********** bench_bit2_mapped ********
+ *
+ * Use:
+ *      Saves a bitmap to a grid file, opens it mapped, and measures
+ *      counting its bits, for comparison with bit2_count on the heap copy.
+ * Parameters:
+ *      Bench_config config: The benchmark options.
+ *      Bit2_T bitmap:       The bitmap to save.
+ *      long bytes:          Size of the bitmap in bytes.
+ * Return:
+ *      None.
+ * Expects:
+ *      config and bitmap are not NULL.
+ * Notes:
+ *      The file is made in /tmp and unlinked as soon as it is mapped. The
+ *      first run after saving warms the page cache, so the records show
+ *      the cost of mapped pages, not of the disk.
+ *
+ ************************/
+void bench_bit2_mapped(Bench_config config, Bit2_T bitmap, long bytes)
+{
+        static const Bench_op op = { "bit2_count_mapped", NULL, count_bits,
+                                     NULL, NULL, NULL };
+        char path[] = "/tmp/benchmark.XXXXXX";
+        int fd = mkstemp(path);
+        if (fd < 0) {
+                fprintf(stderr, "skipping mapped Bit2: cannot make %s\n",
+                        path);
+                return;
+        }
+        close(fd);
+        Bit2_T mapped = NULL;
+        if (Gridfile_save_bit2(bitmap, path)) {
+                mapped = Gridfile_open_bit2(path, false);
+        }
+        unlink(path);
+        if (mapped == NULL) {
+                fprintf(stderr, "skipping mapped Bit2: cannot map %s\n",
+                        path);
+                return;
+        }
+        Bench_result result = measure(config, &op, mapped,
+                                      (long)Bit2_width(mapped) *
+                                      Bit2_height(mapped));
+        result.width = Bit2_width(mapped);
+        result.height = Bit2_height(mapped);
+        result.elem_bits = 1;
+        result.bytes = bytes;
+        print_result(config, &result);
+        Gridfile_close_bit2(&mapped);
+}
+
+/********** bench_sparse2 ********
+ *
+ * Use:
+ *      Measures the Sparse2 operations on a mostly blank mask with the
+ *      dimensions bench_bit2 uses for the same size.
+ * Parameters:
+ *      Bench_config config: The benchmark options.
+ *      long bytes:          Size of the dense bitmap in bytes.
+ * Return:
+ *      None.
+ * Expects:
+ *      config is not NULL, bytes > 0.
+ * Notes:
+ *      The mask is a filled square in the middle, which makes full tiles
+ *      and runs, and a dot every 31 columns on every 97th row, which makes
+ *      arrays. The records carry the dense size in bytes so they line up
+ *      with bench_bit2's; the compressed size goes to stderr.
+ *
+ ************************/
+void bench_sparse2(Bench_config config, long bytes)
+{
+        long bits = 8 * bytes;
+        int width = (int)sqrt((double)bits);
+        int height = (int)(bits / width);
+        Sparse2_T bitmap = Sparse2_new(width, height);
+        for (int row = height / 4; row < height / 4 + width / 4; row++) {
+                for (int col = width / 4; col < width / 2; col++) {
+                        Sparse2_put(bitmap, col, row, 1);
+                }
+        }
+        for (int row = 0; row < height; row += 97) {
+                for (int col = 0; col < width; col += 31) {
+                        Sparse2_put(bitmap, col, row, 1);
+                }
+        }
+        Sparse2_optimize(bitmap);
+        fprintf(stderr, "sparse2 %dx%d: %ld bytes\n", width, height,
+                Sparse2_bytes(bitmap));
+
+        int nops = sizeof(SPARSE2_OPS) / sizeof(SPARSE2_OPS[0]);
+        for (int i = 0; i < nops; i++) {
+                Bench_result result = measure(config, &SPARSE2_OPS[i],
+                                              bitmap, (long)width * height);
+                result.width = width;
+                result.height = height;
+                result.elem_bits = 1;
+                result.bytes = bytes;
+                print_result(config, &result);
+        }
+        Sparse2_free(&bitmap);
+}
+
+/********** bench_rank2 ********
+ *
+ * Use:
+ *      Measures building a Rank2 index and finding the 1 bits of a sparse
+ *      bitmap with it, against finding them with Bit2_get.
+ * Parameters:
+ *      Bench_config config: The benchmark options.
+ *      long bytes:          Size of the bitmap in bytes.
+ * Return:
+ *      None.
+ * Expects:
+ *      config is not NULL, bytes > 0.
+ * Notes:
+ *      About one pixel in 256 is set, scattered by a hash of its position.
+ *
+ ************************/
+void bench_rank2(Bench_config config, long bytes)
+{
+        long bits = 8 * bytes;
+        int width = (int)sqrt((double)bits);
+        int height = (int)(bits / width);
+        Bit2_T bitmap = Bit2_new(width, height);
+        for (int row = 0; row < height; row++) {
+                for (int col = 0; col < width; col++) {
+                        uint32_t hash = (uint32_t)(col * 2654435761u) ^
+                                        (uint32_t)(row * 40503u);
+                        if ((hash * 2246822519u) >> 24 == 0) {
+                                Bit2_put_fast(bitmap, col, row, 1);
+                        }
+                }
+        }
+        Rank2_T index = Rank2_new(bitmap);
+
+        int nops = sizeof(RANK2_OPS) / sizeof(RANK2_OPS[0]);
+        for (int i = 0; i < nops; i++) {
+                void *grid = RANK2_OPS[i].rank2 != NULL ? (void *)index
+                                                        : (void *)bitmap;
+                Bench_result result = measure(config, &RANK2_OPS[i], grid,
+                                              (long)width * height);
+                result.width = width;
+                result.height = height;
+                result.elem_bits = 1;
+                result.bytes = bytes;
+                print_result(config, &result);
+        }
+        Rank2_free(&index);
+        Bit2_free(&bitmap);
+}
+
+/********** bench_morph2 ********
+ *
+ * Use:
+ *      Measures the morphology filters on a noisy bitmap, and a 3x3
+ *      dilation done a pixel at a time through Bit2_map_row_major for
+ *      comparison.
+ * Parameters:
+ *      Bench_config config: The benchmark options.
+ *      long bytes:          Size of the bitmap in bytes.
+ * Return:
+ *      None.
+ * Expects:
+ *      config is not NULL, bytes > 0.
+ * Notes:
+ *      Every operation writes into morph_dst, so the source stays the
+ *      same from run to run.
+ *
+ ************************/
+void bench_morph2(Bench_config config, long bytes)
+{
+        long bits = 8 * bytes;
+        int width = (int)sqrt((double)bits);
+        int height = (int)(bits / width);
+        Bit2_T bitmap = Bit2_new(width, height);
+        for (int row = 0; row < height; row++) {
+                for (int col = 0; col < width; col++) {
+                        uint32_t hash = (uint32_t)(col * 2654435761u) ^
+                                        (uint32_t)(row * 40503u);
+                        Bit2_put_fast(bitmap, col, row,
+                                      (hash * 2246822519u) >> 30 == 0);
+                }
+        }
+        morph_dst = Bit2_new(width, height);
+
+        int nops = sizeof(MORPH2_OPS) / sizeof(MORPH2_OPS[0]);
+        for (int i = 0; i < nops; i++) {
+                Bench_result result = measure(config, &MORPH2_OPS[i],
+                                              bitmap, (long)width * height);
+                result.width = width;
+                result.height = height;
+                result.elem_bits = 1;
+                result.bytes = bytes;
+                print_result(config, &result);
+        }
+        Bit2_free(&morph_dst);
+        Bit2_free(&bitmap);
+}
+
+/********** bench_label2 ********
+ *
+ * Use:
+ *      Measures connected-component labeling on a bitmap with half its
+ *      pixels set, at random.
+ * Parameters:
+ *      Bench_config config: The benchmark options.
+ *      long bytes:          Size of the bitmap in bytes.
+ * Return:
+ *      None.
+ * Expects:
+ *      config is not NULL, bytes > 0.
+ * Notes:
+ *      At half density the components range from single pixels to ones
+ *      spanning the bitmap, so the union-find does real work. Every
+ *      operation includes converting the bitmap to runs.
+ *
+ ************************/
+void bench_label2(Bench_config config, long bytes)
+{
+        long bits = 8 * bytes;
+        int width = (int)sqrt((double)bits);
+        int height = (int)(bits / width);
+        Bit2_T bitmap = Bit2_new(width, height);
+        for (int row = 0; row < height; row++) {
+                for (int col = 0; col < width; col++) {
+                        uint32_t hash = (uint32_t)(col * 2654435761u) ^
+                                        (uint32_t)(row * 40503u);
+                        Bit2_put_fast(bitmap, col, row,
+                                      (hash * 2246822519u) >> 31 == 0);
+                }
+        }
+
+        int nops = sizeof(LABEL2_OPS) / sizeof(LABEL2_OPS[0]);
+        for (int i = 0; i < nops; i++) {
+                Bench_result result = measure(config, &LABEL2_OPS[i],
+                                              bitmap, (long)width * height);
+                result.width = width;
+                result.height = height;
+                result.elem_bits = 1;
+                result.bytes = bytes;
+                print_result(config, &result);
+        }
+        Bit2_free(&bitmap);
+}
+
+/********** run_op ********
+ *
+ * Use:
+ *      Runs one operation once on the grid it takes.
+ * Parameters:
+ *      const Bench_op *op: The operation.
+ *      void *grid:         The UArray2_T, Bit2_T, UArray2_int, Sparse2_T
+ *                          or Rank2_T it takes.
+ * Return:
+ *      The operation's checksum.
+ * Expects:
+ *      op is not NULL and has exactly one function set.
+ * Notes:
+ *      None.
+ *
+ ************************/
+unsigned long run_op(const Bench_op *op, void *grid)
+{
+        if (op->uarray2 != NULL) {
+                return op->uarray2(grid);
+        } else if (op->bit2 != NULL) {
+                return op->bit2(grid);
+        } else if (op->sparse2 != NULL) {
+                return op->sparse2(grid);
+        } else if (op->rank2 != NULL) {
+                return op->rank2(grid);
+        }
+        return op->uarray2_int(grid);
+}
+
+/********** measure ********
+ *
+ * Use:
+ *      Times one operation on one grid.
+ * Parameters:
+ *      Bench_config config: The benchmark options.
+ *      const Bench_op *op:  The operation.
+ *      void *grid:          The grid the operation takes.
+ *      long elems:          Number of elements the operation visits.
+ * Return:
+ *      The result, with the op name and timings filled in.
+ * Expects:
+ *      config, op and grid are not NULL.
+ * Notes:
+ *      The first run warms the caches and picks how many runs make up a
+ *      sample; it is not recorded.
+ *
+ ************************/
+Bench_result measure(Bench_config config, const Bench_op *op, void *grid,
+                     long elems)
+{
+        Bench_result result;
+        memset(&result, 0, sizeof(result));
+        result.op = op->name;
+
+        double start = seconds();
+        sink += run_op(op, grid);
+        double once = seconds() - start;
+        result.inner = 1;
+        if (once < MIN_SAMPLE) {
+                result.inner = (long)ceil(MIN_SAMPLE / (once > 0 ? once
+                                                        : 1e-9));
+        }
+
+        double *samples = CALLOC(config->reps, sizeof(double));
+        for (int r = 0; r < config->reps; r++) {
+                start = seconds();
+                for (long i = 0; i < result.inner; i++) {
+                        sink += run_op(op, grid);
+                }
+                samples[r] = (seconds() - start) * 1e9 /
+                             ((double)result.inner * elems);
+        }
+        qsort(samples, config->reps, sizeof(double), compare_doubles);
+        result.median = samples[config->reps / 2];
+        result.p99 = samples[(int)ceil(0.99 * config->reps) - 1];
+        result.min = samples[0];
+        FREE(samples);
+        return result;
+}
+
+/********** print_result ********
+ *
+ * Use:
+ *      Prints one result as a JSON object or a CSV line.
+ * Parameters:
+ *      Bench_config config:          The benchmark options.
+ *      const Bench_result *result:   The result to print.
+ * Return:
+ *      None.
+ * Expects:
+ *      config and result are not NULL.
+ * Notes:
+ *      Flushes the output so that partial results survive a run that is
+ *      stopped early.
+ *
+ ************************/
+void print_result(Bench_config config, const Bench_result *result)
+{
+        if (config->json) {
+                fprintf(config->out, "%s  {\"label\": \"%s\", \"op\": \"%s\", "
+                        "\"width\": %d, \"height\": %d, \"elem_bits\": %d, "
+                        "\"bytes\": %ld, \"reps\": %d, \"inner\": %ld, "
+                        "\"median_ns\": %.4f, \"p99_ns\": %.4f, "
+                        "\"min_ns\": %.4f}",
+                        config->printed > 0 ? ",\n" : "", config->label,
+                        result->op, result->width, result->height,
+                        result->elem_bits, result->bytes, config->reps,
+                        result->inner, result->median, result->p99,
+                        result->min);
+        } else {
+                fprintf(config->out, "%s,%s,%d,%d,%d,%ld,%d,%ld,%.4f,%.4f,"
+                        "%.4f\n", config->label, result->op, result->width,
+                        result->height, result->elem_bits, result->bytes,
+                        config->reps, result->inner, result->median,
+                        result->p99, result->min);
+        }
+        config->printed++;
+        fflush(config->out);
+}
+
+/********** at_row_major ********
+ *
+ * Use:
+ *      Increments the first byte of every element with UArray2_at, row by
+ *      row.
+ * Parameters:
+ *      UArray2_T arr: The grid.
+ * Return:
+ *      Sum of the bytes after incrementing.
+ * Expects:
+ *      arr is not NULL.
+ * Notes:
+ *      The col-major, map, and Bit2 operations below follow the same
+ *      pattern: touch every element once and return a checksum.
+ *
+ ************************/
+unsigned long at_row_major(UArray2_T arr)
+{
+        unsigned long sum = 0;
+        int width = UArray2_width(arr);
+        int height = UArray2_height(arr);
+        for (int row = 0; row < height; row++) {
+                for (int col = 0; col < width; col++) {
+                        unsigned char *elem = UArray2_at(arr, col, row);
+                        sum += ++*elem;
+                }
+        }
+        return sum;
+}
+
+unsigned long at_col_major(UArray2_T arr)
+{
+        unsigned long sum = 0;
+        int width = UArray2_width(arr);
+        int height = UArray2_height(arr);
+        for (int col = 0; col < width; col++) {
+                for (int row = 0; row < height; row++) {
+                        unsigned char *elem = UArray2_at(arr, col, row);
+                        sum += ++*elem;
+                }
+        }
+        return sum;
+}
+
+unsigned long at_fast_row_major(UArray2_T arr)
+{
+        unsigned long sum = 0;
+        int width = UArray2_width(arr);
+        int height = UArray2_height(arr);
+        for (int row = 0; row < height; row++) {
+                for (int col = 0; col < width; col++) {
+                        unsigned char *elem = UArray2_at_fast(arr, col, row);
+                        sum += ++*elem;
+                }
+        }
+        return sum;
+}
+
+unsigned long at_fast_col_major(UArray2_T arr)
+{
+        unsigned long sum = 0;
+        int width = UArray2_width(arr);
+        int height = UArray2_height(arr);
+        for (int col = 0; col < width; col++) {
+                for (int row = 0; row < height; row++) {
+                        unsigned char *elem = UArray2_at_fast(arr, col, row);
+                        sum += ++*elem;
+                }
+        }
+        return sum;
+}
+
+unsigned long map_row_major(UArray2_T arr)
+{
+        unsigned long sum = 0;
+        UArray2_map_row_major(arr, touch_elem, &sum);
+        return sum;
+}
+
+unsigned long map_col_major(UArray2_T arr)
+{
+        unsigned long sum = 0;
+        UArray2_map_col_major(arr, touch_elem, &sum);
+        return sum;
+}
+
+unsigned long fold_rows(UArray2_T arr)
+{
+        unsigned long sum = 0;
+        UArray2_fold(arr, 0, 0, UArray2_width(arr), UArray2_height(arr),
+                     sum_span, &sum);
+        return sum;
+}
+
+/********** touch_elem ********
+ *
+ * Use:
+ *      UArray2 map apply function that increments the first byte of an
+ *      element and adds it to the checksum.
+ * Parameters:
+ *      int col, int row: Position of the element (not used).
+ *      UArray2_T arr:    The grid (not used).
+ *      void *elem:       The element.
+ *      void *closure:    Pointer to the unsigned long checksum.
+ * Return:
+ *      None.
+ * Expects:
+ *      None.
+ * Notes:
+ *      None.
+ *
+ ************************/
+void touch_elem(int col, int row, UArray2_T arr, void *elem, void *closure)
+{
+        (void) col;
+        (void) row;
+        (void) arr;
+        *(unsigned long *)closure += ++*(unsigned char *)elem;
+}
+
+/********** sum_span ********
+ *
+ * Use:
+ *      UArray2 fold apply function that adds the first byte of every
+ *      element in a row span to the checksum.
+ * Parameters:
+ *      int col, int row: Position of the first element (not used).
+ *      UArray2_T arr:    The grid.
+ *      void *elems:      The first element of the span.
+ *      int count:        Number of elements in the span.
+ *      void *closure:    Pointer to the unsigned long checksum.
+ * Return:
+ *      None.
+ * Expects:
+ *      None.
+ * Notes:
+ *      None.
+ *
+ ************************/
+void sum_span(int col, int row, UArray2_T arr, void *elems, int count,
+              void *closure)
+{
+        (void) col;
+        (void) row;
+        int size = UArray2_size(arr);
+        const unsigned char *bytes = elems;
+        unsigned long sum = 0;
+        for (int i = 0; i < count; i++) {
+                sum += bytes[(long)i * size];
+        }
+        *(unsigned long *)closure += sum;
+}
+
+/********** int_at_row_major ********
+ *
+ * Use:
+ *      Increments every element of a typed int grid with
+ *      UArray2_int_at_fast, row by row.
+ * Parameters:
+ *      UArray2_int arr: The grid.
+ * Return:
+ *      Sum of the elements after incrementing.
+ * Expects:
+ *      arr is not NULL.
+ * Notes:
+ *      Same work as at_fast_row_major on 4-byte elements, but with the
+ *      element size known to the compiler. The other typed operations
+ *      follow the same pattern.
+ *
+ ************************/
+unsigned long int_at_row_major(UArray2_int arr)
+{
+        unsigned long sum = 0;
+        int width = UArray2_int_width(arr);
+        int height = UArray2_int_height(arr);
+        for (int row = 0; row < height; row++) {
+                for (int col = 0; col < width; col++) {
+                        int *elem = UArray2_int_at_fast(arr, col, row);
+                        sum += ++*elem;
+                }
+        }
+        return sum;
+}
+
+unsigned long int_map_row_major(UArray2_int arr)
+{
+        unsigned long sum = 0;
+        UArray2_int_map_row_major(arr, touch_int, &sum);
+        return sum;
+}
+
+unsigned long int_sum(UArray2_int arr)
+{
+        return UArray2_int_sum(arr, 0, 0, UArray2_int_width(arr),
+                               UArray2_int_height(arr));
+}
+
+unsigned long int_sum_threads(UArray2_int arr)
+{
+        return Fold_int_sum(pool, arr, 0, 0, UArray2_int_width(arr),
+                            UArray2_int_height(arr));
+}
+
+unsigned long int_fill(UArray2_int arr)
+{
+        UArray2_int_fill(arr, (int)sink);
+        return *UArray2_int_at(arr, 0, 0);
+}
+
+/********** touch_int ********
+ *
+ * Use:
+ *      UArray2_int map apply function that increments an element and adds
+ *      it to the checksum.
+ * Parameters:
+ *      int col, int row: Position of the element (not used).
+ *      UArray2_int arr:  The grid (not used).
+ *      int *elem:        The element.
+ *      void *closure:    Pointer to the unsigned long checksum.
+ * Return:
+ *      None.
+ * Expects:
+ *      None.
+ * Notes:
+ *      None.
+ *
+ ************************/
+void touch_int(int col, int row, UArray2_int arr, int *elem, void *closure)
+{
+        (void) col;
+        (void) row;
+        (void) arr;
+        *(unsigned long *)closure += ++*elem;
+}
+
+unsigned long get_row_major(Bit2_T bitmap)
+{
+        unsigned long sum = 0;
+        int width = Bit2_width(bitmap);
+        int height = Bit2_height(bitmap);
+        for (int row = 0; row < height; row++) {
+                for (int col = 0; col < width; col++) {
+                        sum += Bit2_get(bitmap, col, row);
+                }
+        }
+        return sum;
+}
+
+unsigned long get_col_major(Bit2_T bitmap)
+{
+        unsigned long sum = 0;
+        int width = Bit2_width(bitmap);
+        int height = Bit2_height(bitmap);
+        for (int col = 0; col < width; col++) {
+                for (int row = 0; row < height; row++) {
+                        sum += Bit2_get(bitmap, col, row);
+                }
+        }
+        return sum;
+}
+
+unsigned long put_row_major(Bit2_T bitmap)
+{
+        unsigned long sum = 0;
+        int width = Bit2_width(bitmap);
+        int height = Bit2_height(bitmap);
+        for (int row = 0; row < height; row++) {
+                for (int col = 0; col < width; col++) {
+                        sum += Bit2_put(bitmap, col, row, (col ^ row) & 1);
+                }
+        }
+        return sum;
+}
+
+unsigned long get_fast_row_major(Bit2_T bitmap)
+{
+        unsigned long sum = 0;
+        int width = Bit2_width(bitmap);
+        int height = Bit2_height(bitmap);
+        for (int row = 0; row < height; row++) {
+                for (int col = 0; col < width; col++) {
+                        sum += Bit2_get_fast(bitmap, col, row);
+                }
+        }
+        return sum;
+}
+
+unsigned long put_fast_row_major(Bit2_T bitmap)
+{
+        unsigned long sum = 0;
+        int width = Bit2_width(bitmap);
+        int height = Bit2_height(bitmap);
+        for (int row = 0; row < height; row++) {
+                for (int col = 0; col < width; col++) {
+                        sum += Bit2_put_fast(bitmap, col, row,
+                                             (col ^ row) & 1);
+                }
+        }
+        return sum;
+}
+
+unsigned long bit_map_row_major(Bit2_T bitmap)
+{
+        unsigned long sum = 0;
+        Bit2_map_row_major(bitmap, touch_bit, &sum);
+        return sum;
+}
+
+unsigned long bit_map_col_major(Bit2_T bitmap)
+{
+        unsigned long sum = 0;
+        Bit2_map_col_major(bitmap, touch_bit, &sum);
+        return sum;
+}
+
+unsigned long count_bits(Bit2_T bitmap)
+{
+        return Bit2_count(bitmap, 0, 0, Bit2_width(bitmap),
+                          Bit2_height(bitmap));
+}
+
+unsigned long count_bits_threads(Bit2_T bitmap)
+{
+        return Fold_bit2_count(pool, bitmap, 0, 0, Bit2_width(bitmap),
+                               Bit2_height(bitmap));
+}
+
+/********** fill_bands ********
+ *
+ * Use:
+ *      Sets every bit of the bitmap with plain writes, a band of rows per
+ *      pool thread.
+ * Parameters:
+ *      Bit2_T bitmap: The bitmap.
+ * Return:
+ *      Number of bits that were already set.
+ * Expects:
+ *      bitmap is not NULL.
+ * Notes:
+ *      The baseline for the atomic fills below.
+ *
+ ************************/
+unsigned long fill_bands(Bit2_T bitmap)
+{
+        unsigned long sum = 0;
+        Fold_rows(pool, 0, Bit2_height(bitmap), put_band, add_sums, &sum,
+                  sizeof(sum), bitmap);
+        return sum;
+}
+
+/********** fill_test_and_set ********
+ *
+ * Use:
+ *      Sets every bit of the bitmap with Bit2_test_and_set, a band of rows
+ *      per pool thread.
+ * Parameters:
+ *      Bit2_T bitmap: The bitmap.
+ * Return:
+ *      Number of bits that were already set.
+ * Expects:
+ *      bitmap is not NULL.
+ * Notes:
+ *      Bands share no words, so this is the cost of an uncontended atomic
+ *      per bit.
+ *
+ ************************/
+unsigned long fill_test_and_set(Bit2_T bitmap)
+{
+        unsigned long sum = 0;
+        Fold_rows(pool, 0, Bit2_height(bitmap), test_and_set_band, add_sums,
+                  &sum, sizeof(sum), bitmap);
+        return sum;
+}
+
+/********** fill_fetch_or ********
+ *
+ * Use:
+ *      Sets every bit of the bitmap with Bit2_fetch_or, 64 bits at a time,
+ *      a band of rows per pool thread.
+ * Parameters:
+ *      Bit2_T bitmap: The bitmap.
+ * Return:
+ *      Number of bits that were already set.
+ * Expects:
+ *      bitmap is not NULL.
+ * Notes:
+ *      Bands share no words, so this is the cost of an uncontended atomic
+ *      per word.
+ *
+ ************************/
+unsigned long fill_fetch_or(Bit2_T bitmap)
+{
+        unsigned long sum = 0;
+        Fold_rows(pool, 0, Bit2_height(bitmap), fetch_or_band, add_sums,
+                  &sum, sizeof(sum), bitmap);
+        return sum;
+}
+
+/********** fill_shared ********
+ *
+ * Use:
+ *      Sets every bit of the bitmap with Bit2_test_and_set, splitting the
+ *      64 bit positions of each word among the pool threads.
+ * Parameters:
+ *      Bit2_T bitmap: The bitmap.
+ * Return:
+ *      Number of bits that were already set.
+ * Expects:
+ *      bitmap is not NULL.
+ * Notes:
+ *      Every thread sets bits of every word, which is the worst case for a
+ *      shared bitmap such as the visited set of a parallel fill.
+ *
+ ************************/
+unsigned long fill_shared(Bit2_T bitmap)
+{
+        unsigned long sum = 0;
+        Fold_rows(pool, 0, 64, test_and_set_lanes, add_sums, &sum,
+                  sizeof(sum), bitmap);
+        return sum;
+}
+
+/********** put_band ********
+ *
+ * Use:
+ *      Fold_rows band function that sets every bit of a band of rows with
+ *      Bit2_put_fast, adding the old bits to the partial sum.
+ * Parameters:
+ *      int row:       First row of the band.
+ *      int height:    Number of rows in the band.
+ *      void *partial: Pointer to the band's unsigned long sum.
+ *      void *closure: The Bit2_T.
+ * Return:
+ *      None.
+ * Expects:
+ *      None.
+ * Notes:
+ *      Rows start on fresh words, so bands of rows share no words and the
+ *      plain read-modify-writes are safe.
+ *
+ ************************/
+void put_band(int row, int height, void *partial, void *closure)
+{
+        Bit2_T bitmap = closure;
+        unsigned long sum = 0;
+        int width = Bit2_width(bitmap);
+        for (int r = row; r < row + height; r++) {
+                for (int col = 0; col < width; col++) {
+                        sum += Bit2_put_fast(bitmap, col, r, 1);
+                }
+        }
+        *(unsigned long *)partial += sum;
+}
+
+/********** test_and_set_band ********
+ *
+ * Use:
+ *      Fold_rows band function that sets every bit of a band of rows with
+ *      Bit2_test_and_set, adding the old bits to the partial sum.
+ * Parameters:
+ *      int row:       First row of the band.
+ *      int height:    Number of rows in the band.
+ *      void *partial: Pointer to the band's unsigned long sum.
+ *      void *closure: The Bit2_T.
+ * Return:
+ *      None.
+ * Expects:
+ *      None.
+ * Notes:
+ *      Uses BIT2_RELAXED: only the bits are shared, and the end of
+ *      Fold_rows orders everything else.
+ *
+ ************************/
+void test_and_set_band(int row, int height, void *partial, void *closure)
+{
+        Bit2_T bitmap = closure;
+        unsigned long sum = 0;
+        int width = Bit2_width(bitmap);
+        for (int r = row; r < row + height; r++) {
+                for (int col = 0; col < width; col++) {
+                        sum += Bit2_test_and_set(bitmap, col, r,
+                                                 BIT2_RELAXED);
+                }
+        }
+        *(unsigned long *)partial += sum;
+}
+
+/********** fetch_or_band ********
+ *
+ * Use:
+ *      Fold_rows band function that sets every bit of a band of rows with
+ *      one Bit2_fetch_or per 64 columns, adding the number of old bits
+ *      that were set to the partial sum.
+ * Parameters:
+ *      int row:       First row of the band.
+ *      int height:    Number of rows in the band.
+ *      void *partial: Pointer to the band's unsigned long sum.
+ *      void *closure: The Bit2_T.
+ * Return:
+ *      None.
+ * Expects:
+ *      None.
+ * Notes:
+ *      Uses BIT2_RELAXED, as test_and_set_band does, and Bit2_count_word
+ *      to count the old bits.
+ *
+ ************************/
+void fetch_or_band(int row, int height, void *partial, void *closure)
+{
+        Bit2_T bitmap = closure;
+        unsigned long sum = 0;
+        int width = Bit2_width(bitmap);
+        for (int r = row; r < row + height; r++) {
+                for (int col = 0; col < width; col += 64) {
+                        uint64_t bits = width - col >= 64
+                                        ? ~(uint64_t)0
+                                        : ((uint64_t)1 << (width - col)) - 1;
+                        sum += Bit2_count_word(Bit2_fetch_or(bitmap, col, r,
+                                                             bits,
+                                                             BIT2_RELAXED));
+                }
+        }
+        *(unsigned long *)partial += sum;
+}
+
+/********** test_and_set_lanes ********
+ *
+ * Use:
+ *      Fold_rows band function that sets, in every row, the bits whose
+ *      position within their word falls in a range of lanes, adding the
+ *      old bits to the partial sum.
+ * Parameters:
+ *      int lane:      First bit position of the range.
+ *      int nlanes:    Number of bit positions in the range.
+ *      void *partial: Pointer to the band's unsigned long sum.
+ *      void *closure: The Bit2_T.
+ * Return:
+ *      None.
+ * Expects:
+ *      None.
+ * Notes:
+ *      Uses BIT2_ACQ_REL, as a parallel fill whose threads act on each
+ *      other's visited bits would need. On x86 both orderings compile to
+ *      the same locked instruction.
+ *
+ ************************/
+void test_and_set_lanes(int lane, int nlanes, void *partial, void *closure)
+{
+        Bit2_T bitmap = closure;
+        unsigned long sum = 0;
+        int width = Bit2_width(bitmap);
+        int height = Bit2_height(bitmap);
+        for (int r = 0; r < height; r++) {
+                for (int base = 0; base < width; base += 64) {
+                        for (int col = base + lane;
+                             col < base + lane + nlanes && col < width;
+                             col++) {
+                                sum += Bit2_test_and_set(bitmap, col, r,
+                                                         BIT2_ACQ_REL);
+                        }
+                }
+        }
+        *(unsigned long *)partial += sum;
+}
+
+/********** add_sums ********
+ *
+ * Use:
+ *      Fold_rows combine function that adds a band's unsigned long sum to
+ *      the total.
+ * Parameters:
+ *      void *acc:           Pointer to the total.
+ *      const void *partial: Pointer to the band's sum.
+ *      void *closure:       Not used.
+ * Return:
+ *      None.
+ * Expects:
+ *      None.
+ * Notes:
+ *      None.
+ *
+ ************************/
+void add_sums(void *acc, const void *partial, void *closure)
+{
+        (void) closure;
+        *(unsigned long *)acc += *(const unsigned long *)partial;
+}
+
+/********** touch_bit ********
+ *
+ * Use:
+ *      Bit2 map apply function that adds a bit to the checksum.
+ * Parameters:
+ *      int col, int row: Position of the bit (not used).
+ *      Bit2_T bitmap:    The bitmap (not used).
+ *      int bit:          The bit.
+ *      void *closure:    Pointer to the unsigned long checksum.
+ * Return:
+ *      None.
+ * Expects:
+ *      None.
+ * Notes:
+ *      None.
+ *
+ ************************/
+void touch_bit(int col, int row, Bit2_T bitmap, int bit, void *closure)
+{
+        (void) col;
+        (void) row;
+        (void) bitmap;
+        *(unsigned long *)closure += bit;
+}
+
+unsigned long sparse_get_row_major(Sparse2_T bitmap)
+{
+        unsigned long sum = 0;
+        int width = Sparse2_width(bitmap);
+        int height = Sparse2_height(bitmap);
+        for (int row = 0; row < height; row++) {
+                for (int col = 0; col < width; col++) {
+                        sum += Sparse2_get(bitmap, col, row);
+                }
+        }
+        return sum;
+}
+
+unsigned long sparse_count(Sparse2_T bitmap)
+{
+        return Sparse2_count(bitmap);
+}
+
+unsigned long sparse_map_set(Sparse2_T bitmap)
+{
+        unsigned long sum = 0;
+        Sparse2_map_set(bitmap, touch_set, &sum);
+        return sum;
+}
+
+unsigned long sparse_and_self(Sparse2_T bitmap)
+{
+        Sparse2_T both = Sparse2_and(bitmap, bitmap);
+        unsigned long sum = Sparse2_count(both);
+        Sparse2_free(&both);
+        return sum;
+}
+
+unsigned long rank_build(Bit2_T bitmap)
+{
+        Rank2_T index = Rank2_new(bitmap);
+        unsigned long sum = Rank2_count(index);
+        Rank2_free(&index);
+        return sum;
+}
+
+unsigned long scan_get(Bit2_T bitmap)
+{
+        unsigned long sum = 0;
+        int width = Bit2_width(bitmap);
+        int height = Bit2_height(bitmap);
+        for (int row = 0; row < height; row++) {
+                for (int col = 0; col < width; col++) {
+                        if (Bit2_get_fast(bitmap, col, row)) {
+                                sum += col ^ row;
+                        }
+                }
+        }
+        return sum;
+}
+
+unsigned long rank_scan_next(Rank2_T index)
+{
+        unsigned long sum = 0;
+        int width = Bit2_width(Rank2_bitmap(index));
+        int height = Bit2_height(Rank2_bitmap(index));
+        int col = 0;
+        int row = 0;
+        while (row < height && Rank2_next(index, col, row, &col, &row)) {
+                sum += col ^ row;
+                if (++col == width) {
+                        col = 0;
+                        row++;
+                }
+        }
+        return sum;
+}
+
+unsigned long rank_rows(Rank2_T index)
+{
+        unsigned long sum = 0;
+        int height = Bit2_height(Rank2_bitmap(index));
+        for (int row = 0; row < height; row++) {
+                sum += Rank2_rank(index, 0, row);
+        }
+        return sum;
+}
+
+unsigned long rank_select(Rank2_T index)
+{
+        unsigned long sum = 0;
+        long count = Rank2_count(index);
+        for (long rank = 0; rank < count; rank++) {
+                int col;
+                int row;
+                Rank2_select(index, rank, &col, &row);
+                sum += col ^ row;
+        }
+        return sum;
+}
+
+unsigned long dilate_square(Bit2_T bitmap)
+{
+        Morph2_dilate(bitmap, morph_dst, MORPH2_SQUARE);
+        return morph_dst->words[0];
+}
+
+unsigned long dilate_get(Bit2_T bitmap)
+{
+        Bit2_map_row_major(bitmap, dilate_pixel, morph_dst);
+        return morph_dst->words[0];
+}
+
+unsigned long erode_cross(Bit2_T bitmap)
+{
+        Morph2_erode(bitmap, morph_dst, MORPH2_CROSS);
+        return morph_dst->words[0];
+}
+
+unsigned long open_rect(Bit2_T bitmap)
+{
+        Morph2_open(bitmap, morph_dst, MORPH2_RECT(15, 15));
+        return morph_dst->words[0];
+}
+
+unsigned long majority(Bit2_T bitmap)
+{
+        Morph2_neighbors(bitmap, morph_dst, 8, 5);
+        return morph_dst->words[0];
+}
+
+unsigned long label4(Bit2_T bitmap)
+{
+        Label2_T labels = Label2_from_bit2(bitmap, 4);
+        unsigned long sum = Label2_count(labels);
+        Label2_free(&labels);
+        return sum;
+}
+
+unsigned long label8(Bit2_T bitmap)
+{
+        Label2_T labels = Label2_from_bit2(bitmap, 8);
+        unsigned long sum = Label2_count(labels);
+        Label2_free(&labels);
+        return sum;
+}
+
+unsigned long label_grid(Bit2_T bitmap)
+{
+        Label2_T labels = Label2_from_bit2(bitmap, 4);
+        UArray2_int grid = Label2_grid(labels);
+        unsigned long sum = *UArray2_int_at(grid, 0, 0);
+        UArray2_int_free(&grid);
+        Label2_free(&labels);
+        return sum;
+}
+
+unsigned long remove_specks(Bit2_T bitmap)
+{
+        long min_area = 4;
+        Label2_T labels = Label2_from_bit2(bitmap, 8);
+        Rle2_T kept = Label2_filter(labels, Label2_at_least, &min_area);
+        unsigned long sum = Rle2_nruns(kept);
+        Rle2_free(&kept);
+        Label2_free(&labels);
+        return sum;
+}
+
+/********** dilate_pixel ********
+ *
+ * Use:
+ *      Bit2 map apply function that dilates one pixel by the 3x3 square.
+ * Parameters:
+ *      int col, int row: Position of the pixel.
+ *      Bit2_T bitmap:    The source bitmap.
+ *      int bit:          The pixel (not used).
+ *      void *closure:    The destination Bit2_T.
+ * Return:
+ *      None.
+ * Expects:
+ *      None.
+ * Notes:
+ *      Reads the nine pixels with Bit2_get, as code without Morph2 must.
+ *
+ ************************/
+void dilate_pixel(int col, int row, Bit2_T bitmap, int bit, void *closure)
+{
+        (void) bit;
+        int any = 0;
+        for (int r = row - 1; r <= row + 1; r++) {
+                for (int c = col - 1; c <= col + 1; c++) {
+                        if (r >= 0 && r < bitmap->height && c >= 0 &&
+                            c < bitmap->width) {
+                                any |= Bit2_get(bitmap, c, r);
+                        }
+                }
+        }
+        Bit2_put(closure, col, row, any);
+}
+
+/********** touch_set ********
+ *
+ * Use:
+ *      Sparse2_map_set apply function that adds a position to the checksum.
+ * Parameters:
+ *      int col, int row: Position of a 1 bit.
+ *      void *closure:    Pointer to the unsigned long checksum.
+ * Return:
+ *      None.
+ * Expects:
+ *      None.
+ * Notes:
+ *      None.
+ *
+ ************************/
+void touch_set(int col, int row, void *closure)
+{
+        *(unsigned long *)closure += col ^ row;
+}
+
+/********** parse_bytes ********
+ *
+ * Use:
+ *      Parses a byte count with an optional K, M or G suffix.
+ * Parameters:
+ *      const char *text: The count.
+ * Return:
+ *      The number of bytes, or 0 if text is not a count.
+ * Expects:
+ *      text is not NULL.
+ * Notes:
+ *      Suffixes are powers of 1024.
+ *
+ ************************/
+static long parse_bytes(const char *text)
+{
+        char *end;
+        long bytes = strtol(text, &end, 10);
+        switch (*end) {
+        case 'G': case 'g':
+                bytes *= KIB;
+                /* FALLTHROUGH */
+        case 'M': case 'm':
+                bytes *= KIB;
+                /* FALLTHROUGH */
+        case 'K': case 'k':
+                bytes *= KIB;
+                end++;
+                break;
+        default:
+                break;
+        }
+        return (*end == '\0' && bytes > 0) ? bytes : 0;
+}
+
+/********** parse_pages ********
+ *
+ * Use:
+ *      Parses the argument of -p.
+ * Parameters:
+ *      const char *text: Comma-separated list of thp, hugetlb, interleave
+ *                        and spread.
+ * Return:
+ *      The PAGES_ flags named, or 0 if any name is unknown.
+ * Expects:
+ *      text is not NULL.
+ * Notes:
+ *      None.
+ *
+ ************************/
+static int parse_pages(const char *text)
+{
+        static const struct {
+                const char *name;
+                int flag;
+        } NAMES[] = {
+                { "thp", PAGES_THP }, { "hugetlb", PAGES_HUGETLB },
+                { "interleave", PAGES_INTERLEAVE }, { "spread", PAGES_SPREAD }
+        };
+        int nnames = sizeof(NAMES) / sizeof(NAMES[0]);
+        int flags = 0;
+        while (*text != '\0') {
+                size_t length = strcspn(text, ",");
+                int flag = 0;
+                for (int i = 0; i < nnames; i++) {
+                        if (strlen(NAMES[i].name) == length &&
+                            strncmp(text, NAMES[i].name, length) == 0) {
+                                flag = NAMES[i].flag;
+                        }
+                }
+                if (flag == 0) {
+                        return 0;
+                }
+                flags |= flag;
+                text += length;
+                if (*text == ',') {
+                        text++;
+                }
+        }
+        return flags;
+}
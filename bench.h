@@ -0,0 +1,137 @@
+/*
+ *     bench.h
+ *     by nozden01 & bdioni01, 2/12/2024
+ *     iii
+ *
+ *     Contains struct and function declarations for the benchmark program.
+ *     Includes libraries and files necessary for this program to function.
+ */
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+#include "uarray2.h"
+#include "uarray2t.h"
+#include "fold.h"
+#include "gridfile.h"
+#include "timing.h"
+#include "pages.h"
+#include "bit2.h"
+#include "sparse2.h"
+#include "rank2.h"
+#include "morph2.h"
+#include "label2.h"
+
+/* One timed operation over a grid; returns a checksum of what it touched
+ * so that the work cannot be optimized away. */
+typedef struct Bench_op {
+        const char *name;
+        unsigned long (*uarray2)(UArray2_T arr);
+        unsigned long (*bit2)(Bit2_T bitmap);
+        unsigned long (*uarray2_int)(UArray2_int arr);
+        unsigned long (*sparse2)(Sparse2_T bitmap);
+        unsigned long (*rank2)(Rank2_T index);
+} Bench_op;
+
+/* Options shared by every measurement. */
+typedef struct Bench_config {
+        int reps;
+        long max_bytes;
+        bool json;
+        const char *label;
+        FILE *out;
+        int printed;
+        int pages;
+} *Bench_config;
+
+/* Summary of the samples of one operation on one grid, in nanoseconds per
+ * element. */
+typedef struct Bench_result {
+        const char *op;
+        int width;
+        int height;
+        int elem_bits;
+        long bytes;
+        long inner;
+        double median;
+        double p99;
+        double min;
+} Bench_result;
+
+void bench_uarray2(Bench_config config, long bytes, int size);
+void bench_uarray2_int(Bench_config config, long bytes);
+void bench_bit2(Bench_config config, long bytes);
+void bench_bit2_mapped(Bench_config config, Bit2_T bitmap, long bytes);
+void bench_sparse2(Bench_config config, long bytes);
+void bench_rank2(Bench_config config, long bytes);
+void bench_morph2(Bench_config config, long bytes);
+void bench_label2(Bench_config config, long bytes);
+unsigned long run_op(const Bench_op *op, void *grid);
+Bench_result measure(Bench_config config, const Bench_op *op, void *grid,
+                     long elems);
+void print_result(Bench_config config, const Bench_result *result);
+
+unsigned long at_row_major(UArray2_T arr);
+unsigned long at_col_major(UArray2_T arr);
+unsigned long at_fast_row_major(UArray2_T arr);
+unsigned long at_fast_col_major(UArray2_T arr);
+unsigned long map_row_major(UArray2_T arr);
+unsigned long map_col_major(UArray2_T arr);
+unsigned long fold_rows(UArray2_T arr);
+void touch_elem(int col, int row, UArray2_T arr, void *elem, void *closure);
+void sum_span(int col, int row, UArray2_T arr, void *elems, int count,
+              void *closure);
+
+unsigned long int_at_row_major(UArray2_int arr);
+unsigned long int_map_row_major(UArray2_int arr);
+unsigned long int_sum(UArray2_int arr);
+unsigned long int_sum_threads(UArray2_int arr);
+unsigned long int_fill(UArray2_int arr);
+void touch_int(int col, int row, UArray2_int arr, int *elem, void *closure);
+
+unsigned long get_row_major(Bit2_T bitmap);
+unsigned long get_col_major(Bit2_T bitmap);
+unsigned long put_row_major(Bit2_T bitmap);
+unsigned long get_fast_row_major(Bit2_T bitmap);
+unsigned long put_fast_row_major(Bit2_T bitmap);
+unsigned long bit_map_row_major(Bit2_T bitmap);
+unsigned long bit_map_col_major(Bit2_T bitmap);
+unsigned long count_bits(Bit2_T bitmap);
+unsigned long count_bits_threads(Bit2_T bitmap);
+void touch_bit(int col, int row, Bit2_T bitmap, int bit, void *closure);
+unsigned long fill_bands(Bit2_T bitmap);
+unsigned long fill_test_and_set(Bit2_T bitmap);
+unsigned long fill_fetch_or(Bit2_T bitmap);
+unsigned long fill_shared(Bit2_T bitmap);
+void put_band(int row, int height, void *partial, void *closure);
+void test_and_set_band(int row, int height, void *partial, void *closure);
+void fetch_or_band(int row, int height, void *partial, void *closure);
+void test_and_set_lanes(int lane, int nlanes, void *partial, void *closure);
+void add_sums(void *acc, const void *partial, void *closure);
+
+unsigned long sparse_get_row_major(Sparse2_T bitmap);
+unsigned long sparse_count(Sparse2_T bitmap);
+unsigned long sparse_map_set(Sparse2_T bitmap);
+unsigned long sparse_and_self(Sparse2_T bitmap);
+void touch_set(int col, int row, void *closure);
+
+unsigned long rank_build(Bit2_T bitmap);
+unsigned long scan_get(Bit2_T bitmap);
+unsigned long rank_scan_next(Rank2_T index);
+unsigned long rank_rows(Rank2_T index);
+unsigned long rank_select(Rank2_T index);
+
+unsigned long dilate_square(Bit2_T bitmap);
+unsigned long dilate_get(Bit2_T bitmap);
+unsigned long erode_cross(Bit2_T bitmap);
+unsigned long open_rect(Bit2_T bitmap);
+unsigned long majority(Bit2_T bitmap);
+void dilate_pixel(int col, int row, Bit2_T bitmap, int bit, void *closure);
+
+unsigned long label4(Bit2_T bitmap);
+unsigned long label8(Bit2_T bitmap);
+unsigned long label_grid(Bit2_T bitmap);
+unsigned long remove_specks(Bit2_T bitmap);
@@ -0,0 +1,270 @@
+/*
+ *     bench_run.c
+ *     by nozden01 & bdioni01, 2/12/2024
+ *     iii
+ *
+ *     Function implementations for the bench_run program.
+ *     Runs every job of a manifest written by gencorpus several times and
+ *     prints its wall time, throughput and peak memory, so that a change to
+ *     unblackedges or sudoku can be measured end to end on the same inputs.
+ *
+ *     Usage: bench_run [-r reps] [-f json|csv] [-l label] [-o output]
+ *                      manifest
+ *            -r reps    runs of every job, 5 by default
+ *            -f format  output format, json (the default) or csv
+ *            -l label   label copied into every record
+ *            -o output  file to write to instead of stdout
+ *
+ *     A manifest line is "name input command [args ...]"; blank lines and
+ *     lines starting with '#' are skipped. The command runs with the input
+ *     on stdin and its stdout and stderr discarded. Throughput is the input
+ *     size over the median wall time, in MB/s (10^6 bytes), and peak RSS is
+ *     the largest resident size of any run, in kilobytes.
+ */
+
+#define _DEFAULT_SOURCE
+
+#include "bench_run.h"
+
+#define LINE_BYTES 4096
+
+/********** main ********
+ *
+ * Use:
+ *      Runs the bench_run program.
+ * Parameters:
+ *      int argc:     The number of arguments on the command line.
+ *      char *argv[]: Pointer to an array of arguments from the command line.
+ * Return:
+ *      EXIT_SUCCESS if every job could be started, EXIT_FAILURE otherwise.
+ * Expects:
+ *      Valid options and a manifest (prints usage and returns EXIT_FAILURE
+ *      if not).
+ * Notes:
+ *      A job that exits with a failure status is still measured; the
+ *      status is part of its record, since sudoku fails on invalid boards
+ *      by design.
+ *
+ ************************/
+int main(int argc, char *argv[])
+{
+        struct Run_config config = { 5, true, "", stdout, 0 };
+        const char *output = NULL;
+        const char *path = NULL;
+        bool ok = true;
+        for (int i = 1; i < argc && ok; i++) {
+                if (argv[i][0] != '-') {
+                        ok = path == NULL;
+                        path = argv[i];
+                } else if (i + 1 >= argc) {
+                        ok = false;
+                } else if (strcmp(argv[i], "-r") == 0) {
+                        config.reps = atoi(argv[++i]);
+                } else if (strcmp(argv[i], "-f") == 0) {
+                        config.json = strcmp(argv[++i], "json") == 0;
+                        ok = config.json || strcmp(argv[i], "csv") == 0;
+                } else if (strcmp(argv[i], "-l") == 0) {
+                        config.label = argv[++i];
+                } else if (strcmp(argv[i], "-o") == 0) {
+                        output = argv[++i];
+                } else {
+                        ok = false;
+                }
+        }
+        if (!ok || path == NULL || config.reps < 1) {
+                fprintf(stderr, "Usage: %s [-r reps] [-f json|csv] "
+                        "[-l label] [-o output] manifest\n", argv[0]);
+                return EXIT_FAILURE;
+        }
+        FILE *manifest = fopen(path, "r");
+        if (manifest == NULL) {
+                fprintf(stderr, "%s: cannot read %s\n", argv[0], path);
+                return EXIT_FAILURE;
+        }
+        if (output != NULL) {
+                config.out = fopen(output, "w");
+                if (config.out == NULL) {
+                        fprintf(stderr, "%s: cannot write %s\n", argv[0],
+                                output);
+                        fclose(manifest);
+                        return EXIT_FAILURE;
+                }
+        }
+
+        if (config.json) {
+                fprintf(config.out, "[\n");
+        } else {
+                fprintf(config.out, "label,name,input_bytes,reps,status,"
+                        "median_s,p99_s,min_s,cpu_s,mb_per_s,"
+                        "peak_rss_kb\n");
+        }
+        char line[LINE_BYTES];
+        while (fgets(line, sizeof(line), manifest) != NULL) {
+                Job job;
+                if (parse_job(line, &job)) {
+                        run_job(&config, &job);
+                }
+        }
+        if (config.json) {
+                fprintf(config.out, "\n]\n");
+        }
+        fclose(manifest);
+        if (output != NULL) {
+                fclose(config.out);
+        }
+        return EXIT_SUCCESS;
+}
+
+/********** parse_job ********
+ *
+ * Use:
+ *      Splits a manifest line into a job.
+ * Parameters:
+ *      char *line: The line; split in place.
+ *      Job *job:   Receives pointers into line.
+ * Return:
+ *      True if the line holds a job, false if it is blank, a comment, or
+ *      too short.
+ * Expects:
+ *      line and job are not NULL.
+ * Notes:
+ *      Fields are separated by whitespace; there is no quoting. Words
+ *      beyond MAX_ARGS are dropped.
+ *
+ ************************/
+bool parse_job(char *line, Job *job)
+{
+        const char *SEPARATORS = " \t\r\n";
+        job->name = strtok(line, SEPARATORS);
+        if (job->name == NULL || job->name[0] == '#') {
+                return false;
+        }
+        job->input = strtok(NULL, SEPARATORS);
+        int n = 0;
+        char *word;
+        while (n < MAX_ARGS && (word = strtok(NULL, SEPARATORS)) != NULL) {
+                job->argv[n++] = word;
+        }
+        job->argv[n] = NULL;
+        return job->input != NULL && n > 0;
+}
+
+/********** run_job ********
+ *
+ * Use:
+ *      Runs a job config->reps times and prints its record.
+ * Parameters:
+ *      Run_config config: The options.
+ *      const Job *job:    The job.
+ * Return:
+ *      None.
+ * Expects:
+ *      config and job are not NULL.
+ * Notes:
+ *      A job whose input is missing or whose command cannot be started is
+ *      reported on stderr and skipped.
+ *
+ ************************/
+void run_job(Run_config config, const Job *job)
+{
+        struct stat info;
+        if (stat(job->input, &info) != 0) {
+                fprintf(stderr, "bench_run: %s: cannot read %s\n", job->name,
+                        job->input);
+                return;
+        }
+        double *walls = CALLOC(config->reps, sizeof(double));
+        double cpu = 0;
+        long peak = 0;
+        int status = 0;
+        for (int r = 0; r < config->reps; r++) {
+                Sample sample;
+                if (!run_once(job, &sample)) {
+                        fprintf(stderr, "bench_run: %s: cannot run %s\n",
+                                job->name, job->argv[0]);
+                        FREE(walls);
+                        return;
+                }
+                walls[r] = sample.wall;
+                cpu += sample.cpu;
+                peak = sample.max_rss_kb > peak ? sample.max_rss_kb : peak;
+                status = sample.status;
+        }
+        qsort(walls, config->reps, sizeof(double), compare_doubles);
+        double median = walls[config->reps / 2];
+        double p99 = walls[(99 * config->reps + 99) / 100 - 1];
+        double rate = median > 0 ? info.st_size / median / 1e6 : 0;
+        cpu /= config->reps;
+
+        if (config->json) {
+                fprintf(config->out, "%s  {\"label\": \"%s\", \"name\": "
+                        "\"%s\", \"input_bytes\": %lld, \"reps\": %d, "
+                        "\"status\": %d, \"median_s\": %.6f, \"p99_s\": %.6f, "
+                        "\"min_s\": %.6f, \"cpu_s\": %.6f, \"mb_per_s\": "
+                        "%.3f, \"peak_rss_kb\": %ld}",
+                        config->printed > 0 ? ",\n" : "", config->label,
+                        job->name, (long long)info.st_size, config->reps,
+                        status, median, p99, walls[0], cpu, rate, peak);
+        } else {
+                fprintf(config->out, "%s,%s,%lld,%d,%d,%.6f,%.6f,%.6f,%.6f,"
+                        "%.3f,%ld\n", config->label, job->name,
+                        (long long)info.st_size, config->reps, status,
+                        median, p99, walls[0], cpu, rate, peak);
+        }
+        config->printed++;
+        fflush(config->out);
+        FREE(walls);
+}
+
+/********** run_once ********
+ *
+ * Use:
+ *      Runs a job once and measures it.
+ * Parameters:
+ *      const Job *job: The job.
+ *      Sample *sample: Receives the measurements.
+ * Return:
+ *      True if the command ran, false if it could not be started.
+ * Expects:
+ *      job and sample are not NULL.
+ * Notes:
+ *      The resource usage comes from wait4, so it covers this child only.
+ *      A child that cannot exec exits with status 127, which is reported as
+ *      a failure to start.
+ *
+ ************************/
+bool run_once(const Job *job, Sample *sample)
+{
+        double start = seconds();
+        pid_t pid = fork();
+        if (pid < 0) {
+                return false;
+        }
+        if (pid == 0) {
+                int input = open(job->input, O_RDONLY);
+                int sink = open("/dev/null", O_WRONLY);
+                if (input < 0 || sink < 0) {
+                        _exit(127);
+                }
+                dup2(input, STDIN_FILENO);
+                dup2(sink, STDOUT_FILENO);
+                dup2(sink, STDERR_FILENO);
+                close(input);
+                close(sink);
+                execvp(job->argv[0], job->argv);
+                _exit(127);
+        }
+
+        int status;
+        struct rusage usage;
+        if (wait4(pid, &status, 0, &usage) != pid) {
+                return false;
+        }
+        sample->wall = seconds() - start;
+        sample->cpu = usage.ru_utime.tv_sec + usage.ru_stime.tv_sec +
+                      (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) * 1e-6;
+        sample->max_rss_kb = usage.ru_maxrss;
+        sample->status = WIFEXITED(status) ? WEXITSTATUS(status)
+                                           : 128 + WTERMSIG(status);
+        return sample->status != 127;
+}
@@ -0,0 +1,52 @@
+/*
+ *     bench_run.h
+ *     by nozden01 & bdioni01, 2/12/2024
+ *     iii
+ *
+ *     Contains struct and function declarations for the bench_run program.
+ *     Includes libraries and files necessary for this program to function.
+ */
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include "mem.h"
+#include "timing.h"
+
+#define MAX_ARGS 64
+
+/* One manifest line: a name, the file fed to stdin, and the command. */
+typedef struct Job {
+        char *name;
+        char *input;
+        char *argv[MAX_ARGS + 1];
+} Job;
+
+/* Options shared by every job. */
+typedef struct Run_config {
+        int reps;
+        bool json;
+        const char *label;
+        FILE *out;
+        int printed;
+} *Run_config;
+
+/* Measurements of one run of a job. */
+typedef struct Sample {
+        double wall;
+        double cpu;
+        long max_rss_kb;
+        int status;
+} Sample;
+
+bool parse_job(char *line, Job *job);
+bool run_once(const Job *job, Sample *sample);
+void run_job(Run_config config, const Job *job);
@@ -8,6 +8,11 @@
 
 #include "bit2.h"
 
+static uint64_t fetch_or_word(uint64_t *word, uint64_t bits,
+                              Bit2_order order);
+static uint64_t fetch_and_word(uint64_t *word, uint64_t bits,
+                               Bit2_order order);
+
 /************** Bit2_width ************
  *
  * Use:
@@ -26,7 +31,7 @@
 int Bit2_width(Bit2_T bitmap) 
 {    
         assert(bitmap != NULL);
-        return bitmap->columns;
+        return bitmap->width;
 }
 
 /************** Bit2_height ************
@@ -47,7 +52,7 @@ int Bit2_width(Bit2_T bitmap)
 int Bit2_height(Bit2_T bitmap) 
 {
         assert(bitmap != NULL);
-        return bitmap->rows;
+        return bitmap->height;
 }
 
 /************** Bit2_new ************
@@ -78,12 +83,103 @@ Bit2_T Bit2_new(int col, int row)
         /* Checking for successful memory allocation. */
         assert(Bit2 != NULL);
 
-        Bit2->rows = row;
-        Bit2->columns = col;
-        Bit2->bitarr2 = Bit_new(row * col);
+        Bit2->width = col;
+        Bit2->height = row;
+        Bit2->words_per_row = ((long)col + 63) / 64;
+        Bit2->offset = 0;
+        Bit2->words = NULL;
+        if (col > 0 && row > 0) {
+                Bit2->words = CALLOC(row, Bit2->words_per_row *
+                                          sizeof(uint64_t));
+        }
         return Bit2;
 }
 
+/************** Bit2_init ************
+ *
+ * Use:
+ *      Builds a 2D bitmap in caller-provided storage, taking the memory for
+ *      its bits from the given allocation function, so that bitmaps can
+ *      live in a region or any other allocator.
+ * Parameters:
+ *      struct Bit2_T *storage: Storage for the bitmap itself.
+ *      int col:                Width of the bitmap.
+ *      int row:                Height of the bitmap.
+ *      void *alloc(long nbytes, void *closure):
+ *                              Returns nbytes of zeroed memory, aligned for
+ *                              uint64_t.
+ *      void *closure:          The closure argument passed to alloc.
+ * Return:
+ *      The bitmap, which is storage.
+ * Expects:
+ *      storage and alloc are not NULL (throws a CRE if not).
+ *      col >= 0 and row >= 0 (throws a CRE if not).
+ * Notes:
+ *      alloc is called once, and not at all for an empty bitmap. The
+ *      bitmap is released along with the memory alloc gave it, and must
+ *      not be passed to Bit2_free.
+ *
+ ************************/
+Bit2_T Bit2_init(struct Bit2_T *storage, int col, int row,
+                 void *alloc(long nbytes, void *closure), void *closure)
+{
+        assert((storage != NULL) && (alloc != NULL));
+        assert((col >= 0) && (row >= 0));
+        storage->width = col;
+        storage->height = row;
+        storage->words_per_row = ((long)col + 63) / 64;
+        storage->offset = 0;
+        storage->words = NULL;
+        if (col > 0 && row > 0) {
+                storage->words = alloc(row * storage->words_per_row *
+                                       (long)sizeof(uint64_t), closure);
+        }
+        return storage;
+}
+
+/************** Bit2_view ************
+ *
+ * Use:
+ *      Makes a view of a rectangle of the given 2D bitmap. The view shares
+ *      the parent's bits: it is indexed from (0, 0) at the rectangle's
+ *      top-left corner, and every Bit2 function except Bit2_free works on
+ *      it, with gets and puts going straight to the parent.
+ * Parameters:
+ *      Bit2_T parent:          Bitmap (or view) being viewed.
+ *      int col, int row:       Top-left corner of the rectangle.
+ *      int width, int height:  Size of the rectangle.
+ *      struct Bit2_T *storage: Caller-provided storage for the view, for
+ *                              example a local variable.
+ * Return:
+ *      The view, which is storage.
+ * Expects:
+ *      That parent and storage are not NULL (throws a CRE if not).
+ *      That the rectangle lies within the parent (throws a CRE if not).
+ * Notes:
+ *      Allocates nothing and copies no bits. The view is valid only while
+ *      the parent is, and must not be passed to Bit2_free.
+ *
+ ************************/
+Bit2_T Bit2_view(Bit2_T parent, int col, int row, int width, int height,
+                 struct Bit2_T *storage)
+{
+        assert((parent != NULL) && (storage != NULL));
+        assert((col >= 0) && (row >= 0) && (width >= 0) && (height >= 0));
+        assert(((long)col + width <= parent->width) &&
+               ((long)row + height <= parent->height));
+        long bitcol = (long)col + parent->offset;
+        storage->width = width;
+        storage->height = height;
+        storage->words_per_row = parent->words_per_row;
+        storage->offset = (int)(bitcol % 64);
+        storage->words = NULL;
+        if (width > 0 && height > 0) {
+                storage->words = parent->words +
+                                 row * parent->words_per_row + bitcol / 64;
+        }
+        return storage;
+}
+
 /************** Bit2_put ************
  *
  * Use:
@@ -100,8 +196,8 @@ Bit2_T Bit2_new(int col, int row)
  *      Integer representing the value of the replaced bit.
  * Expects:
  *      That bitmap is not NULL (throws a CRE if not).
- *      col >= 0 (throws a CRE if not).
- *      row >= 0 (throws a CRE if not).
+ *      0 <= col < width (throws a CRE if not).
+ *      0 <= row < height (throws a CRE if not).
  *      bit == 1 or bit == 0 (throws a CRE if not).
  *      That the bitmap has been properly initialized.
  * Notes:
@@ -112,8 +208,15 @@ int Bit2_put(Bit2_T bitmap, int col, int row, int bit)
 {
         assert(bitmap != NULL);
         assert((col >= 0) && (row >= 0));
+        assert((col < bitmap->width) && (row < bitmap->height));
         assert((bit == 1) || (bit == 0));
-        return Bit_put(bitmap->bitarr2, (bitmap->columns) * (row) + col, bit);
+        long bitcol = (long)col + bitmap->offset;
+        uint64_t *word = &bitmap->words[row * bitmap->words_per_row +
+                                        bitcol / 64];
+        int old = (int)((*word >> (bitcol % 64)) & 1);
+        *word = (*word & ~((uint64_t)1 << (bitcol % 64))) |
+                ((uint64_t)bit << (bitcol % 64));
+        return old;
 }
 
 /************** Bit2_get ************
@@ -131,8 +234,8 @@ int Bit2_put(Bit2_T bitmap, int col, int row, int bit)
  *      Integer representing a bit value.
  * Expects:
  *      That bitmap is not NULL (throws a CRE if not).
- *      col >= 0 (throws a CRE if not).
- *      row >= 0 (throws a CRE if not).
+ *      0 <= col < width (throws a CRE if not).
+ *      0 <= row < height (throws a CRE if not).
  *      That the bitmap has been properly initialized.
  * Notes:
  *      None.
@@ -142,7 +245,149 @@ int Bit2_get(Bit2_T bitmap, int col, int row)
 {
         assert(bitmap != NULL);
         assert((col >= 0) && (row >= 0));
-        return Bit_get(bitmap->bitarr2, (bitmap->columns) * (row) + col);
+        assert((col < bitmap->width) && (row < bitmap->height));
+        long bitcol = (long)col + bitmap->offset;
+        uint64_t word = bitmap->words[row * bitmap->words_per_row +
+                                      bitcol / 64];
+        return (int)((word >> (bitcol % 64)) & 1);
+}
+
+/************** Bit2_test_and_set ************
+ *
+ * Use:
+ *      Atomically sets one bit of the given bitmap to 1 and returns the bit
+ *      it replaced, so that of several threads setting the same bit, only
+ *      one sees 0.
+ * Parameters:
+ *      Bit2_T bitmap:    Bitmap whose bit is set.
+ *      int col:          Column index of the bit.
+ *      int row:          Row index of the bit.
+ *      Bit2_order order: BIT2_RELAXED or BIT2_ACQ_REL.
+ * Return:
+ *      The bit before the call.
+ * Expects:
+ *      That bitmap is not NULL (throws a CRE if not).
+ *      0 <= col < width (throws a CRE if not).
+ *      0 <= row < height (throws a CRE if not).
+ * Notes:
+ *      Bit2_put is a plain read-modify-write of a whole word, so two threads
+ *      that put bits in the same word, even different bits, can lose one of
+ *      the puts; these atomic operations cannot, so threads may share one
+ *      bitmap, such as the visited set of a parallel fill. Each is one
+ *      locked instruction. With BIT2_ACQ_REL a thread that sees a bit set
+ *      also sees what the setter wrote before setting it; BIT2_RELAXED
+ *      suffices when only the bits matter, or when a later join, such as
+ *      the end of a Fold_rows, orders everything. Mixing them with
+ *      concurrent Bit2_put on the same words is still a race.
+ *      Bit2_test_and_clear follows the same pattern, clearing the bit.
+ *
+ ************************/
+int Bit2_test_and_set(Bit2_T bitmap, int col, int row, Bit2_order order)
+{
+        assert(bitmap != NULL);
+        assert((col >= 0) && (row >= 0));
+        assert((col < bitmap->width) && (row < bitmap->height));
+        long bitcol = (long)col + bitmap->offset;
+        uint64_t *word = &bitmap->words[row * bitmap->words_per_row +
+                                        bitcol / 64];
+        uint64_t mask = (uint64_t)1 << (bitcol % 64);
+        return (fetch_or_word(word, mask, order) & mask) != 0;
+}
+
+int Bit2_test_and_clear(Bit2_T bitmap, int col, int row, Bit2_order order)
+{
+        assert(bitmap != NULL);
+        assert((col >= 0) && (row >= 0));
+        assert((col < bitmap->width) && (row < bitmap->height));
+        long bitcol = (long)col + bitmap->offset;
+        uint64_t *word = &bitmap->words[row * bitmap->words_per_row +
+                                        bitcol / 64];
+        uint64_t mask = (uint64_t)1 << (bitcol % 64);
+        return (fetch_and_word(word, ~mask, order) & mask) != 0;
+}
+
+/************** Bit2_fetch_or ************
+ *
+ * Use:
+ *      Atomically sets up to 64 bits of one row of the given bitmap.
+ * Parameters:
+ *      Bit2_T bitmap:    Bitmap whose bits are set.
+ *      int col:          Column index of the first bit.
+ *      int row:          Row index of the bits.
+ *      uint64_t bits:    Bit i is ORed into column col + i.
+ *      Bit2_order order: BIT2_RELAXED or BIT2_ACQ_REL.
+ * Return:
+ *      The 64 bits before the call, bit i from column col + i; columns past
+ *      the width read as 0.
+ * Expects:
+ *      That bitmap is not NULL (throws a CRE if not).
+ *      0 <= col < width (throws a CRE if not).
+ *      0 <= row < height (throws a CRE if not).
+ *      No bit of bits is set past the width (throws a CRE if not).
+ * Notes:
+ *      When col + offset is a multiple of 64 this is one locked OR of one
+ *      word. Otherwise the bits straddle two words, and each word's half is
+ *      ORed atomically on its own, with the given ordering as in
+ *      Bit2_test_and_set.
+ *
+ ************************/
+uint64_t Bit2_fetch_or(Bit2_T bitmap, int col, int row, uint64_t bits,
+                       Bit2_order order)
+{
+        assert(bitmap != NULL);
+        assert((col >= 0) && (row >= 0));
+        assert((col < bitmap->width) && (row < bitmap->height));
+        assert(bitmap->width - col >= 64 ||
+               bits >> (bitmap->width - col) == 0);
+        long bitcol = (long)col + bitmap->offset;
+        uint64_t *word = &bitmap->words[row * bitmap->words_per_row +
+                                        bitcol / 64];
+        int shift = (int)(bitcol % 64);
+        uint64_t old = fetch_or_word(word, bits << shift, order) >> shift;
+        if (shift != 0 && bitmap->width - col > 64 - shift) {
+                old |= fetch_or_word(word + 1, bits >> (64 - shift), order)
+                       << (64 - shift);
+        }
+        if (bitmap->width - col < 64) {
+                old &= ((uint64_t)1 << (bitmap->width - col)) - 1;
+        }
+        return old;
+}
+
+/************** fetch_or_word ************
+ *
+ * Use:
+ *      Atomically ORs bits into a word.
+ * Parameters:
+ *      uint64_t *word:   The word.
+ *      uint64_t bits:    The bits to set.
+ *      Bit2_order order: BIT2_RELAXED or BIT2_ACQ_REL.
+ * Return:
+ *      The word before the call.
+ * Expects:
+ *      None.
+ * Notes:
+ *      The __atomic builtins treat an ordering that is not a constant as
+ *      sequentially consistent, so each ordering gets its own call.
+ *      fetch_and_word follows the same pattern, ANDing the bits in.
+ *
+ ************************/
+static uint64_t fetch_or_word(uint64_t *word, uint64_t bits,
+                              Bit2_order order)
+{
+        if (order == BIT2_RELAXED) {
+                return __atomic_fetch_or(word, bits, __ATOMIC_RELAXED);
+        }
+        return __atomic_fetch_or(word, bits, __ATOMIC_ACQ_REL);
+}
+
+static uint64_t fetch_and_word(uint64_t *word, uint64_t bits,
+                               Bit2_order order)
+{
+        if (order == BIT2_RELAXED) {
+                return __atomic_fetch_and(word, bits, __ATOMIC_RELAXED);
+        }
+        return __atomic_fetch_and(word, bits, __ATOMIC_ACQ_REL);
 }
 
 /*********** bit2_map_col_major *********
@@ -181,9 +426,9 @@ void Bit2_map_col_major(Bit2_T bitmap,
                         void *closure)
 {
         assert(bitmap != NULL);
-        for (int i = 0; i < bitmap->columns; i++) {
-                for (int j = 0; j < bitmap->rows; j++) {
-                        int bit = Bit2_get(bitmap, i, j);
+        for (int i = 0; i < bitmap->width; i++) {
+                for (int j = 0; j < bitmap->height; j++) {
+                        int bit = Bit2_get_fast(bitmap, i, j);
                         apply(i, j, bitmap, bit, closure);
                 }
         }
@@ -225,14 +470,66 @@ void Bit2_map_row_major(Bit2_T bitmap,
                         void *closure)
 {
         assert(bitmap != NULL);
-        for (int i = 0; i < bitmap->rows; i++) {
-                for (int j = 0; j < bitmap->columns; j++) {
-                        int bit = Bit2_get(bitmap, j, i);
+        for (int i = 0; i < bitmap->height; i++) {
+                for (int j = 0; j < bitmap->width; j++) {
+                        int bit = Bit2_get_fast(bitmap, j, i);
                         apply(j, i, bitmap, bit, closure);
                 }
         }
 }
 
+/************** Bit2_count ************
+ *
+ * Use:
+ *      Counts the 1 bits in a rectangle of the given 2D bitmap. Whole
+ *      bitmaps, rows and columns are rectangles too.
+ * Parameters:
+ *      Bit2_T bitmap:         Bitmap whose bits are counted.
+ *      int col, int row:      Top-left corner of the rectangle.
+ *      int width, int height: Size of the rectangle.
+ * Return:
+ *      The number of bits in the rectangle that are 1.
+ * Expects:
+ *      That bitmap is not NULL (throws a CRE if not).
+ *      That the rectangle lies within the bitmap (throws a CRE if not).
+ * Notes:
+ *      Counts a word at a time, masking the partial words at the left and
+ *      right edges of the rectangle, so a whole bitmap is counted at close
+ *      to memory speed.
+ *
+ ************************/
+long Bit2_count(Bit2_T bitmap, int col, int row, int width, int height)
+{
+        assert(bitmap != NULL);
+        assert((col >= 0) && (row >= 0) && (width >= 0) && (height >= 0));
+        assert(((long)col + width <= bitmap->width) &&
+               ((long)row + height <= bitmap->height));
+        if (width == 0 || height == 0) {
+                return 0;
+        }
+        long bitcol = (long)col + bitmap->offset;
+        long first = bitcol / 64;
+        long last = (bitcol + width - 1) / 64;
+        uint64_t first_mask = ~(uint64_t)0 << (bitcol % 64);
+        uint64_t last_mask = ~(uint64_t)0 >> (63 - (bitcol + width - 1) % 64);
+        long count = 0;
+        for (int i = row; i < row + height; i++) {
+                const uint64_t *words = &bitmap->words[i *
+                                                       bitmap->words_per_row];
+                if (first == last) {
+                        count += Bit2_count_word(words[first] &
+                                                 first_mask & last_mask);
+                        continue;
+                }
+                count += Bit2_count_word(words[first] & first_mask);
+                for (long w = first + 1; w < last; w++) {
+                        count += Bit2_count_word(words[w]);
+                }
+                count += Bit2_count_word(words[last] & last_mask);
+        }
+        return count;
+}
+
 /************** Bit2_free ************
  *
  * Use:
@@ -246,12 +543,13 @@ void Bit2_map_row_major(Bit2_T bitmap,
  *      That bitmap is not NULL (throws a CRE if not).
  *      That the pointer to the bitmap is not NULL (throws a CRE if not).
  * Notes:
- *      None.
+ *      Must not be called on a view made by Bit2_view, nor on a bitmap
+ *      made by Bit2_init.
  *
  ************************/
 void Bit2_free(Bit2_T *bitmap)
 {
         assert((bitmap != NULL) && (*bitmap != NULL));
-        Bit_free(&(*bitmap)->bitarr2);
+        FREE((*bitmap)->words);
         FREE(*bitmap);
 }
\ No newline at end of file
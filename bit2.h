@@ -13,22 +13,47 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdint.h>
 #include <assert.h>
-#include "bit.h"
 #include "mem.h"
 
+/* Each row starts on a fresh 64-bit word; with c = col + offset, bit
+ * (col, row) is bit c % 64 of words[row * words_per_row + c / 64]. offset
+ * is 0 except in views, whose rectangle may start partway into a word.
+ * Each dimension is an int, but word indices and sizes are longs, so a
+ * bitmap may hold far more than 2^31 bits.
+ * The fields are public so that the _fast accessors below can be inlined,
+ * but only this interface should change them. */
 typedef struct Bit2_T
 {
-        Bit_T bitarr2;
-        int rows;
-        int columns;
+        int width;
+        int height;
+        long words_per_row;
+        int offset;
+        uint64_t *words;
 } *Bit2_T;
 
+/* Memory ordering of the atomic operations. BIT2_RELAXED only makes the
+ * bit update itself atomic; BIT2_ACQ_REL also orders the thread's other
+ * reads and writes around it. */
+typedef enum Bit2_order {
+        BIT2_RELAXED,
+        BIT2_ACQ_REL
+} Bit2_order;
+
 int Bit2_width(Bit2_T bitmap);
 int Bit2_height(Bit2_T bitmap);
 Bit2_T Bit2_new(int col, int row);
+Bit2_T Bit2_init(struct Bit2_T *storage, int col, int row,
+                 void *alloc(long nbytes, void *closure), void *closure);
+Bit2_T Bit2_view(Bit2_T parent, int col, int row, int width, int height,
+                 struct Bit2_T *storage);
 int Bit2_put(Bit2_T bitmap, int col, int row, int bit);
 int Bit2_get(Bit2_T bitmap, int col, int row);
+int Bit2_test_and_set(Bit2_T bitmap, int col, int row, Bit2_order order);
+int Bit2_test_and_clear(Bit2_T bitmap, int col, int row, Bit2_order order);
+uint64_t Bit2_fetch_or(Bit2_T bitmap, int col, int row, uint64_t bits,
+                       Bit2_order order);
 void Bit2_map_col_major(Bit2_T bitmap,
                         void apply(int col,
                                    int row,
@@ -43,6 +68,54 @@ void Bit2_map_row_major(Bit2_T bitmap,
                                    int bit,
                                    void *closure),
                         void *closure);
+long Bit2_count(Bit2_T bitmap, int col, int row, int width, int height);
 void Bit2_free(Bit2_T *bitmap);
 
-#endif
\ No newline at end of file
+/*
+ * Unchecked accessors for hot loops whose indices are already known to be
+ * in bounds, and whose bits are known to be 0 or 1. They do no checking at
+ * all, so loops that use them can be inlined and vectorized. Building with
+ * III_CHECKED defined (make CHECKED=1) turns them back into calls to the
+ * checked functions, for debugging.
+ */
+#ifdef III_CHECKED
+#define Bit2_get_fast(bitmap, col, row) Bit2_get((bitmap), (col), (row))
+#define Bit2_put_fast(bitmap, col, row, bit) \
+        Bit2_put((bitmap), (col), (row), (bit))
+#else
+static inline int Bit2_get_fast(Bit2_T bitmap, int col, int row)
+{
+        long bitcol = (long)col + bitmap->offset;
+        uint64_t word = bitmap->words[row * bitmap->words_per_row +
+                                      (bitcol >> 6)];
+        return (int)((word >> (bitcol & 63)) & 1);
+}
+
+static inline int Bit2_put_fast(Bit2_T bitmap, int col, int row, int bit)
+{
+        long bitcol = (long)col + bitmap->offset;
+        uint64_t *word = &bitmap->words[row * bitmap->words_per_row +
+                                        (bitcol >> 6)];
+        int old = (int)((*word >> (bitcol & 63)) & 1);
+        *word = (*word & ~((uint64_t)1 << (bitcol & 63))) |
+                ((uint64_t)bit << (bitcol & 63));
+        return old;
+}
+#endif
+
+/*
+ * Counts the 1 bits in a word, for Bit2_count and the bitmaps built on
+ * Bit2 words. Adds bits in parallel within the word rather than calling
+ * __builtin_popcountll, which is a library call unless the target has a
+ * popcount instruction; this form also vectorizes.
+ */
+static inline long Bit2_count_word(uint64_t word)
+{
+        word = word - ((word >> 1) & 0x5555555555555555ULL);
+        word = (word & 0x3333333333333333ULL) +
+               ((word >> 2) & 0x3333333333333333ULL);
+        word = (word + (word >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+        return (long)((word * 0x0101010101010101ULL) >> 56);
+}
+
+#endif
@@ -0,0 +1,1036 @@
+/*
+ *     canon.c
+ *     by nozden01 & bdioni01, 2/12/2024
+ *     iii
+ *
+ *     Function implementations for canonical sudoku boards and the
+ *     concurrent canonical set.
+ *
+ *     The canonical form of a board is the lexicographically smallest
+ *     board, read row-major, among the boards equivalent to it whose rows,
+ *     columns, bands and stacks come in order of their signatures, where
+ *     digits are relabeled in order of first appearance. A signature only
+ *     counts things every symmetry preserves, such as the filled cells of a
+ *     line and how often its digits occur on the board, so equivalent
+ *     boards have the same canonical form. Blank cells (0) and out-of-range
+ *     values (above 9) are never relabeled, so a board that is invalid
+ *     stays invalid in canonical form.
+ *
+ *     The signatures of a puzzle's lines rarely tie, which leaves a few
+ *     orders to try and makes canonicalizing it cost a few microseconds. On
+ *     a complete board they all tie and it costs hundreds, so a Canonset
+ *     also files each board under a cheap invariant of its class and only
+ *     canonicalizes boards whose invariant has been seen before.
+ */
+
+#include <string.h>
+#include <pthread.h>
+#include "canon.h"
+
+#define SIDE 9
+#define UNLABELED 0xFF
+#define VALUES 16
+
+#define SHARD_BITS 6
+#define SHARDS (1 << SHARD_BITS)
+#define KEY_BYTES ((CANON_CELLS + 1) / 2)
+
+static const unsigned char PERMS[6][3] = {
+        { 0, 1, 2 }, { 0, 2, 1 }, { 1, 0, 2 },
+        { 1, 2, 0 }, { 2, 0, 1 }, { 2, 1, 0 }
+};
+
+static const unsigned char IDENTITY[SIDE] = { 1, 2, 3, 4, 5, 6, 7, 8, 9 };
+
+/* State of one canonicalization: the (possibly transposed) grid; for each
+ * row, band and stack, the lines of its group of three with a smaller
+ * signature, which must be placed before it; for each stack, the column
+ * orders that keep its columns in signature order; the column order being
+ * tried, the first row under that order, and the smallest rows found so
+ * far. */
+typedef struct Canon_search {
+        const unsigned char *grid;
+        unsigned full;
+        unsigned row_before[SIDE];
+        unsigned band_before[3];
+        unsigned stack_before[3];
+        unsigned orders[3];
+        unsigned char cols[SIDE];
+        unsigned char first[SIDE];
+        unsigned char best[CANON_CELLS];
+} Canon_search;
+
+typedef struct Entry {
+        uint64_t hash;
+        unsigned char key[KEY_BYTES];
+        unsigned char used;
+} Entry;
+
+typedef struct Shard {
+        pthread_mutex_t lock;
+        Entry *entries;
+        long capacity;
+        long size;
+} Shard;
+
+/* shards holds canonical boards. profiles maps each invariant seen to the
+ * packed cells of the first board that had it; used is 1 while that board
+ * has not been canonicalized, 2 once its canonical form is in shards, and
+ * singles counts the entries still at 1. */
+struct Canonset_T {
+        Shard shards[SHARDS];
+        Shard profiles[SHARDS];
+        long singles[SHARDS];
+};
+
+static void pair_up(unsigned char pairs[VALUES][VALUES], unsigned char a,
+                    unsigned char b, unsigned char c);
+static uint64_t profile(unsigned char first[VALUES][VALUES],
+                        unsigned char second[VALUES][VALUES],
+                        const unsigned *count);
+static uint64_t mix(uint64_t x);
+static void pack_key(const unsigned char *cells, unsigned char *key);
+static bool insert_canonical(Canonset_T set, const unsigned char *canonical);
+static void place_stack(Canon_search *search, int row, int pos,
+                        unsigned stacks, const unsigned char *labels,
+                        int next);
+static void place_row(Canon_search *search, int depth, unsigned used,
+                      int band, const unsigned char *labels, int next);
+static bool second_row_loses(Canon_search *search, int row, int len,
+                             const unsigned char *labels, int next);
+static unsigned full_rows(const unsigned char *grid);
+static uint64_t sign_lines(Canon_search *search, const unsigned *count);
+static unsigned lines_before(const uint64_t *sig, int first, int index);
+static unsigned placed_bands(unsigned used);
+static void grow_shard(Shard *shard);
+static Entry *find_slot(Shard *shard, uint64_t hash, const unsigned char *key);
+static Entry *find_hash(Shard *shard, uint64_t hash);
+
+/********** Canon_board ********
+ *
+ * Use:
+ *      Computes the canonical form of a 9x9 board.
+ * Parameters:
+ *      const unsigned char *cells: The 81 cells in row-major order, 0 for
+ *                                  empty, at most 15.
+ *      unsigned char *canonical:   Receives the 81 canonical cells.
+ * Return:
+ *      None.
+ * Expects:
+ *      cells and canonical are not NULL (throws a CRE if not).
+ * Notes:
+ *      Tries the orientations whose signatures are smallest, and as the
+ *      first row each row that may come first in signature order. The
+ *      column order is then built a stack at a time and abandoned as soon
+ *      as the first row is larger than that of the best board found so far;
+ *      the surviving orders choose the remaining rows depth-first, band by
+ *      band, with the same pruning. Only orders that keep the signatures
+ *      sorted are tried.
+ *
+ ************************/
+void Canon_board(const unsigned char *cells, unsigned char *canonical)
+{
+        assert(cells != NULL && canonical != NULL);
+        unsigned char grids[2][CANON_CELLS];
+        unsigned count[VALUES] = { 0 };
+        for (int row = 0; row < SIDE; row++) {
+                for (int col = 0; col < SIDE; col++) {
+                        unsigned char value = cells[row * SIDE + col];
+                        assert(value < VALUES);
+                        grids[0][row * SIDE + col] = value;
+                        grids[1][col * SIDE + row] = value;
+                        count[value]++;
+                }
+        }
+
+        /* Only digits 1 to 9 are relabeled. */
+        unsigned char labels[VALUES];
+        for (int v = 0; v < VALUES; v++) {
+                labels[v] = (v >= 1 && v <= SIDE) ? UNLABELED : v;
+        }
+
+        Canon_search search;
+        uint64_t shapes[2];
+        for (int t = 0; t < 2; t++) {
+                search.grid = grids[t];
+                shapes[t] = sign_lines(&search, count);
+        }
+        memset(search.best, UNLABELED, sizeof(search.best));
+        for (int t = 0; t < 2; t++) {
+                if (shapes[t] > shapes[1 - t]) {
+                        continue;
+                }
+                search.grid = grids[t];
+                search.full = full_rows(grids[t]);
+                sign_lines(&search, count);
+                for (int row = 0; row < SIDE; row++) {
+                        if ((search.band_before[row / 3] |
+                             search.row_before[row]) == 0) {
+                                place_stack(&search, row, 0, 0, labels, 1);
+                        }
+                }
+        }
+        memcpy(canonical, search.best, CANON_CELLS);
+}
+
+/********** Canon_hash ********
+ *
+ * Use:
+ *      Hashes a canonical board.
+ * Parameters:
+ *      const unsigned char *canonical: The 81 canonical cells.
+ * Return:
+ *      A 64-bit hash, equal for equivalent boards.
+ * Expects:
+ *      canonical is not NULL (throws a CRE if not).
+ * Notes:
+ *      64-bit FNV-1a with a final mix so that the high bits, which pick
+ *      the Canonset shard, depend on every cell.
+ *
+ ************************/
+uint64_t Canon_hash(const unsigned char *canonical)
+{
+        assert(canonical != NULL);
+        uint64_t hash = 0xcbf29ce484222325ULL;
+        for (int i = 0; i < CANON_CELLS; i++) {
+                hash ^= canonical[i];
+                hash *= 0x100000001b3ULL;
+        }
+        hash ^= hash >> 33;
+        hash *= 0xff51afd7ed558ccdULL;
+        hash ^= hash >> 33;
+        return hash;
+}
+
+/********** Canon_invariant ********
+ *
+ * Use:
+ *      Computes a cheap invariant of the class of a 9x9 board.
+ * Parameters:
+ *      const unsigned char *cells: The 81 cells in row-major order, 0 for
+ *                                  empty, at most 15.
+ * Return:
+ *      A 64-bit value, equal for equivalent boards.
+ * Expects:
+ *      cells is not NULL (throws a CRE if not).
+ * Notes:
+ *      Counts, for every pair of values, how often they share a mini-row
+ *      (three cells of a row within one box) and a mini-column. Every
+ *      symmetry maps mini-rows to mini-rows and mini-columns to
+ *      mini-columns, except transposition, which swaps them, so the
+ *      invariant is the smaller of the two orientations' profiles. Unequal
+ *      boards may share an invariant; equal invariants only say that the
+ *      boards need canonicalizing. Costs about a microsecond.
+ *
+ ************************/
+uint64_t Canon_invariant(const unsigned char *cells)
+{
+        assert(cells != NULL);
+        unsigned char across[VALUES][VALUES];
+        unsigned char down[VALUES][VALUES];
+        unsigned count[VALUES] = { 0 };
+        memset(across, 0, sizeof(across));
+        memset(down, 0, sizeof(down));
+        for (int i = 0; i < CANON_CELLS; i++) {
+                assert(cells[i] < VALUES);
+                count[cells[i]]++;
+        }
+        for (int line = 0; line < SIDE; line++) {
+                for (int k = 0; k < SIDE; k += 3) {
+                        const unsigned char *row = &cells[line * SIDE + k];
+                        const unsigned char *col = &cells[k * SIDE + line];
+                        pair_up(across, row[0], row[1], row[2]);
+                        pair_up(down, col[0], col[SIDE], col[2 * SIDE]);
+                }
+        }
+        uint64_t a = profile(across, down, count);
+        uint64_t b = profile(down, across, count);
+        return a < b ? a : b;
+}
+
+/********** Canonset_new ********
+ *
+ * Use:
+ *      Creates an empty set of canonical boards that many threads may insert
+ *      into at once.
+ * Parameters:
+ *      long hint: Expected number of boards, or 0 if unknown.
+ * Return:
+ *      The new set.
+ * Expects:
+ *      hint >= 0 (throws a CRE if not).
+ * Notes:
+ *      The set is split into shards by the top bits of the hash, each with
+ *      its own lock and open-addressed table, so threads rarely wait on each
+ *      other. Boards are stored packed, two cells per byte, and compared in
+ *      full, so distinct boards are never merged by a hash collision; a
+ *      collision of invariants only costs a canonicalization.
+ *
+ ************************/
+Canonset_T Canonset_new(long hint)
+{
+        assert(hint >= 0);
+        long capacity = 64;
+        while (capacity * SHARDS < hint * 2) {
+                capacity *= 2;
+        }
+
+        Canonset_T set;
+        NEW(set);
+        for (int i = 0; i < SHARDS; i++) {
+                Shard *shard = &set->shards[i];
+                pthread_mutex_init(&shard->lock, NULL);
+                shard->capacity = capacity;
+                shard->size = 0;
+                shard->entries = CALLOC(capacity, sizeof(Entry));
+                shard = &set->profiles[i];
+                pthread_mutex_init(&shard->lock, NULL);
+                shard->capacity = capacity;
+                shard->size = 0;
+                shard->entries = CALLOC(capacity, sizeof(Entry));
+                set->singles[i] = 0;
+        }
+        return set;
+}
+
+/********** Canonset_insert ********
+ *
+ * Use:
+ *      Adds the class of a 9x9 board to the set.
+ * Parameters:
+ *      Canonset_T set:             The set being added to.
+ *      const unsigned char *cells: The 81 cells in row-major order, 0 for
+ *                                  empty, at most 15.
+ * Return:
+ *      True if no equivalent board was in the set before, false otherwise.
+ * Expects:
+ *      set and cells are not NULL (throws a CRE if not).
+ * Notes:
+ *      Safe to call from many threads at once. Exactly one caller sees
+ *      true for each class. A board whose invariant is new is the first of
+ *      its class and is only filed; the first time a second board has the
+ *      same invariant, both are canonicalized, and so is every later one.
+ *      The stored board is canonicalized under its shard's lock, so that it
+ *      happens once; the new board is canonicalized outside it.
+ *
+ ************************/
+bool Canonset_insert(Canonset_T set, const unsigned char *cells)
+{
+        assert(set != NULL && cells != NULL);
+        uint64_t invariant = Canon_invariant(cells);
+        int index = (int)(invariant >> (64 - SHARD_BITS));
+        Shard *shard = &set->profiles[index];
+
+        pthread_mutex_lock(&shard->lock);
+        Entry *entry = find_hash(shard, invariant);
+        if (!entry->used) {
+                entry->used = 1;
+                entry->hash = invariant;
+                pack_key(cells, entry->key);
+                shard->size++;
+                set->singles[index]++;
+                if (shard->size * 10 >= shard->capacity * 7) {
+                        grow_shard(shard);
+                }
+                pthread_mutex_unlock(&shard->lock);
+                return true;
+        }
+        if (entry->used == 1) {
+                unsigned char first[CANON_CELLS];
+                unsigned char canonical[CANON_CELLS];
+                for (int i = 0; i < CANON_CELLS; i++) {
+                        first[i] = (entry->key[i / 2] >> (4 * (i % 2))) & 0xF;
+                }
+                Canon_board(first, canonical);
+                insert_canonical(set, canonical);
+                entry->used = 2;
+                set->singles[index]--;
+        }
+        pthread_mutex_unlock(&shard->lock);
+
+        unsigned char canonical[CANON_CELLS];
+        Canon_board(cells, canonical);
+        return insert_canonical(set, canonical);
+}
+
+/********** Canonset_size ********
+ *
+ * Use:
+ *      Returns the number of distinct boards in the set.
+ * Parameters:
+ *      Canonset_T set: The set being queried.
+ * Return:
+ *      The number of boards.
+ * Expects:
+ *      set is not NULL (throws a CRE if not).
+ * Notes:
+ *      Each class is counted once: boards still filed only under their
+ *      invariant, plus distinct canonical boards.
+ *
+ ************************/
+long Canonset_size(Canonset_T set)
+{
+        assert(set != NULL);
+        long size = 0;
+        for (int i = 0; i < SHARDS; i++) {
+                pthread_mutex_lock(&set->profiles[i].lock);
+                size += set->singles[i];
+                pthread_mutex_unlock(&set->profiles[i].lock);
+                pthread_mutex_lock(&set->shards[i].lock);
+                size += set->shards[i].size;
+                pthread_mutex_unlock(&set->shards[i].lock);
+        }
+        return size;
+}
+
+/********** Canonset_free ********
+ *
+ * Use:
+ *      Frees the memory associated with the given set.
+ * Parameters:
+ *      Canonset_T *set: Pointer to the set to be freed.
+ * Return:
+ *      None.
+ * Expects:
+ *      set and *set are not NULL (throws a CRE if not).
+ * Notes:
+ *      Sets *set to NULL.
+ *
+ ************************/
+void Canonset_free(Canonset_T *set)
+{
+        assert(set != NULL && *set != NULL);
+        for (int i = 0; i < SHARDS; i++) {
+                pthread_mutex_destroy(&(*set)->shards[i].lock);
+                FREE((*set)->shards[i].entries);
+                pthread_mutex_destroy(&(*set)->profiles[i].lock);
+                FREE((*set)->profiles[i].entries);
+        }
+        FREE(*set);
+}
+
+/********** pair_up ********
+ *
+ * Use:
+ *      Counts the pairs of values in one mini-row or mini-column.
+ * Parameters:
+ *      unsigned char pairs[][]: pairs[u][v] counts the pairs of u and v.
+ *      unsigned char a, b, c:   The three values.
+ * Return:
+ *      None.
+ * Expects:
+ *      None.
+ * Notes:
+ *      Counts both orders, so the table is symmetric. A count is at most
+ *      6 for each of the 27 mini-rows, so it fits in a byte.
+ *
+ ************************/
+static void pair_up(unsigned char pairs[VALUES][VALUES], unsigned char a,
+                    unsigned char b, unsigned char c)
+{
+        pairs[a][b]++;
+        pairs[b][a]++;
+        pairs[a][c]++;
+        pairs[c][a]++;
+        pairs[b][c]++;
+        pairs[c][b]++;
+}
+
+/********** profile ********
+ *
+ * Use:
+ *      Hashes the pair counts of a board in one orientation.
+ * Parameters:
+ *      unsigned char first[][]:  Pair counts of the mini-rows.
+ *      unsigned char second[][]: Pair counts of the mini-columns.
+ *      const unsigned *count:    count[v] is the number of cells holding v.
+ * Return:
+ *      The hash.
+ * Expects:
+ *      None.
+ * Notes:
+ *      Digits 1 to 9 are interchangeable, so each value's pairs are summed
+ *      with the partner named only if it is not a digit (or is the value
+ *      itself), and the values' hashes are summed again. Sums of mixed
+ *      terms do not depend on the order of the digits.
+ *
+ ************************/
+static uint64_t profile(unsigned char first[VALUES][VALUES],
+                        unsigned char second[VALUES][VALUES],
+                        const unsigned *count)
+{
+        uint64_t sum = 0;
+        for (int v = 0; v < VALUES; v++) {
+                if (count[v] == 0) {
+                        continue;
+                }
+                uint64_t hash = 0;
+                for (int u = 0; u < VALUES; u++) {
+                        if ((first[v][u] | second[v][u]) == 0) {
+                                continue;
+                        }
+                        uint64_t tag = (u == v) ? 16 :
+                                       (u >= 1 && u <= SIDE) ? 17 : u;
+                        hash += mix(((uint64_t)first[v][u] << 16) |
+                                    ((uint64_t)second[v][u] << 8) | tag);
+                }
+                uint64_t tag = (v >= 1 && v <= SIDE) ? 17 : v;
+                sum += mix(hash + mix((tag << 8) | count[v]));
+        }
+        return sum;
+}
+
+/********** mix ********
+ *
+ * Use:
+ *      Scrambles a 64-bit value.
+ * Parameters:
+ *      uint64_t x: The value.
+ * Return:
+ *      The scrambled value.
+ * Expects:
+ *      None.
+ * Notes:
+ *      The MurmurHash3 finalizer; a bijection, so distinct terms of a sum
+ *      stay distinct.
+ *
+ ************************/
+static uint64_t mix(uint64_t x)
+{
+        x ^= x >> 33;
+        x *= 0xff51afd7ed558ccdULL;
+        x ^= x >> 33;
+        x *= 0xc4ceb9fe1a85ec53ULL;
+        x ^= x >> 33;
+        return x;
+}
+
+/********** pack_key ********
+ *
+ * Use:
+ *      Packs 81 cells two to a byte.
+ * Parameters:
+ *      const unsigned char *cells: The cells, each at most 15.
+ *      unsigned char *key:         Receives KEY_BYTES bytes.
+ * Return:
+ *      None.
+ * Expects:
+ *      None.
+ * Notes:
+ *      Cell i goes in the low nibble of byte i / 2 if i is even, the high
+ *      nibble if it is odd.
+ *
+ ************************/
+static void pack_key(const unsigned char *cells, unsigned char *key)
+{
+        memset(key, 0, KEY_BYTES);
+        for (int i = 0; i < CANON_CELLS; i++) {
+                key[i / 2] |= (unsigned char)(cells[i] << (4 * (i % 2)));
+        }
+}
+
+/********** insert_canonical ********
+ *
+ * Use:
+ *      Adds a canonical board to the set of canonical boards.
+ * Parameters:
+ *      Canonset_T set:                 The set being added to.
+ *      const unsigned char *canonical: The 81 canonical cells.
+ * Return:
+ *      True if the board was not in the set before, false otherwise.
+ * Expects:
+ *      None.
+ * Notes:
+ *      May be called with a profiles shard locked; it only locks one of
+ *      shards, so the locks are always taken in that order.
+ *
+ ************************/
+static bool insert_canonical(Canonset_T set, const unsigned char *canonical)
+{
+        unsigned char key[KEY_BYTES];
+        pack_key(canonical, key);
+        uint64_t hash = Canon_hash(canonical);
+        Shard *shard = &set->shards[hash >> (64 - SHARD_BITS)];
+
+        pthread_mutex_lock(&shard->lock);
+        Entry *entry = find_slot(shard, hash, key);
+        bool added = !entry->used;
+        if (added) {
+                entry->used = 1;
+                entry->hash = hash;
+                memcpy(entry->key, key, KEY_BYTES);
+                shard->size++;
+                if (shard->size * 10 >= shard->capacity * 7) {
+                        grow_shard(shard);
+                }
+        }
+        pthread_mutex_unlock(&shard->lock);
+        return added;
+}
+
+/********** place_stack ********
+ *
+ * Use:
+ *      Chooses the grid stack, and the order of its columns, that goes at
+ *      the given stack of the canonical board, with the given grid row
+ *      first, and recurses on the remaining stacks and then the rows.
+ * Parameters:
+ *      Canon_search *search:        The canonicalization being run.
+ *      int row:                     Grid row placed first.
+ *      int pos:                     Stack of the canonical board being
+ *                                   filled.
+ *      unsigned stacks:             Bit s is set if grid stack s is placed.
+ *      const unsigned char *labels: Labels given to digits so far.
+ *      int next:                    Next unused label.
+ * Return:
+ *      None.
+ * Expects:
+ *      None.
+ * Notes:
+ *      Stacks are placed in signature order, and so are the columns within
+ *      a stack. The first row is compared with the best first row after
+ *      every stack, so a column order is dropped as soon as its prefix
+ *      loses. Complete boards always tie on the first row, so for them the
+ *      prefixes of the candidate second rows are compared as well.
+ *
+ ************************/
+static void place_stack(Canon_search *search, int row, int pos,
+                        unsigned stacks, const unsigned char *labels,
+                        int next)
+{
+        if (pos == 3) {
+                /* The last prefix compared was the whole row. */
+                if (memcmp(search->first, search->best, SIDE) < 0) {
+                        memcpy(search->best, search->first, SIDE);
+                        memset(search->best + SIDE, UNLABELED,
+                               CANON_CELLS - SIDE);
+                }
+                place_row(search, 1, 1u << row, row / 3, labels, next);
+                return;
+        }
+        for (int s = 0; s < 3; s++) {
+                if ((stacks & (1u << s)) ||
+                    (search->stack_before[s] & ~stacks)) {
+                        continue;
+                }
+                for (int p = 0; p < 6; p++) {
+                        if (!(search->orders[s] & (1u << p))) {
+                                continue;
+                        }
+                        unsigned char lab[VALUES];
+                        memcpy(lab, labels, VALUES);
+                        int nx = next;
+                        for (int k = 0; k < 3; k++) {
+                                int col = 3 * s + PERMS[p][k];
+                                unsigned char v = search->grid[row * SIDE +
+                                                               col];
+                                if (lab[v] == UNLABELED) {
+                                        lab[v] = (unsigned char)nx++;
+                                }
+                                search->cols[3 * pos + k] = (unsigned char)col;
+                                search->first[3 * pos + k] = lab[v];
+                        }
+                        if (memcmp(search->first, search->best,
+                                   (size_t)(3 * pos + 3)) > 0) {
+                                continue;
+                        }
+                        if (second_row_loses(search, row, 3 * pos + 3, lab,
+                                             nx)) {
+                                continue;
+                        }
+                        place_stack(search, row, pos + 1, stacks | (1u << s),
+                                    lab, nx);
+                }
+        }
+}
+
+/********** second_row_loses ********
+ *
+ * Use:
+ *      Reports whether every possible second row is already larger than the
+ *      best second row, given the columns placed so far.
+ * Parameters:
+ *      Canon_search *search:        The canonicalization being run.
+ *      int row:                     Grid row placed first.
+ *      int len:                     Number of columns placed.
+ *      const unsigned char *labels: Labels given to digits so far.
+ *      int next:                    Next unused label.
+ * Return:
+ *      True if the column order can be dropped, false otherwise.
+ * Expects:
+ *      That the placed prefix of the first row equals that of the best.
+ * Notes:
+ *      Only decides anything when the first row holds every digit and the
+ *      best first row is 1 to 9: then a digit whose column is not placed
+ *      yet will get a label of at least next, so a second-row prefix can be
+ *      compared before the labels of all of its digits are known.
+ *
+ ************************/
+static bool second_row_loses(Canon_search *search, int row, int len,
+                             const unsigned char *labels, int next)
+{
+        if (!(search->full & (1u << row)) ||
+            memcmp(search->best, IDENTITY, SIDE) != 0) {
+                return false;
+        }
+        const unsigned char *best = search->best + SIDE;
+        int band = row / 3;
+        for (int r = 3 * band; r < 3 * band + 3; r++) {
+                if (r == row || (search->row_before[r] & ~(1u << row))) {
+                        continue;
+                }
+                bool loses = false;
+                for (int k = 0; k < len; k++) {
+                        unsigned char v = search->grid[r * SIDE +
+                                                       search->cols[k]];
+                        if (labels[v] != UNLABELED) {
+                                if (labels[v] != best[k]) {
+                                        loses = labels[v] > best[k];
+                                        break;
+                                }
+                        } else {
+                                loses = best[k] < next;
+                                break;
+                        }
+                }
+                if (!loses) {
+                        return false;
+                }
+        }
+        return true;
+}
+
+/********** full_rows ********
+ *
+ * Use:
+ *      Finds the rows of a grid that hold each digit 1 to 9 exactly once.
+ * Parameters:
+ *      const unsigned char *grid: The 81 cells.
+ * Return:
+ *      A mask with bit r set if row r is full.
+ * Expects:
+ *      None.
+ * Notes:
+ *      None.
+ *
+ ************************/
+static unsigned full_rows(const unsigned char *grid)
+{
+        unsigned full = 0;
+        for (int row = 0; row < SIDE; row++) {
+                unsigned seen = 0;
+                for (int col = 0; col < SIDE; col++) {
+                        seen |= 1u << grid[row * SIDE + col];
+                }
+                if (seen == 0x3FEu) {
+                        full |= 1u << row;
+                }
+        }
+        return full;
+}
+
+/********** sign_lines ********
+ *
+ * Use:
+ *      Computes the signatures of the rows, columns, bands and stacks of
+ *      search->grid, and from them the orders the search may place them in.
+ * Parameters:
+ *      Canon_search *search:  The canonicalization being run; its grid is
+ *                             read and its row_before, band_before,
+ *                             stack_before and orders are filled in.
+ *      const unsigned *count: count[v] is the number of cells holding v.
+ * Return:
+ *      A signature of the whole orientation; Canon_board only searches
+ *      the orientations with the smaller one.
+ * Expects:
+ *      None.
+ * Notes:
+ *      A cell counts as the number of times its digit occurs, or as its
+ *      value if it is blank or out of range, which relabeling cannot
+ *      change. A row's signature sums the mixed cells and the number of
+ *      filled cells of each of its mini-rows; a band's sums its rows' and
+ *      the number of filled cells of each of its boxes. Sums do not depend
+ *      on order, so each signature is kept by every symmetry that keeps
+ *      the orientation.
+ *
+ ************************/
+static uint64_t sign_lines(Canon_search *search, const unsigned *count)
+{
+        uint64_t row_sig[SIDE] = { 0 };
+        uint64_t col_sig[SIDE] = { 0 };
+        uint64_t band_sig[3] = { 0 };
+        uint64_t stack_sig[3] = { 0 };
+        unsigned char across[SIDE][3];
+        unsigned char down[SIDE][3];
+        unsigned char boxes[3][3];
+        memset(across, 0, sizeof(across));
+        memset(down, 0, sizeof(down));
+        memset(boxes, 0, sizeof(boxes));
+        for (int row = 0; row < SIDE; row++) {
+                for (int col = 0; col < SIDE; col++) {
+                        unsigned char v = search->grid[row * SIDE + col];
+                        uint64_t weight = (v >= 1 && v <= SIDE) ? count[v]
+                                                                : 0x80u | v;
+                        uint64_t term = mix(0x100u | weight);
+                        row_sig[row] += term;
+                        col_sig[col] += term;
+                        if (v != 0) {
+                                across[row][col / 3]++;
+                                down[col][row / 3]++;
+                                boxes[row / 3][col / 3]++;
+                        }
+                }
+        }
+        for (int i = 0; i < SIDE; i++) {
+                for (int k = 0; k < 3; k++) {
+                        row_sig[i] += mix(0x200u | across[i][k]);
+                        col_sig[i] += mix(0x200u | down[i][k]);
+                }
+        }
+        uint64_t bands = 0;
+        uint64_t stacks = 0;
+        for (int g = 0; g < 3; g++) {
+                for (int k = 0; k < 3; k++) {
+                        band_sig[g] += mix(row_sig[3 * g + k]) +
+                                       mix(0x300u | boxes[g][k]);
+                        stack_sig[g] += mix(col_sig[3 * g + k]) +
+                                        mix(0x300u | boxes[k][g]);
+                }
+                bands += mix(band_sig[g]);
+                stacks += mix(stack_sig[g]);
+        }
+
+        for (int i = 0; i < SIDE; i++) {
+                search->row_before[i] = lines_before(row_sig, i / 3 * 3, i);
+        }
+        for (int g = 0; g < 3; g++) {
+                search->band_before[g] = lines_before(band_sig, 0, g);
+                search->stack_before[g] = lines_before(stack_sig, 0, g);
+                const uint64_t *sig = &col_sig[3 * g];
+                search->orders[g] = 0;
+                for (int p = 0; p < 6; p++) {
+                        if (sig[PERMS[p][0]] <= sig[PERMS[p][1]] &&
+                            sig[PERMS[p][1]] <= sig[PERMS[p][2]]) {
+                                search->orders[g] |= 1u << p;
+                        }
+                }
+        }
+        return mix(bands + mix(stacks));
+}
+
+/********** lines_before ********
+ *
+ * Use:
+ *      Finds the lines that must be placed before a line in signature
+ *      order.
+ * Parameters:
+ *      const uint64_t *sig: Signatures of the lines.
+ *      int first:           First line of the group of three the line is
+ *                           in.
+ *      int index:           The line.
+ * Return:
+ *      A mask with bit i set if line i of the group has a smaller
+ *      signature.
+ * Expects:
+ *      None.
+ * Notes:
+ *      Lines with equal signatures may be placed in either order, so the
+ *      search tries each of them.
+ *
+ ************************/
+static unsigned lines_before(const uint64_t *sig, int first, int index)
+{
+        unsigned before = 0;
+        for (int i = first; i < first + 3; i++) {
+                if (sig[i] < sig[index]) {
+                        before |= 1u << i;
+                }
+        }
+        return before;
+}
+
+/********** placed_bands ********
+ *
+ * Use:
+ *      Finds the bands that have rows placed.
+ * Parameters:
+ *      unsigned used: Bit r is set if row r is placed.
+ * Return:
+ *      A mask with bit b set if band b has a placed row.
+ * Expects:
+ *      None.
+ * Notes:
+ *      None.
+ *
+ ************************/
+static unsigned placed_bands(unsigned used)
+{
+        unsigned bands = 0;
+        for (int b = 0; b < 3; b++) {
+                if ((used >> (3 * b)) & 7u) {
+                        bands |= 1u << b;
+                }
+        }
+        return bands;
+}
+
+/********** place_row ********
+ *
+ * Use:
+ *      Chooses the row that goes at the given depth of the canonical board
+ *      and recurses on the rest, keeping the smallest board in search->best.
+ * Parameters:
+ *      Canon_search *search:        The canonicalization being run.
+ *      int depth:                   Row of the canonical board being filled.
+ *      unsigned used:               Bit r is set if grid row r is placed.
+ *      int band:                    Band of the rows placed in the current
+ *                                   band of the canonical board.
+ *      const unsigned char *labels: Labels given to digits so far.
+ *      int next:                    Next unused label.
+ * Return:
+ *      None.
+ * Expects:
+ *      None.
+ * Notes:
+ *      Only called while the rows placed so far equal the first depth rows
+ *      of search->best. Bands, and rows within a band, are placed in
+ *      signature order. A row that beats best at this depth replaces it, and
+ *      the later rows of best are reset to "larger than anything" so that
+ *      the first completion below becomes the new best.
+ *
+ ************************/
+static void place_row(Canon_search *search, int depth, unsigned used,
+                      int band, const unsigned char *labels, int next)
+{
+        if (depth == SIDE) {
+                return;
+        }
+        for (int r = 0; r < SIDE; r++) {
+                if (used & (1u << r)) {
+                        continue;
+                }
+                if (depth % 3 == 0) {
+                        /* A new band of the canonical board starts with a
+                         * row of a grid band that is not placed yet. */
+                        if (((used >> (3 * (r / 3))) & 7u) ||
+                            (search->band_before[r / 3] &
+                             ~placed_bands(used))) {
+                                continue;
+                        }
+                } else if (r / 3 != band) {
+                        continue;
+                }
+                if (search->row_before[r] & ~used) {
+                        continue;
+                }
+
+                unsigned char lab[VALUES];
+                memcpy(lab, labels, VALUES);
+                int nx = next;
+                unsigned char row[SIDE];
+                for (int k = 0; k < SIDE; k++) {
+                        unsigned char v = search->grid[r * SIDE +
+                                                       search->cols[k]];
+                        if (lab[v] == UNLABELED) {
+                                lab[v] = (unsigned char)nx++;
+                        }
+                        row[k] = lab[v];
+                }
+
+                unsigned char *best = &search->best[depth * SIDE];
+                int cmp = memcmp(row, best, SIDE);
+                if (cmp > 0) {
+                        continue;
+                }
+                if (cmp < 0) {
+                        memcpy(best, row, SIDE);
+                        memset(best + SIDE, UNLABELED,
+                               (size_t)((SIDE - 1 - depth) * SIDE));
+                }
+                place_row(search, depth + 1, used | (1u << r), r / 3, lab,
+                          nx);
+        }
+}
+
+/********** find_slot ********
+ *
+ * Use:
+ *      Finds the entry holding a key, or the empty entry where it belongs.
+ * Parameters:
+ *      Shard *shard:             The shard being searched.
+ *      uint64_t hash:            Hash of the key.
+ *      const unsigned char *key: The packed board.
+ * Return:
+ *      Pointer to the entry.
+ * Expects:
+ *      That the shard is locked and not full.
+ * Notes:
+ *      Linear probing from the low bits of the hash.
+ *
+ ************************/
+static Entry *find_slot(Shard *shard, uint64_t hash, const unsigned char *key)
+{
+        long mask = shard->capacity - 1;
+        long i = (long)(hash & (uint64_t)mask);
+        for (;;) {
+                Entry *entry = &shard->entries[i];
+                if (!entry->used || (entry->hash == hash &&
+                                     memcmp(entry->key, key, KEY_BYTES) == 0)) {
+                        return entry;
+                }
+                i = (i + 1) & mask;
+        }
+}
+
+/********** find_hash ********
+ *
+ * Use:
+ *      Finds the entry with a hash, or the empty entry where it belongs.
+ * Parameters:
+ *      Shard *shard:  The shard being searched.
+ *      uint64_t hash: The hash.
+ * Return:
+ *      Pointer to the entry.
+ * Expects:
+ *      That the shard is locked and not full.
+ * Notes:
+ *      Used for profiles, where the invariant alone is the key.
+ *
+ ************************/
+static Entry *find_hash(Shard *shard, uint64_t hash)
+{
+        long mask = shard->capacity - 1;
+        long i = (long)(hash & (uint64_t)mask);
+        while (shard->entries[i].used && shard->entries[i].hash != hash) {
+                i = (i + 1) & mask;
+        }
+        return &shard->entries[i];
+}
+
+/********** grow_shard ********
+ *
+ * Use:
+ *      Doubles the table of a shard and reinserts its entries.
+ * Parameters:
+ *      Shard *shard: The shard being grown.
+ * Return:
+ *      None.
+ * Expects:
+ *      That the shard is locked.
+ * Notes:
+ *      None.
+ *
+ ************************/
+static void grow_shard(Shard *shard)
+{
+        Entry *old = shard->entries;
+        long old_capacity = shard->capacity;
+        shard->capacity *= 2;
+        shard->entries = CALLOC(shard->capacity, sizeof(Entry));
+        for (long i = 0; i < old_capacity; i++) {
+                if (old[i].used) {
+                        *find_slot(shard, old[i].hash, old[i].key) = old[i];
+                }
+        }
+        FREE(old);
+}
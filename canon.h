@@ -0,0 +1,39 @@
+/*
+ *     canon.h
+ *     by nozden01 & bdioni01, 2/12/2024
+ *     iii
+ *
+ *     Struct and function declarations for canonical forms of 9x9 sudoku
+ *     boards and a concurrent set of canonical boards.
+ *
+ *     Two boards are equivalent when one can be turned into the other by
+ *     relabeling the digits, transposing, permuting rows within a band or
+ *     columns within a stack, and permuting bands or stacks. Every such
+ *     transformation keeps a board valid or invalid and keeps its number of
+ *     solutions, so only one board of each class needs to be checked.
+ */
+
+#ifndef CANON_INCLUDED
+#define CANON_INCLUDED
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <assert.h>
+#include "mem.h"
+
+#define CANON_CELLS 81
+
+typedef struct Canonset_T *Canonset_T;
+
+void Canon_board(const unsigned char *cells, unsigned char *canonical);
+uint64_t Canon_hash(const unsigned char *canonical);
+uint64_t Canon_invariant(const unsigned char *cells);
+
+Canonset_T Canonset_new(long hint);
+bool Canonset_insert(Canonset_T set, const unsigned char *cells);
+long Canonset_size(Canonset_T set);
+void Canonset_free(Canonset_T *set);
+
+#endif
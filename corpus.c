@@ -0,0 +1,688 @@
+/*
+ *     corpus.c
+ *     by nozden01 & bdioni01, 2/12/2024
+ *     iii
+ *
+ *     Function implementations for binary sudoku corpora.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "corpus.h"
+
+static const char MAGIC[8] = { 'I', 'I', 'I', 'S', 'D', 'K', '0', '1' };
+
+/* Byte offsets of the header fields. */
+enum {
+        BOX_FIELD = 8,
+        RECORD_FIELD = 12,
+        COUNT_FIELD = 16,
+        INDEX_FIELD = 24
+};
+
+struct Corpus_writer {
+        FILE *fp;
+        int box;
+        long count;
+        uint64_t offset;
+        uint64_t *index;
+        long capacity;
+        unsigned char *buffer;
+        bool failed;
+};
+
+struct Corpus_T {
+        const unsigned char *base;
+        size_t length;
+        int box;
+        long record_bytes;
+        long count;
+        const unsigned char *index;
+};
+
+static void write_bytes(Corpus_writer writer, const void *bytes,
+                        size_t length);
+static long packed_bytes(int n);
+static void pack_cells(const unsigned char *cells, int n, unsigned char *out);
+static int packed_cell(const unsigned char *record, int n, int k);
+static void put_u32(unsigned char *p, uint32_t v);
+static void put_u64(unsigned char *p, uint64_t v);
+static uint32_t get_u32(const unsigned char *p);
+static uint64_t get_u64(const unsigned char *p);
+
+/********** Corpus_create ********
+ *
+ * Use:
+ *      Creates a corpus file for writing.
+ * Parameters:
+ *      const char *path: Path of the file to create.
+ *      int box:          Box size of every board, or 0 for a mixed corpus
+ *                        in which every board carries its own size.
+ * Return:
+ *      A writer, or NULL if the file could not be created.
+ * Expects:
+ *      path is not NULL and box is 0 or in [2, CORPUS_MAX_BOX] (throws a
+ *      CRE if not).
+ * Notes:
+ *      The header is written by Corpus_finish, which must be called to
+ *      produce a readable file. Until then the header is zeros, which
+ *      Corpus_open rejects.
+ *
+ ************************/
+Corpus_writer Corpus_create(const char *path, int box)
+{
+        assert(path != NULL);
+        assert(box == 0 || (box > 1 && box <= CORPUS_MAX_BOX));
+        FILE *fp = fopen(path, "wb");
+        if (fp == NULL) {
+                return NULL;
+        }
+        Corpus_writer writer;
+        NEW(writer);
+        writer->fp = fp;
+        writer->box = box;
+        writer->count = 0;
+        writer->offset = CORPUS_HEADER_BYTES;
+        writer->index = NULL;
+        writer->capacity = 0;
+        writer->buffer = ALLOC(1 + packed_bytes(CORPUS_MAX_BOX *
+                                                CORPUS_MAX_BOX));
+        writer->failed = false;
+
+        unsigned char header[CORPUS_HEADER_BYTES] = { 0 };
+        write_bytes(writer, header, sizeof(header));
+        return writer;
+}
+
+/********** Corpus_append ********
+ *
+ * Use:
+ *      Packs a board and appends it to the corpus.
+ * Parameters:
+ *      Corpus_writer writer:       The corpus being written.
+ *      const unsigned char *cells: The n * n cells in row-major order, where
+ *                                  n is box * box.
+ *      int box:                    Box size of this board.
+ * Return:
+ *      False if the board does not fit the corpus (its box differs from the
+ *      one given to Corpus_create), true otherwise.
+ * Expects:
+ *      writer and cells are not NULL and box is in [2, CORPUS_MAX_BOX]
+ *      (throws a CRE if not).
+ * Notes:
+ *      Cells above the largest value a cell can hold (15 in a nibble, 255
+ *      in a byte) are stored as that value. No such value is a legal digit,
+ *      so the board stays exactly as valid as it was.
+ *
+ ************************/
+bool Corpus_append(Corpus_writer writer, const unsigned char *cells, int box)
+{
+        assert(writer != NULL && cells != NULL);
+        assert(box > 1 && box <= CORPUS_MAX_BOX);
+        if (writer->box != 0 && writer->box != box) {
+                return false;
+        }
+
+        int n = box * box;
+        long bytes = packed_bytes(n);
+        unsigned char *out = writer->buffer;
+        if (writer->box == 0) {
+                if (writer->count == writer->capacity) {
+                        writer->capacity = writer->capacity * 2 + 1024;
+                        long size = writer->capacity * (long)sizeof(uint64_t);
+                        if (writer->index == NULL) {
+                                writer->index = ALLOC(size);
+                        } else {
+                                RESIZE(writer->index, size);
+                        }
+                }
+                writer->index[writer->count] = writer->offset;
+                *out++ = (unsigned char)box;
+                bytes++;
+        }
+        pack_cells(cells, n, out);
+        write_bytes(writer, writer->buffer, (size_t)bytes);
+        writer->offset += (uint64_t)bytes;
+        writer->count++;
+        return true;
+}
+
+/********** Corpus_finish ********
+ *
+ * Use:
+ *      Writes the record index (for a mixed corpus) and the header, closes
+ *      the file and frees the writer.
+ * Parameters:
+ *      Corpus_writer *writer: Pointer to the writer being finished.
+ * Return:
+ *      True if every byte of the corpus was written, false if a write
+ *      failed (for example on a full disk).
+ * Expects:
+ *      writer and *writer are not NULL (throws a CRE if not).
+ * Notes:
+ *      Sets *writer to NULL. After a failed write the header is left as
+ *      zeros, so a truncated corpus is never mistaken for a valid one.
+ *
+ ************************/
+bool Corpus_finish(Corpus_writer *writer)
+{
+        assert(writer != NULL && *writer != NULL);
+        Corpus_writer w = *writer;
+
+        uint64_t index_offset = 0;
+        if (w->box == 0) {
+                index_offset = w->offset;
+                unsigned char entry[8];
+                for (long i = 0; i < w->count; i++) {
+                        put_u64(entry, w->index[i]);
+                        write_bytes(w, entry, sizeof(entry));
+                }
+        }
+
+        unsigned char header[CORPUS_HEADER_BYTES] = { 0 };
+        memcpy(header, MAGIC, sizeof(MAGIC));
+        put_u32(header + BOX_FIELD, (uint32_t)w->box);
+        put_u32(header + RECORD_FIELD,
+                w->box == 0 ? 0 : (uint32_t)packed_bytes(w->box * w->box));
+        put_u64(header + COUNT_FIELD, (uint64_t)w->count);
+        put_u64(header + INDEX_FIELD, index_offset);
+        /* Flush the records before the header goes in, so that a write
+         * error found only at flush still leaves the header zeroed. */
+        if (fflush(w->fp) != 0) {
+                w->failed = true;
+        }
+        if (!w->failed && fseek(w->fp, 0, SEEK_SET) != 0) {
+                w->failed = true;
+        }
+        if (!w->failed) {
+                write_bytes(w, header, sizeof(header));
+        }
+        if (fclose(w->fp) != 0) {
+                w->failed = true;
+        }
+        bool ok = !w->failed;
+
+        if (w->index != NULL) {
+                FREE(w->index);
+        }
+        FREE(w->buffer);
+        FREE(*writer);
+        return ok;
+}
+
+/********** Corpus_open ********
+ *
+ * Use:
+ *      Maps a corpus file read-only and checks its header.
+ * Parameters:
+ *      const char *path: Path of the corpus.
+ * Return:
+ *      The opened corpus, or NULL if the file cannot be opened or mapped or
+ *      is not a well-formed corpus.
+ * Expects:
+ *      path is not NULL (throws a CRE if not).
+ * Notes:
+ *      Pages are loaded on demand, so opening a large corpus is cheap and
+ *      random access only touches the pages of the boards that are read.
+ *      The client closes the corpus with Corpus_close.
+ *
+ ************************/
+Corpus_T Corpus_open(const char *path)
+{
+        assert(path != NULL);
+        int fd = open(path, O_RDONLY);
+        if (fd < 0) {
+                return NULL;
+        }
+        struct stat st;
+        if (fstat(fd, &st) != 0 || st.st_size < CORPUS_HEADER_BYTES) {
+                close(fd);
+                return NULL;
+        }
+        size_t length = (size_t)st.st_size;
+        void *map = mmap(NULL, length, PROT_READ, MAP_SHARED, fd, 0);
+        close(fd);
+        if (map == MAP_FAILED) {
+                return NULL;
+        }
+
+        const unsigned char *base = map;
+        int box = (int)get_u32(base + BOX_FIELD);
+        long record_bytes = (long)get_u32(base + RECORD_FIELD);
+        uint64_t count = get_u64(base + COUNT_FIELD);
+        uint64_t index = get_u64(base + INDEX_FIELD);
+        bool ok = memcmp(base, MAGIC, sizeof(MAGIC)) == 0 &&
+                  box >= 0 && box <= CORPUS_MAX_BOX && box != 1;
+        if (ok && box != 0) {
+                ok = record_bytes == packed_bytes(box * box) &&
+                     count <= (length - CORPUS_HEADER_BYTES) /
+                              (uint64_t)record_bytes;
+        } else if (ok) {
+                ok = index >= CORPUS_HEADER_BYTES && index <= length &&
+                     count <= (length - index) / 8;
+        }
+        if (!ok) {
+                munmap(map, length);
+                return NULL;
+        }
+
+        Corpus_T corpus;
+        NEW(corpus);
+        corpus->base = base;
+        corpus->length = length;
+        corpus->box = box;
+        corpus->record_bytes = record_bytes;
+        corpus->count = (long)count;
+        corpus->index = (box == 0) ? base + index : NULL;
+        return corpus;
+}
+
+/********** Corpus_count ********
+ *
+ * Use:
+ *      Returns the number of boards in a corpus.
+ * Parameters:
+ *      Corpus_T corpus: The corpus being queried.
+ * Return:
+ *      The number of boards.
+ * Expects:
+ *      corpus is not NULL (throws a CRE if not).
+ * Notes:
+ *      None.
+ *
+ ************************/
+long Corpus_count(Corpus_T corpus)
+{
+        assert(corpus != NULL);
+        return corpus->count;
+}
+
+/********** Corpus_box ********
+ *
+ * Use:
+ *      Returns the box size of board i.
+ * Parameters:
+ *      Corpus_T corpus: The corpus being read.
+ *      long i:          Index of the board.
+ * Return:
+ *      The box size, or 0 if a mixed corpus holds a damaged record.
+ * Expects:
+ *      corpus is not NULL and i is in [0, count) (throws a CRE if not).
+ * Notes:
+ *      None.
+ *
+ ************************/
+int Corpus_box(Corpus_T corpus, long i)
+{
+        assert(corpus != NULL && i >= 0 && i < corpus->count);
+        if (corpus->box != 0) {
+                return corpus->box;
+        }
+        uint64_t offset = get_u64(corpus->index + 8 * i);
+        if (offset >= corpus->length) {
+                return 0;
+        }
+        int box = corpus->base[offset];
+        if (box < 2 || box > CORPUS_MAX_BOX ||
+            offset + 1 + (uint64_t)packed_bytes(box * box) >
+            corpus->length) {
+                return 0;
+        }
+        return box;
+}
+
+/********** Corpus_record ********
+ *
+ * Use:
+ *      Returns a pointer to the packed cells of board i inside the mapping.
+ * Parameters:
+ *      Corpus_T corpus: The corpus being read.
+ *      long i:          Index of the board.
+ * Return:
+ *      Pointer to the packed cells, valid until Corpus_close, or NULL if a
+ *      mixed corpus holds a damaged record.
+ * Expects:
+ *      corpus is not NULL and i is in [0, count) (throws a CRE if not).
+ * Notes:
+ *      No data is copied.
+ *
+ ************************/
+const unsigned char *Corpus_record(Corpus_T corpus, long i)
+{
+        assert(corpus != NULL && i >= 0 && i < corpus->count);
+        if (corpus->box != 0) {
+                return corpus->base + CORPUS_HEADER_BYTES +
+                       i * corpus->record_bytes;
+        }
+        if (Corpus_box(corpus, i) == 0) {
+                return NULL;
+        }
+        return corpus->base + get_u64(corpus->index + 8 * i) + 1;
+}
+
+/********** Corpus_cell ********
+ *
+ * Use:
+ *      Decodes one cell of board i.
+ * Parameters:
+ *      Corpus_T corpus: The corpus being read.
+ *      long i:          Index of the board.
+ *      int col:         Column of the cell.
+ *      int row:         Row of the cell.
+ * Return:
+ *      The value of the cell, 0 for empty.
+ * Expects:
+ *      corpus is not NULL, i is in [0, count), the record is intact, and
+ *      col and row are on the board (throws a CRE if not).
+ * Notes:
+ *      None.
+ *
+ ************************/
+int Corpus_cell(Corpus_T corpus, long i, int col, int row)
+{
+        int box = Corpus_box(corpus, i);
+        assert(box != 0);
+        int n = box * box;
+        assert(col >= 0 && col < n && row >= 0 && row < n);
+        return packed_cell(Corpus_record(corpus, i), n, row * n + col);
+}
+
+/********** Corpus_unpack ********
+ *
+ * Use:
+ *      Copies board i into a UArray2 of ints, for clients that need one.
+ * Parameters:
+ *      Corpus_T corpus: The corpus being read.
+ *      long i:          Index of the board.
+ *      UArray2_T board: Board of side box * box receiving the cells.
+ * Return:
+ *      None.
+ * Expects:
+ *      The same as Corpus_cell, and that board has the right size (throws a
+ *      CRE if not).
+ * Notes:
+ *      Validation and solving read records in place; this is only needed to
+ *      hand a board to code written against UArray2.
+ *
+ ************************/
+void Corpus_unpack(Corpus_T corpus, long i, UArray2_T board)
+{
+        int box = Corpus_box(corpus, i);
+        assert(box != 0 && board != NULL);
+        int n = box * box;
+        assert(UArray2_width(board) == n && UArray2_height(board) == n);
+        const unsigned char *record = Corpus_record(corpus, i);
+        for (int row = 0; row < n; row++) {
+                for (int col = 0; col < n; col++) {
+                        *(int *)UArray2_at(board, col, row) =
+                                packed_cell(record, n, row * n + col);
+                }
+        }
+}
+
+/********** Corpus_check ********
+ *
+ * Use:
+ *      Checks whether board i is a solved sudoku, reading the packed cells
+ *      straight from the mapping.
+ * Parameters:
+ *      Corpus_T corpus: The corpus being read.
+ *      long i:          Index of the board.
+ * Return:
+ *      True if every row, column and box holds each digit 1 to n once.
+ * Expects:
+ *      corpus is not NULL and i is in [0, count) (throws a CRE if not).
+ * Notes:
+ *      Stops at the first illegal value or duplicate, like the sudoku
+ *      program. Damaged records are not valid.
+ *
+ ************************/
+bool Corpus_check(Corpus_T corpus, long i)
+{
+        int box = Corpus_box(corpus, i);
+        if (box == 0) {
+                return false;
+        }
+        int n = box * box;
+        const unsigned char *record = Corpus_record(corpus, i);
+
+        /* Bit d of each mask is set once digit d has been seen. */
+        uint64_t rows[CORPUS_MAX_BOX * CORPUS_MAX_BOX] = { 0 };
+        uint64_t cols[CORPUS_MAX_BOX * CORPUS_MAX_BOX] = { 0 };
+        uint64_t boxes[CORPUS_MAX_BOX * CORPUS_MAX_BOX] = { 0 };
+        int k = 0;
+        for (int row = 0; row < n; row++) {
+                for (int col = 0; col < n; col++, k++) {
+                        int digit = packed_cell(record, n, k);
+                        if (digit < 1 || digit > n) {
+                                return false;
+                        }
+                        uint64_t bit = (uint64_t)1 << digit;
+                        int b = (row / box) * box + col / box;
+                        if ((rows[row] | cols[col] | boxes[b]) & bit) {
+                                return false;
+                        }
+                        rows[row] |= bit;
+                        cols[col] |= bit;
+                        boxes[b] |= bit;
+                }
+        }
+        return true;
+}
+
+/********** Corpus_close ********
+ *
+ * Use:
+ *      Unmaps a corpus and frees the memory associated with it.
+ * Parameters:
+ *      Corpus_T *corpus: Pointer to the corpus being closed.
+ * Return:
+ *      None.
+ * Expects:
+ *      corpus and *corpus are not NULL (throws a CRE if not).
+ * Notes:
+ *      Pointers returned by Corpus_record become invalid. Sets *corpus to
+ *      NULL.
+ *
+ ************************/
+void Corpus_close(Corpus_T *corpus)
+{
+        assert(corpus != NULL && *corpus != NULL);
+        munmap((void *)(*corpus)->base, (*corpus)->length);
+        FREE(*corpus);
+}
+
+/********** write_bytes ********
+ *
+ * Use:
+ *      Writes bytes to the corpus file, noting a short write.
+ * Parameters:
+ *      Corpus_writer writer: The corpus being written.
+ *      const void *bytes:    The bytes.
+ *      size_t length:        How many.
+ * Return:
+ *      None.
+ * Expects:
+ *      None.
+ * Notes:
+ *      Once a write has failed the rest are skipped; Corpus_finish reports
+ *      the failure.
+ *
+ ************************/
+static void write_bytes(Corpus_writer writer, const void *bytes,
+                        size_t length)
+{
+        if (!writer->failed &&
+            fwrite(bytes, 1, length, writer->fp) != length) {
+                writer->failed = true;
+        }
+}
+
+/********** packed_bytes ********
+ *
+ * Use:
+ *      Returns the size of the packed cells of a board with side n.
+ * Parameters:
+ *      int n: Side of the board.
+ * Return:
+ *      The number of bytes.
+ * Expects:
+ *      None.
+ * Notes:
+ *      Sides up to 15 fit every value in a nibble; larger sides use a byte.
+ *
+ ************************/
+static long packed_bytes(int n)
+{
+        long cells = (long)n * n;
+        return (n <= 15) ? (cells + 1) / 2 : cells;
+}
+
+/********** pack_cells ********
+ *
+ * Use:
+ *      Packs n * n cells into the corpus record layout.
+ * Parameters:
+ *      const unsigned char *cells: The cells in row-major order.
+ *      int n:                      Side of the board.
+ *      unsigned char *out:         Buffer of packed_bytes(n) bytes.
+ * Return:
+ *      None.
+ * Expects:
+ *      None.
+ * Notes:
+ *      Values too large for a cell are stored as the largest value.
+ *
+ ************************/
+static void pack_cells(const unsigned char *cells, int n, unsigned char *out)
+{
+        long total = (long)n * n;
+        if (n > 15) {
+                memcpy(out, cells, (size_t)total);
+                return;
+        }
+        memset(out, 0, (size_t)packed_bytes(n));
+        for (long k = 0; k < total; k++) {
+                unsigned value = cells[k] > 15 ? 15 : cells[k];
+                out[k / 2] |= (unsigned char)(value << (4 * (k % 2)));
+        }
+}
+
+/********** packed_cell ********
+ *
+ * Use:
+ *      Decodes cell k of a packed record.
+ * Parameters:
+ *      const unsigned char *record: The packed cells.
+ *      int n:                       Side of the board.
+ *      int k:                       Row-major index of the cell.
+ * Return:
+ *      The value of the cell.
+ * Expects:
+ *      None.
+ * Notes:
+ *      None.
+ *
+ ************************/
+static int packed_cell(const unsigned char *record, int n, int k)
+{
+        if (n > 15) {
+                return record[k];
+        }
+        return (record[k / 2] >> (4 * (k % 2))) & 0xF;
+}
+
+/********** put_u32 ********
+ *
+ * Use:
+ *      Stores a 32-bit integer in little-endian order.
+ * Parameters:
+ *      unsigned char *p: Where to store it.
+ *      uint32_t v:       The value.
+ * Return:
+ *      None.
+ * Expects:
+ *      None.
+ * Notes:
+ *      None.
+ *
+ ************************/
+static void put_u32(unsigned char *p, uint32_t v)
+{
+        for (int i = 0; i < 4; i++) {
+                p[i] = (unsigned char)(v >> (8 * i));
+        }
+}
+
+/********** put_u64 ********
+ *
+ * Use:
+ *      Stores a 64-bit integer in little-endian order.
+ * Parameters:
+ *      unsigned char *p: Where to store it.
+ *      uint64_t v:       The value.
+ * Return:
+ *      None.
+ * Expects:
+ *      None.
+ * Notes:
+ *      None.
+ *
+ ************************/
+static void put_u64(unsigned char *p, uint64_t v)
+{
+        for (int i = 0; i < 8; i++) {
+                p[i] = (unsigned char)(v >> (8 * i));
+        }
+}
+
+/********** get_u32 ********
+ *
+ * Use:
+ *      Loads a little-endian 32-bit integer.
+ * Parameters:
+ *      const unsigned char *p: Where to load it from.
+ * Return:
+ *      The value.
+ * Expects:
+ *      None.
+ * Notes:
+ *      None.
+ *
+ ************************/
+static uint32_t get_u32(const unsigned char *p)
+{
+        uint32_t v = 0;
+        for (int i = 3; i >= 0; i--) {
+                v = (v << 8) | p[i];
+        }
+        return v;
+}
+
+/********** get_u64 ********
+ *
+ * Use:
+ *      Loads a little-endian 64-bit integer.
+ * Parameters:
+ *      const unsigned char *p: Where to load it from.
+ * Return:
+ *      The value.
+ * Expects:
+ *      None.
+ * Notes:
+ *      None.
+ *
+ ************************/
+static uint64_t get_u64(const unsigned char *p)
+{
+        uint64_t v = 0;
+        for (int i = 7; i >= 0; i--) {
+                v = (v << 8) | p[i];
+        }
+        return v;
+}
@@ -0,0 +1,51 @@
+/*
+ *     corpus.h
+ *     by nozden01 & bdioni01, 2/12/2024
+ *     iii
+ *
+ *     Struct and function declarations for binary sudoku corpora.
+ *
+ *     A corpus file is a 64-byte header followed by the boards. Cells are
+ *     stored row-major, two to a byte (low nibble first) when the side is at
+ *     most 15 and one to a byte otherwise, so a 9x9 board takes 41 bytes.
+ *     When every board has the same size, records have a fixed length and
+ *     board i is found by arithmetic. A mixed corpus (box 0 in the header)
+ *     prefixes every record with its box size and ends with an index of
+ *     64-bit record offsets. All integers are little-endian.
+ *
+ *     Readers map the file and decode cells straight out of the mapping,
+ *     so opening a corpus costs nothing and boards are never copied.
+ */
+
+#ifndef CORPUS_INCLUDED
+#define CORPUS_INCLUDED
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <assert.h>
+#include "uarray2.h"
+#include "mem.h"
+
+#define CORPUS_HEADER_BYTES 64
+#define CORPUS_MAX_BOX 7
+
+typedef struct Corpus_T *Corpus_T;
+typedef struct Corpus_writer *Corpus_writer;
+
+Corpus_writer Corpus_create(const char *path, int box);
+bool Corpus_append(Corpus_writer writer, const unsigned char *cells,
+                   int box);
+bool Corpus_finish(Corpus_writer *writer);
+
+Corpus_T Corpus_open(const char *path);
+long Corpus_count(Corpus_T corpus);
+int Corpus_box(Corpus_T corpus, long i);
+const unsigned char *Corpus_record(Corpus_T corpus, long i);
+int Corpus_cell(Corpus_T corpus, long i, int col, int row);
+void Corpus_unpack(Corpus_T corpus, long i, UArray2_T board);
+bool Corpus_check(Corpus_T corpus, long i);
+void Corpus_close(Corpus_T *corpus);
+
+#endif
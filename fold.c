@@ -0,0 +1,388 @@
+/*
+ *     fold.c
+ *     by nozden01 & bdioni01, 2/12/2024
+ *     iii
+ *
+ *     Function implementations for folds that run across threads.
+ */
+
+#include "fold.h"
+#include "pages.h"
+
+/* Bands per worker; more than one so that a slow worker does not hold up
+ * the whole fold. */
+#define BANDS_PER_WORKER 4
+
+/* Rows below which a fold is not worth handing to the pool. */
+#define MIN_PARALLEL_ROWS 64
+
+/* One band of rows and the partial result it reduces into. */
+typedef struct Band {
+        void (*fold_band)(int row, int height, void *partial, void *closure);
+        int row;
+        int height;
+        void *partial;
+        void *closure;
+        int node;
+} Band;
+
+/* Rectangle and array shared by the bands of the typed folds; first is
+ * the address of the grid's row 0 and stride the bytes between rows. */
+typedef struct Rect {
+        void *grid;
+        int col;
+        int width;
+        const char *first;
+        long stride;
+} Rect;
+
+static void fold_bands(Taskpool_T pool, int row, int height,
+                       void fold_band(int row, int height, void *partial,
+                                      void *closure),
+                       void combine(void *acc, const void *partial,
+                                    void *closure),
+                       void *acc, int size, void *closure,
+                       int node_of(int row, void *closure));
+static int (*rect_locator(void))(int row, void *closure);
+static int rect_node(int row, void *closure);
+static void run_band(Taskpool_T pool, int worker, void *arg);
+static void int_sum_band(int row, int height, void *partial, void *closure);
+static void int_sum_combine(void *acc, const void *partial, void *closure);
+static void double_sum_band(int row, int height, void *partial,
+                            void *closure);
+static void double_sum_combine(void *acc, const void *partial,
+                               void *closure);
+static void bit2_count_band(int row, int height, void *partial,
+                            void *closure);
+
+/********** Fold_rows ********
+ *
+ * Use:
+ *      Folds over the rows [row, row + height) in bands. Each band starts
+ *      from a copy of *acc, fold_band reduces the band's rows into it, and
+ *      the partials are then combined into *acc in band order.
+ * Parameters:
+ *      Taskpool_T pool:   Pool whose workers run the bands, or NULL to run
+ *                         the fold on the calling thread.
+ *      int row:           First row of the fold.
+ *      int height:        Number of rows.
+ *      void fold_band(int row, int height, void *partial, void *closure):
+ *                         Reduces rows [row, row + height) into partial.
+ *      void combine(void *acc, const void *partial, void *closure):
+ *                         Combines one band's partial into acc.
+ *      void *acc:         The identity of the fold on entry, the result
+ *                         on return.
+ *      int size:          Size of *acc in bytes.
+ *      void *closure:     Passed to fold_band and combine; usually the
+ *                         array being folded.
+ * Return:
+ *      None.
+ * Expects:
+ *      fold_band, combine and acc are not NULL, height >= 0 and size > 0
+ *      (throws a CRE if not).
+ *      That it is not called from inside a task of the same pool.
+ * Notes:
+ *      Waits for every task in the pool, not only the bands, so the pool
+ *      should not be running other work at the same time. Short folds run
+ *      on the calling thread, where fold_band is applied to *acc directly
+ *      and combine is not called.
+ *
+ ************************/
+void Fold_rows(Taskpool_T pool, int row, int height,
+               void fold_band(int row, int height, void *partial,
+                              void *closure),
+               void combine(void *acc, const void *partial, void *closure),
+               void *acc, int size, void *closure)
+{
+        fold_bands(pool, row, height, fold_band, combine, acc, size, closure,
+                   NULL);
+}
+
+/********** Fold_int_sum ********
+ *
+ * Use:
+ *      Sums a rectangle of a typed int array across the pool's workers.
+ * Parameters:
+ *      Taskpool_T pool:       Pool that runs the fold, or NULL.
+ *      UArray2_int arr:       The array.
+ *      int col, int row:      Top-left corner of the rectangle.
+ *      int width, int height: Size of the rectangle.
+ * Return:
+ *      The sum of the elements in the rectangle.
+ * Expects:
+ *      arr is not NULL and the rectangle lies within it (throws a CRE if
+ *      not).
+ * Notes:
+ *      Each band is summed with UArray2_int_sum.
+ *
+ ************************/
+long Fold_int_sum(Taskpool_T pool, UArray2_int arr, int col, int row,
+                  int width, int height)
+{
+        UARRAY2_ASSERT_RECT(arr, col, row, width, height);
+        Rect rect = { arr, col, width, arr->generic.elems,
+                      arr->generic.stride };
+        long sum = 0;
+        fold_bands(pool, row, height, int_sum_band, int_sum_combine, &sum,
+                   sizeof(sum), &rect, rect_locator());
+        return sum;
+}
+
+/********** Fold_double_sum ********
+ *
+ * Use:
+ *      Sums a rectangle of a typed double array across the pool's workers.
+ * Parameters:
+ *      Taskpool_T pool:       Pool that runs the fold, or NULL.
+ *      UArray2_double arr:    The array.
+ *      int col, int row:      Top-left corner of the rectangle.
+ *      int width, int height: Size of the rectangle.
+ * Return:
+ *      The sum of the elements in the rectangle.
+ * Expects:
+ *      arr is not NULL and the rectangle lies within it (throws a CRE if
+ *      not).
+ * Notes:
+ *      The bands and the partial sums within them are added in a fixed
+ *      order, so the result is the same from run to run for a given pool
+ *      size, but may differ in the last bits from a sequential sum.
+ *
+ ************************/
+double Fold_double_sum(Taskpool_T pool, UArray2_double arr, int col,
+                       int row, int width, int height)
+{
+        UARRAY2_ASSERT_RECT(arr, col, row, width, height);
+        Rect rect = { arr, col, width, arr->generic.elems,
+                      arr->generic.stride };
+        double sum = 0;
+        fold_bands(pool, row, height, double_sum_band, double_sum_combine,
+                   &sum, sizeof(sum), &rect, rect_locator());
+        return sum;
+}
+
+/********** Fold_bit2_count ********
+ *
+ * Use:
+ *      Counts the 1 bits in a rectangle of a bitmap across the pool's
+ *      workers.
+ * Parameters:
+ *      Taskpool_T pool:       Pool that runs the fold, or NULL.
+ *      Bit2_T bitmap:         The bitmap.
+ *      int col, int row:      Top-left corner of the rectangle.
+ *      int width, int height: Size of the rectangle.
+ * Return:
+ *      The number of 1 bits in the rectangle.
+ * Expects:
+ *      bitmap is not NULL and the rectangle lies within it (throws a CRE
+ *      if not).
+ * Notes:
+ *      Each band is counted with Bit2_count.
+ *
+ ************************/
+long Fold_bit2_count(Taskpool_T pool, Bit2_T bitmap, int col, int row,
+                     int width, int height)
+{
+        assert(bitmap != NULL);
+        assert((row >= 0) && (height >= 0) &&
+               ((long)row + height <= Bit2_height(bitmap)));
+        Rect rect = { bitmap, col, width, (const char *)bitmap->words,
+                      bitmap->words_per_row * (long)sizeof(uint64_t) };
+        long count = 0;
+        fold_bands(pool, row, height, bit2_count_band, int_sum_combine,
+                   &count, sizeof(count), &rect, rect_locator());
+        return count;
+}
+
+/********** fold_bands ********
+ *
+ * Use:
+ *      Does the work of Fold_rows, optionally running each band on the
+ *      NUMA node that holds its first row.
+ * Parameters:
+ *      The same as Fold_rows, and:
+ *      int node_of(int row, void *closure):
+ *              Returns the node that holds the given row, or -1 for no
+ *              preference; NULL runs every band wherever the pool does.
+ * Return:
+ *      None.
+ * Expects:
+ *      The same as Fold_rows.
+ * Notes:
+ *      A worker runs a band with a node on that node's CPUs and returns
+ *      to its old affinity when the band is done.
+ *
+ ************************/
+static void fold_bands(Taskpool_T pool, int row, int height,
+                       void fold_band(int row, int height, void *partial,
+                                      void *closure),
+                       void combine(void *acc, const void *partial,
+                                    void *closure),
+                       void *acc, int size, void *closure,
+                       int node_of(int row, void *closure))
+{
+        assert(fold_band != NULL && combine != NULL && acc != NULL);
+        assert(height >= 0 && size > 0);
+        int nbands = 1;
+        if (pool != NULL && height >= MIN_PARALLEL_ROWS) {
+                nbands = Taskpool_workers(pool) * BANDS_PER_WORKER;
+                if (nbands > height) {
+                        nbands = height;
+                }
+        }
+        if (nbands <= 1) {
+                fold_band(row, height, acc, closure);
+                return;
+        }
+
+        Band *bands = ALLOC(nbands * (long)sizeof(Band));
+        char *partials = ALLOC(nbands * (long)size);
+        for (int i = 0; i < nbands; i++) {
+                int first = (int)((long)height * i / nbands);
+                int next = (int)((long)height * (i + 1) / nbands);
+                bands[i].fold_band = fold_band;
+                bands[i].row = row + first;
+                bands[i].height = next - first;
+                bands[i].partial = partials + (long)i * size;
+                bands[i].closure = closure;
+                bands[i].node = node_of != NULL ? node_of(bands[i].row,
+                                                          closure)
+                                                : -1;
+                memcpy(bands[i].partial, acc, size);
+                Taskpool_submit(pool, run_band, &bands[i]);
+        }
+        Taskpool_wait(pool);
+        for (int i = 0; i < nbands; i++) {
+                combine(acc, bands[i].partial, closure);
+        }
+        FREE(partials);
+        FREE(bands);
+}
+
+/********** rect_locator ********
+ *
+ * Use:
+ *      Chooses the node_of function for the typed folds.
+ * Parameters:
+ *      None.
+ * Return:
+ *      rect_node when there is more than one NUMA node, otherwise NULL, so
+ *      that single-node machines never ask the kernel where pages are.
+ * Expects:
+ *      None.
+ * Notes:
+ *      None.
+ *
+ ************************/
+static int (*rect_locator(void))(int row, void *closure)
+{
+        return Pages_nodes() > 1 ? rect_node : NULL;
+}
+
+/********** rect_node ********
+ *
+ * Use:
+ *      node_of function of the typed folds.
+ * Parameters:
+ *      int row:       A row of the grid.
+ *      void *closure: The Rect being folded.
+ * Return:
+ *      The node that holds the row's first page, or -1 if unknown.
+ * Expects:
+ *      None.
+ * Notes:
+ *      None.
+ *
+ ************************/
+static int rect_node(int row, void *closure)
+{
+        Rect *rect = closure;
+        if (rect->first == NULL) {
+                return -1;
+        }
+        return Pages_node_of(rect->first + row * rect->stride);
+}
+
+/********** run_band ********
+ *
+ * Use:
+ *      Taskpool task that folds one band.
+ * Parameters:
+ *      Taskpool_T pool: The pool (not used).
+ *      int worker:      Index of the worker (not used).
+ *      void *arg:       The Band.
+ * Return:
+ *      None.
+ * Expects:
+ *      None.
+ * Notes:
+ *      The band belongs to Fold_rows, which frees it after the wait. A
+ *      band with a node runs on that node's CPUs, and the worker gets its
+ *      old affinity back afterwards, so later tasks are not confined.
+ *
+ ************************/
+static void run_band(Taskpool_T pool, int worker, void *arg)
+{
+        (void) pool;
+        (void) worker;
+        Band *band = arg;
+        Pages_affinity saved = { false, { 0 } };
+        if (band->node >= 0) {
+                Pages_run_on_node(band->node, &saved);
+        }
+        band->fold_band(band->row, band->height, band->partial,
+                        band->closure);
+        Pages_restore_affinity(&saved);
+}
+
+/********** int_sum_band ********
+ *
+ * Use:
+ *      Band function of Fold_int_sum; adds the band's sum to the long at
+ *      partial.
+ * Parameters:
+ *      int row, int height: The band.
+ *      void *partial:       Pointer to the band's long sum.
+ *      void *closure:       The Rect being summed.
+ * Return:
+ *      None.
+ * Expects:
+ *      None.
+ * Notes:
+ *      The remaining band and combine functions follow the same pattern.
+ *
+ ************************/
+static void int_sum_band(int row, int height, void *partial, void *closure)
+{
+        Rect *rect = closure;
+        *(long *)partial += UArray2_int_sum(rect->grid, rect->col, row,
+                                            rect->width, height);
+}
+
+static void int_sum_combine(void *acc, const void *partial, void *closure)
+{
+        (void) closure;
+        *(long *)acc += *(const long *)partial;
+}
+
+static void double_sum_band(int row, int height, void *partial,
+                            void *closure)
+{
+        Rect *rect = closure;
+        *(double *)partial += UArray2_double_sum(rect->grid, rect->col, row,
+                                                 rect->width, height);
+}
+
+static void double_sum_combine(void *acc, const void *partial,
+                               void *closure)
+{
+        (void) closure;
+        *(double *)acc += *(const double *)partial;
+}
+
+static void bit2_count_band(int row, int height, void *partial,
+                            void *closure)
+{
+        Rect *rect = closure;
+        *(long *)partial += Bit2_count(rect->grid, rect->col, row,
+                                       rect->width, height);
+}
@@ -0,0 +1,39 @@
+/*
+ *     fold.h
+ *     by nozden01 & bdioni01, 2/12/2024
+ *     iii
+ *
+ *     Function declarations for folds that run across threads. A fold
+ *     splits the rows of a rectangle into bands, reduces each band into its
+ *     own partial result on a Taskpool worker, and then combines the
+ *     partials in band order, so results do not depend on scheduling.
+ *     Passing a NULL pool runs the whole fold on the calling thread.
+ *     On a NUMA machine the typed folds run each band on the node that
+ *     holds its rows, which pays off for grids placed with pages.h.
+ */
+
+#ifndef FOLD_INCLUDED
+#define FOLD_INCLUDED
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include "mem.h"
+#include "taskpool.h"
+#include "uarray2t.h"
+#include "bit2.h"
+
+void Fold_rows(Taskpool_T pool, int row, int height,
+               void fold_band(int row, int height, void *partial,
+                              void *closure),
+               void combine(void *acc, const void *partial, void *closure),
+               void *acc, int size, void *closure);
+long Fold_int_sum(Taskpool_T pool, UArray2_int arr, int col, int row,
+                  int width, int height);
+double Fold_double_sum(Taskpool_T pool, UArray2_double arr, int col,
+                       int row, int width, int height);
+long Fold_bit2_count(Taskpool_T pool, Bit2_T bitmap, int col, int row,
+                     int width, int height);
+
+#endif
@@ -0,0 +1,162 @@
+/*
+ *     frame.c
+ *     by nozden01 & bdioni01, 2/12/2024
+ *     iii
+ *
+ *     Function implementations for the framed socket protocol.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <errno.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include "frame.h"
+
+static bool send_all(int fd, const unsigned char *bytes, uint64_t length);
+static void put_be(unsigned char *bytes, uint64_t value, int size);
+static uint64_t get_be(const unsigned char *bytes, int size);
+
+/********** Frame_send ********
+ *
+ * Use:
+ *      Sends one message.
+ * Parameters:
+ *      int fd:                      The connected socket.
+ *      const Frame_header *header:  The header; length is the number of
+ *                                   payload bytes.
+ *      const void *payload:         The payload, or NULL if length is 0.
+ * Return:
+ *      True if the whole message was sent, false if the peer is gone or
+ *      the socket failed.
+ * Expects:
+ *      header is not NULL (throws a CRE if not).
+ * Notes:
+ *      Sends with MSG_NOSIGNAL, so a closed peer is an error to return
+ *      rather than a SIGPIPE that kills the process.
+ *
+ ************************/
+bool Frame_send(int fd, const Frame_header *header, const void *payload)
+{
+        assert(header != NULL);
+        assert(payload != NULL || header->length == 0);
+        unsigned char bytes[FRAME_HEADER_BYTES];
+        put_be(bytes, header->kind, 4);
+        put_be(bytes + 4, header->status, 4);
+        put_be(bytes + 8, header->length, 8);
+        return send_all(fd, bytes, FRAME_HEADER_BYTES) &&
+               send_all(fd, payload, header->length);
+}
+
+/********** Frame_receive_header ********
+ *
+ * Use:
+ *      Receives the header of the next message.
+ * Parameters:
+ *      int fd:               The connected socket.
+ *      Frame_header *header: Filled in with the header.
+ * Return:
+ *      True if a whole header arrived, false at end of stream or on an
+ *      error.
+ * Expects:
+ *      header is not NULL (throws a CRE if not).
+ * Notes:
+ *      Frame_receive follows the same pattern, receiving exactly length
+ *      payload bytes; the client reads the header first to learn how many.
+ *
+ ************************/
+bool Frame_receive_header(int fd, Frame_header *header)
+{
+        assert(header != NULL);
+        unsigned char bytes[FRAME_HEADER_BYTES];
+        if (!Frame_receive(fd, bytes, FRAME_HEADER_BYTES)) {
+                return false;
+        }
+        header->kind = (uint32_t)get_be(bytes, 4);
+        header->status = (uint32_t)get_be(bytes + 4, 4);
+        header->length = get_be(bytes + 8, 8);
+        return true;
+}
+
+bool Frame_receive(int fd, void *payload, uint64_t length)
+{
+        assert(payload != NULL || length == 0);
+        unsigned char *bytes = payload;
+        while (length > 0) {
+                ssize_t got = recv(fd, bytes, length, 0);
+                if (got < 0 && errno == EINTR) {
+                        continue;
+                }
+                if (got <= 0) {
+                        return false;
+                }
+                bytes += got;
+                length -= got;
+        }
+        return true;
+}
+
+/********** send_all ********
+ *
+ * Use:
+ *      Sends every byte of a buffer, however many calls it takes.
+ * Parameters:
+ *      int fd:                     The connected socket.
+ *      const unsigned char *bytes: The buffer.
+ *      uint64_t length:            Its length.
+ * Return:
+ *      True if every byte was sent, false otherwise.
+ * Expects:
+ *      None.
+ * Notes:
+ *      None.
+ *
+ ************************/
+static bool send_all(int fd, const unsigned char *bytes, uint64_t length)
+{
+        while (length > 0) {
+                ssize_t sent = send(fd, bytes, length, MSG_NOSIGNAL);
+                if (sent < 0 && errno == EINTR) {
+                        continue;
+                }
+                if (sent <= 0) {
+                        return false;
+                }
+                bytes += sent;
+                length -= sent;
+        }
+        return true;
+}
+
+/********** put_be ********
+ *
+ * Use:
+ *      Stores an unsigned number big-endian.
+ * Parameters:
+ *      unsigned char *bytes: Where to store it.
+ *      uint64_t value:       The number.
+ *      int size:             Number of bytes, 4 or 8.
+ * Return:
+ *      None.
+ * Expects:
+ *      None.
+ * Notes:
+ *      get_be follows the same pattern, loading the number.
+ *
+ ************************/
+static void put_be(unsigned char *bytes, uint64_t value, int size)
+{
+        for (int i = size - 1; i >= 0; i--) {
+                bytes[i] = (unsigned char)(value & 0xff);
+                value >>= 8;
+        }
+}
+
+static uint64_t get_be(const unsigned char *bytes, int size)
+{
+        uint64_t value = 0;
+        for (int i = 0; i < size; i++) {
+                value = (value << 8) | bytes[i];
+        }
+        return value;
+}
@@ -0,0 +1,54 @@
+/*
+ *     frame.h
+ *     by nozden01 & bdioni01, 2/12/2024
+ *     iii
+ *
+ *     Struct and function declarations for the framed protocol that
+ *     iii_serve and iii_client speak over a Unix domain socket. Every
+ *     message is a 16-byte header followed by length bytes of payload:
+ *
+ *         bytes 0-3    kind, one of the FRAME_ constants below
+ *         bytes 4-7    status: 0 in requests; in responses 0 for success,
+ *                      FRAME_FAILED when the program would have exited
+ *                      with a failure, FRAME_BAD for a malformed request
+ *         bytes 8-15   length of the payload
+ *
+ *     all big-endian. A request's payload is the input file the program
+ *     would read; a response's is what it would print on stdout, and its
+ *     kind is the request's. A connection carries any number of requests,
+ *     each answered before the next is read.
+ */
+
+#ifndef FRAME_INCLUDED
+#define FRAME_INCLUDED
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <assert.h>
+
+/* Request kinds: unblackedges a PBM, check a solved sudoku (as the sudoku
+ * program does), solve a sudoku puzzle (as sudoku_solve does), or stop the
+ * server. */
+#define FRAME_CLEAN 'c'
+#define FRAME_CHECK 'v'
+#define FRAME_SOLVE 's'
+#define FRAME_QUIT 'q'
+
+#define FRAME_FAILED 1
+#define FRAME_BAD 2
+
+#define FRAME_HEADER_BYTES 16
+
+typedef struct Frame_header {
+        uint32_t kind;
+        uint32_t status;
+        uint64_t length;
+} Frame_header;
+
+bool Frame_send(int fd, const Frame_header *header, const void *payload);
+bool Frame_receive_header(int fd, Frame_header *header);
+bool Frame_receive(int fd, void *payload, uint64_t length);
+
+#endif
@@ -0,0 +1,933 @@
+/*
+ *     gencorpus.c
+ *     by nozden01 & bdioni01, 2/12/2024
+ *     iii
+ *
+ *     Function implementations for the gencorpus program.
+ *     Writes reproducible inputs for unblackedges and sudoku: scanned-page
+ *     bitmaps with black edges and random noise, a grayscale scan of one
+ *     of them for unblackedges -t, adversarial bitmaps (a
+ *     one-pixel spiral and a serpentine, whose single black region is as
+ *     long as the image allows, and a fully black image), streams of
+ *     valid or invalid sudoku boards drawn from many solved grids, and
+ *     sudoku puzzles with empty cells. The same seed always gives the same
+ *     bytes.
+ *
+ *     Usage: gencorpus [-s seed] [-4] page width height density
+ *            gencorpus [-s seed] [-4] spiral|serpentine|black width height
+ *            gencorpus [-s seed] valid|invalid count
+ *            gencorpus [-s seed] puzzle blanks
+ *            gencorpus [-s seed] suite directory [scale]
+ *            -s seed  seed for the random choices, 1 by default
+ *            -4       write raw (P4) bitmaps instead of plain (P1)
+ *     The first four forms write to stdout. "suite" fills a directory with
+ *     the standard workloads, with sides and board counts multiplied by
+ *     scale, and a manifest for the bench_run program.
+ */
+
+#include "gencorpus.h"
+
+/* Letter paper at 300 dpi. */
+#define PAGE_WIDTH 2550
+#define PAGE_HEIGHT 3300
+#define MAZE_SIDE 2048
+#define SUITE_BOARDS 10000L
+#define PATH_BYTES 4096
+/* Solved grids a board stream is drawn from; each is its own symmetry
+ * class with overwhelming probability. */
+#define BASE_GRIDS 64
+/* Empty cells of the suite's puzzle, leaving 26 givens. */
+#define PUZZLE_BLANKS 55
+
+/********** main ********
+ *
+ * Use:
+ *      Runs the gencorpus program.
+ * Parameters:
+ *      int argc:     The number of arguments on the command line.
+ *      char *argv[]: Pointer to an array of arguments from the command line.
+ * Return:
+ *      EXIT_SUCCESS if everything was written, EXIT_FAILURE otherwise.
+ * Expects:
+ *      Valid arguments (prints usage and returns EXIT_FAILURE if not).
+ * Notes:
+ *      None.
+ *
+ ************************/
+int main(int argc, char *argv[])
+{
+        uint64_t seed = 1;
+        int format = 1;
+        int i = 1;
+        for (; i < argc && argv[i][0] == '-'; i++) {
+                if (strcmp(argv[i], "-s") == 0 && i + 1 < argc) {
+                        seed = strtoull(argv[++i], NULL, 10);
+                } else if (strcmp(argv[i], "-4") == 0) {
+                        format = 4;
+                } else {
+                        break;
+                }
+        }
+        /* xorshift must not start at zero. */
+        uint64_t state = seed * 0x9E3779B97F4A7C15ULL + 1;
+
+        const char *kind = i < argc ? argv[i] : "";
+        int nargs = argc - i - 1;
+        char **args = argv + i + 1;
+        if (strcmp(kind, "suite") == 0 && (nargs == 1 || nargs == 2)) {
+                int scale = nargs == 2 ? atoi(args[1]) : 1;
+                if (scale > 0) {
+                        return write_suite(args[0], scale, seed)
+                               ? EXIT_SUCCESS : EXIT_FAILURE;
+                }
+        } else if ((strcmp(kind, "valid") == 0 ||
+                    strcmp(kind, "invalid") == 0) && nargs == 1) {
+                long count = atol(args[0]);
+                if (count > 0) {
+                        write_boards(stdout, count, kind[0] == 'v', &state);
+                        return EXIT_SUCCESS;
+                }
+        } else if (strcmp(kind, "puzzle") == 0 && nargs == 1) {
+                int blanks = atoi(args[0]);
+                if (blanks >= 0 && blanks <= 81) {
+                        write_puzzle(stdout, blanks, &state);
+                        return EXIT_SUCCESS;
+                }
+        } else if (nargs >= 2) {
+                int width = atoi(args[0]);
+                int height = atoi(args[1]);
+                Bit2_T bitmap = NULL;
+                if (width < 3 || height < 3) {
+                        bitmap = NULL;
+                } else if (strcmp(kind, "page") == 0 && nargs == 3) {
+                        bitmap = make_page(width, height, atof(args[2]),
+                                           &state);
+                } else if (strcmp(kind, "spiral") == 0 && nargs == 2) {
+                        bitmap = make_spiral(width, height);
+                } else if (strcmp(kind, "serpentine") == 0 && nargs == 2) {
+                        bitmap = make_serpentine(width, height);
+                } else if (strcmp(kind, "black") == 0 && nargs == 2) {
+                        bitmap = make_black(width, height);
+                }
+                if (bitmap != NULL) {
+                        write_pbm(stdout, bitmap, format);
+                        Bit2_free(&bitmap);
+                        return EXIT_SUCCESS;
+                }
+        }
+        fprintf(stderr,
+                "Usage: %s [-s seed] [-4] page width height density\n"
+                "       %s [-s seed] [-4] spiral|serpentine|black "
+                "width height\n"
+                "       %s [-s seed] valid|invalid count\n"
+                "       %s [-s seed] puzzle blanks\n"
+                "       %s [-s seed] suite directory [scale]\n",
+                argv[0], argv[0], argv[0], argv[0], argv[0]);
+        return EXIT_FAILURE;
+}
+
+/********** next_random ********
+ *
+ * Use:
+ *      Returns the next number of a xorshift64* generator.
+ * Parameters:
+ *      uint64_t *state: The generator state; never zero.
+ * Return:
+ *      A uniformly distributed 64-bit number.
+ * Expects:
+ *      state is not NULL.
+ * Notes:
+ *      Used instead of rand() so that a seed gives the same corpus on every
+ *      platform.
+ *
+ ************************/
+uint64_t next_random(uint64_t *state)
+{
+        uint64_t x = *state;
+        x ^= x >> 12;
+        x ^= x << 25;
+        x ^= x >> 27;
+        *state = x;
+        return x * 0x2545F4914F6CDD1DULL;
+}
+
+/********** random_unit ********
+ *
+ * Use:
+ *      Returns a random number in [0, 1).
+ * Parameters:
+ *      uint64_t *state: The generator state.
+ * Return:
+ *      The number.
+ * Expects:
+ *      state is not NULL.
+ * Notes:
+ *      None.
+ *
+ ************************/
+double random_unit(uint64_t *state)
+{
+        return (next_random(state) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+/********** make_page ********
+ *
+ * Use:
+ *      Makes a bitmap that looks like a scanned page: black bands of ragged
+ *      width along every edge, and black noise pixels everywhere.
+ * Parameters:
+ *      int width, int height: Size of the page.
+ *      double density:        Chance that any pixel is noise.
+ *      uint64_t *state:       The generator state.
+ * Return:
+ *      The new bitmap; the caller frees it.
+ * Expects:
+ *      width, height >= 3, state is not NULL.
+ * Notes:
+ *      Noise touching the bands is black edge too, so density controls how
+ *      much of the page unblackedges has to clear; near 0.59 the noise
+ *      percolates and most of the page is one black region.
+ *
+ ************************/
+Bit2_T make_page(int width, int height, double density, uint64_t *state)
+{
+        Bit2_T bitmap = Bit2_new(width, height);
+        int band = width < height ? width / 100 : height / 100;
+        band = band < 1 ? 1 : band;
+        for (int row = 0; row < height; row++) {
+                int left = band + (int)(next_random(state) % band);
+                int right = width - band - (int)(next_random(state) % band);
+                for (int col = 0; col < width; col++) {
+                        int bit = col < left || col >= right ||
+                                  random_unit(state) < density;
+                        Bit2_put(bitmap, col, row, bit);
+                }
+        }
+        for (int col = 0; col < width; col++) {
+                int top = band + (int)(next_random(state) % band);
+                int bottom = height - band - (int)(next_random(state) % band);
+                for (int row = 0; row < height; row++) {
+                        if (row < top || row >= bottom) {
+                                Bit2_put(bitmap, col, row, 1);
+                        }
+                }
+        }
+        return bitmap;
+}
+
+/********** make_spiral ********
+ *
+ * Use:
+ *      Makes a bitmap holding a one-pixel-wide black spiral that starts at
+ *      the top-left corner and winds inward with one-pixel white gaps.
+ * Parameters:
+ *      int width, int height: Size of the bitmap.
+ * Return:
+ *      The new bitmap; the caller frees it.
+ * Expects:
+ *      width, height >= 3.
+ * Notes:
+ *      The whole spiral is one black edge region about half the image long,
+ *      reached from the border only at its outer turn, so unblackedges must
+ *      follow it all the way to the center.
+ *
+ ************************/
+Bit2_T make_spiral(int width, int height)
+{
+        static const int DCOL[4] = { 1, 0, -1, 0 };
+        static const int DROW[4] = { 0, 1, 0, -1 };
+        Bit2_T bitmap = Bit2_new(width, height);
+        int col = 0;
+        int row = 0;
+        int dir = 0;
+        int turns = 0;
+        Bit2_put(bitmap, col, row, 1);
+        while (turns < 2) {
+                int c1 = col + DCOL[dir];
+                int r1 = row + DROW[dir];
+                int c2 = c1 + DCOL[dir];
+                int r2 = r1 + DROW[dir];
+                bool open = c1 >= 0 && c1 < width && r1 >= 0 && r1 < height &&
+                            Bit2_get(bitmap, c1, r1) == 0 &&
+                            !(c2 >= 0 && c2 < width && r2 >= 0 &&
+                              r2 < height && Bit2_get(bitmap, c2, r2) == 1);
+                if (open) {
+                        col = c1;
+                        row = r1;
+                        Bit2_put(bitmap, col, row, 1);
+                        turns = 0;
+                } else {
+                        dir = (dir + 1) % 4;
+                        turns++;
+                }
+        }
+        return bitmap;
+}
+
+/********** make_serpentine ********
+ *
+ * Use:
+ *      Makes a bitmap holding a black path that runs back and forth across
+ *      every other row, joined at alternating ends.
+ * Parameters:
+ *      int width, int height: Size of the bitmap.
+ * Return:
+ *      The new bitmap; the caller frees it.
+ * Expects:
+ *      width, height >= 3.
+ * Notes:
+ *      The path touches the border only along the top row, so like the
+ *      spiral it is one long region that must be followed from one end.
+ *
+ ************************/
+Bit2_T make_serpentine(int width, int height)
+{
+        Bit2_T bitmap = Bit2_new(width, height);
+        for (int col = 0; col < width; col++) {
+                Bit2_put(bitmap, col, 0, 1);
+        }
+        for (int row = 1; row < height - 1; row++) {
+                if (row % 2 == 0) {
+                        for (int col = 1; col < width - 1; col++) {
+                                Bit2_put(bitmap, col, row, 1);
+                        }
+                } else {
+                        Bit2_put(bitmap, (row / 2) % 2 ? 1 : width - 2, row,
+                                 1);
+                }
+        }
+        return bitmap;
+}
+
+/********** make_black ********
+ *
+ * Use:
+ *      Makes a bitmap with every pixel black.
+ * Parameters:
+ *      int width, int height: Size of the bitmap.
+ * Return:
+ *      The new bitmap; the caller frees it.
+ * Expects:
+ *      width, height >= 3.
+ * Notes:
+ *      Every pixel is black edge, and every pixel has four black
+ *      neighbors, which is the most work a pixel can cause.
+ *
+ ************************/
+Bit2_T make_black(int width, int height)
+{
+        Bit2_T bitmap = Bit2_new(width, height);
+        for (int row = 0; row < height; row++) {
+                for (int col = 0; col < width; col++) {
+                        Bit2_put(bitmap, col, row, 1);
+                }
+        }
+        return bitmap;
+}
+
+/********** write_pbm ********
+ *
+ * Use:
+ *      Writes a bitmap as a plain (P1) or raw (P4) pbm.
+ * Parameters:
+ *      FILE *outputfp: Where to write.
+ *      Bit2_T bitmap:  The bitmap.
+ *      int format:     1 for plain, 4 for raw.
+ * Return:
+ *      None.
+ * Expects:
+ *      outputfp and bitmap are not NULL, format is 1 or 4.
+ * Notes:
+ *      Plain rows are written the way unblackedges writes them. Raw rows
+ *      are packed eight pixels to a byte, first pixel in the high bit, and
+ *      padded to a whole byte.
+ *
+ ************************/
+void write_pbm(FILE *outputfp, Bit2_T bitmap, int format)
+{
+        assert(outputfp != NULL && bitmap != NULL);
+        assert(format == 1 || format == 4);
+        int width = Bit2_width(bitmap);
+        int height = Bit2_height(bitmap);
+        fprintf(outputfp, "P%d\n%d %d\n", format, width, height);
+        for (int row = 0; row < height; row++) {
+                unsigned byte = 0;
+                for (int col = 0; col < width; col++) {
+                        int bit = Bit2_get(bitmap, col, row);
+                        if (format == 1) {
+                                putc('0' + bit, outputfp);
+                                putc(col == width - 1 ? '\n' : ' ', outputfp);
+                                continue;
+                        }
+                        byte |= (unsigned)bit << (7 - col % 8);
+                        if (col % 8 == 7 || col == width - 1) {
+                                putc((int)byte, outputfp);
+                                byte = 0;
+                        }
+                }
+        }
+}
+
+/********** write_scan ********
+ *
+ * Use:
+ *      Writes a bitmap as a raw (P5) graymap, the way a scanner would
+ *      deliver it before thresholding.
+ * Parameters:
+ *      FILE *outputfp:  Where to write.
+ *      Bit2_T bitmap:   The bitmap.
+ *      uint64_t *state: The generator state.
+ * Return:
+ *      None.
+ * Expects:
+ *      outputfp, bitmap and state are not NULL.
+ * Notes:
+ *      Black pixels get random samples in [0, 96) and white ones in
+ *      [160, 256), so any level from 96 to 160 thresholds the scan back
+ *      to the bitmap.
+ *
+ ************************/
+void write_scan(FILE *outputfp, Bit2_T bitmap, uint64_t *state)
+{
+        assert(outputfp != NULL && bitmap != NULL && state != NULL);
+        int width = Bit2_width(bitmap);
+        int height = Bit2_height(bitmap);
+        fprintf(outputfp, "P5\n%d %d\n255\n", width, height);
+        for (int row = 0; row < height; row++) {
+                for (int col = 0; col < width; col++) {
+                        int sample = (int)(next_random(state) % 96);
+                        if (!Bit2_get(bitmap, col, row)) {
+                                sample += 160;
+                        }
+                        putc(sample, outputfp);
+                }
+        }
+}
+
+/********** make_base ********
+ *
+ * Use:
+ *      Makes a random solved 9x9 sudoku grid.
+ * Parameters:
+ *      int grid[9][9]:   Receives the grid, indexed [row][col].
+ *      uint64_t *state:  The generator state.
+ * Return:
+ *      None.
+ * Expects:
+ *      grid and state are not NULL.
+ * Notes:
+ *      Fills the cells in order by backtracking, trying the digits of each
+ *      cell in a random order, so any solved grid can come out.
+ *
+ ************************/
+void make_base(int grid[9][9], uint64_t *state)
+{
+        memset(grid, 0, 9 * sizeof(grid[0]));
+        bool filled = fill_cells(grid, 0, state);
+        assert(filled);
+        (void) filled;
+}
+
+/********** fill_cells ********
+ *
+ * Use:
+ *      Fills the cells of a grid from the given one on, keeping the grid
+ *      valid.
+ * Parameters:
+ *      int grid[9][9]:   The grid; cells before cell are filled, the rest
+ *                        are 0.
+ *      int cell:         Row-major index of the first empty cell.
+ *      uint64_t *state:  The generator state.
+ * Return:
+ *      True if the grid could be completed, false otherwise (and the cells
+ *      from cell on are 0 again).
+ * Expects:
+ *      None.
+ * Notes:
+ *      Recurses once per cell, so at most 81 deep.
+ *
+ ************************/
+bool fill_cells(int grid[9][9], int cell, uint64_t *state)
+{
+        if (cell == 81) {
+                return true;
+        }
+        int row = cell / 9;
+        int col = cell % 9;
+        unsigned used = 0;
+        for (int k = 0; k < 9; k++) {
+                used |= 1u << grid[row][k];
+                used |= 1u << grid[k][col];
+                used |= 1u << grid[row / 3 * 3 + k / 3][col / 3 * 3 + k % 3];
+        }
+        int digits[9];
+        for (int i = 0; i < 9; i++) {
+                digits[i] = i + 1;
+        }
+        for (int i = 8; i > 0; i--) {
+                int j = (int)(next_random(state) % (i + 1));
+                int t = digits[i];
+                digits[i] = digits[j];
+                digits[j] = t;
+        }
+        for (int i = 0; i < 9; i++) {
+                if (used & (1u << digits[i])) {
+                        continue;
+                }
+                grid[row][col] = digits[i];
+                if (fill_cells(grid, cell + 1, state)) {
+                        return true;
+                }
+        }
+        grid[row][col] = 0;
+        return false;
+}
+
+/********** make_board ********
+ *
+ * Use:
+ *      Makes a random solved 9x9 sudoku board equivalent to a base grid.
+ * Parameters:
+ *      int board[9][9]:  Receives the board, indexed [row][col].
+ *      int base[9][9]:   The solved grid to start from.
+ *      uint64_t *state:  The generator state.
+ * Return:
+ *      None.
+ * Expects:
+ *      board, base and state are not NULL.
+ * Notes:
+ *      Applies random validity-preserving changes to the base: relabeling
+ *      digits, swapping rows within bands, columns within stacks, bands,
+ *      stacks, and transposing.
+ *
+ ************************/
+void make_board(int board[9][9], int base[9][9], uint64_t *state)
+{
+        int digits[10];
+        int rows[9];
+        int cols[9];
+        for (int i = 0; i < 10; i++) {
+                digits[i] = i;
+        }
+        for (int i = 9; i > 1; i--) {
+                int j = 1 + (int)(next_random(state) % i);
+                int t = digits[i];
+                digits[i] = digits[j];
+                digits[j] = t;
+        }
+        for (int pass = 0; pass < 2; pass++) {
+                int *order = pass == 0 ? rows : cols;
+                int bands[3] = { 0, 1, 2 };
+                for (int i = 2; i > 0; i--) {
+                        int j = (int)(next_random(state) % (i + 1));
+                        int t = bands[i];
+                        bands[i] = bands[j];
+                        bands[j] = t;
+                }
+                for (int b = 0; b < 3; b++) {
+                        int within[3] = { 0, 1, 2 };
+                        for (int i = 2; i > 0; i--) {
+                                int j = (int)(next_random(state) % (i + 1));
+                                int t = within[i];
+                                within[i] = within[j];
+                                within[j] = t;
+                        }
+                        for (int k = 0; k < 3; k++) {
+                                order[3 * b + k] = 3 * bands[b] + within[k];
+                        }
+                }
+        }
+        bool transpose = next_random(state) & 1;
+        for (int r = 0; r < 9; r++) {
+                for (int c = 0; c < 9; c++) {
+                        int value = base[rows[r]][cols[c]];
+                        if (transpose) {
+                                board[c][r] = digits[value];
+                        } else {
+                                board[r][c] = digits[value];
+                        }
+                }
+        }
+}
+
+/********** break_board ********
+ *
+ * Use:
+ *      Makes a solved board invalid by copying one cell over another cell
+ *      of the same row.
+ * Parameters:
+ *      int board[9][9]:  The board, changed in place.
+ *      uint64_t *state:  The generator state.
+ * Return:
+ *      None.
+ * Expects:
+ *      board is solved, state is not NULL.
+ * Notes:
+ *      The duplicate lands anywhere on the board, so a checker that stops
+ *      at the first error reads a random amount of each invalid board.
+ *
+ ************************/
+void break_board(int board[9][9], uint64_t *state)
+{
+        int row = (int)(next_random(state) % 9);
+        int from = (int)(next_random(state) % 9);
+        int to = (from + 1 + (int)(next_random(state) % 8)) % 9;
+        board[row][to] = board[row][from];
+}
+
+/********** write_boards ********
+ *
+ * Use:
+ *      Writes boards back to back as plain (P2) graymaps.
+ * Parameters:
+ *      FILE *outputfp:   Where to write.
+ *      long count:       Number of boards.
+ *      bool valid:       Whether the boards are solved or broken.
+ *      uint64_t *state:  The generator state.
+ * Return:
+ *      None.
+ * Expects:
+ *      outputfp and state are not NULL.
+ * Notes:
+ *      A single board is input for sudoku; a stream is input for
+ *      sudoku_pack. Each board is drawn from one of up to BASE_GRIDS
+ *      independent solved grids, so a stream holds that many symmetry
+ *      classes, each many times over.
+ *
+ ************************/
+void write_boards(FILE *outputfp, long count, bool valid, uint64_t *state)
+{
+        int bases[BASE_GRIDS][9][9];
+        int nbases = count < BASE_GRIDS ? (int)count : BASE_GRIDS;
+        for (int i = 0; i < nbases; i++) {
+                make_base(bases[i], state);
+        }
+        int board[9][9];
+        for (long n = 0; n < count; n++) {
+                make_board(board, bases[next_random(state) % nbases], state);
+                if (!valid) {
+                        break_board(board, state);
+                }
+                write_board(outputfp, board);
+        }
+}
+
+/********** blank_board ********
+ *
+ * Use:
+ *      Turns a solved board into a puzzle by emptying some of its cells.
+ * Parameters:
+ *      int board[9][9]:  The board, changed in place.
+ *      int blanks:       Number of cells to empty.
+ *      uint64_t *state:  The generator state.
+ * Return:
+ *      None.
+ * Expects:
+ *      board is solved, 0 <= blanks <= 81, state is not NULL.
+ * Notes:
+ *      The cells are distinct and chosen uniformly. The puzzle keeps the
+ *      board as a solution but may have others.
+ *
+ ************************/
+void blank_board(int board[9][9], int blanks, uint64_t *state)
+{
+        assert(blanks >= 0 && blanks <= 81);
+        int cells[81];
+        for (int i = 0; i < 81; i++) {
+                cells[i] = i;
+        }
+        for (int i = 0; i < blanks; i++) {
+                int j = i + (int)(next_random(state) % (81 - i));
+                int t = cells[i];
+                cells[i] = cells[j];
+                cells[j] = t;
+                board[cells[i] / 9][cells[i] % 9] = 0;
+        }
+}
+
+/********** write_puzzle ********
+ *
+ * Use:
+ *      Writes one puzzle as a plain (P2) graymap, 0 marking an empty cell.
+ * Parameters:
+ *      FILE *outputfp:   Where to write.
+ *      int blanks:       Number of empty cells.
+ *      uint64_t *state:  The generator state.
+ * Return:
+ *      None.
+ * Expects:
+ *      outputfp and state are not NULL, 0 <= blanks <= 81.
+ * Notes:
+ *      Input for sudoku_solve and for solve requests to iii_serve.
+ *
+ ************************/
+void write_puzzle(FILE *outputfp, int blanks, uint64_t *state)
+{
+        int base[9][9];
+        int board[9][9];
+        make_base(base, state);
+        make_board(board, base, state);
+        blank_board(board, blanks, state);
+        write_board(outputfp, board);
+}
+
+/********** write_board ********
+ *
+ * Use:
+ *      Writes one board as a plain (P2) graymap.
+ * Parameters:
+ *      FILE *outputfp:   Where to write.
+ *      int board[9][9]:  The board, 0 for an empty cell.
+ * Return:
+ *      None.
+ * Expects:
+ *      outputfp and board are not NULL.
+ * Notes:
+ *      None.
+ *
+ ************************/
+void write_board(FILE *outputfp, int board[9][9])
+{
+        fprintf(outputfp, "P2\n9 9\n9\n");
+        for (int row = 0; row < 9; row++) {
+                for (int col = 0; col < 9; col++) {
+                        putc('0' + board[row][col], outputfp);
+                        putc(col == 8 ? '\n' : ' ', outputfp);
+                }
+        }
+}
+
+/********** write_suite ********
+ *
+ * Use:
+ *      Writes the standard workloads and their manifest to a directory.
+ * Parameters:
+ *      const char *dir: The directory, which must exist.
+ *      int scale:       Multiplier for image sides and board counts.
+ *      uint64_t seed:   The seed.
+ * Return:
+ *      True if every file was written, false otherwise.
+ * Expects:
+ *      dir is not NULL, scale > 0.
+ * Notes:
+ *      Each manifest line is "name input command [args ...]"; bench_run
+ *      runs the command with the input on stdin. The sudoku_pack lines
+ *      write the corpora that the sudoku_bulk lines after them read, and
+ *      program paths are relative to the directory bench_run runs in.
+ *
+ ************************/
+bool write_suite(const char *dir, int scale, uint64_t seed)
+{
+        char path[PATH_BYTES];
+        snprintf(path, sizeof(path), "%s/manifest", dir);
+        FILE *manifest = fopen(path, "w");
+        if (manifest == NULL) {
+                fprintf(stderr, "gencorpus: cannot write %s\n", path);
+                return false;
+        }
+        uint64_t state = seed * 0x9E3779B97F4A7C15ULL + 1;
+        int width = PAGE_WIDTH * scale;
+        int height = PAGE_HEIGHT * scale;
+        int side = MAZE_SIDE * scale;
+        bool ok = true;
+
+        Bit2_T bitmap = make_page(width, height, 0.02, &state);
+        ok = ok && write_image_file(dir, "page_p1.pbm", bitmap, 1, manifest);
+        ok = ok && write_image_file(dir, "page_p4.pbm", bitmap, 4, manifest);
+        uint64_t noise = state + 1;
+        ok = ok && write_scan_file(dir, "page_p5.pgm", bitmap, manifest,
+                                   &noise);
+        Bit2_free(&bitmap);
+        bitmap = make_page(width, height, 0.45, &state);
+        ok = ok && write_image_file(dir, "noisy_p4.pbm", bitmap, 4, manifest);
+        Bit2_free(&bitmap);
+        bitmap = make_spiral(side, side);
+        ok = ok && write_image_file(dir, "spiral_p4.pbm", bitmap, 4,
+                                    manifest);
+        Bit2_free(&bitmap);
+        bitmap = make_serpentine(side, side);
+        ok = ok && write_image_file(dir, "serpentine_p4.pbm", bitmap, 4,
+                                    manifest);
+        Bit2_free(&bitmap);
+        bitmap = make_black(width, height);
+        ok = ok && write_image_file(dir, "black_p4.pbm", bitmap, 4, manifest);
+        Bit2_free(&bitmap);
+
+        long boards = SUITE_BOARDS * scale;
+        ok = ok && write_board_file(dir, "board_valid.pgm", 1, true, &state);
+        ok = ok && write_board_file(dir, "board_invalid.pgm", 1, false,
+                                    &state);
+        ok = ok && write_board_file(dir, "boards_valid.pgm", boards, true,
+                                    &state);
+        ok = ok && write_board_file(dir, "boards_invalid.pgm", boards, false,
+                                    &state);
+        ok = ok && write_puzzle_file(dir, "board_puzzle.pgm", PUZZLE_BLANKS,
+                                     &state);
+        fprintf(manifest,
+                "sudoku_valid %s/board_valid.pgm ./sudoku\n"
+                "sudoku_invalid %s/board_invalid.pgm ./sudoku\n"
+                "sudoku_solve %s/board_puzzle.pgm ./sudoku_solve\n"
+                "sudoku_pack_valid %s/boards_valid.pgm ./sudoku_pack "
+                "%s/valid.sdk\n"
+                "sudoku_pack_invalid %s/boards_invalid.pgm ./sudoku_pack "
+                "%s/invalid.sdk\n"
+                "sudoku_bulk_valid %s/valid.sdk ./sudoku_bulk -s "
+                "%s/valid.sdk\n"
+                "sudoku_bulk_invalid %s/invalid.sdk ./sudoku_bulk -s "
+                "%s/invalid.sdk\n",
+                dir, dir, dir, dir, dir, dir, dir, dir, dir, dir, dir);
+        if (fclose(manifest) != 0) {
+                ok = false;
+        }
+        return ok;
+}
+
+/********** write_image_file ********
+ *
+ * Use:
+ *      Writes a bitmap to a file of the suite and adds its unblackedges
+ *      lines, dense, run-based and labeling, to the manifest.
+ * Parameters:
+ *      const char *dir:  The suite directory.
+ *      const char *name: Name of the file.
+ *      Bit2_T bitmap:    The bitmap.
+ *      int format:       1 for plain, 4 for raw.
+ *      FILE *manifest:   The open manifest.
+ * Return:
+ *      True if the file was written, false otherwise.
+ * Expects:
+ *      No argument is NULL.
+ * Notes:
+ *      The manifest names are "unblackedges_", "unblackedges_runs_" and
+ *      "unblackedges_labels_" followed by the file name without its
+ *      extension.
+ *
+ ************************/
+bool write_image_file(const char *dir, const char *name, Bit2_T bitmap,
+                      int format, FILE *manifest)
+{
+        char path[PATH_BYTES];
+        snprintf(path, sizeof(path), "%s/%s", dir, name);
+        FILE *fp = fopen(path, "wb");
+        if (fp == NULL) {
+                fprintf(stderr, "gencorpus: cannot write %s\n", path);
+                return false;
+        }
+        write_pbm(fp, bitmap, format);
+        if (fclose(fp) != 0) {
+                return false;
+        }
+        int stem = (int)(strrchr(name, '.') - name);
+        fprintf(manifest, "unblackedges_%.*s %s ./unblackedges\n", stem, name,
+                path);
+        fprintf(manifest, "unblackedges_runs_%.*s %s ./unblackedges -r\n",
+                stem, name, path);
+        fprintf(manifest, "unblackedges_labels_%.*s %s ./unblackedges -l\n",
+                stem, name, path);
+        return true;
+}
+
+/********** write_scan_file ********
+ *
+ * Use:
+ *      Writes a grayscale scan of a bitmap to a file of the suite and adds
+ *      its unblackedges -t line to the manifest.
+ * Parameters:
+ *      const char *dir:  The suite directory.
+ *      const char *name: Name of the file.
+ *      Bit2_T bitmap:    The bitmap.
+ *      FILE *manifest:   The open manifest.
+ *      uint64_t *state:  The generator state.
+ * Return:
+ *      True if the file was written, false otherwise.
+ * Expects:
+ *      No argument is NULL.
+ * Notes:
+ *      The manifest name is "unblackedges_threshold_" followed by the file
+ *      name without its extension. The level, 128, recovers the bitmap, so
+ *      the output is that of unblackedges on the bitmap itself.
+ *
+ ************************/
+bool write_scan_file(const char *dir, const char *name, Bit2_T bitmap,
+                     FILE *manifest, uint64_t *state)
+{
+        char path[PATH_BYTES];
+        snprintf(path, sizeof(path), "%s/%s", dir, name);
+        FILE *fp = fopen(path, "wb");
+        if (fp == NULL) {
+                fprintf(stderr, "gencorpus: cannot write %s\n", path);
+                return false;
+        }
+        write_scan(fp, bitmap, state);
+        if (fclose(fp) != 0) {
+                return false;
+        }
+        int stem = (int)(strrchr(name, '.') - name);
+        fprintf(manifest,
+                "unblackedges_threshold_%.*s %s ./unblackedges -t 128\n",
+                stem, name, path);
+        return true;
+}
+
+/********** write_board_file ********
+ *
+ * Use:
+ *      Writes a stream of boards to a file of the suite.
+ * Parameters:
+ *      const char *dir:  The suite directory.
+ *      const char *name: Name of the file.
+ *      long count:       Number of boards.
+ *      bool valid:       Whether the boards are solved or broken.
+ *      uint64_t *state:  The generator state.
+ * Return:
+ *      True if the file was written, false otherwise.
+ * Expects:
+ *      No pointer argument is NULL.
+ * Notes:
+ *      None.
+ *
+ ************************/
+bool write_board_file(const char *dir, const char *name, long count,
+                      bool valid, uint64_t *state)
+{
+        char path[PATH_BYTES];
+        snprintf(path, sizeof(path), "%s/%s", dir, name);
+        FILE *fp = fopen(path, "w");
+        if (fp == NULL) {
+                fprintf(stderr, "gencorpus: cannot write %s\n", path);
+                return false;
+        }
+        write_boards(fp, count, valid, state);
+        return fclose(fp) == 0;
+}
+
+/********** write_puzzle_file ********
+ *
+ * Use:
+ *      Writes one puzzle to a file of the suite.
+ * Parameters:
+ *      const char *dir:  The suite directory.
+ *      const char *name: Name of the file.
+ *      int blanks:       Number of empty cells.
+ *      uint64_t *state:  The generator state.
+ * Return:
+ *      True if the file was written, false otherwise.
+ * Expects:
+ *      No pointer argument is NULL, 0 <= blanks <= 81.
+ * Notes:
+ *      None.
+ *
+ ************************/
+bool write_puzzle_file(const char *dir, const char *name, int blanks,
+                       uint64_t *state)
+{
+        char path[PATH_BYTES];
+        snprintf(path, sizeof(path), "%s/%s", dir, name);
+        FILE *fp = fopen(path, "w");
+        if (fp == NULL) {
+                fprintf(stderr, "gencorpus: cannot write %s\n", path);
+                return false;
+        }
+        write_puzzle(fp, blanks, state);
+        return fclose(fp) == 0;
+}
@@ -0,0 +1,45 @@
+/*
+ *     gencorpus.h
+ *     by nozden01 & bdioni01, 2/12/2024
+ *     iii
+ *
+ *     Contains struct and function declarations for the gencorpus program.
+ *     Includes libraries and files necessary for this program to function.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include "bit2.h"
+
+uint64_t next_random(uint64_t *state);
+double random_unit(uint64_t *state);
+
+Bit2_T make_page(int width, int height, double density, uint64_t *state);
+Bit2_T make_spiral(int width, int height);
+Bit2_T make_serpentine(int width, int height);
+Bit2_T make_black(int width, int height);
+void write_pbm(FILE *outputfp, Bit2_T bitmap, int format);
+void write_scan(FILE *outputfp, Bit2_T bitmap, uint64_t *state);
+
+void make_base(int grid[9][9], uint64_t *state);
+bool fill_cells(int grid[9][9], int cell, uint64_t *state);
+void make_board(int board[9][9], int base[9][9], uint64_t *state);
+void break_board(int board[9][9], uint64_t *state);
+void write_boards(FILE *outputfp, long count, bool valid, uint64_t *state);
+void blank_board(int board[9][9], int blanks, uint64_t *state);
+void write_puzzle(FILE *outputfp, int blanks, uint64_t *state);
+void write_board(FILE *outputfp, int board[9][9]);
+
+bool write_suite(const char *dir, int scale, uint64_t seed);
+bool write_image_file(const char *dir, const char *name, Bit2_T bitmap,
+                      int format, FILE *manifest);
+bool write_scan_file(const char *dir, const char *name, Bit2_T bitmap,
+                     FILE *manifest, uint64_t *state);
+bool write_board_file(const char *dir, const char *name, long count,
+                      bool valid, uint64_t *state);
+bool write_puzzle_file(const char *dir, const char *name, int blanks,
+                       uint64_t *state);
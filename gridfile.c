@@ -0,0 +1,535 @@
+/*
+ *     gridfile.c
+ *     by nozden01 & bdioni01, 2/12/2024
+ *     iii
+ *
+ *     Function implementations for file-backed UArray2 and Bit2 grids.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "gridfile.h"
+
+#define MAGIC "iiigrid\n"
+#define VERSION 1
+#define KIND_UARRAY2 1
+#define KIND_BIT2 2
+#define HEADER_BYTES 64
+
+typedef struct Header {
+        char magic[8];
+        uint32_t version;
+        uint32_t kind;
+        int64_t width;
+        int64_t height;
+        int64_t size;
+        int64_t row_bytes;
+        char zero[16];
+} Header;
+
+static Header make_header(uint32_t kind, long width, long height, long size,
+                          long row_bytes);
+static bool map_grid(const char *path, bool writable, uint32_t kind,
+                     Header *header, char **base);
+static bool create_grid(const char *path, const Header *header,
+                        char **base);
+static void unmap_grid(void *data, long height, long row_bytes);
+static uint64_t bits_at(const uint64_t *words, long first, int count);
+
+/********** Gridfile_save_uarray2 ********
+ *
+ * Use:
+ *      Writes a 2D array to a grid file.
+ * Parameters:
+ *      UArray2_T arr:    The array, which may be a view.
+ *      const char *path: The file to write; it is replaced if it exists.
+ * Return:
+ *      True on success, false if the file could not be written.
+ * Expects:
+ *      arr and path are not NULL (throws a CRE if not).
+ * Notes:
+ *      Only the array's own elements are written, so saving a view crops
+ *      its parent.
+ *
+ ************************/
+bool Gridfile_save_uarray2(UArray2_T arr, const char *path)
+{
+        assert(arr != NULL && path != NULL);
+        int width = UArray2_width(arr);
+        int height = UArray2_height(arr);
+        long row_bytes = (long)width * UArray2_size(arr);
+        Header header = make_header(KIND_UARRAY2, width, height,
+                                    UArray2_size(arr), row_bytes);
+        FILE *fp = fopen(path, "wb");
+        if (fp == NULL) {
+                return false;
+        }
+        bool ok = fwrite(&header, sizeof(header), 1, fp) == 1;
+        for (int row = 0; ok && row < height && width > 0; row++) {
+                ok = fwrite(UArray2_at(arr, 0, row), row_bytes, 1, fp) == 1;
+        }
+        return (fclose(fp) == 0) && ok;
+}
+
+/********** Gridfile_open_uarray2 ********
+ *
+ * Use:
+ *      Opens a grid file written by Gridfile_save_uarray2 or
+ *      Gridfile_create_uarray2 as a 2D array backed by the file.
+ * Parameters:
+ *      const char *path: The grid file.
+ *      bool writable:    True to map the file for writing, so that changes
+ *                        to the array are written back to the file.
+ * Return:
+ *      The array, or NULL if the file cannot be opened or is not a UArray2
+ *      grid file.
+ * Expects:
+ *      path is not NULL (throws a CRE if not).
+ * Notes:
+ *      Writing to an array that was opened read-only is a segmentation
+ *      fault. Release the array with Gridfile_close_uarray2.
+ *
+ ************************/
+UArray2_T Gridfile_open_uarray2(const char *path, bool writable)
+{
+        assert(path != NULL);
+        Header header;
+        char *base;
+        if (!map_grid(path, writable, KIND_UARRAY2, &header, &base)) {
+                return NULL;
+        }
+        if (header.size <= 0 || header.size > INT32_MAX ||
+            header.row_bytes != header.width * header.size) {
+                unmap_grid(base + HEADER_BYTES, header.height,
+                           header.row_bytes);
+                return NULL;
+        }
+        UArray2_T arr;
+        NEW(arr);
+        arr->width = (int)header.width;
+        arr->height = (int)header.height;
+        arr->size = (int)header.size;
+        arr->stride = header.row_bytes;
+        arr->elems = base + HEADER_BYTES;
+        if (arr->width == 0 || arr->height == 0) {
+                unmap_grid(arr->elems, arr->height, arr->stride);
+                arr->elems = NULL;
+        }
+        return arr;
+}
+
+/********** Gridfile_create_uarray2 ********
+ *
+ * Use:
+ *      Creates a grid file for a zeroed 2D array and opens it for writing,
+ *      so that a grid larger than memory can be filled in place.
+ * Parameters:
+ *      const char *path:      The file to create; it is replaced if it
+ *                             exists.
+ *      int width, int height: Dimensions of the array.
+ *      int size:              Size of an element in bytes.
+ * Return:
+ *      The array, or NULL if the file cannot be created.
+ * Expects:
+ *      path is not NULL, width and height >= 0 and size > 0 (throws a CRE
+ *      if not).
+ * Notes:
+ *      The file is sparse until it is written. Release the array with
+ *      Gridfile_close_uarray2.
+ *
+ ************************/
+UArray2_T Gridfile_create_uarray2(const char *path, int width, int height,
+                                  int size)
+{
+        assert(path != NULL && width >= 0 && height >= 0 && size > 0);
+        Header header = make_header(KIND_UARRAY2, width, height, size,
+                                    (long)width * size);
+        char *base;
+        if (!create_grid(path, &header, &base)) {
+                return NULL;
+        }
+        UArray2_T arr;
+        NEW(arr);
+        arr->width = width;
+        arr->height = height;
+        arr->size = size;
+        arr->stride = header.row_bytes;
+        arr->elems = base + HEADER_BYTES;
+        if (width == 0 || height == 0) {
+                unmap_grid(arr->elems, height, arr->stride);
+                arr->elems = NULL;
+        }
+        return arr;
+}
+
+/********** Gridfile_close_uarray2 ********
+ *
+ * Use:
+ *      Unmaps a 2D array that was opened or created by this interface, and
+ *      frees it.
+ * Parameters:
+ *      UArray2_T *arr: Pointer to the array; set to NULL.
+ * Return:
+ *      None.
+ * Expects:
+ *      arr and *arr are not NULL (throws a CRE if not).
+ * Notes:
+ *      Changes to a writable array are in the file once this returns; the
+ *      kernel writes them to disk in its own time.
+ *
+ ************************/
+void Gridfile_close_uarray2(UArray2_T *arr)
+{
+        assert(arr != NULL && *arr != NULL);
+        if ((*arr)->elems != NULL) {
+                unmap_grid((*arr)->elems, (*arr)->height, (*arr)->stride);
+        }
+        FREE(*arr);
+}
+
+/********** Gridfile_save_bit2 ********
+ *
+ * Use:
+ *      Writes a bitmap to a grid file.
+ * Parameters:
+ *      Bit2_T bitmap:    The bitmap, which may be a view.
+ *      const char *path: The file to write; it is replaced if it exists.
+ * Return:
+ *      True on success, false if the file could not be written.
+ * Expects:
+ *      bitmap and path are not NULL (throws a CRE if not).
+ * Notes:
+ *      Rows are realigned to start at bit 0 of a word, so a view whose
+ *      rectangle starts partway into a word is saved as a plain bitmap.
+ *
+ ************************/
+bool Gridfile_save_bit2(Bit2_T bitmap, const char *path)
+{
+        assert(bitmap != NULL && path != NULL);
+        int width = Bit2_width(bitmap);
+        int height = Bit2_height(bitmap);
+        long nwords = ((long)width + 63) / 64;
+        Header header = make_header(KIND_BIT2, width, height, 0,
+                                    nwords * (long)sizeof(uint64_t));
+        FILE *fp = fopen(path, "wb");
+        if (fp == NULL) {
+                return false;
+        }
+        bool ok = fwrite(&header, sizeof(header), 1, fp) == 1;
+        uint64_t *row_words = NULL;
+        if (nwords > 0) {
+                row_words = CALLOC(nwords, sizeof(uint64_t));
+        }
+        for (int row = 0; ok && row < height && nwords > 0; row++) {
+                const uint64_t *words = bitmap->words +
+                                        row * bitmap->words_per_row;
+                for (long w = 0; w < nwords; w++) {
+                        int count = width - 64 * w < 64 ? width - 64 * w
+                                                        : 64;
+                        row_words[w] = bits_at(words,
+                                               bitmap->offset + 64 * w,
+                                               count);
+                }
+                ok = fwrite(row_words, sizeof(uint64_t), nwords, fp) ==
+                     (size_t)nwords;
+        }
+        FREE(row_words);
+        return (fclose(fp) == 0) && ok;
+}
+
+/********** Gridfile_open_bit2 ********
+ *
+ * Use:
+ *      Opens a grid file written by Gridfile_save_bit2 or
+ *      Gridfile_create_bit2 as a bitmap backed by the file.
+ * Parameters:
+ *      const char *path: The grid file.
+ *      bool writable:    True to map the file for writing, so that changes
+ *                        to the bitmap are written back to the file.
+ * Return:
+ *      The bitmap, or NULL if the file cannot be opened or is not a Bit2
+ *      grid file.
+ * Expects:
+ *      path is not NULL (throws a CRE if not).
+ * Notes:
+ *      Writing to a bitmap that was opened read-only is a segmentation
+ *      fault. Release the bitmap with Gridfile_close_bit2.
+ *
+ ************************/
+Bit2_T Gridfile_open_bit2(const char *path, bool writable)
+{
+        assert(path != NULL);
+        Header header;
+        char *base;
+        if (!map_grid(path, writable, KIND_BIT2, &header, &base)) {
+                return NULL;
+        }
+        if (header.size != 0 || header.row_bytes !=
+            (header.width + 63) / 64 * (int64_t)sizeof(uint64_t)) {
+                unmap_grid(base + HEADER_BYTES, header.height,
+                           header.row_bytes);
+                return NULL;
+        }
+        Bit2_T bitmap;
+        NEW(bitmap);
+        bitmap->width = (int)header.width;
+        bitmap->height = (int)header.height;
+        bitmap->words_per_row = header.row_bytes / sizeof(uint64_t);
+        bitmap->offset = 0;
+        bitmap->words = (uint64_t *)(base + HEADER_BYTES);
+        if (bitmap->width == 0 || bitmap->height == 0) {
+                unmap_grid(bitmap->words, bitmap->height, header.row_bytes);
+                bitmap->words = NULL;
+        }
+        return bitmap;
+}
+
+/********** Gridfile_create_bit2 ********
+ *
+ * Use:
+ *      Creates a grid file for a zeroed bitmap and opens it for writing.
+ * Parameters:
+ *      const char *path:      The file to create; it is replaced if it
+ *                             exists.
+ *      int width, int height: Dimensions of the bitmap.
+ * Return:
+ *      The bitmap, or NULL if the file cannot be created.
+ * Expects:
+ *      path is not NULL, width and height >= 0 (throws a CRE if not).
+ * Notes:
+ *      Release the bitmap with Gridfile_close_bit2.
+ *
+ ************************/
+Bit2_T Gridfile_create_bit2(const char *path, int width, int height)
+{
+        assert(path != NULL && width >= 0 && height >= 0);
+        long words_per_row = ((long)width + 63) / 64;
+        Header header = make_header(KIND_BIT2, width, height, 0,
+                                    words_per_row * sizeof(uint64_t));
+        char *base;
+        if (!create_grid(path, &header, &base)) {
+                return NULL;
+        }
+        Bit2_T bitmap;
+        NEW(bitmap);
+        bitmap->width = width;
+        bitmap->height = height;
+        bitmap->words_per_row = words_per_row;
+        bitmap->offset = 0;
+        bitmap->words = (uint64_t *)(base + HEADER_BYTES);
+        if (width == 0 || height == 0) {
+                unmap_grid(bitmap->words, height, header.row_bytes);
+                bitmap->words = NULL;
+        }
+        return bitmap;
+}
+
+/********** Gridfile_close_bit2 ********
+ *
+ * Use:
+ *      Unmaps a bitmap that was opened or created by this interface, and
+ *      frees it.
+ * Parameters:
+ *      Bit2_T *bitmap: Pointer to the bitmap; set to NULL.
+ * Return:
+ *      None.
+ * Expects:
+ *      bitmap and *bitmap are not NULL (throws a CRE if not).
+ * Notes:
+ *      None.
+ *
+ ************************/
+void Gridfile_close_bit2(Bit2_T *bitmap)
+{
+        assert(bitmap != NULL && *bitmap != NULL);
+        if ((*bitmap)->words != NULL) {
+                unmap_grid((*bitmap)->words, (*bitmap)->height,
+                           (*bitmap)->words_per_row * sizeof(uint64_t));
+        }
+        FREE(*bitmap);
+}
+
+/********** make_header ********
+ *
+ * Use:
+ *      Fills in a grid file header.
+ * Parameters:
+ *      uint32_t kind:  KIND_UARRAY2 or KIND_BIT2.
+ *      long width:     Width of the grid.
+ *      long height:    Height of the grid.
+ *      long size:      Element size in bytes, or 0 for a bitmap.
+ *      long row_bytes: Bytes per row in the file.
+ * Return:
+ *      The header.
+ * Expects:
+ *      None.
+ * Notes:
+ *      None.
+ *
+ ************************/
+static Header make_header(uint32_t kind, long width, long height, long size,
+                          long row_bytes)
+{
+        Header header;
+        memset(&header, 0, sizeof(header));
+        memcpy(header.magic, MAGIC, sizeof(header.magic));
+        header.version = VERSION;
+        header.kind = kind;
+        header.width = width;
+        header.height = height;
+        header.size = size;
+        header.row_bytes = row_bytes;
+        return header;
+}
+
+/********** map_grid ********
+ *
+ * Use:
+ *      Maps a whole grid file and checks its header.
+ * Parameters:
+ *      const char *path: The grid file.
+ *      bool writable:    True for a shared writable mapping.
+ *      uint32_t kind:    The kind of grid expected.
+ *      Header *header:   Set to the file's header.
+ *      char **base:      Set to the start of the mapping (the header).
+ * Return:
+ *      True if the file was mapped and its header is valid for a grid of
+ *      the given kind whose data fills the rest of the file.
+ * Expects:
+ *      None.
+ * Notes:
+ *      The file descriptor is closed before returning; the mapping keeps
+ *      the file open.
+ *
+ ************************/
+static bool map_grid(const char *path, bool writable, uint32_t kind,
+                     Header *header, char **base)
+{
+        int fd = open(path, writable ? O_RDWR : O_RDONLY);
+        if (fd < 0) {
+                return false;
+        }
+        struct stat info;
+        if (fstat(fd, &info) != 0 || info.st_size < HEADER_BYTES) {
+                close(fd);
+                return false;
+        }
+        void *mapping = mmap(NULL, info.st_size,
+                             PROT_READ | (writable ? PROT_WRITE : 0),
+                             MAP_SHARED, fd, 0);
+        close(fd);
+        if (mapping == MAP_FAILED) {
+                return false;
+        }
+        memcpy(header, mapping, sizeof(*header));
+        bool ok = memcmp(header->magic, MAGIC, sizeof(header->magic)) == 0 &&
+                  header->version == VERSION && header->kind == kind &&
+                  header->width >= 0 && header->width <= INT32_MAX &&
+                  header->height >= 0 && header->height <= INT32_MAX &&
+                  header->row_bytes >= 0 &&
+                  (header->height == 0 || header->row_bytes <=
+                   (info.st_size - HEADER_BYTES) / header->height) &&
+                  info.st_size == HEADER_BYTES +
+                                  header->height * header->row_bytes;
+        if (!ok) {
+                munmap(mapping, info.st_size);
+                return false;
+        }
+        *base = mapping;
+        return true;
+}
+
+/********** create_grid ********
+ *
+ * Use:
+ *      Creates a grid file of the size its header describes, writes the
+ *      header, and maps the file for writing.
+ * Parameters:
+ *      const char *path:     The file to create.
+ *      const Header *header: The header to write.
+ *      char **base:          Set to the start of the mapping (the header).
+ * Return:
+ *      True on success.
+ * Expects:
+ *      None.
+ * Notes:
+ *      The data after the header reads as zeros.
+ *
+ ************************/
+static bool create_grid(const char *path, const Header *header,
+                        char **base)
+{
+        int fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0666);
+        if (fd < 0) {
+                return false;
+        }
+        off_t length = HEADER_BYTES + header->height * header->row_bytes;
+        void *mapping = MAP_FAILED;
+        if (ftruncate(fd, length) == 0) {
+                mapping = mmap(NULL, length, PROT_READ | PROT_WRITE,
+                               MAP_SHARED, fd, 0);
+        }
+        close(fd);
+        if (mapping == MAP_FAILED) {
+                unlink(path);
+                return false;
+        }
+        memcpy(mapping, header, sizeof(*header));
+        *base = mapping;
+        return true;
+}
+
+/********** unmap_grid ********
+ *
+ * Use:
+ *      Unmaps a grid file mapped by map_grid or create_grid.
+ * Parameters:
+ *      void *data:     The grid's data, just after the header.
+ *      long height:    Height of the grid.
+ *      long row_bytes: Bytes per row in the file.
+ * Return:
+ *      None.
+ * Expects:
+ *      None.
+ * Notes:
+ *      None.
+ *
+ ************************/
+static void unmap_grid(void *data, long height, long row_bytes)
+{
+        munmap((char *)data - HEADER_BYTES, HEADER_BYTES + height * row_bytes);
+}
+
+/********** bits_at ********
+ *
+ * Use:
+ *      Reads up to 64 consecutive bits of a row, which may straddle two
+ *      words.
+ * Parameters:
+ *      const uint64_t *words: The row's words.
+ *      long first:            Index of the first bit in the row.
+ *      int count:             Number of bits, 1 to 64.
+ * Return:
+ *      The bits, LSB first, with the bits above count zero.
+ * Expects:
+ *      The count bits exist in the row.
+ * Notes:
+ *      The second word is read only if some of the bits are in it.
+ *
+ ************************/
+static uint64_t bits_at(const uint64_t *words, long first, int count)
+{
+        int shift = first % 64;
+        uint64_t value = words[first / 64] >> shift;
+        if (shift != 0 && shift + count > 64) {
+                value |= words[first / 64 + 1] << (64 - shift);
+        }
+        if (count < 64) {
+                value &= ((uint64_t)1 << count) - 1;
+        }
+        return value;
+}
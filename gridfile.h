@@ -0,0 +1,55 @@
+/*
+ *     gridfile.h
+ *     by nozden01 & bdioni01, 2/12/2024
+ *     iii
+ *
+ *     Function declarations for file-backed UArray2 and Bit2 grids.
+ *
+ *     A grid file is a 64-byte header followed by the grid's rows, each
+ *     row_bytes long with no gaps:
+ *
+ *         offset  size  field
+ *              0     8  magic, "iiigrid\n"
+ *              8     4  version, 1
+ *             12     4  kind, 1 for UArray2 and 2 for Bit2
+ *             16     8  width
+ *             24     8  height
+ *             32     8  element size in bytes (UArray2) or 0 (Bit2)
+ *             40     8  row_bytes
+ *             48    16  zero
+ *
+ *     Numbers are in host byte order. Bit2 rows are 64-bit words holding
+ *     bits LSB-first, as in memory, with the bits past the width zero.
+ *
+ *     Opening a grid file maps it instead of reading it, so a grid of any
+ *     size opens at once and its pages are read as they are touched; grids
+ *     opened read-only can be shared by any number of processes. Grids
+ *     that are opened or created here are released with the matching
+ *     Gridfile_close function, never with UArray2_free or Bit2_free.
+ */
+
+#ifndef GRIDFILE_INCLUDED
+#define GRIDFILE_INCLUDED
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <assert.h>
+#include "mem.h"
+#include "uarray2.h"
+#include "bit2.h"
+
+bool Gridfile_save_uarray2(UArray2_T arr, const char *path);
+UArray2_T Gridfile_open_uarray2(const char *path, bool writable);
+UArray2_T Gridfile_create_uarray2(const char *path, int width, int height,
+                                  int size);
+void Gridfile_close_uarray2(UArray2_T *arr);
+
+bool Gridfile_save_bit2(Bit2_T bitmap, const char *path);
+Bit2_T Gridfile_open_bit2(const char *path, bool writable);
+Bit2_T Gridfile_create_bit2(const char *path, int width, int height);
+void Gridfile_close_bit2(Bit2_T *bitmap);
+
+#endif
@@ -0,0 +1,228 @@
+/*
+ *     iii_client.c
+ *     by nozden01 & bdioni01, 2/12/2024
+ *     iii
+ *
+ *     Function implementations for the iii_client program.
+ *     Sends one request to a running iii_serve and prints the response, so
+ *     that "iii_client sock clean page.pbm" prints what "unblackedges
+ *     page.pbm" prints and exits the same way. With -n it sends the same
+ *     request many times over one connection and reports the round-trip
+ *     latency, which is the cost of the algorithm plus the socket, with no
+ *     process startup.
+ *
+ *     Usage: iii_client [-n reps] socket clean|check|solve [file]
+ *            iii_client socket quit
+ *            -n reps  send the request reps times (default 1) and print
+ *                     its p50, p99 and minimum latency to stderr
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "iii_client.h"
+
+/********** main ********
+ *
+ * Use:
+ *      Runs the iii_client program.
+ * Parameters:
+ *      int argc:     The number of arguments on the command line.
+ *      char *argv[]: Pointer to an array of arguments from the command line.
+ * Return:
+ *      EXIT_SUCCESS if the server answered with status 0, EXIT_FAILURE
+ *      otherwise.
+ * Expects:
+ *      Valid options, a socket and a request kind (prints usage and
+ *      returns EXIT_FAILURE if not).
+ *      That the file can be opened (throws a CRE if not).
+ * Notes:
+ *      The input is read from the file or stdin once, before the first
+ *      request, and only the last response is printed.
+ *
+ ************************/
+int main(int argc, char *argv[])
+{
+        int reps = 1;
+        int arg = 1;
+        if (argc > 2 && strcmp(argv[1], "-n") == 0) {
+                reps = atoi(argv[2]);
+                arg = 3;
+        }
+        if (reps < 1 || argc - arg < 2 || argc - arg > 3) {
+                usage(argv[0]);
+                return EXIT_FAILURE;
+        }
+        const char *path = argv[arg];
+        const char *request = argv[arg + 1];
+        Frame_header header = { 0, 0, 0 };
+        if (strcmp(request, "clean") == 0) {
+                header.kind = FRAME_CLEAN;
+        } else if (strcmp(request, "check") == 0) {
+                header.kind = FRAME_CHECK;
+        } else if (strcmp(request, "solve") == 0) {
+                header.kind = FRAME_SOLVE;
+        } else if (strcmp(request, "quit") == 0 && argc - arg == 2) {
+                header.kind = FRAME_QUIT;
+        } else {
+                usage(argv[0]);
+                return EXIT_FAILURE;
+        }
+
+        long length = 0;
+        unsigned char *input = NULL;
+        if (header.kind != FRAME_QUIT) {
+                FILE *fp = stdin;
+                if (argc - arg == 3) {
+                        fp = fopen(argv[arg + 2], "rb");
+                        assert(fp != NULL);
+                }
+                input = read_input(fp, &length);
+                if (fp != stdin) {
+                        fclose(fp);
+                }
+        }
+        header.length = length;
+
+        int fd = connect_to(path);
+        if (fd < 0) {
+                fprintf(stderr, "%s: cannot connect to %s\n", argv[0], path);
+                FREE(input);
+                return EXIT_FAILURE;
+        }
+        double *latencies = ALLOC(reps * (long)sizeof(double));
+        char *output = NULL;
+        long capacity = 0;
+        Frame_header reply = { 0, FRAME_BAD, 0 };
+        bool ok = true;
+        for (int i = 0; i < reps && ok; i++) {
+                double start = seconds();
+                ok = Frame_send(fd, &header, input) &&
+                     Frame_receive_header(fd, &reply);
+                if (ok && (long)reply.length > capacity) {
+                        capacity = reply.length;
+                        if (output == NULL) {
+                                output = ALLOC(capacity);
+                        } else {
+                                RESIZE(output, capacity);
+                        }
+                }
+                ok = ok && Frame_receive(fd, output, reply.length);
+                latencies[i] = seconds() - start;
+        }
+        close(fd);
+
+        if (!ok) {
+                fprintf(stderr, "%s: connection to %s failed\n", argv[0],
+                        path);
+        } else {
+                fwrite(output, 1, reply.length, stdout);
+                if (reply.status == FRAME_BAD) {
+                        fprintf(stderr, "%s: server refused the request\n",
+                                argv[0]);
+                }
+        }
+        if (ok && reps > 1) {
+                qsort(latencies, reps, sizeof(double), compare_doubles);
+                fprintf(stderr, "%s: %d requests, p50 %.1f us, p99 %.1f us, "
+                        "min %.1f us\n", request, reps,
+                        latencies[reps / 2] * 1e6,
+                        latencies[(99 * reps + 99) / 100 - 1] * 1e6,
+                        latencies[0] * 1e6);
+        }
+        FREE(latencies);
+        FREE(output);
+        FREE(input);
+        return ok && reply.status == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/********** connect_to ********
+ *
+ * Use:
+ *      Connects to a server's Unix domain socket.
+ * Parameters:
+ *      const char *path: The socket.
+ * Return:
+ *      The connected socket, or -1 if there is no server there.
+ * Expects:
+ *      path is not NULL.
+ * Notes:
+ *      None.
+ *
+ ************************/
+int connect_to(const char *path)
+{
+        struct sockaddr_un address;
+        memset(&address, 0, sizeof(address));
+        address.sun_family = AF_UNIX;
+        if (strlen(path) >= sizeof(address.sun_path)) {
+                return -1;
+        }
+        strcpy(address.sun_path, path);
+        int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd < 0) {
+                return -1;
+        }
+        if (connect(fd, (struct sockaddr *)&address, sizeof(address)) != 0) {
+                close(fd);
+                return -1;
+        }
+        return fd;
+}
+
+/********** read_input ********
+ *
+ * Use:
+ *      Reads a whole file into memory.
+ * Parameters:
+ *      FILE *inputfp: The file.
+ *      long *length:  Set to the number of bytes read.
+ * Return:
+ *      The bytes, which the client frees with FREE, or NULL if the file is
+ *      empty.
+ * Expects:
+ *      inputfp and length are not NULL.
+ * Notes:
+ *      Works on pipes as well as files, growing the buffer as it goes.
+ *
+ ************************/
+unsigned char *read_input(FILE *inputfp, long *length)
+{
+        long capacity = 64 * 1024;
+        unsigned char *bytes = ALLOC(capacity);
+        *length = 0;
+        size_t got;
+        while ((got = fread(bytes + *length, 1, capacity - *length,
+                            inputfp)) > 0) {
+                *length += got;
+                if (*length == capacity) {
+                        capacity *= 2;
+                        RESIZE(bytes, capacity);
+                }
+        }
+        if (*length == 0) {
+                FREE(bytes);
+        }
+        return bytes;
+}
+
+/********** usage ********
+ *
+ * Use:
+ *      Prints the usage message to stderr.
+ * Parameters:
+ *      const char *progname: Name the program was run as.
+ * Return:
+ *      None.
+ * Expects:
+ *      None.
+ * Notes:
+ *      None.
+ *
+ ************************/
+void usage(const char *progname)
+{
+        fprintf(stderr,
+                "Usage: %s [-n reps] socket clean|check|solve [file]\n"
+                "       %s socket quit\n",
+                progname, progname);
+}
@@ -0,0 +1,26 @@
+/*
+ *     iii_client.h
+ *     by nozden01 & bdioni01, 2/12/2024
+ *     iii
+ *
+ *     Contains function declarations for the iii_client program.
+ *     Includes libraries and files necessary for this program to function.
+ */
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <assert.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "mem.h"
+#include "frame.h"
+#include "timing.h"
+
+int connect_to(const char *path);
+unsigned char *read_input(FILE *inputfp, long *length);
+void usage(const char *progname);
@@ -0,0 +1,617 @@
+/*
+ *     iii_serve.c
+ *     by nozden01 & bdioni01, 2/12/2024
+ *     iii
+ *
+ *     Function implementations for the iii_serve program.
+ *     A long-running server that answers unblackedges, sudoku and
+ *     sudoku_solve requests over a Unix domain socket (see frame.h for the
+ *     protocol), so that a stream of pages or boards pays for process
+ *     startup, dynamic loading and thread creation once instead of once per
+ *     input. The solver's workers, the buffers and the boards are kept
+ *     between requests; iii_client sends requests and measures their
+ *     latency.
+ *
+ *     Usage: iii_serve [-j threads] socket
+ *            -j threads  solver threads, 0 for all CPUs (default 1)
+ *
+ *     Responses are byte for byte what the programs print: a clean request
+ *     gets the plain PBM unblackedges prints, a check request an empty
+ *     payload, and a solve request the board sudoku_solve prints. Status
+ *     FRAME_FAILED stands for their failing exit status. Connections are
+ *     served one at a time, and a quit request stops the server.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "iii_serve.h"
+
+/********** main ********
+ *
+ * Use:
+ *      Runs the iii_serve program.
+ * Parameters:
+ *      int argc:     The number of arguments on the command line.
+ *      char *argv[]: Pointer to an array of arguments from the command line.
+ * Return:
+ *      EXIT_SUCCESS after a quit request, EXIT_FAILURE on bad usage or if
+ *      the socket cannot be made.
+ * Expects:
+ *      Valid options and a socket path (prints usage and returns
+ *      EXIT_FAILURE if not).
+ * Notes:
+ *      Any file already at the socket path is replaced, and the socket is
+ *      removed on the way out.
+ *
+ ************************/
+int main(int argc, char *argv[])
+{
+        int threads = 1;
+        const char *path = NULL;
+        bool ok = true;
+        for (int i = 1; i < argc && ok; i++) {
+                if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+                        threads = atoi(argv[++i]);
+                } else if (argv[i][0] != '-' && path == NULL) {
+                        path = argv[i];
+                } else {
+                        ok = false;
+                }
+        }
+        if (!ok || path == NULL || threads < 0) {
+                fprintf(stderr, "Usage: %s [-j threads] socket\n", argv[0]);
+                return EXIT_FAILURE;
+        }
+        int listener = listen_on(path);
+        if (listener < 0) {
+                fprintf(stderr, "%s: cannot listen on %s\n", argv[0], path);
+                return EXIT_FAILURE;
+        }
+
+        struct Server server;
+        memset(&server, 0, sizeof(server));
+        if (threads == 0) {
+                threads = Taskpool_online_cpus();
+        }
+        server.pool = threads > 1 ? Taskpool_new(threads) : NULL;
+        for (int box = 2; box <= SOLVER_MAX_BOX; box++) {
+                server.boards[box] = UArray2_new(box * box, box * box,
+                                                 sizeof(int));
+                server.solutions[box] = UArray2_new(box * box, box * box,
+                                                    sizeof(int));
+        }
+
+        bool running = true;
+        while (running) {
+                int fd = accept(listener, NULL, NULL);
+                if (fd < 0) {
+                        running = errno == EINTR || errno == ECONNABORTED;
+                        continue;
+                }
+                running = serve_connection(&server, fd);
+                close(fd);
+        }
+
+        close(listener);
+        unlink(path);
+        for (int box = 2; box <= SOLVER_MAX_BOX; box++) {
+                UArray2_free(&server.boards[box]);
+                UArray2_free(&server.solutions[box]);
+        }
+        if (server.pool != NULL) {
+                Taskpool_free(&server.pool);
+        }
+        FREE(server.request);
+        FREE(server.response);
+        return EXIT_SUCCESS;
+}
+
+/********** listen_on ********
+ *
+ * Use:
+ *      Makes a listening Unix domain socket.
+ * Parameters:
+ *      const char *path: Where to bind it.
+ * Return:
+ *      The socket, or -1 if it cannot be made.
+ * Expects:
+ *      path is not NULL.
+ * Notes:
+ *      Paths too long for a sockaddr_un are refused.
+ *
+ ************************/
+int listen_on(const char *path)
+{
+        struct sockaddr_un address;
+        memset(&address, 0, sizeof(address));
+        address.sun_family = AF_UNIX;
+        if (strlen(path) >= sizeof(address.sun_path)) {
+                return -1;
+        }
+        strcpy(address.sun_path, path);
+        int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd < 0) {
+                return -1;
+        }
+        unlink(path);
+        if (bind(fd, (struct sockaddr *)&address, sizeof(address)) != 0 ||
+            listen(fd, 16) != 0) {
+                close(fd);
+                return -1;
+        }
+        return fd;
+}
+
+/********** serve_connection ********
+ *
+ * Use:
+ *      Answers the requests of one connection until the client closes it.
+ * Parameters:
+ *      Server server: The server.
+ *      int fd:        The connection.
+ * Return:
+ *      False if a quit request arrived, true otherwise.
+ * Expects:
+ *      server is not NULL.
+ * Notes:
+ *      A request of an unknown kind, or one larger than
+ *      MAX_REQUEST_BYTES, is answered with FRAME_BAD; a connection that
+ *      fails midway is dropped. The buffers are reused between requests,
+ *      unless a request grew one past KEEP_BUFFER_BYTES.
+ *
+ ************************/
+bool serve_connection(Server server, int fd)
+{
+        Frame_header header;
+        while (Frame_receive_header(fd, &header)) {
+                Frame_header reply = { header.kind, FRAME_BAD, 0 };
+                if (header.length > (uint64_t)MAX_REQUEST_BYTES) {
+                        Frame_send(fd, &reply, NULL);
+                        return true;
+                }
+                long length = (long)header.length;
+                if (!receive_request(server, fd, length)) {
+                        trim_buffers(server);
+                        return true;
+                }
+
+                server->response_length = 0;
+                switch (header.kind) {
+                case FRAME_CLEAN:
+                        reply.status = handle_clean(server, server->request,
+                                                    length);
+                        break;
+                case FRAME_CHECK:
+                        reply.status = handle_check(server, server->request,
+                                                    length);
+                        break;
+                case FRAME_SOLVE:
+                        reply.status = handle_solve(server, server->request,
+                                                    length);
+                        break;
+                case FRAME_QUIT:
+                        reply.status = 0;
+                        Frame_send(fd, &reply, NULL);
+                        return false;
+                default:
+                        break;
+                }
+                if (reply.status == FRAME_BAD) {
+                        server->response_length = 0;
+                }
+                reply.length = server->response_length;
+                bool sent = Frame_send(fd, &reply, server->response);
+                trim_buffers(server);
+                if (!sent) {
+                        return true;
+                }
+        }
+        return true;
+}
+
+/********** receive_request ********
+ *
+ * Use:
+ *      Receives the payload of a request into the server's request buffer.
+ * Parameters:
+ *      Server server: The server.
+ *      int fd:        The connection.
+ *      long length:   Length of the payload, at most MAX_REQUEST_BYTES.
+ * Return:
+ *      True if the whole payload arrived, false otherwise.
+ * Expects:
+ *      server is not NULL.
+ * Notes:
+ *      The buffer is grown only once the bytes already received fill it,
+ *      doubling from MIN_REQUEST_BYTES, so a header that claims a large
+ *      payload costs no more memory than the bytes actually sent.
+ *
+ ************************/
+bool receive_request(Server server, int fd, long length)
+{
+        long got = 0;
+        while (got < length) {
+                if (got == server->request_capacity) {
+                        long capacity = 2 * server->request_capacity;
+                        if (capacity < MIN_REQUEST_BYTES) {
+                                capacity = MIN_REQUEST_BYTES;
+                        }
+                        if (capacity > length) {
+                                capacity = length;
+                        }
+                        if (server->request == NULL) {
+                                server->request = ALLOC(capacity);
+                        } else {
+                                RESIZE(server->request, capacity);
+                        }
+                        server->request_capacity = capacity;
+                }
+                long chunk = (server->request_capacity < length
+                              ? server->request_capacity : length) - got;
+                if (!Frame_receive(fd, server->request + got, chunk)) {
+                        return false;
+                }
+                got += chunk;
+        }
+        return true;
+}
+
+/********** trim_buffers ********
+ *
+ * Use:
+ *      Frees the request and response buffers if either has grown past
+ *      KEEP_BUFFER_BYTES.
+ * Parameters:
+ *      Server server: The server.
+ * Return:
+ *      None.
+ * Expects:
+ *      server is not NULL.
+ * Notes:
+ *      Called after every request; the next request starts the buffer
+ *      again from nothing.
+ *
+ ************************/
+void trim_buffers(Server server)
+{
+        if (server->request_capacity > KEEP_BUFFER_BYTES) {
+                FREE(server->request);
+                server->request_capacity = 0;
+        }
+        if (server->response_capacity > KEEP_BUFFER_BYTES) {
+                FREE(server->response);
+                server->response_capacity = 0;
+                server->response_length = 0;
+        }
+}
+
+/********** handle_clean ********
+ *
+ * Use:
+ *      Answers a clean request: removes the black pixels connected to the
+ *      edges of a bitmap and writes the result as a plain PBM.
+ * Parameters:
+ *      Server server:              The server, whose response is written.
+ *      const unsigned char *input: The plain (P1) or raw (P4) PBM file.
+ *      long length:                Its length in bytes.
+ * Return:
+ *      0, or FRAME_BAD if the input is not a bitmap.
+ * Expects:
+ *      server and input are not NULL.
+ * Notes:
+ *      Works on runs, as unblackedges -r does, and formats each row into
+ *      the response directly, so the output matches unblackedges.
+ *
+ ************************/
+uint32_t handle_clean(Server server, const unsigned char *input,
+                      long length)
+{
+        Rle2_T image = parse_pbm(input, length);
+        if (image == NULL) {
+                return FRAME_BAD;
+        }
+        Rle2_T cleared = Rle2_clear_border(image);
+        Rle2_free(&image);
+
+        int width = Rle2_width(cleared);
+        int height = Rle2_height(cleared);
+        append(server, "P1\n", 3);
+        append_number(server, width, ' ');
+        append_number(server, height, '\n');
+        for (int row = 0; row < height; row++) {
+                reserve(server, 2 * (long)width);
+                char *line = server->response + server->response_length;
+                for (long i = 0; i < width; i++) {
+                        line[2 * i] = '0';
+                        line[2 * i + 1] = ' ';
+                }
+                line[2 * (long)width - 1] = '\n';
+                const Rle2_run *runs;
+                int count = Rle2_row(cleared, row, &runs);
+                for (int i = 0; i < count; i++) {
+                        for (long col = runs[i].start; col < runs[i].end;
+                             col++) {
+                                line[2 * col] = '1';
+                        }
+                }
+                server->response_length += 2 * (long)width;
+        }
+        Rle2_free(&cleared);
+        return 0;
+}
+
+/********** handle_check ********
+ *
+ * Use:
+ *      Answers a check request: tells whether a 9x9 board is a solved
+ *      sudoku, as the sudoku program does.
+ * Parameters:
+ *      Server server:              The server.
+ *      const unsigned char *input: The graymap (P2 or P5).
+ *      long length:                Its length in bytes.
+ * Return:
+ *      0 if the board is solved, FRAME_FAILED otherwise.
+ * Expects:
+ *      server and input are not NULL.
+ * Notes:
+ *      The response is empty. Input that is not a 9x9 board with maxval 9
+ *      fails, as it does in sudoku, rather than being a bad request.
+ *
+ ************************/
+uint32_t handle_check(Server server, const unsigned char *input,
+                      long length)
+{
+        int box = read_board(server, input, length);
+        if (box != 3) {
+                return FRAME_FAILED;
+        }
+        UArray2_T board = server->boards[box];
+        for (int row = 0; row < 9; row++) {
+                for (int col = 0; col < 9; col++) {
+                        if (*(int *)UArray2_at(board, col, row) == 0) {
+                                return FRAME_FAILED;
+                        }
+                }
+        }
+        Validator_T validator = Validator_from_board(board, box);
+        bool solved = Validator_valid(validator) &&
+                      Validator_complete(validator);
+        Validator_free(&validator);
+        return solved ? 0 : FRAME_FAILED;
+}
+
+/********** handle_solve ********
+ *
+ * Use:
+ *      Answers a solve request: solves a puzzle, as sudoku_solve does,
+ *      and writes the solution as a plain graymap.
+ * Parameters:
+ *      Server server:              The server, whose response is written.
+ *      const unsigned char *input: The puzzle (P2 or P5), 0 for empty.
+ *      long length:                Its length in bytes.
+ * Return:
+ *      0 if a solution was found, FRAME_FAILED otherwise.
+ * Expects:
+ *      server and input are not NULL.
+ * Notes:
+ *      The search runs on the server's pool, whose workers stay up between
+ *      requests. Puzzles whose givens clash fail without a search.
+ *
+ ************************/
+uint32_t handle_solve(Server server, const unsigned char *input,
+                      long length)
+{
+        int box = read_board(server, input, length);
+        if (box == 0) {
+                return FRAME_FAILED;
+        }
+        UArray2_T board = server->boards[box];
+        UArray2_T solution = server->solutions[box];
+        Validator_T givens = Validator_from_board(board, box);
+        bool clash = !Validator_valid(givens);
+        Validator_free(&givens);
+        if (clash || Solver_solve_pool(board, box, 1, server->pool,
+                                       solution) == 0) {
+                return FRAME_FAILED;
+        }
+
+        int n = box * box;
+        append(server, "P2\n", 3);
+        append_number(server, n, ' ');
+        append_number(server, n, '\n');
+        append_number(server, n, '\n');
+        for (int row = 0; row < n; row++) {
+                for (int col = 0; col < n; col++) {
+                        append_number(server,
+                                      *(int *)UArray2_at(solution, col, row),
+                                      col == n - 1 ? '\n' : ' ');
+                }
+        }
+        return 0;
+}
+
+/********** parse_pbm ********
+ *
+ * Use:
+ *      Reads the runs of a PBM file held in memory.
+ * Parameters:
+ *      const unsigned char *input: The plain (P1) or raw (P4) file.
+ *      long length:                Its length in bytes.
+ * Return:
+ *      A new run-length encoded bitmap, or NULL if the input is not a
+ *      complete bitmap.
+ * Expects:
+ *      input is not NULL.
+ * Notes:
+ *      The header is read with Pnmscan_header through a memory stream.
+ *      Raw rows are encoded in place with Rle2_from_packed; plain ones are
+ *      read a digit at a time. Input too short for the dimensions in its
+ *      header ((width + 7) / 8 bytes a row when raw, at least a byte a
+ *      pixel when plain) is refused before anything is allocated, so a
+ *      header alone cannot make the server allocate.
+ *
+ ************************/
+Rle2_T parse_pbm(const unsigned char *input, long length)
+{
+        if (length == 0) {
+                return NULL;
+        }
+        FILE *fp = fmemopen((void *)input, length, "r");
+        if (fp == NULL) {
+                return NULL;
+        }
+        Pnmscan_info info;
+        bool ok = Pnmscan_header(fp, &info) &&
+                  (info.format == 1 || info.format == 4);
+        long offset = ftell(fp);
+        fclose(fp);
+        if (!ok) {
+                return NULL;
+        }
+        int width = info.width;
+        int height = info.height;
+        if (info.format == 4) {
+                long row_bytes = ((long)width + 7) / 8;
+                if ((length - offset) / row_bytes < height) {
+                        return NULL;
+                }
+                return Rle2_from_packed(input + offset, width, height);
+        }
+        if ((length - offset) / width < height) {
+                return NULL;
+        }
+
+        Rle2_T image = Rle2_new(width, height);
+        long at = offset;
+        for (int row = 0; row < height; row++) {
+                int start = -1;
+                for (int col = 0; col < width; col++) {
+                        while (at < length && (input[at] == ' ' ||
+                               (input[at] >= '\t' && input[at] <= '\r'))) {
+                                at++;
+                        }
+                        if (at == length ||
+                            (input[at] != '0' && input[at] != '1')) {
+                                Rle2_free(&image);
+                                return NULL;
+                        }
+                        int bit = input[at++] - '0';
+                        if (bit == 1 && start < 0) {
+                                start = col;
+                        } else if (bit == 0 && start >= 0) {
+                                Rle2_append(image, row, start, col);
+                                start = -1;
+                        }
+                }
+                if (start >= 0) {
+                        Rle2_append(image, row, start, width);
+                }
+        }
+        return image;
+}
+
+/********** read_board ********
+ *
+ * Use:
+ *      Reads a sudoku board held in memory into the server's board of its
+ *      size.
+ * Parameters:
+ *      Server server:              The server.
+ *      const unsigned char *input: The graymap (P2 or P5).
+ *      long length:                Its length in bytes.
+ * Return:
+ *      The side of one box of the board, or 0 if the input is not a
+ *      board: a square graymap whose side is a perfect square up to
+ *      SOLVER_MAX_BOX squared, with that side as its maxval and every
+ *      sample at most the side.
+ * Expects:
+ *      server and input are not NULL.
+ * Notes:
+ *      The same rules as sudoku_solve's read_puzzle.
+ *
+ ************************/
+int read_board(Server server, const unsigned char *input, long length)
+{
+        if (length == 0) {
+                return 0;
+        }
+        FILE *fp = fmemopen((void *)input, length, "r");
+        if (fp == NULL) {
+                return 0;
+        }
+        Pnmscan_info info;
+        int box = 2;
+        bool ok = Pnmscan_header(fp, &info) &&
+                  (info.format == 2 || info.format == 5);
+        if (ok) {
+                while (box < SOLVER_MAX_BOX && box * box < (int)info.width) {
+                        box++;
+                }
+                ok = box * box == (int)info.width &&
+                     info.height == info.width &&
+                     info.maxval == info.width;
+        }
+        int n = box * box;
+        for (int row = 0; ok && row < n; row++) {
+                for (int col = 0; ok && col < n; col++) {
+                        long value = Pnmscan_gray(fp, &info);
+                        ok = value >= 0 && value <= n;
+                        *(int *)UArray2_at(server->boards[box], col, row) =
+                                (int)value;
+                }
+        }
+        fclose(fp);
+        return ok ? box : 0;
+}
+
+/********** reserve ********
+ *
+ * Use:
+ *      Makes room for more bytes at the end of the response.
+ * Parameters:
+ *      Server server: The server.
+ *      long bytes:    The number of bytes to make room for.
+ * Return:
+ *      None.
+ * Expects:
+ *      server is not NULL.
+ * Notes:
+ *      The buffer at least doubles when it grows, and is kept between
+ *      requests up to KEEP_BUFFER_BYTES, so after the first few responses
+ *      a request rarely allocates. append
+ *      copies bytes into the room it reserves; append_number writes a
+ *      decimal number and one character after it.
+ *
+ ************************/
+void reserve(Server server, long bytes)
+{
+        long needed = server->response_length + bytes;
+        if (needed <= server->response_capacity) {
+                return;
+        }
+        long capacity = 2 * server->response_capacity;
+        if (capacity < needed) {
+                capacity = needed < 4096 ? 4096 : needed;
+        }
+        if (server->response == NULL) {
+                server->response = ALLOC(capacity);
+        } else {
+                RESIZE(server->response, capacity);
+        }
+        server->response_capacity = capacity;
+}
+
+void append(Server server, const char *text, long length)
+{
+        reserve(server, length);
+        memcpy(server->response + server->response_length, text, length);
+        server->response_length += length;
+}
+
+void append_number(Server server, long number, char after)
+{
+        char digits[24];
+        int length = snprintf(digits, sizeof(digits), "%ld%c", number,
+                              after);
+        append(server, digits, length);
+}
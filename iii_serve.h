@@ -0,0 +1,69 @@
+/*
+ *     iii_serve.h
+ *     by nozden01 & bdioni01, 2/12/2024
+ *     iii
+ *
+ *     Contains struct and function declarations for the iii_serve program.
+ *     Includes libraries and files necessary for this program to function.
+ */
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "mem.h"
+#include "uarray2.h"
+#include "rle2.h"
+#include "pnmscan.h"
+#include "solver.h"
+#include "taskpool.h"
+#include "validator.h"
+#include "frame.h"
+
+/* Requests larger than this are refused without reading their payload;
+ * a letter page at 600 dpi is about 67 MB as a plain PBM. */
+#define MAX_REQUEST_BYTES (128L << 20)
+
+/* The request buffer grows from this size as payload bytes arrive. */
+#define MIN_REQUEST_BYTES (64L << 10)
+
+/* Buffers larger than this are freed after the request that grew them,
+ * so that one large request does not keep its memory; a letter page at
+ * 300 dpi (about 17 MB as a plain PBM) stays within it. */
+#define KEEP_BUFFER_BYTES (32L << 20)
+
+/* State kept across requests: the solver's workers, the request and
+ * response buffers, which are reused up to KEEP_BUFFER_BYTES, and a
+ * puzzle and a solution board for every box size. */
+typedef struct Server {
+        Taskpool_T pool;
+        unsigned char *request;
+        long request_capacity;
+        char *response;
+        long response_capacity;
+        long response_length;
+        UArray2_T boards[SOLVER_MAX_BOX + 1];
+        UArray2_T solutions[SOLVER_MAX_BOX + 1];
+} *Server;
+
+int listen_on(const char *path);
+bool serve_connection(Server server, int fd);
+bool receive_request(Server server, int fd, long length);
+void trim_buffers(Server server);
+uint32_t handle_clean(Server server, const unsigned char *input,
+                      long length);
+uint32_t handle_check(Server server, const unsigned char *input,
+                      long length);
+uint32_t handle_solve(Server server, const unsigned char *input,
+                      long length);
+Rle2_T parse_pbm(const unsigned char *input, long length);
+int read_board(Server server, const unsigned char *input, long length);
+void reserve(Server server, long bytes);
+void append(Server server, const char *text, long length);
+void append_number(Server server, long number, char after);
@@ -0,0 +1,217 @@
+/*
+ *     instrument.c
+ *     by nozden01 & bdioni01, 2/12/2024
+ *     iii
+ *
+ *     Function implementations for optional hot-path instrumentation.
+ *     Nothing here is called unless the program is built with
+ *     III_INSTRUMENT defined, and the Makefile only links this file in
+ *     then; see instrument.h.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdarg.h>
+#include <time.h>
+#include <unistd.h>
+#include "instrument.h"
+
+#define REPORT_BYTES 2048
+
+static const char *PHASE_NAMES[INSTR_PHASES] = {
+        "read", "fill", "write", "header", "validate"
+};
+
+static const char *COUNTER_NAMES[INSTR_COUNTERS] = {
+        "pixels_read", "pixels_visited", "pixels_written", "pushes", "pops",
+        "worklist_max", "cells"
+};
+
+/* Totals of every phase, and the start of the phase in progress. */
+typedef struct Phase_time {
+        int64_t wall_ns;
+        uint64_t cycles;
+        int64_t calls;
+        int64_t start_ns;
+        uint64_t start_cycles;
+} Phase_time;
+
+int64_t Instrument_counts[INSTR_COUNTERS];
+static Phase_time phases[INSTR_PHASES];
+
+static void append(char *line, int *length, const char *format, ...);
+static int64_t now_ns(void);
+static uint64_t now_cycles(void);
+
+/********** Instrument_begin ********
+ *
+ * Use:
+ *      Marks the start of a phase.
+ * Parameters:
+ *      Instrument_phase phase: The phase.
+ * Return:
+ *      None.
+ * Expects:
+ *      phase is a valid phase, and is not already started.
+ * Notes:
+ *      A phase may run many times; its times are summed.
+ *
+ ************************/
+void Instrument_begin(Instrument_phase phase)
+{
+        phases[phase].start_cycles = now_cycles();
+        phases[phase].start_ns = now_ns();
+}
+
+/********** Instrument_end ********
+ *
+ * Use:
+ *      Marks the end of a phase and adds its time to the phase's total.
+ * Parameters:
+ *      Instrument_phase phase: The phase.
+ * Return:
+ *      None.
+ * Expects:
+ *      phase was started with Instrument_begin.
+ * Notes:
+ *      None.
+ *
+ ************************/
+void Instrument_end(Instrument_phase phase)
+{
+        int64_t ns = now_ns();
+        uint64_t cycles = now_cycles();
+        phases[phase].wall_ns += ns - phases[phase].start_ns;
+        phases[phase].cycles += cycles - phases[phase].start_cycles;
+        phases[phase].calls++;
+}
+
+/********** Instrument_report ********
+ *
+ * Use:
+ *      Writes the phase times and counters as one JSON line.
+ * Parameters:
+ *      const char *program: Name of the program, copied into the line.
+ *      int status:          Exit status the program is about to return.
+ * Return:
+ *      None.
+ * Expects:
+ *      program is not NULL.
+ * Notes:
+ *      Phases that never ran are left out. The line is written with one
+ *      write call to stderr, or to the descriptor in III_INSTRUMENT_FD, so
+ *      it is not mixed up with the program's buffered output. A line longer
+ *      than REPORT_BYTES is cut short, but still ends in a newline.
+ *
+ ************************/
+void Instrument_report(const char *program, int status)
+{
+        char line[REPORT_BYTES];
+        int n = 0;
+        append(line, &n, "{\"program\": \"%s\", \"status\": %d, "
+               "\"phases\": {", program, status);
+        const char *separator = "";
+        for (int i = 0; i < INSTR_PHASES; i++) {
+                if (phases[i].calls == 0) {
+                        continue;
+                }
+                append(line, &n, "%s\"%s\": {\"wall_ns\": %lld, \"cycles\": "
+                       "%llu, \"calls\": %lld}", separator, PHASE_NAMES[i],
+                       (long long)phases[i].wall_ns,
+                       (unsigned long long)phases[i].cycles,
+                       (long long)phases[i].calls);
+                separator = ", ";
+        }
+        append(line, &n, "}, \"counters\": {");
+        for (int i = 0; i < INSTR_COUNTERS; i++) {
+                append(line, &n, "%s\"%s\": %lld", i > 0 ? ", " : "",
+                       COUNTER_NAMES[i], (long long)Instrument_counts[i]);
+        }
+        append(line, &n, "}}\n");
+        line[n - 1] = '\n';
+
+        int fd = STDERR_FILENO;
+        const char *env = getenv("III_INSTRUMENT_FD");
+        if (env != NULL && *env != '\0') {
+                fd = atoi(env);
+        }
+        ssize_t written = write(fd, line, n);
+        (void) written;
+}
+
+/********** append ********
+ *
+ * Use:
+ *      Appends formatted text to the report line.
+ * Parameters:
+ *      char *line:         The line, REPORT_BYTES long.
+ *      int *length:        Length of the text in the line so far; updated.
+ *      const char *format: printf format, followed by its arguments.
+ * Return:
+ *      None.
+ * Expects:
+ *      None.
+ * Notes:
+ *      Once the line is full, text is dropped, and *length stays below
+ *      REPORT_BYTES, so the line is always terminated.
+ *
+ ************************/
+static void append(char *line, int *length, const char *format, ...)
+{
+        int room = REPORT_BYTES - *length;
+        if (room <= 1) {
+                return;
+        }
+        va_list args;
+        va_start(args, format);
+        int added = vsnprintf(line + *length, room, format, args);
+        va_end(args);
+        if (added > 0) {
+                *length += added < room ? added : room - 1;
+        }
+}
+
+/********** now_ns ********
+ *
+ * Use:
+ *      Reads the monotonic clock.
+ * Parameters:
+ *      None.
+ * Return:
+ *      Nanoseconds from an arbitrary start.
+ * Expects:
+ *      None.
+ * Notes:
+ *      None.
+ *
+ ************************/
+static int64_t now_ns(void)
+{
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        return (int64_t)now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+/********** now_cycles ********
+ *
+ * Use:
+ *      Reads the CPU's cycle counter.
+ * Parameters:
+ *      None.
+ * Return:
+ *      The time stamp counter on x86, 0 elsewhere.
+ * Expects:
+ *      None.
+ * Notes:
+ *      On current x86 parts the counter runs at a constant rate, so this is
+ *      reference cycles rather than core cycles.
+ *
+ ************************/
+static uint64_t now_cycles(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+        return __builtin_ia32_rdtsc();
+#else
+        return 0;
+#endif
+}
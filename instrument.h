@@ -0,0 +1,72 @@
+/*
+ *     instrument.h
+ *     by nozden01 & bdioni01, 2/12/2024
+ *     iii
+ *
+ *     Macros and function declarations for optional hot-path
+ *     instrumentation. Programs mark their phases and count events with the
+ *     INSTR_ macros, and print everything as one JSON line at exit.
+ *
+ *     The macros do something only when the program is built with
+ *     III_INSTRUMENT defined (make INSTRUMENT=1). Otherwise they expand to
+ *     nothing, and neither their arguments nor the clock reads are
+ *     compiled, so uninstrumented builds run exactly the original code.
+ *
+ *     The JSON line goes to stderr, or to the file descriptor named by the
+ *     III_INSTRUMENT_FD environment variable.
+ */
+
+#ifndef INSTRUMENT_INCLUDED
+#define INSTRUMENT_INCLUDED
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+/* Phases whose wall and cycle time are recorded. */
+typedef enum Instrument_phase {
+        INSTR_READ,
+        INSTR_FILL,
+        INSTR_WRITE,
+        INSTR_HEADER,
+        INSTR_VALIDATE,
+        INSTR_PHASES
+} Instrument_phase;
+
+/* Event counters; INSTR_WORKLIST_MAX holds a high-water mark. */
+typedef enum Instrument_counter {
+        INSTR_PIXELS_READ,
+        INSTR_PIXELS_VISITED,
+        INSTR_PIXELS_WRITTEN,
+        INSTR_PUSHES,
+        INSTR_POPS,
+        INSTR_WORKLIST_MAX,
+        INSTR_CELLS,
+        INSTR_COUNTERS
+} Instrument_counter;
+
+extern int64_t Instrument_counts[INSTR_COUNTERS];
+
+void Instrument_begin(Instrument_phase phase);
+void Instrument_end(Instrument_phase phase);
+void Instrument_report(const char *program, int status);
+
+#ifdef III_INSTRUMENT
+#define INSTR_BEGIN(phase) Instrument_begin(phase)
+#define INSTR_END(phase) Instrument_end(phase)
+#define INSTR_COUNT(counter, n) ((void)(Instrument_counts[counter] += (n)))
+#define INSTR_GET(counter) (Instrument_counts[counter])
+#define INSTR_MAX(counter, value)                                       \
+        ((void)(Instrument_counts[counter] < (value)                    \
+                ? (Instrument_counts[counter] = (value)) : 0))
+#define INSTR_REPORT(program, status) Instrument_report(program, status)
+#else
+#define INSTR_BEGIN(phase) ((void)0)
+#define INSTR_END(phase) ((void)0)
+#define INSTR_COUNT(counter, n) ((void)0)
+#define INSTR_GET(counter) ((int64_t)0)
+#define INSTR_MAX(counter, value) ((void)0)
+#define INSTR_REPORT(program, status) ((void)0)
+#endif
+
+#endif
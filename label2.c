@@ -0,0 +1,551 @@
+/*
+ *     label2.c
+ *     by nozden01 & bdioni01, 2/12/2024
+ *     iii
+ *
+ *     Function implementations for connected-component labeling of 2D
+ *     bitmaps.
+ */
+
+#include "label2.h"
+
+/* Runs are numbered in raster order; run_first[row] is the number of the
+ * first run of row, and run_first[height] the number of runs.
+ * run_label[i] is the label of run i. components[label - 1] describes
+ * label. image is freed with the labels only when owned is set. */
+struct Label2_T {
+        Rle2_T image;
+        bool owned;
+        int connectivity;
+        int ncomponents;
+        long *run_first;
+        int *run_label;
+        Label2_component *components;
+};
+
+static void join_rows(const Rle2_run *above, int nabove, long first_above,
+                      const Rle2_run *runs, int nruns, long first,
+                      int reach, long *parent);
+static long find(long *parent, long run);
+static void clear_range(Bit2_T bitmap, int row, int start, int end);
+
+/********** Label2_new ********
+ *
+ * Use:
+ *      Labels the connected components of a run-length encoded bitmap.
+ * Parameters:
+ *      Rle2_T image:     The bitmap.
+ *      int connectivity: 4 if only pixels that share a side are connected,
+ *                        8 if pixels that share a corner are too.
+ * Return:
+ *      The labels, with each component's statistics.
+ * Expects:
+ *      image is not NULL and connectivity is 4 or 8 (throws a CRE if not).
+ * Notes:
+ *      The image must outlive the labels. Time and memory are linear in
+ *      the number of runs: the union-find links each root to the smaller
+ *      of the two and halves paths as it finds, so the first pass is
+ *      nearly linear, and the second is one find per run. The client
+ *      releases the labels with Label2_free.
+ *
+ ************************/
+Label2_T Label2_new(Rle2_T image, int connectivity)
+{
+        assert(image != NULL);
+        assert(connectivity == 4 || connectivity == 8);
+        int width = Rle2_width(image);
+        int height = Rle2_height(image);
+        long nruns = Rle2_nruns(image);
+        Label2_T labels;
+        NEW(labels);
+        labels->image = image;
+        labels->owned = false;
+        labels->connectivity = connectivity;
+        labels->ncomponents = 0;
+        labels->run_first = ALLOC(((long)height + 1) * sizeof(long));
+        labels->run_label = NULL;
+        labels->components = NULL;
+        labels->run_first[0] = 0;
+        for (int row = 0; row < height; row++) {
+                const Rle2_run *runs;
+                labels->run_first[row + 1] = labels->run_first[row] +
+                                             Rle2_row(image, row, &runs);
+        }
+        if (nruns == 0) {
+                return labels;
+        }
+
+        long *parent = ALLOC(nruns * (long)sizeof(long));
+        for (long i = 0; i < nruns; i++) {
+                parent[i] = i;
+        }
+        int reach = connectivity == 8 ? 1 : 0;
+        for (int row = 1; row < height; row++) {
+                const Rle2_run *above;
+                const Rle2_run *runs;
+                int nabove = Rle2_row(image, row - 1, &above);
+                int count = Rle2_row(image, row, &runs);
+                join_rows(above, nabove, labels->run_first[row - 1], runs,
+                          count, labels->run_first[row], reach, parent);
+        }
+
+        labels->run_label = ALLOC(nruns * (long)sizeof(int));
+        long capacity = 0;
+        for (int row = 0; row < height; row++) {
+                const Rle2_run *runs;
+                int count = Rle2_row(image, row, &runs);
+                for (int i = 0; i < count; i++) {
+                        long run = labels->run_first[row] + i;
+                        long root = find(parent, run);
+                        Label2_component *component;
+                        if (root == run) {
+                                if (labels->ncomponents == capacity) {
+                                        capacity = capacity == 0
+                                                   ? 64 : 2 * capacity;
+                                        if (labels->components == NULL) {
+                                                labels->components =
+                                                        ALLOC(capacity *
+                                                        (long)sizeof(
+                                                        Label2_component));
+                                        } else {
+                                                RESIZE(labels->components,
+                                                       capacity * (long)
+                                                       sizeof(
+                                                       Label2_component));
+                                        }
+                                }
+                                labels->run_label[run] =
+                                        ++labels->ncomponents;
+                                component = &labels->components[
+                                        labels->ncomponents - 1];
+                                component->area = 0;
+                                component->left = runs[i].start;
+                                component->top = row;
+                                component->right = runs[i].end - 1;
+                                component->bottom = row;
+                                component->border = false;
+                        } else {
+                                labels->run_label[run] =
+                                        labels->run_label[root];
+                                component = &labels->components[
+                                        labels->run_label[run] - 1];
+                        }
+                        component->area += runs[i].end - runs[i].start;
+                        if (runs[i].start < component->left) {
+                                component->left = runs[i].start;
+                        }
+                        if (runs[i].end - 1 > component->right) {
+                                component->right = runs[i].end - 1;
+                        }
+                        component->bottom = row;
+                        component->border |= row == 0 ||
+                                             row == height - 1 ||
+                                             runs[i].start == 0 ||
+                                             runs[i].end == width;
+                }
+        }
+        FREE(parent);
+        return labels;
+}
+
+/********** Label2_from_bit2 ********
+ *
+ * Use:
+ *      Labels the connected components of a dense bitmap.
+ * Parameters:
+ *      Bit2_T bitmap:    The bitmap, which may be a view.
+ *      int connectivity: 4 or 8, as in Label2_new.
+ * Return:
+ *      The labels.
+ * Expects:
+ *      bitmap is not NULL and connectivity is 4 or 8 (throws a CRE if
+ *      not).
+ * Notes:
+ *      Converts the bitmap to runs first; the labels own the runs, so the
+ *      bitmap may change or be freed afterwards.
+ *
+ ************************/
+Label2_T Label2_from_bit2(Bit2_T bitmap, int connectivity)
+{
+        Label2_T labels = Label2_new(Rle2_from_bit2(bitmap), connectivity);
+        labels->owned = true;
+        return labels;
+}
+
+/********** Label2_free ********
+ *
+ * Use:
+ *      Frees labels.
+ * Parameters:
+ *      Label2_T *labels: Pointer to the labels; set to NULL.
+ * Return:
+ *      None.
+ * Expects:
+ *      labels and *labels are not NULL (throws a CRE if not).
+ * Notes:
+ *      Frees the runs only if Label2_from_bit2 made them.
+ *
+ ************************/
+void Label2_free(Label2_T *labels)
+{
+        assert(labels != NULL && *labels != NULL);
+        if ((*labels)->owned) {
+                Rle2_free(&(*labels)->image);
+        }
+        FREE((*labels)->run_first);
+        FREE((*labels)->run_label);
+        FREE((*labels)->components);
+        FREE(*labels);
+}
+
+/********** Label2_count ********
+ *
+ * Use:
+ *      Returns the number of components.
+ * Parameters:
+ *      Label2_T labels: The labels.
+ * Return:
+ *      The number of components; their labels are 1 to that number.
+ * Expects:
+ *      labels is not NULL (throws a CRE if not).
+ * Notes:
+ *      None.
+ *
+ ************************/
+int Label2_count(Label2_T labels)
+{
+        assert(labels != NULL);
+        return labels->ncomponents;
+}
+
+/********** Label2_component_of ********
+ *
+ * Use:
+ *      Returns the statistics of one component.
+ * Parameters:
+ *      Label2_T labels: The labels.
+ *      int label:       The component, 1 to Label2_count.
+ * Return:
+ *      The component, valid until the labels are freed.
+ * Expects:
+ *      labels is not NULL and label is in range (throws a CRE if not).
+ * Notes:
+ *      None.
+ *
+ ************************/
+const Label2_component *Label2_component_of(Label2_T labels, int label)
+{
+        assert(labels != NULL);
+        assert(label >= 1 && label <= labels->ncomponents);
+        return &labels->components[label - 1];
+}
+
+/********** Label2_at ********
+ *
+ * Use:
+ *      Returns the label of one pixel.
+ * Parameters:
+ *      Label2_T labels:  The labels.
+ *      int col, int row: The pixel.
+ * Return:
+ *      The pixel's label, or 0 for background.
+ * Expects:
+ *      labels is not NULL and (col, row) is in the bitmap (throws a CRE if
+ *      not).
+ * Notes:
+ *      A binary search over the row's runs.
+ *
+ ************************/
+int Label2_at(Label2_T labels, int col, int row)
+{
+        assert(labels != NULL);
+        assert(col >= 0 && col < Rle2_width(labels->image));
+        assert(row >= 0 && row < Rle2_height(labels->image));
+        const Rle2_run *runs;
+        int count = Rle2_row(labels->image, row, &runs);
+        int lo = 0;
+        int hi = count;
+        while (lo < hi) {
+                int mid = lo + (hi - lo) / 2;
+                if (runs[mid].end <= col) {
+                        lo = mid + 1;
+                } else {
+                        hi = mid;
+                }
+        }
+        if (lo < count && runs[lo].start <= col) {
+                return labels->run_label[labels->run_first[row] + lo];
+        }
+        return 0;
+}
+
+/********** Label2_grid ********
+ *
+ * Use:
+ *      Writes every pixel's label into a 2D array.
+ * Parameters:
+ *      Label2_T labels: The labels.
+ * Return:
+ *      A new array the size of the bitmap, 0 for background pixels.
+ * Expects:
+ *      labels is not NULL (throws a CRE if not).
+ * Notes:
+ *      The client releases the array with UArray2_int_free.
+ *
+ ************************/
+UArray2_int Label2_grid(Label2_T labels)
+{
+        assert(labels != NULL);
+        int height = Rle2_height(labels->image);
+        UArray2_int grid = UArray2_int_new(Rle2_width(labels->image),
+                                           height);
+        for (int row = 0; row < height; row++) {
+                const Rle2_run *runs;
+                int count = Rle2_row(labels->image, row, &runs);
+                int *line = UArray2_int_row(grid, row);
+                for (int i = 0; i < count; i++) {
+                        int label = labels->run_label[labels->run_first[row] +
+                                                      i];
+                        for (int col = runs[i].start; col < runs[i].end;
+                             col++) {
+                                line[col] = label;
+                        }
+                }
+        }
+        return grid;
+}
+
+/********** Label2_filter ********
+ *
+ * Use:
+ *      Keeps the components a predicate accepts and drops the rest.
+ * Parameters:
+ *      Label2_T labels: The labels.
+ *      bool keep(int label, const Label2_component *component,
+ *                void *closure):
+ *                       Called once per component; returns true to keep
+ *                       it.
+ *      void *closure:   Passed to keep.
+ * Return:
+ *      A new run-length encoded bitmap with the kept components' pixels.
+ * Expects:
+ *      labels and keep are not NULL (throws a CRE if not).
+ * Notes:
+ *      Label2_clear follows the same pattern, clearing the dropped
+ *      components' pixels from a dense bitmap the size of the labeled one
+ *      instead. Both ask keep about each component once, then make one
+ *      pass over the runs.
+ *
+ ************************/
+Rle2_T Label2_filter(Label2_T labels,
+                     bool keep(int label, const Label2_component *component,
+                               void *closure),
+                     void *closure)
+{
+        assert(labels != NULL && keep != NULL);
+        int height = Rle2_height(labels->image);
+        Rle2_T kept = Rle2_new(Rle2_width(labels->image), height);
+        if (labels->ncomponents == 0) {
+                return kept;
+        }
+        bool *keeps = ALLOC(labels->ncomponents * (long)sizeof(bool));
+        for (int label = 1; label <= labels->ncomponents; label++) {
+                keeps[label - 1] = keep(label,
+                                        &labels->components[label - 1],
+                                        closure);
+        }
+        for (int row = 0; row < height; row++) {
+                const Rle2_run *runs;
+                int count = Rle2_row(labels->image, row, &runs);
+                for (int i = 0; i < count; i++) {
+                        long run = labels->run_first[row] + i;
+                        if (keeps[labels->run_label[run] - 1]) {
+                                Rle2_append(kept, row, runs[i].start,
+                                            runs[i].end);
+                        }
+                }
+        }
+        FREE(keeps);
+        return kept;
+}
+
+void Label2_clear(Label2_T labels, Bit2_T bitmap,
+                  bool keep(int label, const Label2_component *component,
+                            void *closure),
+                  void *closure)
+{
+        assert(labels != NULL && bitmap != NULL && keep != NULL);
+        int height = Rle2_height(labels->image);
+        assert(Bit2_width(bitmap) == Rle2_width(labels->image));
+        assert(Bit2_height(bitmap) == height);
+        if (labels->ncomponents == 0) {
+                return;
+        }
+        bool *keeps = ALLOC(labels->ncomponents * (long)sizeof(bool));
+        for (int label = 1; label <= labels->ncomponents; label++) {
+                keeps[label - 1] = keep(label,
+                                        &labels->components[label - 1],
+                                        closure);
+        }
+        for (int row = 0; row < height; row++) {
+                const Rle2_run *runs;
+                int count = Rle2_row(labels->image, row, &runs);
+                for (int i = 0; i < count; i++) {
+                        long run = labels->run_first[row] + i;
+                        if (!keeps[labels->run_label[run] - 1]) {
+                                clear_range(bitmap, row, runs[i].start,
+                                            runs[i].end);
+                        }
+                }
+        }
+        FREE(keeps);
+}
+
+/********** Label2_inside ********
+ *
+ * Use:
+ *      Filter predicate that keeps the components that do not touch the
+ *      border; with it, Label2_filter does what unblackedges does.
+ * Parameters:
+ *      int label:                         The component (not used).
+ *      const Label2_component *component: Its statistics.
+ *      void *closure:                     Not used.
+ * Return:
+ *      true if the component has no pixel on the border.
+ * Expects:
+ *      None.
+ * Notes:
+ *      Label2_on_border follows the same pattern, keeping the components
+ *      that do touch the border, the ones unblackedges clears; and
+ *      Label2_at_least keeps the components whose area is at least
+ *      *(long *)closure, which removes specks.
+ *
+ ************************/
+bool Label2_inside(int label, const Label2_component *component,
+                   void *closure)
+{
+        (void) label;
+        (void) closure;
+        return !component->border;
+}
+
+bool Label2_on_border(int label, const Label2_component *component,
+                      void *closure)
+{
+        (void) label;
+        (void) closure;
+        return component->border;
+}
+
+bool Label2_at_least(int label, const Label2_component *component,
+                     void *closure)
+{
+        (void) label;
+        return component->area >= *(long *)closure;
+}
+
+/********** join_rows ********
+ *
+ * Use:
+ *      Unions each run of a row with the runs it touches in the row
+ *      above.
+ * Parameters:
+ *      const Rle2_run *above: The runs of the row above.
+ *      int nabove:            Their number.
+ *      long first_above:      The number of the first of them.
+ *      const Rle2_run *runs:  The runs of the row.
+ *      int nruns:             Their number.
+ *      long first:            The number of the first of them.
+ *      int reach:             0 for 4-connectivity, 1 for 8, the columns
+ *                             a run reaches past its ends diagonally.
+ *      long *parent:          The union-find forest over runs.
+ * Return:
+ *      None.
+ * Expects:
+ *      None.
+ * Notes:
+ *      Walks both rows together, so the time is linear in their runs. A
+ *      union links the larger root under the smaller, so every root is
+ *      its component's first run in raster order.
+ *
+ ************************/
+static void join_rows(const Rle2_run *above, int nabove, long first_above,
+                      const Rle2_run *runs, int nruns, long first,
+                      int reach, long *parent)
+{
+        int j = 0;
+        for (int i = 0; i < nruns; i++) {
+                long start = (long)runs[i].start - reach;
+                long end = (long)runs[i].end + reach;
+                while (j < nabove && above[j].end <= start) {
+                        j++;
+                }
+                for (int k = j; k < nabove && above[k].start < end; k++) {
+                        long a = find(parent, first_above + k);
+                        long b = find(parent, first + i);
+                        if (a < b) {
+                                parent[b] = a;
+                        } else if (b < a) {
+                                parent[a] = b;
+                        }
+                }
+        }
+}
+
+/********** find ********
+ *
+ * Use:
+ *      Finds the root of a run's tree, halving the path on the way.
+ * Parameters:
+ *      long *parent: The union-find forest.
+ *      long run:     The run.
+ * Return:
+ *      The root.
+ * Expects:
+ *      None.
+ * Notes:
+ *      None.
+ *
+ ************************/
+static long find(long *parent, long run)
+{
+        while (parent[run] != run) {
+                parent[run] = parent[parent[run]];
+                run = parent[run];
+        }
+        return run;
+}
+
+/********** clear_range ********
+ *
+ * Use:
+ *      Clears columns [start, end) of one row of a dense bitmap.
+ * Parameters:
+ *      Bit2_T bitmap: The bitmap, which may be a view.
+ *      int row:       The row.
+ *      int start:     First column.
+ *      int end:       One past the last column.
+ * Return:
+ *      None.
+ * Expects:
+ *      start < end and both lie in the bitmap.
+ * Notes:
+ *      Clears whole words at a time.
+ *
+ ************************/
+static void clear_range(Bit2_T bitmap, int row, int start, int end)
+{
+        uint64_t *words = &bitmap->words[row * bitmap->words_per_row];
+        long first = (long)start + bitmap->offset;
+        long last = (long)end - 1 + bitmap->offset;
+        for (long w = first / 64; w <= last / 64; w++) {
+                uint64_t mask = ~(uint64_t)0;
+                if (w == first / 64) {
+                        mask &= ~(uint64_t)0 << (first % 64);
+                }
+                if (w == last / 64) {
+                        mask &= ~(uint64_t)0 >> (63 - last % 64);
+                }
+                words[w] &= ~mask;
+        }
+}
@@ -0,0 +1,71 @@
+/*
+ *     label2.h
+ *     by nozden01 & bdioni01, 2/12/2024
+ *     iii
+ *
+ *     Struct and function declarations for connected-component labeling
+ *     of 2D bitmaps. Labeling works on the runs of an Rle2_T in two
+ *     passes: the first joins each run to the runs it touches in the row
+ *     above with a union-find over runs, and the second numbers the
+ *     components 1, 2, ... in raster order of their first pixel and
+ *     gathers their statistics. Background pixels have label 0.
+ *
+ *     From the labels, a filter keeps or drops whole components in one
+ *     pass over the runs, so edge removal (drop components that touch the
+ *     border), speck removal (drop components smaller than some area) and
+ *     layout analysis (read the bounding boxes) share one engine.
+ */
+
+#ifndef LABEL2_INCLUDED
+#define LABEL2_INCLUDED
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <assert.h>
+#include "mem.h"
+#include "bit2.h"
+#include "rle2.h"
+#include "uarray2t.h"
+
+/* One component: its number of pixels, its bounding box (columns [left,
+ * right] and rows [top, bottom]), and whether it has a pixel in the first
+ * or last row or column. */
+typedef struct Label2_component {
+        long area;
+        int left;
+        int top;
+        int right;
+        int bottom;
+        bool border;
+} Label2_component;
+
+typedef struct Label2_T *Label2_T;
+
+Label2_T Label2_new(Rle2_T image, int connectivity);
+Label2_T Label2_from_bit2(Bit2_T bitmap, int connectivity);
+void Label2_free(Label2_T *labels);
+
+int Label2_count(Label2_T labels);
+const Label2_component *Label2_component_of(Label2_T labels, int label);
+int Label2_at(Label2_T labels, int col, int row);
+UArray2_int Label2_grid(Label2_T labels);
+
+Rle2_T Label2_filter(Label2_T labels,
+                     bool keep(int label, const Label2_component *component,
+                               void *closure),
+                     void *closure);
+void Label2_clear(Label2_T labels, Bit2_T bitmap,
+                  bool keep(int label, const Label2_component *component,
+                            void *closure),
+                  void *closure);
+bool Label2_inside(int label, const Label2_component *component,
+                   void *closure);
+bool Label2_on_border(int label, const Label2_component *component,
+                      void *closure);
+bool Label2_at_least(int label, const Label2_component *component,
+                     void *closure);
+
+#endif
@@ -0,0 +1,692 @@
+/*
+ *     morph2.c
+ *     by nozden01 & bdioni01, 2/12/2024
+ *     iii
+ *
+ *     Function implementations for binary morphology on 2D bitmaps.
+ */
+
+#include "morph2.h"
+
+#ifndef MORPH2_LANES
+#define MORPH2_LANES 2
+#endif
+
+/* MORPH2_LANES words, operated on together. */
+typedef uint64_t Lanes __attribute__((vector_size(8 * MORPH2_LANES)));
+
+enum { OP_OR, OP_AND, OP_COPY };
+
+/* A row of a bitmap copied into words, padded at both ends with 0 words so
+ * that shifting it by up to twice its width reads only 0s. n is a
+ * multiple of MORPH2_LANES, at least the number of words of the row. */
+typedef struct Rows {
+        int width;
+        long row_words;
+        long n;
+        long guard;
+} Rows;
+
+static Rows rows_for(Bit2_T bitmap);
+static uint64_t *new_row(Rows rows);
+static void free_row(Rows rows, uint64_t **row);
+static void load_row(Bit2_T bitmap, int row, uint64_t *buf);
+static void store_row(Bit2_T bitmap, int row, const uint64_t *buf);
+static void rect(Bit2_T src, Bit2_T dst, Morph2_shape shape, int op);
+static void cross(Bit2_T src, Bit2_T dst, int op);
+static void span(uint64_t *out, const uint64_t *in, uint64_t *tmp, long n,
+                 long before, long after, int op);
+static void shift_op(uint64_t *out, const uint64_t *a, const uint64_t *b,
+                     long s, long n, int op);
+static void count_row(uint64_t *planes[4], uint64_t *const ring[3],
+                      uint64_t *tmp, long n, int connectivity);
+static inline Lanes load(const uint64_t *p);
+static inline void store(uint64_t *p, Lanes v);
+static inline Lanes shifted(const uint64_t *b, long k, long q, int bits);
+
+/************** Morph2_dilate ************
+ *
+ * Use:
+ *      Dilates a bitmap: a pixel of the result is 1 if any pixel under the
+ *      element centered on it is 1.
+ * Parameters:
+ *      Bit2_T src:         The bitmap.
+ *      Bit2_T dst:         The result, which may be src.
+ *      Morph2_shape shape: The structuring element.
+ * Return:
+ *      None.
+ * Expects:
+ *      src and dst are not NULL and the same size, and the element's
+ *      sides are positive (throws a CRE if not).
+ * Notes:
+ *      A rectangle is applied as a row pass and a column pass; the row
+ *      pass takes log2(width) shifts per word by doubling the span, and
+ *      the column pass one operation per row of the element.
+ *      Morph2_erode follows the same pattern, with and in place of or.
+ *
+ ************************/
+void Morph2_dilate(Bit2_T src, Bit2_T dst, Morph2_shape shape)
+{
+        if (shape.cross) {
+                cross(src, dst, OP_OR);
+        } else {
+                rect(src, dst, shape, OP_OR);
+        }
+}
+
+void Morph2_erode(Bit2_T src, Bit2_T dst, Morph2_shape shape)
+{
+        if (shape.cross) {
+                cross(src, dst, OP_AND);
+        } else {
+                rect(src, dst, shape, OP_AND);
+        }
+}
+
+/************** Morph2_open ************
+ *
+ * Use:
+ *      Opens a bitmap: erodes it and then dilates the result, removing
+ *      specks smaller than the element.
+ * Parameters:
+ *      Bit2_T src:         The bitmap.
+ *      Bit2_T dst:         The result, which may be src.
+ *      Morph2_shape shape: The structuring element.
+ * Return:
+ *      None.
+ * Expects:
+ *      As Morph2_dilate.
+ * Notes:
+ *      Works in dst, so needs no more memory than a single pass.
+ *      Morph2_close follows the same pattern, dilating first to fill gaps
+ *      smaller than the element.
+ *
+ ************************/
+void Morph2_open(Bit2_T src, Bit2_T dst, Morph2_shape shape)
+{
+        Morph2_erode(src, dst, shape);
+        Morph2_dilate(dst, dst, shape);
+}
+
+void Morph2_close(Bit2_T src, Bit2_T dst, Morph2_shape shape)
+{
+        Morph2_dilate(src, dst, shape);
+        Morph2_erode(dst, dst, shape);
+}
+
+/************** Morph2_neighbors ************
+ *
+ * Use:
+ *      Marks the pixels that have at least min neighbors set.
+ * Parameters:
+ *      Bit2_T src:       The bitmap.
+ *      Bit2_T dst:       The result, which may be src.
+ *      int connectivity: 4 to count the pixels beside, above and below, 8
+ *                        to count the diagonals too.
+ *      int min:          The fewest neighbors that give a 1.
+ * Return:
+ *      None.
+ * Expects:
+ *      src and dst are not NULL and the same size, connectivity is 4 or 8
+ *      and 0 <= min <= connectivity (throws a CRE if not).
+ * Notes:
+ *      The pixel itself is not counted. The counts are kept as four bit
+ *      planes, summed a word at a time with carries, and compared with min
+ *      the same way; for example min 1 finds pixels next to a 1 and, with
+ *      connectivity 8, min 5 is a majority filter.
+ *
+ ************************/
+void Morph2_neighbors(Bit2_T src, Bit2_T dst, int connectivity, int min)
+{
+        assert(src != NULL && dst != NULL);
+        assert(src->width == dst->width && src->height == dst->height);
+        assert(connectivity == 4 || connectivity == 8);
+        assert(min >= 0 && min <= connectivity);
+        Rows rows = rows_for(src);
+        uint64_t *ring[3];
+        uint64_t *planes[4];
+        for (int i = 0; i < 3; i++) {
+                ring[i] = new_row(rows);
+        }
+        for (int i = 0; i < 4; i++) {
+                planes[i] = new_row(rows);
+        }
+        uint64_t *tmp = new_row(rows);
+        uint64_t *out = new_row(rows);
+        if (src->height > 0) {
+                load_row(src, 0, ring[1]);
+        }
+        for (int row = 0; row < src->height; row++) {
+                memset(ring[2], 0, rows.n * sizeof(uint64_t));
+                if (row + 1 < src->height) {
+                        load_row(src, row + 1, ring[2]);
+                }
+                count_row(planes, ring, tmp, rows.n, connectivity);
+                for (long k = 0; k < rows.n; k += MORPH2_LANES) {
+                        Lanes gt = { 0 };
+                        Lanes eq = ~gt;
+                        for (int b = 3; b >= 0; b--) {
+                                Lanes plane = load(planes[b] + k);
+                                if ((min >> b) & 1) {
+                                        eq &= plane;
+                                } else {
+                                        gt |= eq & plane;
+                                        eq &= ~plane;
+                                }
+                        }
+                        store(out + k, gt | eq);
+                }
+                store_row(dst, row, out);
+                uint64_t *oldest = ring[0];
+                ring[0] = ring[1];
+                ring[1] = ring[2];
+                ring[2] = oldest;
+        }
+        for (int i = 0; i < 3; i++) {
+                free_row(rows, &ring[i]);
+        }
+        for (int i = 0; i < 4; i++) {
+                free_row(rows, &planes[i]);
+        }
+        free_row(rows, &tmp);
+        free_row(rows, &out);
+}
+
+/************** Morph2_count ************
+ *
+ * Use:
+ *      Counts the set neighbors of every pixel.
+ * Parameters:
+ *      Bit2_T src:       The bitmap.
+ *      UArray2_u8 counts: Set to each pixel's count, 0 to connectivity.
+ *      int connectivity: 4 or 8, as in Morph2_neighbors.
+ * Return:
+ *      None.
+ * Expects:
+ *      src and counts are not NULL and the same size, and connectivity is
+ *      4 or 8 (throws a CRE if not).
+ * Notes:
+ *      Counts as Morph2_neighbors does; only spreading the bit planes into
+ *      bytes is done a pixel at a time.
+ *
+ ************************/
+void Morph2_count(Bit2_T src, UArray2_u8 counts, int connectivity)
+{
+        assert(src != NULL && counts != NULL);
+        assert(src->width == UArray2_u8_width(counts));
+        assert(src->height == UArray2_u8_height(counts));
+        assert(connectivity == 4 || connectivity == 8);
+        Rows rows = rows_for(src);
+        uint64_t *ring[3];
+        uint64_t *planes[4];
+        for (int i = 0; i < 3; i++) {
+                ring[i] = new_row(rows);
+        }
+        for (int i = 0; i < 4; i++) {
+                planes[i] = new_row(rows);
+        }
+        uint64_t *tmp = new_row(rows);
+        if (src->height > 0) {
+                load_row(src, 0, ring[1]);
+        }
+        for (int row = 0; row < src->height; row++) {
+                memset(ring[2], 0, rows.n * sizeof(uint64_t));
+                if (row + 1 < src->height) {
+                        load_row(src, row + 1, ring[2]);
+                }
+                count_row(planes, ring, tmp, rows.n, connectivity);
+                uint8_t *bytes = UArray2_u8_row(counts, row);
+                for (int col = 0; col < src->width; col++) {
+                        int k = col / 64;
+                        int bit = col % 64;
+                        bytes[col] = (uint8_t)((planes[0][k] >> bit & 1) |
+                                               (planes[1][k] >> bit & 1) << 1 |
+                                               (planes[2][k] >> bit & 1) << 2 |
+                                               (planes[3][k] >> bit & 1) << 3);
+                }
+                uint64_t *oldest = ring[0];
+                ring[0] = ring[1];
+                ring[1] = ring[2];
+                ring[2] = oldest;
+        }
+        for (int i = 0; i < 3; i++) {
+                free_row(rows, &ring[i]);
+        }
+        for (int i = 0; i < 4; i++) {
+                free_row(rows, &planes[i]);
+        }
+        free_row(rows, &tmp);
+}
+
+/************** rows_for ************
+ *
+ * Use:
+ *      Sizes the row buffers for a bitmap.
+ * Parameters:
+ *      Bit2_T bitmap: The bitmap.
+ * Return:
+ *      The sizes.
+ * Expects:
+ *      bitmap is not NULL (throws a CRE if not).
+ * Notes:
+ *      The guard on each side is two rows' worth of words and a vector
+ *      more, the farthest any shift reads.
+ *
+ ************************/
+static Rows rows_for(Bit2_T bitmap)
+{
+        assert(bitmap != NULL);
+        Rows rows;
+        rows.width = bitmap->width;
+        rows.row_words = ((long)bitmap->width + 63) / 64;
+        rows.n = (rows.row_words + MORPH2_LANES - 1) / MORPH2_LANES *
+                 MORPH2_LANES;
+        if (rows.n == 0) {
+                rows.n = MORPH2_LANES;
+        }
+        rows.guard = 2 * rows.n + 2 * MORPH2_LANES;
+        return rows;
+}
+
+/************** new_row ************
+ *
+ * Use:
+ *      Allocates a zeroed row buffer.
+ * Parameters:
+ *      Rows rows: The buffer sizes.
+ * Return:
+ *      A pointer to word 0 of the row, past the front guard.
+ * Expects:
+ *      None.
+ * Notes:
+ *      free_row releases it.
+ *
+ ************************/
+static uint64_t *new_row(Rows rows)
+{
+        uint64_t *words = CALLOC(rows.n + 2 * rows.guard, sizeof(uint64_t));
+        return words + rows.guard;
+}
+
+static void free_row(Rows rows, uint64_t **row)
+{
+        uint64_t *words = *row - rows.guard;
+        FREE(words);
+        *row = NULL;
+}
+
+/************** load_row ************
+ *
+ * Use:
+ *      Copies one row of a bitmap into a row buffer.
+ * Parameters:
+ *      Bit2_T bitmap: The bitmap, which may be a view.
+ *      int row:       The row.
+ *      uint64_t *buf: The buffer; its first row_words words are written.
+ * Return:
+ *      None.
+ * Expects:
+ *      None.
+ * Notes:
+ *      Bits past the width are cleared. store_row does the reverse,
+ *      leaving the bitmap's bits outside the row's width alone, so it is
+ *      safe on views that share words with their parent.
+ *
+ ************************/
+static void load_row(Bit2_T bitmap, int row, uint64_t *buf)
+{
+        const uint64_t *words = &bitmap->words[row * bitmap->words_per_row];
+        long row_words = ((long)bitmap->width + 63) / 64;
+        for (long k = 0; k < row_words; k++) {
+                long bit = 64 * k + bitmap->offset;
+                int shift = (int)(bit % 64);
+                uint64_t word = words[bit / 64] >> shift;
+                if (shift != 0 && bit / 64 + 1 < bitmap->words_per_row) {
+                        word |= words[bit / 64 + 1] << (64 - shift);
+                }
+                buf[k] = word;
+        }
+        if (bitmap->width % 64 != 0) {
+                buf[row_words - 1] &= ~(uint64_t)0 >>
+                                      (64 - bitmap->width % 64);
+        }
+}
+
+static void store_row(Bit2_T bitmap, int row, const uint64_t *buf)
+{
+        uint64_t *words = &bitmap->words[row * bitmap->words_per_row];
+        long row_words = ((long)bitmap->width + 63) / 64;
+        for (long k = 0; k < row_words; k++) {
+                long nbits = bitmap->width - 64 * k;
+                uint64_t mask = nbits >= 64 ? ~(uint64_t)0
+                                            : ~(~(uint64_t)0 << nbits);
+                uint64_t value = buf[k] & mask;
+                long bit = 64 * k + bitmap->offset;
+                int shift = (int)(bit % 64);
+                words[bit / 64] = (words[bit / 64] & ~(mask << shift)) |
+                                  value << shift;
+                if (shift != 0 && (mask >> (64 - shift)) != 0) {
+                        words[bit / 64 + 1] =
+                                (words[bit / 64 + 1] &
+                                 ~(mask >> (64 - shift))) |
+                                value >> (64 - shift);
+                }
+        }
+}
+
+/************** rect ************
+ *
+ * Use:
+ *      Dilates or erodes a bitmap by a rectangle.
+ * Parameters:
+ *      Bit2_T src, Bit2_T dst: As Morph2_dilate.
+ *      Morph2_shape shape:     The rectangle.
+ *      int op:                 OP_OR to dilate, OP_AND to erode.
+ * Return:
+ *      None.
+ * Expects:
+ *      As Morph2_dilate (throws a CRE if not).
+ * Notes:
+ *      Keeps the row-pass results of the rows under the element in a
+ *      ring, so each source row is read and spanned once, before the
+ *      first destination row it affects is written. Parts of the element
+ *      farther than the bitmap's size past the pixel change nothing and
+ *      are dropped, which bounds the shifts and the ring.
+ *
+ ************************/
+static void rect(Bit2_T src, Bit2_T dst, Morph2_shape shape, int op)
+{
+        assert(src != NULL && dst != NULL);
+        assert(src->width == dst->width && src->height == dst->height);
+        assert(shape.width > 0 && shape.height > 0);
+        Rows rows = rows_for(src);
+        long left = shape.width / 2;
+        long right = shape.width - 1 - left;
+        long above = shape.height / 2;
+        long below = shape.height - 1 - above;
+        left = left < src->width ? left : src->width;
+        right = right < src->width ? right : src->width;
+        above = above < src->height ? above : src->height;
+        below = below < src->height ? below : src->height;
+        int nring = (int)(above + below + 1);
+
+        uint64_t **ring = ALLOC(nring * (long)sizeof(uint64_t *));
+        for (int i = 0; i < nring; i++) {
+                ring[i] = new_row(rows);
+        }
+        uint64_t *raw = new_row(rows);
+        uint64_t *tmp = new_row(rows);
+        uint64_t *out = new_row(rows);
+        long loaded = 0;
+        for (long row = 0; row < src->height; row++) {
+                for (; loaded <= row + below && loaded < src->height;
+                     loaded++) {
+                        load_row(src, (int)loaded, raw);
+                        span(ring[loaded % nring], raw, tmp, rows.n, left,
+                             right, op);
+                }
+                long first = row - above;
+                long last = row + below;
+                if (op == OP_AND && (first < 0 || last >= src->height)) {
+                        memset(out, 0, rows.n * sizeof(uint64_t));
+                } else {
+                        first = first > 0 ? first : 0;
+                        last = last < src->height ? last : src->height - 1;
+                        memcpy(out, ring[first % nring],
+                               rows.n * sizeof(uint64_t));
+                        for (long r = first + 1; r <= last; r++) {
+                                shift_op(out, out, ring[r % nring], 0,
+                                         rows.n, op);
+                        }
+                }
+                store_row(dst, (int)row, out);
+        }
+        for (int i = 0; i < nring; i++) {
+                free_row(rows, &ring[i]);
+        }
+        FREE(ring);
+        free_row(rows, &raw);
+        free_row(rows, &tmp);
+        free_row(rows, &out);
+}
+
+/************** cross ************
+ *
+ * Use:
+ *      Dilates or erodes a bitmap by the 4-connected plus sign.
+ * Parameters:
+ *      Bit2_T src, Bit2_T dst: As Morph2_dilate.
+ *      int op:                 OP_OR to dilate, OP_AND to erode.
+ * Return:
+ *      None.
+ * Expects:
+ *      src and dst are not NULL and the same size (throws a CRE if not).
+ * Notes:
+ *      Each result row is the rows above and below combined with a
+ *      3-wide span of the row itself.
+ *
+ ************************/
+static void cross(Bit2_T src, Bit2_T dst, int op)
+{
+        assert(src != NULL && dst != NULL);
+        assert(src->width == dst->width && src->height == dst->height);
+        Rows rows = rows_for(src);
+        uint64_t *ring[3];
+        for (int i = 0; i < 3; i++) {
+                ring[i] = new_row(rows);
+        }
+        uint64_t *tmp = new_row(rows);
+        uint64_t *out = new_row(rows);
+        if (src->height > 0) {
+                load_row(src, 0, ring[1]);
+        }
+        for (int row = 0; row < src->height; row++) {
+                memset(ring[2], 0, rows.n * sizeof(uint64_t));
+                if (row + 1 < src->height) {
+                        load_row(src, row + 1, ring[2]);
+                }
+                if (op == OP_AND && (row == 0 || row + 1 == src->height)) {
+                        memset(out, 0, rows.n * sizeof(uint64_t));
+                } else {
+                        span(out, ring[1], tmp, rows.n, 1, 1, op);
+                        shift_op(out, out, ring[0], 0, rows.n, op);
+                        shift_op(out, out, ring[2], 0, rows.n, op);
+                }
+                store_row(dst, row, out);
+                uint64_t *oldest = ring[0];
+                ring[0] = ring[1];
+                ring[1] = ring[2];
+                ring[2] = oldest;
+        }
+        for (int i = 0; i < 3; i++) {
+                free_row(rows, &ring[i]);
+        }
+        free_row(rows, &tmp);
+        free_row(rows, &out);
+}
+
+/************** span ************
+ *
+ * Use:
+ *      Combines every pixel of a row with its neighbors in the row.
+ * Parameters:
+ *      uint64_t *out:      Set so that pixel c is the op of pixels
+ *                          [c - before, c + after] of in.
+ *      const uint64_t *in: The row.
+ *      uint64_t *tmp:      A scratch row.
+ *      long n:             Words per row buffer.
+ *      long before:        Pixels to the left, at most twice the width.
+ *      long after:         Pixels to the right, likewise.
+ *      int op:             OP_OR or OP_AND.
+ * Return:
+ *      None.
+ * Expects:
+ *      The guards of in are 0, and so is tmp's back guard.
+ * Notes:
+ *      After step i, pixel c of tmp combines the 2^i pixels from c on; a
+ *      last step with a shorter shift fills out the span, which then
+ *      shifts into place. Each step reads ahead of what it writes, so it
+ *      can work in place, and it covers the words left of the row that
+ *      the final shift reads, using tmp's front guard.
+ *
+ ************************/
+static void span(uint64_t *out, const uint64_t *in, uint64_t *tmp, long n,
+                 long before, long after, int op)
+{
+        long size = before + after + 1;
+        long ext = ((before + 63) / 64 + MORPH2_LANES - 1) / MORPH2_LANES *
+                   MORPH2_LANES;
+        uint64_t *from = tmp - ext;
+        memcpy(from, in - ext, (n + ext) * sizeof(uint64_t));
+        long done = 1;
+        while (2 * done <= size) {
+                shift_op(from, from, from, done, n + ext, op);
+                done *= 2;
+        }
+        if (done < size) {
+                shift_op(from, from, from, size - done, n + ext, op);
+        }
+        shift_op(out, NULL, tmp, -before, n, OP_COPY);
+}
+
+/************** shift_op ************
+ *
+ * Use:
+ *      Combines a row with a shifted row.
+ * Parameters:
+ *      uint64_t *out:     Set so that pixel c is pixel c of a op pixel
+ *                         c + s of b.
+ *      const uint64_t *a: The first row; not read for OP_COPY.
+ *      const uint64_t *b: The shifted row.
+ *      long s:            The shift, negative to read to the left.
+ *      long n:            Words per row buffer.
+ *      int op:            OP_OR, OP_AND or OP_COPY.
+ * Return:
+ *      None.
+ * Expects:
+ *      |s| is within b's guard. out may be a; out may be b only when s
+ *      >= 0, since each vector reads b at or ahead of where it writes.
+ * Notes:
+ *      The word offset and bit shift are worked out once per call, so the
+ *      loops are straight vector code.
+ *
+ ************************/
+static void shift_op(uint64_t *out, const uint64_t *a, const uint64_t *b,
+                     long s, long n, int op)
+{
+        long q = s >= 0 ? s / 64 : -((-s + 63) / 64);
+        int bits = (int)(s - 64 * q);
+        if (op == OP_OR) {
+                for (long k = 0; k < n; k += MORPH2_LANES) {
+                        store(out + k, load(a + k) | shifted(b, k, q, bits));
+                }
+        } else if (op == OP_AND) {
+                for (long k = 0; k < n; k += MORPH2_LANES) {
+                        store(out + k, load(a + k) & shifted(b, k, q, bits));
+                }
+        } else {
+                for (long k = 0; k < n; k += MORPH2_LANES) {
+                        store(out + k, shifted(b, k, q, bits));
+                }
+        }
+}
+
+/************** count_row ************
+ *
+ * Use:
+ *      Counts the set neighbors of every pixel of a row into bit planes.
+ * Parameters:
+ *      uint64_t *planes[4]:       Set so that bit c of plane b is bit b of
+ *                                 pixel c's count.
+ *      uint64_t *const ring[3]:   The rows above, at and below; rows
+ *                                 outside the bitmap are 0.
+ *      uint64_t *tmp:             A scratch row.
+ *      long n:                    Words per row buffer.
+ *      int connectivity:          4 or 8.
+ * Return:
+ *      None.
+ * Expects:
+ *      None.
+ * Notes:
+ *      Each neighbor direction is one shifted row, added into the planes
+ *      with a ripple of carries: at most 4 ands and 4 xors per word.
+ *
+ ************************/
+static void count_row(uint64_t *planes[4], uint64_t *const ring[3],
+                      uint64_t *tmp, long n, int connectivity)
+{
+        static const int STEPS[8][2] = {
+                { 0, 0 }, { 2, 0 }, { 1, -1 }, { 1, 1 },
+                { 0, -1 }, { 0, 1 }, { 2, -1 }, { 2, 1 }
+        };
+        for (int b = 0; b < 4; b++) {
+                memset(planes[b], 0, n * sizeof(uint64_t));
+        }
+        for (int i = 0; i < connectivity; i++) {
+                shift_op(tmp, NULL, ring[STEPS[i][0]], STEPS[i][1], n,
+                         OP_COPY);
+                for (long k = 0; k < n; k += MORPH2_LANES) {
+                        Lanes carry = load(tmp + k);
+                        for (int b = 0; b < 4; b++) {
+                                Lanes plane = load(planes[b] + k);
+                                store(planes[b] + k, plane ^ carry);
+                                carry &= plane;
+                        }
+                }
+        }
+}
+
+/************** load ************
+ *
+ * Use:
+ *      Reads MORPH2_LANES words at any alignment.
+ * Parameters:
+ *      const uint64_t *p: The first word.
+ * Return:
+ *      The words.
+ * Expects:
+ *      None.
+ * Notes:
+ *      store writes them back the same way; both compile to single
+ *      unaligned vector moves.
+ *
+ ************************/
+static inline Lanes load(const uint64_t *p)
+{
+        Lanes v;
+        memcpy(&v, p, sizeof(v));
+        return v;
+}
+
+static inline void store(uint64_t *p, Lanes v)
+{
+        memcpy(p, &v, sizeof(v));
+}
+
+/************** shifted ************
+ *
+ * Use:
+ *      Reads MORPH2_LANES words of a row shifted by 64 * q + bits bits.
+ * Parameters:
+ *      const uint64_t *b: The row.
+ *      long k:            The first word.
+ *      long q:            Whole words of shift.
+ *      int bits:          Bits of shift, 0 to 63.
+ * Return:
+ *      Words k onward of the row whose pixel c is pixel c + 64 * q + bits
+ *      of b.
+ * Expects:
+ *      None.
+ * Notes:
+ *      None.
+ *
+ ************************/
+static inline Lanes shifted(const uint64_t *b, long k, long q, int bits)
+{
+        Lanes lo = load(b + k + q);
+        if (bits == 0) {
+                return lo;
+        }
+        Lanes hi = load(b + k + q + 1);
+        return (lo >> bits) | (hi << (64 - bits));
+}
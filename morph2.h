@@ -0,0 +1,55 @@
+/*
+ *     morph2.h
+ *     by nozden01 & bdioni01, 2/12/2024
+ *     iii
+ *
+ *     Struct and function declarations for binary morphology on 2D
+ *     bitmaps: dilation, erosion, opening and closing, and 3x3 neighbor
+ *     counts. Every operation works on whole rows of 64-bit words, three
+ *     or more rows at a time, with shifts and bitwise operations; no
+ *     pixel is visited on its own except to write Morph2_count's bytes.
+ *
+ *     The word loops use GCC vector extensions, MORPH2_LANES words at a
+ *     time: 2 by default, one SSE2 register; 4 for AVX2, which needs
+ *     -mavx2; 1 for the plain one-word version.
+ *
+ *     Pixels outside the bitmap count as 0, so erosion clears pixels
+ *     whose element reaches past the edge. The source and destination
+ *     may be the same bitmap, and either may be a view.
+ */
+
+#ifndef MORPH2_INCLUDED
+#define MORPH2_INCLUDED
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <assert.h>
+#include "mem.h"
+#include "bit2.h"
+#include "uarray2t.h"
+
+/* A structuring element: a width x height rectangle whose center, at
+ * (width / 2, height / 2), lies on the pixel, or with cross set, the
+ * 4-connected 3x3 plus sign. */
+typedef struct Morph2_shape {
+        int width;
+        int height;
+        bool cross;
+} Morph2_shape;
+
+#define MORPH2_CROSS ((Morph2_shape){ 3, 3, true })
+#define MORPH2_SQUARE ((Morph2_shape){ 3, 3, false })
+#define MORPH2_RECT(width, height) ((Morph2_shape){ (width), (height), false })
+
+void Morph2_dilate(Bit2_T src, Bit2_T dst, Morph2_shape shape);
+void Morph2_erode(Bit2_T src, Bit2_T dst, Morph2_shape shape);
+void Morph2_open(Bit2_T src, Bit2_T dst, Morph2_shape shape);
+void Morph2_close(Bit2_T src, Bit2_T dst, Morph2_shape shape);
+
+void Morph2_neighbors(Bit2_T src, Bit2_T dst, int connectivity, int min);
+void Morph2_count(Bit2_T src, UArray2_u8 counts, int connectivity);
+
+#endif
@@ -0,0 +1,499 @@
+/*
+ *     pages.c
+ *     by nozden01 & bdioni01, 2/12/2024
+ *     iii
+ *
+ *     Function implementations for page-level allocation of large grids.
+ */
+
+#define _GNU_SOURCE
+
+#include <stdbool.h>
+#include <string.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include "pages.h"
+
+/* Every block is a whole number of huge pages, whatever its flags, so
+ * that Pages_free needs only the size that was asked for. */
+#define HUGE_BYTES (2L * 1024 * 1024)
+
+#define MAX_NODES 64
+
+/* Memory policy modes and flags, from the kernel's mempolicy.h. */
+#define POLICY_BIND 2
+#define POLICY_INTERLEAVE 3
+#define POLICY_F_NODE 1
+#define POLICY_F_ADDR 2
+
+static long round_up(long nbytes);
+static void *map_aligned(long length);
+static void bind_range(void *addr, long length, int mode,
+                       unsigned long mask);
+static int read_list(const char *path, bool *members, int limit);
+static void *zeroed_pages(long nbytes, void *flags);
+
+/********** Pages_alloc ********
+ *
+ * Use:
+ *      Maps a block of zeroed memory with the given page size and NUMA
+ *      placement.
+ * Parameters:
+ *      long nbytes: Size of the block in bytes.
+ *      int flags:   PAGES_ flags or'd together, or 0 for normal pages
+ *                   placed by the default policy.
+ * Return:
+ *      Pointer to the block, aligned to a huge page, or NULL if the memory
+ *      cannot be mapped.
+ * Expects:
+ *      nbytes > 0 (throws a CRE if not).
+ * Notes:
+ *      The size is rounded up to a whole number of huge pages, but pages
+ *      cost memory only once touched. PAGES_INTERLEAVE wins over
+ *      PAGES_SPREAD. The client releases the block with Pages_free.
+ *
+ ************************/
+void *Pages_alloc(long nbytes, int flags)
+{
+        assert(nbytes > 0);
+        long length = round_up(nbytes);
+        void *ptr = MAP_FAILED;
+        if (flags & PAGES_HUGETLB) {
+                ptr = mmap(NULL, length, PROT_READ | PROT_WRITE,
+                           MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+                if (ptr == MAP_FAILED) {
+                        flags |= PAGES_THP;
+                }
+        }
+        if (ptr == MAP_FAILED) {
+                ptr = map_aligned(length);
+                if (ptr == NULL) {
+                        return NULL;
+                }
+                if (flags & PAGES_THP) {
+                        madvise(ptr, length, MADV_HUGEPAGE);
+                }
+        }
+
+        int nodes = Pages_nodes();
+        if (nodes > 1 && (flags & PAGES_INTERLEAVE)) {
+                unsigned long all = nodes == MAX_NODES ? ~0UL
+                                                       : (1UL << nodes) - 1;
+                bind_range(ptr, length, POLICY_INTERLEAVE, all);
+        } else if (nodes > 1 && (flags & PAGES_SPREAD)) {
+                long slice = round_up((length + nodes - 1) / nodes);
+                for (int node = 0; node < nodes; node++) {
+                        long start = node * slice;
+                        if (start >= length) {
+                                break;
+                        }
+                        long size = length - start < slice ? length - start
+                                                           : slice;
+                        bind_range((char *)ptr + start, size, POLICY_BIND,
+                                   1UL << node);
+                }
+        }
+        return ptr;
+}
+
+/********** Pages_free ********
+ *
+ * Use:
+ *      Unmaps a block made by Pages_alloc.
+ * Parameters:
+ *      void *ptr:   The block.
+ *      long nbytes: The size that was passed to Pages_alloc.
+ * Return:
+ *      None.
+ * Expects:
+ *      ptr is not NULL (throws a CRE if not).
+ * Notes:
+ *      None.
+ *
+ ************************/
+void Pages_free(void *ptr, long nbytes)
+{
+        assert(ptr != NULL);
+        munmap(ptr, round_up(nbytes));
+}
+
+/********** Pages_nodes ********
+ *
+ * Use:
+ *      Returns the number of NUMA nodes.
+ * Parameters:
+ *      None.
+ * Return:
+ *      One more than the highest online node, at least 1 and at most 64.
+ * Expects:
+ *      None.
+ * Notes:
+ *      Read from sysfs on the first call and remembered; machines without
+ *      NUMA report 1.
+ *
+ ************************/
+int Pages_nodes(void)
+{
+        static int nodes = 0;
+        int known = __atomic_load_n(&nodes, __ATOMIC_RELAXED);
+        if (known == 0) {
+                bool online[MAX_NODES];
+                known = read_list("/sys/devices/system/node/online", online,
+                                  MAX_NODES);
+                if (known < 1) {
+                        known = 1;
+                }
+                __atomic_store_n(&nodes, known, __ATOMIC_RELAXED);
+        }
+        return known;
+}
+
+/********** Pages_node_of ********
+ *
+ * Use:
+ *      Finds the NUMA node that holds the page at an address.
+ * Parameters:
+ *      const void *addr: Any address in a mapped page.
+ * Return:
+ *      The node, or -1 if the kernel cannot say.
+ * Expects:
+ *      None.
+ * Notes:
+ *      A page that has not been touched yet is allocated as if it had
+ *      been read, so its node reflects the policy it was mapped with.
+ *
+ ************************/
+int Pages_node_of(const void *addr)
+{
+        int node = -1;
+        if (syscall(SYS_get_mempolicy, &node, NULL, 0UL, addr,
+                    POLICY_F_NODE | POLICY_F_ADDR) != 0) {
+                return -1;
+        }
+        return node;
+}
+
+/********** Pages_run_on_node ********
+ *
+ * Use:
+ *      Restricts the calling thread to the CPUs of one NUMA node.
+ * Parameters:
+ *      int node:               The node.
+ *      Pages_affinity *saved:  Receives the thread's affinity before the
+ *                              call, for Pages_restore_affinity.
+ * Return:
+ *      None.
+ * Expects:
+ *      saved is not NULL (throws a CRE if not).
+ * Notes:
+ *      Does nothing on a machine with one node, for a node outside
+ *      [0, Pages_nodes()), or if the node's CPUs or the thread's affinity
+ *      cannot be read; saved->saved then stays false. The restriction
+ *      stays until the thread is moved again, so a thread that runs other
+ *      work afterwards (a pool worker) should restore it.
+ *
+ ************************/
+void Pages_run_on_node(int node, Pages_affinity *saved)
+{
+        assert(saved != NULL);
+        assert(sizeof(cpu_set_t) <= sizeof(saved->mask));
+        saved->saved = false;
+        if (Pages_nodes() <= 1 || node < 0 || node >= Pages_nodes()) {
+                return;
+        }
+        char path[64];
+        snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/cpulist",
+                 node);
+        bool cpus[CPU_SETSIZE];
+        int ncpus = read_list(path, cpus, CPU_SETSIZE);
+        if (ncpus == 0) {
+                return;
+        }
+        cpu_set_t old;
+        if (sched_getaffinity(0, sizeof(old), &old) != 0) {
+                return;
+        }
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        for (int cpu = 0; cpu < ncpus; cpu++) {
+                if (cpus[cpu]) {
+                        CPU_SET(cpu, &set);
+                }
+        }
+        if (sched_setaffinity(0, sizeof(set), &set) == 0) {
+                memcpy(saved->mask, &old, sizeof(old));
+                saved->saved = true;
+        }
+}
+
+/********** Pages_restore_affinity ********
+ *
+ * Use:
+ *      Puts back the CPU affinity the calling thread had before
+ *      Pages_run_on_node.
+ * Parameters:
+ *      const Pages_affinity *saved: The affinity Pages_run_on_node saved.
+ * Return:
+ *      None.
+ * Expects:
+ *      saved is not NULL (throws a CRE if not).
+ * Notes:
+ *      Does nothing if Pages_run_on_node did not move the thread.
+ *
+ ************************/
+void Pages_restore_affinity(const Pages_affinity *saved)
+{
+        assert(saved != NULL);
+        if (!saved->saved) {
+                return;
+        }
+        cpu_set_t old;
+        memcpy(&old, saved->mask, sizeof(old));
+        sched_setaffinity(0, sizeof(old), &old);
+}
+
+/********** Pages_uarray2 ********
+ *
+ * Use:
+ *      Makes a 2D array whose elements are allocated with Pages_alloc.
+ * Parameters:
+ *      int col, int row: Dimensions of the array.
+ *      int size:         Size of an element in bytes.
+ *      int flags:        PAGES_ flags for the elements.
+ * Return:
+ *      The zeroed array, or NULL if its elements cannot be mapped.
+ * Expects:
+ *      The same as UArray2_new.
+ * Notes:
+ *      With PAGES_SPREAD each node holds a contiguous band of rows. The
+ *      client releases the array with Pages_free_uarray2.
+ *
+ ************************/
+UArray2_T Pages_uarray2(int col, int row, int size, int flags)
+{
+        struct UArray2_T *arr;
+        NEW(arr);
+        UArray2_init(arr, col, row, size, zeroed_pages, &flags);
+        if (arr->elems == NULL && col > 0 && row > 0) {
+                FREE(arr);
+        }
+        return arr;
+}
+
+/********** Pages_free_uarray2 ********
+ *
+ * Use:
+ *      Frees a 2D array made by Pages_uarray2.
+ * Parameters:
+ *      UArray2_T *arr: Pointer to the array; set to NULL.
+ * Return:
+ *      None.
+ * Expects:
+ *      arr and *arr are not NULL (throws a CRE if not).
+ * Notes:
+ *      None.
+ *
+ ************************/
+void Pages_free_uarray2(UArray2_T *arr)
+{
+        assert(arr != NULL && *arr != NULL);
+        if ((*arr)->elems != NULL) {
+                Pages_free((*arr)->elems, (*arr)->height * (*arr)->stride);
+        }
+        FREE(*arr);
+}
+
+/********** Pages_bit2 ********
+ *
+ * Use:
+ *      Makes a bitmap whose words are allocated with Pages_alloc.
+ * Parameters:
+ *      int col, int row: Dimensions of the bitmap.
+ *      int flags:        PAGES_ flags for the words.
+ * Return:
+ *      The zeroed bitmap, or NULL if its words cannot be mapped.
+ * Expects:
+ *      The same as Bit2_new.
+ * Notes:
+ *      The client releases the bitmap with Pages_free_bit2.
+ *
+ ************************/
+Bit2_T Pages_bit2(int col, int row, int flags)
+{
+        struct Bit2_T *bitmap;
+        NEW(bitmap);
+        Bit2_init(bitmap, col, row, zeroed_pages, &flags);
+        if (bitmap->words == NULL && col > 0 && row > 0) {
+                FREE(bitmap);
+        }
+        return bitmap;
+}
+
+/********** Pages_free_bit2 ********
+ *
+ * Use:
+ *      Frees a bitmap made by Pages_bit2.
+ * Parameters:
+ *      Bit2_T *bitmap: Pointer to the bitmap; set to NULL.
+ * Return:
+ *      None.
+ * Expects:
+ *      bitmap and *bitmap are not NULL (throws a CRE if not).
+ * Notes:
+ *      None.
+ *
+ ************************/
+void Pages_free_bit2(Bit2_T *bitmap)
+{
+        assert(bitmap != NULL && *bitmap != NULL);
+        if ((*bitmap)->words != NULL) {
+                Pages_free((*bitmap)->words, (*bitmap)->height *
+                           (*bitmap)->words_per_row * (long)sizeof(uint64_t));
+        }
+        FREE(*bitmap);
+}
+
+/********** round_up ********
+ *
+ * Use:
+ *      Rounds a size up to a whole number of huge pages.
+ * Parameters:
+ *      long nbytes: The size.
+ * Return:
+ *      The rounded size.
+ * Expects:
+ *      None.
+ * Notes:
+ *      None.
+ *
+ ************************/
+static long round_up(long nbytes)
+{
+        return (nbytes + HUGE_BYTES - 1) / HUGE_BYTES * HUGE_BYTES;
+}
+
+/********** map_aligned ********
+ *
+ * Use:
+ *      Maps anonymous memory that starts on a huge page boundary, which
+ *      transparent huge pages need.
+ * Parameters:
+ *      long length: Size of the mapping, a multiple of HUGE_BYTES.
+ * Return:
+ *      The mapping, or NULL if the memory cannot be mapped.
+ * Expects:
+ *      None.
+ * Notes:
+ *      Maps one huge page too many and unmaps the unaligned ends.
+ *
+ ************************/
+static void *map_aligned(long length)
+{
+        char *raw = mmap(NULL, length + HUGE_BYTES, PROT_READ | PROT_WRITE,
+                         MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (raw == MAP_FAILED) {
+                return NULL;
+        }
+        long head = (HUGE_BYTES - (long)((uintptr_t)raw % HUGE_BYTES)) %
+                    HUGE_BYTES;
+        if (head > 0) {
+                munmap(raw, head);
+        }
+        if (HUGE_BYTES - head > 0) {
+                munmap(raw + head + length, HUGE_BYTES - head);
+        }
+        return raw + head;
+}
+
+/********** bind_range ********
+ *
+ * Use:
+ *      Sets the NUMA policy of a range of pages that have not been touched
+ *      yet.
+ * Parameters:
+ *      void *addr:         Start of the range, page aligned.
+ *      long length:        Length of the range.
+ *      int mode:           POLICY_BIND or POLICY_INTERLEAVE.
+ *      unsigned long mask: The nodes, one bit each.
+ * Return:
+ *      None.
+ * Expects:
+ *      None.
+ * Notes:
+ *      Failures are ignored; the pages then follow the default policy.
+ *
+ ************************/
+static void bind_range(void *addr, long length, int mode,
+                       unsigned long mask)
+{
+        (void) syscall(SYS_mbind, addr, (unsigned long)length, mode, &mask,
+                       (unsigned long)MAX_NODES + 1, 0U);
+}
+
+/********** read_list ********
+ *
+ * Use:
+ *      Reads a sysfs list of numbers such as "0-3,8,10-11".
+ * Parameters:
+ *      const char *path: The sysfs file.
+ *      bool *members:    Set so that members[i] is true when i is listed.
+ *      int limit:        Length of members; larger numbers are ignored.
+ * Return:
+ *      One more than the highest number listed, or 0 if the file cannot
+ *      be read or lists nothing.
+ * Expects:
+ *      None.
+ * Notes:
+ *      None.
+ *
+ ************************/
+static int read_list(const char *path, bool *members, int limit)
+{
+        memset(members, 0, limit * sizeof(bool));
+        FILE *fp = fopen(path, "r");
+        if (fp == NULL) {
+                return 0;
+        }
+        int end = 0;
+        int first, last;
+        while (fscanf(fp, "%d", &first) == 1) {
+                last = first;
+                int c = fgetc(fp);
+                if (c == '-' && fscanf(fp, "%d", &last) == 1) {
+                        c = fgetc(fp);
+                }
+                for (int i = first; i <= last && i < limit; i++) {
+                        if (i >= 0) {
+                                members[i] = true;
+                                end = i + 1 > end ? i + 1 : end;
+                        }
+                }
+                if (c != ',') {
+                        break;
+                }
+        }
+        fclose(fp);
+        return end;
+}
+
+/********** zeroed_pages ********
+ *
+ * Use:
+ *      Allocation function for UArray2_init and Bit2_init.
+ * Parameters:
+ *      long nbytes: Number of bytes wanted.
+ *      void *flags: Pointer to the int PAGES_ flags.
+ * Return:
+ *      A zeroed block from Pages_alloc, or NULL.
+ * Expects:
+ *      None.
+ * Notes:
+ *      None.
+ *
+ ************************/
+static void *zeroed_pages(long nbytes, void *flags)
+{
+        return Pages_alloc(nbytes, *(int *)flags);
+}
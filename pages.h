@@ -0,0 +1,63 @@
+/*
+ *     pages.h
+ *     by nozden01 & bdioni01, 2/12/2024
+ *     iii
+ *
+ *     Function declarations for page-level allocation of large grids.
+ *
+ *     Pages_alloc maps memory straight from the kernel with a choice of
+ *     page size and NUMA placement:
+ *
+ *         PAGES_THP         ask for transparent huge pages (2 MiB), which
+ *                           cut TLB misses on column-major traversals
+ *         PAGES_HUGETLB     take pages from the hugetlbfs pool, falling
+ *                           back to PAGES_THP when the pool is empty
+ *         PAGES_INTERLEAVE  spread pages round-robin over all NUMA nodes
+ *         PAGES_SPREAD      split the block into one contiguous slice per
+ *                           node, so that bands of rows live on one node
+ *
+ *     Placement is a hint: on a machine with one node, or if the kernel
+ *     refuses, the memory is still returned, placed by the default policy.
+ *     Folds over grids whose rows have been placed by node (fold.h) run
+ *     each band on a CPU of the node that holds it.
+ *
+ *     Everything here is Linux-specific; NUMA calls are made directly as
+ *     system calls so that no NUMA library is needed.
+ */
+
+#ifndef PAGES_INCLUDED
+#define PAGES_INCLUDED
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include "mem.h"
+#include "uarray2.h"
+#include "bit2.h"
+
+#define PAGES_THP        1
+#define PAGES_HUGETLB    2
+#define PAGES_INTERLEAVE 4
+#define PAGES_SPREAD     8
+
+/* A thread's CPU affinity, saved by Pages_run_on_node so that it can be
+ * put back; mask holds a cpu_set_t. */
+typedef struct Pages_affinity {
+        bool saved;
+        unsigned long mask[16];
+} Pages_affinity;
+
+void *Pages_alloc(long nbytes, int flags);
+void Pages_free(void *ptr, long nbytes);
+int Pages_nodes(void);
+int Pages_node_of(const void *addr);
+void Pages_run_on_node(int node, Pages_affinity *saved);
+void Pages_restore_affinity(const Pages_affinity *saved);
+
+UArray2_T Pages_uarray2(int col, int row, int size, int flags);
+void Pages_free_uarray2(UArray2_T *arr);
+Bit2_T Pages_bit2(int col, int row, int flags);
+void Pages_free_bit2(Bit2_T *bitmap);
+
+#endif
@@ -0,0 +1,141 @@
+/*
+ *     pnmscan.c
+ *     by nozden01 & bdioni01, 2/12/2024
+ *     iii
+ *
+ *     Function implementations for the minimal streaming pnm reader.
+ */
+
+#include <ctype.h>
+#include <limits.h>
+#include "pnmscan.h"
+
+static long read_number(FILE *inputfd);
+
+/********** Pnmscan_header ********
+ *
+ * Use:
+ *      Reads a pnm header (magic number, width, height and, for graymaps and
+ *      pixmaps, the maximum value) and leaves the file at the first pixel.
+ * Parameters:
+ *      FILE *inputfd:      The file being read.
+ *      Pnmscan_info *info: Filled in with the header fields. format is the
+ *                          digit of the magic number, 1 through 6.
+ * Return:
+ *      True if a well-formed header was read, false otherwise.
+ * Expects:
+ *      inputfd and info are not NULL (throws a CRE if not).
+ * Notes:
+ *      Bitmaps (P1 and P4) get a maxval of 1. Comments starting with '#' are
+ *      skipped wherever whitespace is allowed. Widths and heights above
+ *      INT_MAX are rejected, since grids index each dimension with an int.
+ *
+ ************************/
+bool Pnmscan_header(FILE *inputfd, Pnmscan_info *info)
+{
+        assert(inputfd != NULL && info != NULL);
+        if (getc(inputfd) != 'P') {
+                return false;
+        }
+        int magic = getc(inputfd);
+        if (magic < '1' || magic > '6') {
+                return false;
+        }
+        info->format = magic - '0';
+
+        long width = read_number(inputfd);
+        long height = read_number(inputfd);
+        long maxval = 1;
+        if (info->format != 1 && info->format != 4) {
+                maxval = read_number(inputfd);
+        }
+        if (width <= 0 || height <= 0 || width > INT_MAX ||
+            height > INT_MAX || maxval <= 0 || maxval > 65535) {
+                return false;
+        }
+
+        /* Raw formats have exactly one whitespace byte before the data. */
+        if (info->format >= 4 && !isspace(getc(inputfd))) {
+                return false;
+        }
+        info->width = (unsigned)width;
+        info->height = (unsigned)height;
+        info->maxval = (unsigned)maxval;
+        return true;
+}
+
+/********** Pnmscan_gray ********
+ *
+ * Use:
+ *      Reads the next sample of a graymap, in either the plain (P2) or the
+ *      raw (P5) encoding.
+ * Parameters:
+ *      FILE *inputfd:            The file being read.
+ *      const Pnmscan_info *info: The header read by Pnmscan_header.
+ * Return:
+ *      The sample, or -1 at end of file or on malformed input.
+ * Expects:
+ *      info->format is 2 or 5 (throws a CRE if not).
+ * Notes:
+ *      Raw samples are two bytes, most significant first, when maxval is
+ *      above 255. Values above maxval are returned as they are; range
+ *      checking is up to the client.
+ *
+ ************************/
+long Pnmscan_gray(FILE *inputfd, const Pnmscan_info *info)
+{
+        assert(info->format == 2 || info->format == 5);
+        if (info->format == 2) {
+                return read_number(inputfd);
+        }
+        int high = getc(inputfd);
+        if (high == EOF || info->maxval < 256) {
+                return high;
+        }
+        int low = getc(inputfd);
+        return (low == EOF) ? -1 : (high << 8) | low;
+}
+
+/********** read_number ********
+ *
+ * Use:
+ *      Skips whitespace and comments and reads one unsigned decimal number.
+ * Parameters:
+ *      FILE *inputfd: The file being read.
+ * Return:
+ *      The number, or -1 at end of file, on a non-digit, or on overflow.
+ * Expects:
+ *      None.
+ * Notes:
+ *      The character after the number is pushed back, so that the single
+ *      whitespace byte before raw data can be checked by the caller.
+ *
+ ************************/
+static long read_number(FILE *inputfd)
+{
+        int c = getc(inputfd);
+        while (c == '#' || isspace(c)) {
+                if (c == '#') {
+                        while (c != '\n' && c != EOF) {
+                                c = getc(inputfd);
+                        }
+                }
+                c = getc(inputfd);
+        }
+        if (!isdigit(c)) {
+                return -1;
+        }
+
+        long value = 0;
+        while (isdigit(c)) {
+                if (value > (LONG_MAX - 9) / 10) {
+                        return -1;
+                }
+                value = value * 10 + (c - '0');
+                c = getc(inputfd);
+        }
+        if (c != EOF) {
+                ungetc(c, inputfd);
+        }
+        return value;
+}
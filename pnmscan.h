@@ -0,0 +1,29 @@
+/*
+ *     pnmscan.h
+ *     by nozden01 & bdioni01, 2/12/2024
+ *     iii
+ *
+ *     Struct and function declarations for a minimal streaming pnm reader.
+ *     Unlike Pnmrdr, it lets the client stop reading at any pixel, so that
+ *     input can be rejected as soon as it is known to be bad.
+ */
+
+#ifndef PNMSCAN_INCLUDED
+#define PNMSCAN_INCLUDED
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <assert.h>
+
+typedef struct Pnmscan_info {
+        int format;
+        unsigned width;
+        unsigned height;
+        unsigned maxval;
+} Pnmscan_info;
+
+bool Pnmscan_header(FILE *inputfd, Pnmscan_info *info);
+long Pnmscan_gray(FILE *inputfd, const Pnmscan_info *info);
+
+#endif
@@ -0,0 +1,510 @@
+/*
+ *     rank2.c
+ *     by nozden01 & bdioni01, 2/12/2024
+ *     iii
+ *
+ *     Function implementations for rank/select indexes over 2D bitmaps.
+ */
+
+#include "rank2.h"
+
+/* The index numbers the bitmap's bits as if each row were padded to whole
+ * words: word g is bits [64 * (g % row_words), +64) of row g / row_words,
+ * with 0s past the width. Blocks are BLOCK_WORDS words and superblocks
+ * SUPER_BLOCKS blocks; a superblock's count is the number of 1 bits in
+ * the words before it, and a block's is the number in the words between
+ * its superblock's start and its own. */
+#define BLOCK_WORDS 8
+#define SUPER_BLOCKS 8
+#define SUPER_WORDS (BLOCK_WORDS * SUPER_BLOCKS)
+
+struct Rank2_T {
+        Bit2_T bitmap;
+        long row_words;
+        long nwords;
+        long nblocks;
+        long nsupers;
+        long *supers;
+        uint16_t *blocks;
+};
+
+static void recount(Rank2_T index, long first, long last);
+static long rank_words(Rank2_T index, long g);
+static long select_rank(Rank2_T index, long rank);
+static uint64_t word_of(Rank2_T index, long g);
+static int select_word(uint64_t word, long rank);
+
+/************** Rank2_new ************
+ *
+ * Use:
+ *      Builds a rank/select index over a bitmap.
+ * Parameters:
+ *      Bit2_T bitmap: The bitmap, which may be a view.
+ * Return:
+ *      The new index.
+ * Expects:
+ *      bitmap is not NULL (throws a CRE if not).
+ * Notes:
+ *      Reads the bitmap once, a word at a time. The bitmap must outlive
+ *      the index; the client releases the index with Rank2_free.
+ *
+ ************************/
+Rank2_T Rank2_new(Bit2_T bitmap)
+{
+        assert(bitmap != NULL);
+        Rank2_T index;
+        NEW(index);
+        index->bitmap = bitmap;
+        index->row_words = ((long)bitmap->width + 63) / 64;
+        index->nwords = index->row_words * bitmap->height;
+        index->nblocks = (index->nwords + BLOCK_WORDS - 1) / BLOCK_WORDS;
+        index->nsupers = (index->nwords + SUPER_WORDS - 1) / SUPER_WORDS;
+        index->supers = CALLOC(index->nsupers + 1, sizeof(long));
+        index->blocks = NULL;
+        if (index->nblocks > 0) {
+                index->blocks = CALLOC(index->nblocks, sizeof(uint16_t));
+                recount(index, 0, index->nsupers - 1);
+        }
+        return index;
+}
+
+/************** Rank2_free ************
+ *
+ * Use:
+ *      Frees an index.
+ * Parameters:
+ *      Rank2_T *index: Pointer to the index; set to NULL.
+ * Return:
+ *      None.
+ * Expects:
+ *      index and *index are not NULL (throws a CRE if not).
+ * Notes:
+ *      Does not free the bitmap.
+ *
+ ************************/
+void Rank2_free(Rank2_T *index)
+{
+        assert(index != NULL && *index != NULL);
+        FREE((*index)->supers);
+        FREE((*index)->blocks);
+        FREE(*index);
+}
+
+/************** Rank2_bitmap ************
+ *
+ * Use:
+ *      Returns the bitmap an index was built over.
+ * Parameters:
+ *      Rank2_T index: The index.
+ * Return:
+ *      The bitmap.
+ * Expects:
+ *      index is not NULL (throws a CRE if not).
+ * Notes:
+ *      None.
+ *
+ ************************/
+Bit2_T Rank2_bitmap(Rank2_T index)
+{
+        assert(index != NULL);
+        return index->bitmap;
+}
+
+/************** Rank2_count ************
+ *
+ * Use:
+ *      Counts the 1 bits of the indexed bitmap.
+ * Parameters:
+ *      Rank2_T index: The index.
+ * Return:
+ *      The number of 1 bits.
+ * Expects:
+ *      index is not NULL (throws a CRE if not).
+ * Notes:
+ *      Constant time.
+ *
+ ************************/
+long Rank2_count(Rank2_T index)
+{
+        assert(index != NULL);
+        return index->supers[index->nsupers];
+}
+
+/************** Rank2_rank ************
+ *
+ * Use:
+ *      Counts the 1 bits before a pixel in row-major order.
+ * Parameters:
+ *      Rank2_T index:    The index.
+ *      int col, int row: The pixel; (0, height) stands for the end.
+ * Return:
+ *      The number of 1 bits in the rows above row and in columns [0, col)
+ *      of row.
+ * Expects:
+ *      index is not NULL and (col, row) is in the bitmap or is (0,
+ *      height) (throws a CRE if not).
+ * Notes:
+ *      Two directory reads and at most BLOCK_WORDS word counts.
+ *
+ ************************/
+long Rank2_rank(Rank2_T index, int col, int row)
+{
+        assert(index != NULL);
+        Bit2_T bitmap = index->bitmap;
+        assert(row >= 0 && row <= bitmap->height);
+        assert(col >= 0 && (row < bitmap->height ? col < bitmap->width
+                                                 : col == 0));
+        long g = row * index->row_words + col / 64;
+        long rank = rank_words(index, g);
+        if (col % 64 != 0) {
+                rank += Bit2_count_word(word_of(index, g) &
+                                        ~(~(uint64_t)0 << (col % 64)));
+        }
+        return rank;
+}
+
+/************** Rank2_select ************
+ *
+ * Use:
+ *      Finds the 1 bit with a given rank.
+ * Parameters:
+ *      Rank2_T index: The index.
+ *      long rank:     The number of 1 bits before the one sought.
+ *      int *col:      Set to the column of the bit when there is one.
+ *      int *row:      Set to its row.
+ * Return:
+ *      true if the bitmap has more than rank 1 bits, false if not.
+ * Expects:
+ *      index, col and row are not NULL and rank >= 0 (throws a CRE if
+ *      not).
+ * Notes:
+ *      A binary search over the superblocks, then at most SUPER_BLOCKS
+ *      blocks and BLOCK_WORDS words.
+ *
+ ************************/
+bool Rank2_select(Rank2_T index, long rank, int *col, int *row)
+{
+        assert(index != NULL && col != NULL && row != NULL);
+        assert(rank >= 0);
+        if (rank >= Rank2_count(index)) {
+                return false;
+        }
+        long bit = select_rank(index, rank);
+        long g = bit / 64;
+        *row = (int)(g / index->row_words);
+        *col = (int)((g % index->row_words) * 64 + bit % 64);
+        return true;
+}
+
+/************** Rank2_next ************
+ *
+ * Use:
+ *      Finds the first 1 bit at or after a pixel in row-major order.
+ * Parameters:
+ *      Rank2_T index:    The index.
+ *      int col, int row: Where to start.
+ *      int *next_col:    Set to the column of the bit when there is one.
+ *      int *next_row:    Set to its row.
+ * Return:
+ *      true if there is such a bit, false if not.
+ * Expects:
+ *      index, next_col and next_row are not NULL and (col, row) is in the
+ *      bitmap (throws a CRE if not).
+ * Notes:
+ *      Checks the rest of the starting block first, which finds the next
+ *      bit of a dense bitmap without touching the directory; otherwise
+ *      selects the first bit past that block.
+ *
+ ************************/
+bool Rank2_next(Rank2_T index, int col, int row, int *next_col,
+                int *next_row)
+{
+        assert(index != NULL && next_col != NULL && next_row != NULL);
+        Bit2_T bitmap = index->bitmap;
+        assert(col >= 0 && col < bitmap->width);
+        assert(row >= 0 && row < bitmap->height);
+        long g = row * index->row_words + col / 64;
+        uint64_t word = word_of(index, g) & (~(uint64_t)0 << (col % 64));
+        long end = g - g % BLOCK_WORDS + BLOCK_WORDS;
+        if (end > index->nwords) {
+                end = index->nwords;
+        }
+        while (word == 0 && ++g < end) {
+                word = word_of(index, g);
+        }
+        if (word != 0) {
+                *next_row = (int)(g / index->row_words);
+                *next_col = (int)((g % index->row_words) * 64 +
+                                  __builtin_ctzll(word));
+                return true;
+        }
+        return Rank2_select(index, rank_words(index, end), next_col,
+                            next_row);
+}
+
+/************** Rank2_put ************
+ *
+ * Use:
+ *      Sets one bit of the indexed bitmap and updates the index.
+ * Parameters:
+ *      Rank2_T index:    The index.
+ *      int col, int row: Position of the bit.
+ *      int bit:          The new value, 0 or 1.
+ * Return:
+ *      The previous value of the bit.
+ * Expects:
+ *      index is not NULL, (col, row) is in the bitmap and bit is 0 or 1
+ *      (throws a CRE if not).
+ * Notes:
+ *      Adjusts the later blocks of the bit's superblock and every later
+ *      superblock, one add each; a bitmap of n bits has n / 4096
+ *      superblocks.
+ *
+ ************************/
+int Rank2_put(Rank2_T index, int col, int row, int bit)
+{
+        assert(index != NULL);
+        int old = Bit2_put(index->bitmap, col, row, bit);
+        if (old != bit) {
+                int delta = bit - old;
+                long g = row * index->row_words + col / 64;
+                long s = g / SUPER_WORDS;
+                long last = (s + 1) * SUPER_BLOCKS;
+                if (last > index->nblocks) {
+                        last = index->nblocks;
+                }
+                for (long b = g / BLOCK_WORDS + 1; b < last; b++) {
+                        index->blocks[b] += delta;
+                }
+                for (s++; s <= index->nsupers; s++) {
+                        index->supers[s] += delta;
+                }
+        }
+        return old;
+}
+
+/************** Rank2_refresh ************
+ *
+ * Use:
+ *      Updates the index after the client changed the bitmap directly.
+ * Parameters:
+ *      Rank2_T index:           The index.
+ *      int col, int row:        Top left corner of the changed rectangle.
+ *      int width, int height:   Its size; either may be 0.
+ * Return:
+ *      None.
+ * Expects:
+ *      index is not NULL and the rectangle lies in the bitmap (throws a
+ *      CRE if not).
+ * Notes:
+ *      Recounts the superblocks the rectangle's words fall in and shifts
+ *      the later ones by the change, so a small edit costs far less than
+ *      Rank2_new.
+ *
+ ************************/
+void Rank2_refresh(Rank2_T index, int col, int row, int width, int height)
+{
+        assert(index != NULL);
+        Bit2_T bitmap = index->bitmap;
+        assert(col >= 0 && width >= 0 && (long)col + width <= bitmap->width);
+        assert(row >= 0 && height >= 0 &&
+               (long)row + height <= bitmap->height);
+        if (width == 0 || height == 0) {
+                return;
+        }
+        long first = (row * index->row_words + col / 64) / SUPER_WORDS;
+        long last = ((row + height - 1L) * index->row_words +
+                     (col + width - 1L) / 64) / SUPER_WORDS;
+        long before = index->supers[last + 1];
+        recount(index, first, last);
+        long delta = index->supers[last + 1] - before;
+        for (long s = last + 2; s <= index->nsupers && delta != 0; s++) {
+                index->supers[s] += delta;
+        }
+}
+
+/************** recount ************
+ *
+ * Use:
+ *      Recomputes the counts of a range of superblocks and their blocks.
+ * Parameters:
+ *      Rank2_T index: The index.
+ *      long first:    First superblock, whose count is correct.
+ *      long last:     Last superblock.
+ * Return:
+ *      None.
+ * Expects:
+ *      0 <= first <= last < index->nsupers.
+ * Notes:
+ *      Leaves the count of superblock last + 1 correct too, so the caller
+ *      can compare it with the old one; later counts are not touched.
+ *
+ ************************/
+static void recount(Rank2_T index, long first, long last)
+{
+        long total = index->supers[first];
+        for (long s = first; s <= last; s++) {
+                index->supers[s] = total;
+                long end = (s + 1) * SUPER_WORDS;
+                if (end > index->nwords) {
+                        end = index->nwords;
+                }
+                for (long g = s * SUPER_WORDS; g < end; g++) {
+                        if (g % BLOCK_WORDS == 0) {
+                                index->blocks[g / BLOCK_WORDS] =
+                                        (uint16_t)(total -
+                                                   index->supers[s]);
+                        }
+                        total += Bit2_count_word(word_of(index, g));
+                }
+        }
+        index->supers[last + 1] = total;
+}
+
+/************** rank_words ************
+ *
+ * Use:
+ *      Counts the 1 bits in the words before a word.
+ * Parameters:
+ *      Rank2_T index: The index.
+ *      long g:        The word, at most index->nwords.
+ * Return:
+ *      The number of 1 bits in words [0, g).
+ * Expects:
+ *      None.
+ * Notes:
+ *      None.
+ *
+ ************************/
+static long rank_words(Rank2_T index, long g)
+{
+        if (g >= index->nwords) {
+                return index->supers[index->nsupers];
+        }
+        long rank = index->supers[g / SUPER_WORDS] +
+                    index->blocks[g / BLOCK_WORDS];
+        for (long w = g - g % BLOCK_WORDS; w < g; w++) {
+                rank += Bit2_count_word(word_of(index, w));
+        }
+        return rank;
+}
+
+/************** select_rank ************
+ *
+ * Use:
+ *      Finds the padded bit number of the 1 bit with a given rank.
+ * Parameters:
+ *      Rank2_T index: The index.
+ *      long rank:     The rank, less than the count.
+ * Return:
+ *      64 * g + b for bit b of word g.
+ * Expects:
+ *      None.
+ * Notes:
+ *      None.
+ *
+ ************************/
+static long select_rank(Rank2_T index, long rank)
+{
+        long lo = 0;
+        long hi = index->nsupers - 1;
+        while (lo < hi) {
+                long mid = lo + (hi - lo + 1) / 2;
+                if (index->supers[mid] <= rank) {
+                        lo = mid;
+                } else {
+                        hi = mid - 1;
+                }
+        }
+        rank -= index->supers[lo];
+
+        long b = lo * SUPER_BLOCKS;
+        long last = b + SUPER_BLOCKS;
+        if (last > index->nblocks) {
+                last = index->nblocks;
+        }
+        while (b + 1 < last && index->blocks[b + 1] <= rank) {
+                b++;
+        }
+        rank -= index->blocks[b];
+
+        for (long g = b * BLOCK_WORDS; ; g++) {
+                uint64_t word = word_of(index, g);
+                long count = Bit2_count_word(word);
+                if (rank < count) {
+                        return 64 * g + select_word(word, rank);
+                }
+                rank -= count;
+        }
+}
+
+/************** word_of ************
+ *
+ * Use:
+ *      Reads one word of the bitmap as the index numbers them.
+ * Parameters:
+ *      Rank2_T index: The index.
+ *      long g:        The word, less than index->nwords.
+ * Return:
+ *      The word, with bits past the width cleared.
+ * Expects:
+ *      None.
+ * Notes:
+ *      Bitmaps that are not views read the stored word; views shift two
+ *      stored words together.
+ *
+ ************************/
+static uint64_t word_of(Rank2_T index, long g)
+{
+        Bit2_T bitmap = index->bitmap;
+        long row = g / index->row_words;
+        long k = g % index->row_words;
+        const uint64_t *words = &bitmap->words[row * bitmap->words_per_row];
+        long bit = 64 * k + bitmap->offset;
+        int shift = (int)(bit % 64);
+        uint64_t word = words[bit / 64] >> shift;
+        if (shift != 0 && bit / 64 + 1 < bitmap->words_per_row) {
+                word |= words[bit / 64 + 1] << (64 - shift);
+        }
+        if (k == index->row_words - 1 && bitmap->width % 64 != 0) {
+                word &= ~(uint64_t)0 >> (64 - bitmap->width % 64);
+        }
+        return word;
+}
+
+/************** select_word ************
+ *
+ * Use:
+ *      Finds the 1 bit with a given rank in one word.
+ * Parameters:
+ *      uint64_t word: The word.
+ *      long rank:     The rank, less than the word's count.
+ * Return:
+ *      The bit's position, 0 to 63.
+ * Expects:
+ *      None.
+ * Notes:
+ *      Finds the byte from the running byte counts, then clears at most
+ *      seven lower bits within it.
+ *
+ ************************/
+static int select_word(uint64_t word, long rank)
+{
+        uint64_t bytes = word - ((word >> 1) & 0x5555555555555555ULL);
+        bytes = (bytes & 0x3333333333333333ULL) +
+                ((bytes >> 2) & 0x3333333333333333ULL);
+        bytes = (bytes + (bytes >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+        uint64_t running = bytes * 0x0101010101010101ULL;
+        int byte = 0;
+        while ((long)((running >> (8 * byte)) & 0xFF) <= rank) {
+                byte++;
+        }
+        if (byte > 0) {
+                rank -= (long)((running >> (8 * (byte - 1))) & 0xFF);
+        }
+        word >>= 8 * byte;
+        for (; rank > 0; rank--) {
+                word &= word - 1;
+        }
+        return 8 * byte + __builtin_ctzll(word);
+}
@@ -0,0 +1,43 @@
+/*
+ *     rank2.h
+ *     by nozden01 & bdioni01, 2/12/2024
+ *     iii
+ *
+ *     Struct and function declarations for rank/select indexes over 2D
+ *     bitmaps. Pixels are ordered row-major; the rank of a pixel is the
+ *     number of 1 bits before it, and the select of k is the position of
+ *     the 1 bit whose rank is k. An index answers both, and "next 1 bit at
+ *     or after this pixel", without looping over pixels.
+ *
+ *     The index is a two-level directory of counts: a long every 4096 bits
+ *     and a 16-bit count every 512 bits, about 4.7% of the bitmap. It
+ *     refers to the bitmap, which the client keeps and frees; edits made
+ *     through Rank2_put keep the counts current, and edits made to the
+ *     bitmap directly are brought in with Rank2_refresh.
+ */
+
+#ifndef RANK2_INCLUDED
+#define RANK2_INCLUDED
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <assert.h>
+#include "mem.h"
+#include "bit2.h"
+
+typedef struct Rank2_T *Rank2_T;
+
+Rank2_T Rank2_new(Bit2_T bitmap);
+void Rank2_free(Rank2_T *index);
+Bit2_T Rank2_bitmap(Rank2_T index);
+long Rank2_count(Rank2_T index);
+long Rank2_rank(Rank2_T index, int col, int row);
+bool Rank2_select(Rank2_T index, long rank, int *col, int *row);
+bool Rank2_next(Rank2_T index, int col, int row, int *next_col,
+                int *next_row);
+int Rank2_put(Rank2_T index, int col, int row, int bit);
+void Rank2_refresh(Rank2_T index, int col, int row, int width, int height);
+
+#endif
@@ -0,0 +1,230 @@
+/*
+ *     region.c
+ *     by nozden01 & bdioni01, 2/12/2024
+ *     iii
+ *
+ *     Function implementations for regions.
+ */
+
+#include "region.h"
+
+/* Every allocation is aligned for any basic type. */
+#define ALIGN 16
+
+/* Chunk size when Region_new is given 0. */
+#define DEFAULT_CHUNK (64 * 1024L)
+
+/* A chunk's usable bytes start HEADER_BYTES after the chunk itself. */
+typedef struct Chunk {
+        struct Chunk *next;
+        long size;
+} Chunk;
+
+#define HEADER_BYTES ((long)((sizeof(Chunk) + ALIGN - 1) / ALIGN * ALIGN))
+
+struct Region_T {
+        long chunk_bytes;
+        Chunk *used;
+        Chunk *spare;
+        char *avail;
+        char *limit;
+};
+
+static void add_chunk(Region_T region, long nbytes);
+
+/********** Region_new ********
+ *
+ * Use:
+ *      Creates an empty region.
+ * Parameters:
+ *      long chunk_bytes: Size of the chunks the region allocates, or 0 for
+ *                        the default of 64 KiB.
+ * Return:
+ *      The new region.
+ * Expects:
+ *      chunk_bytes >= 0 (throws a CRE if not).
+ * Notes:
+ *      Allocates nothing until the first Region_alloc. The client releases
+ *      the region with Region_free.
+ *
+ ************************/
+Region_T Region_new(long chunk_bytes)
+{
+        assert(chunk_bytes >= 0);
+        Region_T region;
+        NEW(region);
+        region->chunk_bytes = chunk_bytes > 0 ? chunk_bytes : DEFAULT_CHUNK;
+        region->used = NULL;
+        region->spare = NULL;
+        region->avail = NULL;
+        region->limit = NULL;
+        return region;
+}
+
+/********** Region_alloc ********
+ *
+ * Use:
+ *      Allocates memory from a region.
+ * Parameters:
+ *      Region_T region: The region.
+ *      long nbytes:     Number of bytes wanted.
+ * Return:
+ *      Pointer to nbytes of uninitialized memory, aligned for any basic
+ *      type, that stays valid until the region is reset or freed.
+ * Expects:
+ *      region is not NULL and nbytes > 0 (throws a CRE if not).
+ * Notes:
+ *      Allocations larger than the chunk size get a chunk of their own.
+ *      Raises Mem_Failed if memory runs out, as ALLOC does.
+ *
+ ************************/
+void *Region_alloc(Region_T region, long nbytes)
+{
+        assert(region != NULL && nbytes > 0);
+        nbytes = (nbytes + ALIGN - 1) / ALIGN * ALIGN;
+        if (region->avail == NULL || nbytes > region->limit - region->avail) {
+                add_chunk(region, nbytes);
+        }
+        void *ptr = region->avail;
+        region->avail += nbytes;
+        return ptr;
+}
+
+/********** Region_calloc ********
+ *
+ * Use:
+ *      Allocates zeroed memory for an array from a region.
+ * Parameters:
+ *      Region_T region: The region.
+ *      long count:      Number of elements.
+ *      long nbytes:     Size of an element in bytes.
+ * Return:
+ *      Pointer to count * nbytes zeroed bytes.
+ * Expects:
+ *      region is not NULL, count > 0 and nbytes > 0 (throws a CRE if not).
+ * Notes:
+ *      None.
+ *
+ ************************/
+void *Region_calloc(Region_T region, long count, long nbytes)
+{
+        assert(count > 0 && nbytes > 0);
+        void *ptr = Region_alloc(region, count * nbytes);
+        memset(ptr, 0, count * nbytes);
+        return ptr;
+}
+
+/********** Region_zeroed ********
+ *
+ * Use:
+ *      Allocation function for UArray2_init and Bit2_init that takes
+ *      zeroed memory from the region passed as its closure.
+ * Parameters:
+ *      long nbytes:  Number of bytes wanted.
+ *      void *region: The Region_T.
+ * Return:
+ *      Pointer to nbytes zeroed bytes.
+ * Expects:
+ *      region is not NULL and nbytes > 0 (throws a CRE if not).
+ * Notes:
+ *      None.
+ *
+ ************************/
+void *Region_zeroed(long nbytes, void *region)
+{
+        return Region_calloc(region, 1, nbytes);
+}
+
+/********** Region_reset ********
+ *
+ * Use:
+ *      Releases everything allocated from a region at once, keeping its
+ *      chunks for the allocations that follow.
+ * Parameters:
+ *      Region_T region: The region.
+ * Return:
+ *      None.
+ * Expects:
+ *      region is not NULL (throws a CRE if not).
+ * Notes:
+ *      Chunks of the standard size are kept; the larger chunks made for
+ *      single big allocations are freed.
+ *
+ ************************/
+void Region_reset(Region_T region)
+{
+        assert(region != NULL);
+        while (region->used != NULL) {
+                Chunk *chunk = region->used;
+                region->used = chunk->next;
+                if (chunk->size == region->chunk_bytes) {
+                        chunk->next = region->spare;
+                        region->spare = chunk;
+                } else {
+                        FREE(chunk);
+                }
+        }
+        region->avail = NULL;
+        region->limit = NULL;
+}
+
+/********** Region_free ********
+ *
+ * Use:
+ *      Frees a region and everything allocated from it.
+ * Parameters:
+ *      Region_T *region: Pointer to the region; set to NULL.
+ * Return:
+ *      None.
+ * Expects:
+ *      region and *region are not NULL (throws a CRE if not).
+ * Notes:
+ *      None.
+ *
+ ************************/
+void Region_free(Region_T *region)
+{
+        assert(region != NULL && *region != NULL);
+        Region_reset(*region);
+        while ((*region)->spare != NULL) {
+                Chunk *chunk = (*region)->spare;
+                (*region)->spare = chunk->next;
+                FREE(chunk);
+        }
+        FREE(*region);
+}
+
+/********** add_chunk ********
+ *
+ * Use:
+ *      Makes a chunk with room for at least nbytes into the region's
+ *      current chunk, reusing a spare chunk when one is big enough.
+ * Parameters:
+ *      Region_T region: The region.
+ *      long nbytes:     Size of the allocation that did not fit.
+ * Return:
+ *      None.
+ * Expects:
+ *      None.
+ * Notes:
+ *      Whatever was left in the previous chunk is abandoned until the next
+ *      reset.
+ *
+ ************************/
+static void add_chunk(Region_T region, long nbytes)
+{
+        Chunk *chunk;
+        if (nbytes <= region->chunk_bytes && region->spare != NULL) {
+                chunk = region->spare;
+                region->spare = chunk->next;
+        } else {
+                long size = nbytes > region->chunk_bytes ? nbytes
+                                                         : region->chunk_bytes;
+                chunk = ALLOC(HEADER_BYTES + size);
+                chunk->size = size;
+        }
+        chunk->next = region->used;
+        region->used = chunk;
+        region->avail = (char *)chunk + HEADER_BYTES;
+        region->limit = region->avail + chunk->size;
+}
@@ -0,0 +1,51 @@
+/*
+ *     region.h
+ *     by nozden01 & bdioni01, 2/12/2024
+ *     iii
+ *
+ *     Struct and function declarations for regions: allocators that hand
+ *     out memory from large chunks and release everything they handed out
+ *     in one operation. A region has no global state, so threads that each
+ *     use their own region never contend, and a region that is reset keeps
+ *     its chunks, so a loop that resets it every iteration stops calling
+ *     malloc after the first.
+ *
+ *     Region_uarray2 and Region_bit2 build grids whose struct and elements
+ *     both live in a region; they are released with the region and must
+ *     not be passed to UArray2_free or Bit2_free.
+ */
+
+#ifndef REGION_INCLUDED
+#define REGION_INCLUDED
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include "mem.h"
+#include "uarray2.h"
+#include "bit2.h"
+
+typedef struct Region_T *Region_T;
+
+Region_T Region_new(long chunk_bytes);
+void *Region_alloc(Region_T region, long nbytes);
+void *Region_calloc(Region_T region, long count, long nbytes);
+void *Region_zeroed(long nbytes, void *region);
+void Region_reset(Region_T region);
+void Region_free(Region_T *region);
+
+static inline UArray2_T Region_uarray2(Region_T region, int col, int row,
+                                       int size)
+{
+        struct UArray2_T *arr = Region_alloc(region, sizeof(*arr));
+        return UArray2_init(arr, col, row, size, Region_zeroed, region);
+}
+
+static inline Bit2_T Region_bit2(Region_T region, int col, int row)
+{
+        struct Bit2_T *bitmap = Region_alloc(region, sizeof(*bitmap));
+        return Bit2_init(bitmap, col, row, Region_zeroed, region);
+}
+
+#endif
@@ -0,0 +1,740 @@
+/*
+ *     rle2.c
+ *     by nozden01 & bdioni01, 2/12/2024
+ *     iii
+ *
+ *     Function implementations for run-length encoded 2D bitmaps.
+ */
+
+#include "rle2.h"
+
+/* Truth tables of the boolean operations: bit 2 * a + b is the result for
+ * input bits a and b. */
+#define OP_AND   0x8
+#define OP_OR    0xE
+#define OP_XOR   0x6
+#define OP_MINUS 0x4
+
+/* Runs are stored row after row in one array; row_first[r] is the index
+ * of row r's first run for every row up to last_row, and the rows after
+ * last_row have no runs yet. */
+struct Rle2_T {
+        int width;
+        int height;
+        int last_row;
+        long nruns;
+        long capacity;
+        Rle2_run *runs;
+        long *row_first;
+};
+
+/* A run waiting to be visited by Rle2_clear_border. */
+typedef struct Pending {
+        long run;
+        int row;
+} Pending;
+
+static long row_span(Rle2_T rle, int row, long *first);
+static Rle2_T combine(Rle2_T a, Rle2_T b, int table);
+static void mark_overlaps(Rle2_T rle, int row, const Rle2_run *run,
+                          char *marked, Pending **stack, long *depth,
+                          long *capacity);
+static void push_run(long run, int row, char *marked, Pending **stack,
+                     long *depth, long *capacity);
+
+/********** Rle2_new ********
+ *
+ * Use:
+ *      Creates an all-zero run-length encoded bitmap.
+ * Parameters:
+ *      int width, int height: Dimensions of the bitmap.
+ * Return:
+ *      The new bitmap, which has no runs.
+ * Expects:
+ *      width >= 0 and height >= 0 (throws a CRE if not).
+ * Notes:
+ *      Uses one long per row and nothing per pixel. The client releases
+ *      the bitmap with Rle2_free.
+ *
+ ************************/
+Rle2_T Rle2_new(int width, int height)
+{
+        assert(width >= 0 && height >= 0);
+        Rle2_T rle;
+        NEW(rle);
+        rle->width = width;
+        rle->height = height;
+        rle->last_row = -1;
+        rle->nruns = 0;
+        rle->capacity = 0;
+        rle->runs = NULL;
+        rle->row_first = NULL;
+        if (height > 0) {
+                rle->row_first = ALLOC(height * (long)sizeof(long));
+        }
+        return rle;
+}
+
+/********** Rle2_free ********
+ *
+ * Use:
+ *      Frees a run-length encoded bitmap.
+ * Parameters:
+ *      Rle2_T *rle: Pointer to the bitmap; set to NULL.
+ * Return:
+ *      None.
+ * Expects:
+ *      rle and *rle are not NULL (throws a CRE if not).
+ * Notes:
+ *      None.
+ *
+ ************************/
+void Rle2_free(Rle2_T *rle)
+{
+        assert(rle != NULL && *rle != NULL);
+        FREE((*rle)->runs);
+        FREE((*rle)->row_first);
+        FREE(*rle);
+}
+
+/********** Rle2_width ********
+ *
+ * Use:
+ *      Returns the width of the bitmap.
+ * Parameters:
+ *      Rle2_T rle: The bitmap.
+ * Return:
+ *      The width.
+ * Expects:
+ *      rle is not NULL (throws a CRE if not).
+ * Notes:
+ *      Rle2_height and Rle2_nruns follow the same pattern; Rle2_nruns
+ *      returns the total number of runs.
+ *
+ ************************/
+int Rle2_width(Rle2_T rle)
+{
+        assert(rle != NULL);
+        return rle->width;
+}
+
+int Rle2_height(Rle2_T rle)
+{
+        assert(rle != NULL);
+        return rle->height;
+}
+
+long Rle2_nruns(Rle2_T rle)
+{
+        assert(rle != NULL);
+        return rle->nruns;
+}
+
+/********** Rle2_append ********
+ *
+ * Use:
+ *      Sets the bits in columns [start, end) of a row to 1.
+ * Parameters:
+ *      Rle2_T rle:          The bitmap.
+ *      int row:             The row.
+ *      int start, int end:  The columns.
+ * Return:
+ *      None.
+ * Expects:
+ *      rle is not NULL, row is in [0, height) and 0 <= start < end <=
+ *      width (throws a CRE if not).
+ *      That runs are appended in row-major order: row is not before the
+ *      row of the last run appended, and in the same row start is not
+ *      before that run's end (throws a CRE if not).
+ * Notes:
+ *      A run that starts where the last one ended extends it, so runs
+ *      stay maximal.
+ *
+ ************************/
+void Rle2_append(Rle2_T rle, int row, int start, int end)
+{
+        assert(rle != NULL);
+        assert(row >= 0 && row < rle->height);
+        assert(start >= 0 && start < end && end <= rle->width);
+        assert(row >= rle->last_row);
+        if (row == rle->last_row && rle->nruns > rle->row_first[row]) {
+                Rle2_run *last = &rle->runs[rle->nruns - 1];
+                assert(start >= last->end);
+                if (start == last->end) {
+                        last->end = end;
+                        return;
+                }
+        }
+        while (rle->last_row < row) {
+                rle->row_first[++rle->last_row] = rle->nruns;
+        }
+        if (rle->capacity == 0) {
+                rle->capacity = 16;
+                rle->runs = ALLOC(rle->capacity * (long)sizeof(Rle2_run));
+        } else if (rle->nruns == rle->capacity) {
+                rle->capacity *= 2;
+                RESIZE(rle->runs, rle->capacity * (long)sizeof(Rle2_run));
+        }
+        rle->runs[rle->nruns].start = start;
+        rle->runs[rle->nruns].end = end;
+        rle->nruns++;
+}
+
+/********** Rle2_from_bit2 ********
+ *
+ * Use:
+ *      Encodes a dense bitmap.
+ * Parameters:
+ *      Bit2_T bitmap: The bitmap, which may be a view.
+ * Return:
+ *      A new run-length encoded bitmap with the same bits.
+ * Expects:
+ *      bitmap is not NULL (throws a CRE if not).
+ * Notes:
+ *      Scans a word at a time and finds the ends of runs with a count of
+ *      trailing zeros, so long runs of either color cost one step per
+ *      word.
+ *
+ ************************/
+Rle2_T Rle2_from_bit2(Bit2_T bitmap)
+{
+        assert(bitmap != NULL);
+        int width = Bit2_width(bitmap);
+        int height = Bit2_height(bitmap);
+        Rle2_T rle = Rle2_new(width, height);
+        long nbits = (long)bitmap->offset + width;
+        for (int row = 0; row < height; row++) {
+                const uint64_t *words = &bitmap->words[row *
+                                                       bitmap->words_per_row];
+                bool in_run = false;
+                long start = 0;
+                for (long w = 0; w * 64 < nbits; w++) {
+                        uint64_t word = words[w];
+                        if (w == 0) {
+                                word &= ~(uint64_t)0 << bitmap->offset;
+                        }
+                        if ((w + 1) * 64 > nbits) {
+                                word &= ~(uint64_t)0 >> (64 - nbits % 64);
+                        }
+                        long base = w * 64 - bitmap->offset;
+                        int pos = 0;
+                        while (pos < 64) {
+                                uint64_t rest = (in_run ? ~word : word) &
+                                                (~(uint64_t)0 << pos);
+                                if (rest == 0) {
+                                        break;
+                                }
+                                int bit = __builtin_ctzll(rest);
+                                if (in_run) {
+                                        Rle2_append(rle, row, (int)start,
+                                                    (int)(base + bit));
+                                } else {
+                                        start = base + bit;
+                                }
+                                in_run = !in_run;
+                                pos = bit + 1;
+                        }
+                }
+                if (in_run) {
+                        Rle2_append(rle, row, (int)start, width);
+                }
+        }
+        return rle;
+}
+
+/********** Rle2_from_packed ********
+ *
+ * Use:
+ *      Encodes bitmap rows packed as in a raw (P4) PBM file.
+ * Parameters:
+ *      const unsigned char *data: The rows, (width + 7) / 8 bytes each,
+ *                                 eight pixels to a byte with the first in
+ *                                 the high bit.
+ *      int width:                 Number of columns.
+ *      int height:                Number of rows.
+ * Return:
+ *      A new run-length encoded bitmap with the same bits.
+ * Expects:
+ *      data is not NULL, width >= 0 and height >= 0 (throws a CRE if
+ *      not), and data holds height rows.
+ * Notes:
+ *      All-0 bytes outside a run and all-1 bytes inside one are passed
+ *      over whole; only bytes where a run starts or ends are taken apart
+ *      bit by bit. The padding bits after the last column are ignored.
+ *
+ ************************/
+Rle2_T Rle2_from_packed(const unsigned char *data, int width, int height)
+{
+        assert(data != NULL);
+        assert(width >= 0 && height >= 0);
+        long row_bytes = ((long)width + 7) / 8;
+        Rle2_T rle = Rle2_new(width, height);
+        for (int row = 0; row < height; row++) {
+                const unsigned char *bytes = data + row * row_bytes;
+                int start = -1;
+                for (long k = 0; k < row_bytes; k++) {
+                        unsigned byte = bytes[k];
+                        if ((start < 0 && byte == 0) ||
+                            (start >= 0 && byte == 0xff)) {
+                                continue;
+                        }
+                        for (int bit = 0; bit < 8; bit++) {
+                                int col = (int)(8 * k + bit);
+                                int set = (byte >> (7 - bit)) & 1;
+                                if (col >= width) {
+                                        break;
+                                } else if (set && start < 0) {
+                                        start = col;
+                                } else if (!set && start >= 0) {
+                                        Rle2_append(rle, row, start, col);
+                                        start = -1;
+                                }
+                        }
+                }
+                if (start >= 0) {
+                        Rle2_append(rle, row, start, width);
+                }
+        }
+        return rle;
+}
+
+/********** Rle2_to_bit2 ********
+ *
+ * Use:
+ *      Decodes a run-length encoded bitmap.
+ * Parameters:
+ *      Rle2_T rle: The bitmap.
+ * Return:
+ *      A new Bit2_T with the same bits.
+ * Expects:
+ *      rle is not NULL (throws a CRE if not).
+ * Notes:
+ *      Fills whole words inside each run. The client releases the result
+ *      with Bit2_free.
+ *
+ ************************/
+Bit2_T Rle2_to_bit2(Rle2_T rle)
+{
+        assert(rle != NULL);
+        Bit2_T bitmap = Bit2_new(rle->width, rle->height);
+        for (int row = 0; row < rle->height; row++) {
+                long first;
+                long count = row_span(rle, row, &first);
+                uint64_t *words = &bitmap->words[row *
+                                                 bitmap->words_per_row];
+                for (long i = first; i < first + count; i++) {
+                        long lo = rle->runs[i].start;
+                        long hi = rle->runs[i].end - 1;
+                        long lo_word = lo / 64;
+                        long hi_word = hi / 64;
+                        uint64_t lo_mask = ~(uint64_t)0 << (lo % 64);
+                        uint64_t hi_mask = ~(uint64_t)0 >> (63 - hi % 64);
+                        if (lo_word == hi_word) {
+                                words[lo_word] |= lo_mask & hi_mask;
+                                continue;
+                        }
+                        words[lo_word] |= lo_mask;
+                        for (long w = lo_word + 1; w < hi_word; w++) {
+                                words[w] = ~(uint64_t)0;
+                        }
+                        words[hi_word] |= hi_mask;
+                }
+        }
+        return bitmap;
+}
+
+/********** Rle2_get ********
+ *
+ * Use:
+ *      Returns one bit of the bitmap.
+ * Parameters:
+ *      Rle2_T rle:       The bitmap.
+ *      int col, int row: Position of the bit.
+ * Return:
+ *      The bit, 0 or 1.
+ * Expects:
+ *      rle is not NULL and (col, row) is in the bitmap (throws a CRE if
+ *      not).
+ * Notes:
+ *      Binary searches the row's runs.
+ *
+ ************************/
+int Rle2_get(Rle2_T rle, int col, int row)
+{
+        assert(rle != NULL);
+        assert(col >= 0 && col < rle->width && row >= 0 && row < rle->height);
+        long first;
+        long lo = 0;
+        long count = row_span(rle, row, &first);
+        long hi = count;
+        const Rle2_run *runs = &rle->runs[first];
+        while (lo < hi) {
+                long mid = lo + (hi - lo) / 2;
+                if (runs[mid].end <= col) {
+                        lo = mid + 1;
+                } else {
+                        hi = mid;
+                }
+        }
+        return lo < count && runs[lo].start <= col;
+}
+
+/********** Rle2_row ********
+ *
+ * Use:
+ *      Gives the runs of one row.
+ * Parameters:
+ *      Rle2_T rle:            The bitmap.
+ *      int row:               The row.
+ *      const Rle2_run **runs: Set to the row's first run.
+ * Return:
+ *      The number of runs in the row.
+ * Expects:
+ *      rle and runs are not NULL and row is in [0, height) (throws a CRE
+ *      if not).
+ * Notes:
+ *      The runs belong to the bitmap and stay valid until the next
+ *      Rle2_append.
+ *
+ ************************/
+int Rle2_row(Rle2_T rle, int row, const Rle2_run **runs)
+{
+        assert(rle != NULL && runs != NULL);
+        assert(row >= 0 && row < rle->height);
+        long first;
+        long count = row_span(rle, row, &first);
+        *runs = rle->runs + first;
+        return (int)count;
+}
+
+/********** Rle2_map_runs ********
+ *
+ * Use:
+ *      Calls apply on every run of the bitmap in row-major order.
+ * Parameters:
+ *      Rle2_T rle: The bitmap.
+ *      void apply(int row, int start, int end, void *closure):
+ *                  Called with each run's row and columns [start, end).
+ *      void *closure: Passed to apply.
+ * Return:
+ *      None.
+ * Expects:
+ *      rle and apply are not NULL (throws a CRE if not).
+ * Notes:
+ *      Rows without runs are skipped without a call.
+ *
+ ************************/
+void Rle2_map_runs(Rle2_T rle,
+                   void apply(int row, int start, int end, void *closure),
+                   void *closure)
+{
+        assert(rle != NULL && apply != NULL);
+        for (int row = 0; row <= rle->last_row; row++) {
+                long first;
+                long count = row_span(rle, row, &first);
+                for (long i = first; i < first + count; i++) {
+                        apply(row, rle->runs[i].start, rle->runs[i].end,
+                              closure);
+                }
+        }
+}
+
+/********** Rle2_count ********
+ *
+ * Use:
+ *      Counts the 1 bits of the bitmap.
+ * Parameters:
+ *      Rle2_T rle: The bitmap.
+ * Return:
+ *      The number of 1 bits.
+ * Expects:
+ *      rle is not NULL (throws a CRE if not).
+ * Notes:
+ *      Takes time in proportion to the number of runs.
+ *
+ ************************/
+long Rle2_count(Rle2_T rle)
+{
+        assert(rle != NULL);
+        long count = 0;
+        for (long i = 0; i < rle->nruns; i++) {
+                count += rle->runs[i].end - rle->runs[i].start;
+        }
+        return count;
+}
+
+/********** Rle2_and ********
+ *
+ * Use:
+ *      Computes the bitwise and of two bitmaps of the same size.
+ * Parameters:
+ *      Rle2_T a, Rle2_T b: The bitmaps.
+ * Return:
+ *      A new bitmap with the result.
+ * Expects:
+ *      a and b are not NULL and have the same dimensions (throws a CRE if
+ *      not).
+ * Notes:
+ *      Rle2_or, Rle2_xor and Rle2_minus (a and not b) follow the same
+ *      pattern. Each row is merged in one pass over both rows' runs.
+ *
+ ************************/
+Rle2_T Rle2_and(Rle2_T a, Rle2_T b)
+{
+        return combine(a, b, OP_AND);
+}
+
+Rle2_T Rle2_or(Rle2_T a, Rle2_T b)
+{
+        return combine(a, b, OP_OR);
+}
+
+Rle2_T Rle2_xor(Rle2_T a, Rle2_T b)
+{
+        return combine(a, b, OP_XOR);
+}
+
+Rle2_T Rle2_minus(Rle2_T a, Rle2_T b)
+{
+        return combine(a, b, OP_MINUS);
+}
+
+/********** Rle2_clear_border ********
+ *
+ * Use:
+ *      Removes every run that is connected to the edge of the bitmap, the
+ *      run-based form of unblacking black edges.
+ * Parameters:
+ *      Rle2_T rle: The bitmap.
+ * Return:
+ *      A new bitmap holding the runs that are not connected to the edge.
+ * Expects:
+ *      rle is not NULL (throws a CRE if not).
+ * Notes:
+ *      Runs in the first and last rows, and runs that touch the first or
+ *      last column, are on the edge. A run is connected to a run in the
+ *      row above or below when they share a column, which is the same
+ *      4-connectivity unblackedges uses for pixels. Each run is visited
+ *      once, and its neighbors are found by binary search, so the time
+ *      and memory depend on the runs, not the pixels.
+ *
+ ************************/
+Rle2_T Rle2_clear_border(Rle2_T rle)
+{
+        assert(rle != NULL);
+        Rle2_T result = Rle2_new(rle->width, rle->height);
+        if (rle->nruns == 0) {
+                return result;
+        }
+        char *marked = CALLOC(rle->nruns, 1);
+        Pending *stack = NULL;
+        long depth = 0;
+        long capacity = 0;
+        for (int row = 0; row <= rle->last_row; row++) {
+                long first;
+                long count = row_span(rle, row, &first);
+                for (long i = first; i < first + count; i++) {
+                        if (row == 0 || row == rle->height - 1 ||
+                            rle->runs[i].start == 0 ||
+                            rle->runs[i].end == rle->width) {
+                                push_run(i, row, marked, &stack, &depth,
+                                         &capacity);
+                        }
+                }
+        }
+        while (depth > 0) {
+                Pending pending = stack[--depth];
+                const Rle2_run *run = &rle->runs[pending.run];
+                if (pending.row > 0) {
+                        mark_overlaps(rle, pending.row - 1, run, marked,
+                                      &stack, &depth, &capacity);
+                }
+                if (pending.row < rle->height - 1) {
+                        mark_overlaps(rle, pending.row + 1, run, marked,
+                                      &stack, &depth, &capacity);
+                }
+        }
+        for (int row = 0; row <= rle->last_row; row++) {
+                long first;
+                long count = row_span(rle, row, &first);
+                for (long i = first; i < first + count; i++) {
+                        if (!marked[i]) {
+                                Rle2_append(result, row, rle->runs[i].start,
+                                            rle->runs[i].end);
+                        }
+                }
+        }
+        FREE(stack);
+        FREE(marked);
+        return result;
+}
+
+/********** row_span ********
+ *
+ * Use:
+ *      Finds the runs of one row.
+ * Parameters:
+ *      Rle2_T rle:  The bitmap.
+ *      int row:     The row.
+ *      long *first: Set to the index of the row's first run.
+ * Return:
+ *      The number of runs in the row.
+ * Expects:
+ *      row is in [0, height).
+ * Notes:
+ *      Rows after last_row have no runs.
+ *
+ ************************/
+static long row_span(Rle2_T rle, int row, long *first)
+{
+        if (row > rle->last_row) {
+                *first = rle->nruns;
+                return 0;
+        }
+        *first = rle->row_first[row];
+        long next = row < rle->last_row ? rle->row_first[row + 1]
+                                        : rle->nruns;
+        return next - *first;
+}
+
+/********** combine ********
+ *
+ * Use:
+ *      Does the work of the boolean operations.
+ * Parameters:
+ *      Rle2_T a, Rle2_T b: The bitmaps.
+ *      int table:          One of the OP_ truth tables.
+ * Return:
+ *      A new bitmap with the result.
+ * Expects:
+ *      a and b are not NULL and have the same dimensions (throws a CRE if
+ *      not).
+ * Notes:
+ *      Sweeps each row from boundary to boundary of the two rows' runs;
+ *      a row's sweep stops early once the runs left in one input cannot
+ *      make a 1 without the other.
+ *
+ ************************/
+static Rle2_T combine(Rle2_T a, Rle2_T b, int table)
+{
+        assert(a != NULL && b != NULL);
+        assert(a->width == b->width && a->height == b->height);
+        Rle2_T result = Rle2_new(a->width, a->height);
+        bool only_a = (table & 0x4) != 0;
+        bool only_b = (table & 0x2) != 0;
+        for (int row = 0; row < a->height; row++) {
+                long first_a, first_b;
+                long na = row_span(a, row, &first_a);
+                long nb = row_span(b, row, &first_b);
+                const Rle2_run *ra = &a->runs[first_a];
+                const Rle2_run *rb = &b->runs[first_b];
+                long i = 0;
+                long j = 0;
+                int col = 0;
+                while ((i < na && (j < nb || only_a)) ||
+                       (j < nb && only_b)) {
+                        bool in_a = i < na && ra[i].start <= col;
+                        bool in_b = j < nb && rb[j].start <= col;
+                        int next = a->width;
+                        if (i < na) {
+                                next = in_a ? ra[i].end : ra[i].start;
+                        }
+                        if (j < nb) {
+                                int edge = in_b ? rb[j].end : rb[j].start;
+                                next = edge < next ? edge : next;
+                        }
+                        if ((table >> (2 * in_a + in_b)) & 1) {
+                                Rle2_append(result, row, col, next);
+                        }
+                        col = next;
+                        if (i < na && ra[i].end <= col) {
+                                i++;
+                        }
+                        if (j < nb && rb[j].end <= col) {
+                                j++;
+                        }
+                }
+        }
+        return result;
+}
+
+/********** mark_overlaps ********
+ *
+ * Use:
+ *      Marks and pushes the unmarked runs of a row that share a column
+ *      with the given run.
+ * Parameters:
+ *      Rle2_T rle:           The bitmap.
+ *      int row:              The row to search.
+ *      const Rle2_run *run:  The run in the row above or below.
+ *      char *marked:         One flag per run of the bitmap.
+ *      Pending **stack:      The runs still to visit.
+ *      long *depth:          Number of runs on the stack.
+ *      long *capacity:       Number of runs the stack has room for.
+ * Return:
+ *      None.
+ * Expects:
+ *      None.
+ * Notes:
+ *      Binary searches for the first run that ends after run starts.
+ *
+ ************************/
+static void mark_overlaps(Rle2_T rle, int row, const Rle2_run *run,
+                          char *marked, Pending **stack, long *depth,
+                          long *capacity)
+{
+        long first;
+        long lo = 0;
+        long count = row_span(rle, row, &first);
+        long hi = count;
+        const Rle2_run *runs = &rle->runs[first];
+        while (lo < hi) {
+                long mid = lo + (hi - lo) / 2;
+                if (runs[mid].end <= run->start) {
+                        lo = mid + 1;
+                } else {
+                        hi = mid;
+                }
+        }
+        for (long i = lo; i < count && runs[i].start < run->end; i++) {
+                push_run(first + i, row, marked, stack, depth, capacity);
+        }
+}
+
+/********** push_run ********
+ *
+ * Use:
+ *      Marks a run and pushes it onto the stack, unless it is marked.
+ * Parameters:
+ *      long run:        Index of the run.
+ *      int row:         Its row.
+ *      char *marked:    One flag per run of the bitmap.
+ *      Pending **stack: The runs still to visit; grown as needed.
+ *      long *depth:     Number of runs on the stack.
+ *      long *capacity:  Number of runs the stack has room for.
+ * Return:
+ *      None.
+ * Expects:
+ *      None.
+ * Notes:
+ *      None.
+ *
+ ************************/
+static void push_run(long run, int row, char *marked, Pending **stack,
+                     long *depth, long *capacity)
+{
+        if (marked[run]) {
+                return;
+        }
+        marked[run] = 1;
+        if (*capacity == 0) {
+                *capacity = 64;
+                *stack = ALLOC(*capacity * (long)sizeof(Pending));
+        } else if (*depth == *capacity) {
+                *capacity *= 2;
+                RESIZE(*stack, *capacity * (long)sizeof(Pending));
+        }
+        (*stack)[*depth].run = run;
+        (*stack)[*depth].row = row;
+        (*depth)++;
+}
@@ -0,0 +1,62 @@
+/*
+ *     rle2.h
+ *     by nozden01 & bdioni01, 2/12/2024
+ *     iii
+ *
+ *     Struct and function declarations for run-length encoded 2D bitmaps.
+ *     Each row is stored as its runs of 1 bits, sorted and separated by at
+ *     least one 0 bit, so a mostly white page costs memory in proportion
+ *     to its runs rather than its pixels. The boolean operations and
+ *     Rle2_clear_border work on runs directly and take time in proportion
+ *     to the runs they read.
+ *
+ *     A bitmap is built by appending runs in row-major order, or converted
+ *     from a Bit2_T or from packed PBM rows; it is not changed after that.
+ */
+
+#ifndef RLE2_INCLUDED
+#define RLE2_INCLUDED
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <assert.h>
+#include "mem.h"
+#include "bit2.h"
+
+/* The 1 bits in columns [start, end) of one row. */
+typedef struct Rle2_run {
+        int start;
+        int end;
+} Rle2_run;
+
+typedef struct Rle2_T *Rle2_T;
+
+Rle2_T Rle2_new(int width, int height);
+void Rle2_free(Rle2_T *rle);
+int Rle2_width(Rle2_T rle);
+int Rle2_height(Rle2_T rle);
+long Rle2_nruns(Rle2_T rle);
+void Rle2_append(Rle2_T rle, int row, int start, int end);
+
+Rle2_T Rle2_from_bit2(Bit2_T bitmap);
+Rle2_T Rle2_from_packed(const unsigned char *data, int width, int height);
+Bit2_T Rle2_to_bit2(Rle2_T rle);
+
+int Rle2_get(Rle2_T rle, int col, int row);
+int Rle2_row(Rle2_T rle, int row, const Rle2_run **runs);
+void Rle2_map_runs(Rle2_T rle,
+                   void apply(int row, int start, int end, void *closure),
+                   void *closure);
+long Rle2_count(Rle2_T rle);
+
+Rle2_T Rle2_and(Rle2_T a, Rle2_T b);
+Rle2_T Rle2_or(Rle2_T a, Rle2_T b);
+Rle2_T Rle2_xor(Rle2_T a, Rle2_T b);
+Rle2_T Rle2_minus(Rle2_T a, Rle2_T b);
+
+Rle2_T Rle2_clear_border(Rle2_T rle);
+
+#endif
@@ -0,0 +1,507 @@
+/*
+ *     solver.c
+ *     by nozden01 & bdioni01, 2/12/2024
+ *     iii
+ *
+ *     Function implementations for the sudoku solving engine.
+ */
+
+#include <stdint.h>
+#include <string.h>
+#include "solver.h"
+
+#define MAX_N (SOLVER_MAX_BOX * SOLVER_MAX_BOX)
+#define MAX_CELLS (MAX_N * MAX_N)
+
+/* Nodes shallower than this always hand their extra branches to the pool;
+ * deeper nodes only split when some worker is asleep. */
+#define SPLIT_DEPTH 2
+
+/* One point in the search: the board and the digits used in every row,
+ * column and box. Bit d - 1 of a mask is set when digit d is used. */
+typedef struct State {
+        uint64_t rows[MAX_N];
+        uint64_t cols[MAX_N];
+        uint64_t boxes[MAX_N];
+        unsigned char cells[MAX_CELLS];
+        int depth;
+} State;
+
+/* Shared by every task of one search. */
+typedef struct Search {
+        int box;
+        int n;
+        uint64_t full;
+        long limit;
+        long count;
+        int stop;
+        unsigned char solution[MAX_CELLS];
+        Taskpool_T pool;
+} Search;
+
+typedef struct Job {
+        Search *search;
+        State state;
+} Job;
+
+static bool load_board(Search *search, State *state,
+                       int cell(int col, int row, void *closure),
+                       void *closure);
+static int board_cell(int col, int row, void *closure);
+static void search_tree(Search *search, State *state, int worker);
+static void run_job(Taskpool_T pool, int worker, void *arg);
+static void record_solution(Search *search, State *state);
+static void store_solution(Search *search, UArray2_T solution);
+
+/********** Solver_solve ********
+ *
+ * Use:
+ *      Solves the given board, counting solutions until the limit is reached.
+ *      With more than one thread, the search runs on a private work-stealing
+ *      pool that is created and torn down by this call.
+ * Parameters:
+ *      UArray2_T board:    Board of ints with side box * box, 0 for empty.
+ *      int box:            Side of one box (3 for a 9x9 board).
+ *      long limit:         Stop after this many solutions, or 0 to count
+ *                          them all.
+ *      int threads:        Number of threads, or 0 for every online CPU.
+ *      UArray2_T solution: If not NULL, receives the first solution found.
+ * Return:
+ *      The number of solutions found, never more than limit when limit > 0.
+ * Expects:
+ *      board is box * box on each side (throws a CRE if not).
+ *      1 < box <= SOLVER_MAX_BOX and threads >= 0 (throws a CRE if not).
+ *      solution, if given, has the same shape as board.
+ * Notes:
+ *      With several threads, which solution is "first" depends on timing.
+ *      Use Solver_unique when the answer must be deterministic.
+ *
+ ************************/
+long Solver_solve(UArray2_T board, int box, long limit, int threads,
+                  UArray2_T solution)
+{
+        assert(threads >= 0);
+        if (threads == 0) {
+                threads = Taskpool_online_cpus();
+        }
+        if (threads == 1) {
+                return Solver_solve_pool(board, box, limit, NULL, solution);
+        }
+
+        Taskpool_T pool = Taskpool_new(threads);
+        long count = Solver_solve_pool(board, box, limit, pool, solution);
+        Taskpool_free(&pool);
+        return count;
+}
+
+/********** Solver_unique ********
+ *
+ * Use:
+ *      Checks whether the given board has exactly one solution.
+ * Parameters:
+ *      UArray2_T board:    Board of ints with side box * box, 0 for empty.
+ *      int box:            Side of one box.
+ *      int threads:        Number of threads, or 0 for every online CPU.
+ *      UArray2_T solution: If not NULL, receives the solution when it is
+ *                          unique and is left untouched otherwise.
+ * Return:
+ *      0 if the board has no solution, 1 if it has exactly one, and 2 if it
+ *      has more than one.
+ * Expects:
+ *      The same as Solver_solve.
+ * Notes:
+ *      The search stops at the second solution, so the answer and the
+ *      solution it reports do not depend on the number of threads or on
+ *      scheduling.
+ *
+ ************************/
+int Solver_unique(UArray2_T board, int box, int threads, UArray2_T solution)
+{
+        UArray2_T scratch = NULL;
+        if (solution != NULL) {
+                scratch = UArray2_new(box * box, box * box, sizeof(int));
+        }
+        long count = Solver_solve(board, box, 2, threads, scratch);
+        if (count == 1 && solution != NULL) {
+                for (int row = 0; row < box * box; row++) {
+                        for (int col = 0; col < box * box; col++) {
+                                *(int *)UArray2_at(solution, col, row) =
+                                        *(int *)UArray2_at(scratch, col, row);
+                        }
+                }
+        }
+        if (scratch != NULL) {
+                UArray2_free(&scratch);
+        }
+        return (int)count;
+}
+
+/********** Solver_solve_pool ********
+ *
+ * Use:
+ *      Solves the given board on an existing pool, so that callers which
+ *      solve many boards can keep their workers warm.
+ * Parameters:
+ *      UArray2_T board:    Board of ints with side box * box, 0 for empty.
+ *      int box:            Side of one box.
+ *      long limit:         Stop after this many solutions, or 0 for all.
+ *      Taskpool_T pool:    Pool to run on, or NULL to search on the calling
+ *                          thread.
+ *      UArray2_T solution: If not NULL, receives the first solution found.
+ * Return:
+ *      The number of solutions found, never more than limit when limit > 0.
+ * Expects:
+ *      The same as Solver_solve.
+ *      That no other search is using the pool at the same time.
+ * Notes:
+ *      Boards whose givens already clash have no solutions.
+ *
+ ************************/
+long Solver_solve_pool(UArray2_T board, int box, long limit, Taskpool_T pool,
+                       UArray2_T solution)
+{
+        assert(board != NULL);
+        assert(UArray2_width(board) == box * box &&
+               UArray2_height(board) == box * box);
+        return Solver_solve_cells(box, board_cell, board, limit, pool,
+                                  solution);
+}
+
+/********** Solver_solve_cells ********
+ *
+ * Use:
+ *      Solves a board whose cells are read through a function rather than
+ *      from a UArray2, so that boards stored in other forms (such as packed
+ *      corpus records) can be solved without first being copied out.
+ * Parameters:
+ *      int box:            Side of one box.
+ *      int cell(int col, int row, void *closure):
+ *                          Returns the value of a cell, 0 for empty.
+ *      void *closure:      The closure argument passed to cell.
+ *      long limit:         Stop after this many solutions, or 0 for all.
+ *      Taskpool_T pool:    Pool to run on, or NULL to search on the calling
+ *                          thread.
+ *      UArray2_T solution: If not NULL, receives the first solution found.
+ * Return:
+ *      The number of solutions found, never more than limit when limit > 0.
+ * Expects:
+ *      1 < box <= SOLVER_MAX_BOX and limit >= 0 (throws a CRE if not).
+ *      That no other search is using the pool at the same time.
+ * Notes:
+ *      Each cell is read exactly once. Boards with values outside
+ *      [0, box * box] or with clashing givens have no solutions.
+ *
+ ************************/
+long Solver_solve_cells(int box,
+                        int cell(int col, int row, void *closure),
+                        void *closure,
+                        long limit,
+                        Taskpool_T pool,
+                        UArray2_T solution)
+{
+        assert(cell != NULL);
+        assert(box > 1 && box <= SOLVER_MAX_BOX);
+        assert(limit >= 0);
+
+        Search *search;
+        NEW(search);
+        search->box = box;
+        search->n = box * box;
+        search->full = ((uint64_t)1 << search->n) - 1;
+        search->limit = limit;
+        search->count = 0;
+        search->stop = 0;
+        search->pool = pool;
+
+        Job *root;
+        NEW(root);
+        root->search = search;
+        if (!load_board(search, &root->state, cell, closure)) {
+                FREE(root);
+                FREE(search);
+                return 0;
+        }
+
+        if (pool == NULL) {
+                search_tree(search, &root->state, 0);
+                FREE(root);
+        } else {
+                Taskpool_submit(pool, run_job, root);
+                Taskpool_wait(pool);
+        }
+
+        long count = search->count;
+        if (limit > 0 && count > limit) {
+                count = limit;
+        }
+        if (count > 0 && solution != NULL) {
+                store_solution(search, solution);
+        }
+        FREE(search);
+        return count;
+}
+
+/********** load_board ********
+ *
+ * Use:
+ *      Copies the givens of a board into a search state and builds the
+ *      row, column and box masks.
+ * Parameters:
+ *      Search *search:  The search the state belongs to.
+ *      State *state:    The state being filled in.
+ *      int cell(...):   Returns the value of a cell.
+ *      void *closure:   The closure argument passed to cell.
+ * Return:
+ *      False if a value is out of range or two givens clash, true otherwise.
+ * Expects:
+ *      None.
+ * Notes:
+ *      None.
+ *
+ ************************/
+static bool load_board(Search *search, State *state,
+                       int cell(int col, int row, void *closure),
+                       void *closure)
+{
+        int n = search->n;
+        int box = search->box;
+
+        memset(state, 0, sizeof(*state));
+        for (int row = 0; row < n; row++) {
+                for (int col = 0; col < n; col++) {
+                        int digit = cell(col, row, closure);
+                        if (digit < 0 || digit > n) {
+                                return false;
+                        }
+                        if (digit == 0) {
+                                continue;
+                        }
+                        uint64_t bit = (uint64_t)1 << (digit - 1);
+                        int b = (row / box) * box + col / box;
+                        if ((state->rows[row] | state->cols[col] |
+                             state->boxes[b]) & bit) {
+                                return false;
+                        }
+                        state->rows[row] |= bit;
+                        state->cols[col] |= bit;
+                        state->boxes[b] |= bit;
+                        state->cells[row * n + col] = (unsigned char)digit;
+                }
+        }
+        return true;
+}
+
+/********** board_cell ********
+ *
+ * Use:
+ *      Cell function for boards held in a UArray2 of ints.
+ * Parameters:
+ *      int col:       Column of the cell.
+ *      int row:       Row of the cell.
+ *      void *closure: The UArray2_T board.
+ * Return:
+ *      The value of the cell.
+ * Expects:
+ *      None.
+ * Notes:
+ *      None.
+ *
+ ************************/
+static int board_cell(int col, int row, void *closure)
+{
+        return *(int *)UArray2_at(closure, col, row);
+}
+
+/********** search_tree ********
+ *
+ * Use:
+ *      Depth-first search below the given state. Picks the empty cell with
+ *      the fewest candidates and tries each candidate in ascending order.
+ *      When running on a pool, the branches after the first are handed to
+ *      the pool as new jobs if the node is shallow or a worker is idle.
+ * Parameters:
+ *      Search *search: The search being run.
+ *      State *state:   The current state; restored before returning.
+ *      int worker:     Index of the worker running this search.
+ * Return:
+ *      None.
+ * Expects:
+ *      None.
+ * Notes:
+ *      Polls the shared stop flag once per node.
+ *
+ ************************/
+static void search_tree(Search *search, State *state, int worker)
+{
+        if (__atomic_load_n(&search->stop, __ATOMIC_RELAXED)) {
+                return;
+        }
+
+        int n = search->n;
+        int box = search->box;
+        int best = -1;
+        int best_count = n + 1;
+        uint64_t best_cand = 0;
+        for (int i = 0; i < n * n; i++) {
+                if (state->cells[i] != 0) {
+                        continue;
+                }
+                int row = i / n;
+                int col = i % n;
+                int b = (row / box) * box + col / box;
+                uint64_t cand = search->full & ~(state->rows[row] |
+                                                 state->cols[col] |
+                                                 state->boxes[b]);
+                int count = __builtin_popcountll(cand);
+                if (count < best_count) {
+                        best = i;
+                        best_count = count;
+                        best_cand = cand;
+                        if (count <= 1) {
+                                break;
+                        }
+                }
+        }
+
+        if (best < 0) {
+                record_solution(search, state);
+                return;
+        }
+        if (best_count == 0) {
+                return;
+        }
+
+        int row = best / n;
+        int col = best % n;
+        int b = (row / box) * box + col / box;
+
+        /* Hand every branch but the lowest digit to the pool, newest first,
+         * so that this worker keeps the leftmost subtree. */
+        if (search->pool != NULL && best_count > 1 &&
+            (state->depth < SPLIT_DEPTH || Taskpool_idle(search->pool) > 0)) {
+                uint64_t first = best_cand & -best_cand;
+                uint64_t rest = best_cand & ~first;
+                while (rest != 0) {
+                        int high = 63 - __builtin_clzll(rest);
+                        uint64_t bit = (uint64_t)1 << high;
+                        rest &= ~bit;
+
+                        Job *job;
+                        NEW(job);
+                        job->search = search;
+                        job->state = *state;
+                        job->state.rows[row] |= bit;
+                        job->state.cols[col] |= bit;
+                        job->state.boxes[b] |= bit;
+                        job->state.cells[best] = (unsigned char)(high + 1);
+                        job->state.depth++;
+                        Taskpool_spawn(search->pool, worker, run_job, job);
+                }
+                best_cand = first;
+        }
+
+        while (best_cand != 0) {
+                int digit = __builtin_ctzll(best_cand);
+                uint64_t bit = (uint64_t)1 << digit;
+                best_cand &= best_cand - 1;
+
+                state->rows[row] |= bit;
+                state->cols[col] |= bit;
+                state->boxes[b] |= bit;
+                state->cells[best] = (unsigned char)(digit + 1);
+                state->depth++;
+
+                search_tree(search, state, worker);
+
+                state->depth--;
+                state->cells[best] = 0;
+                state->rows[row] &= ~bit;
+                state->cols[col] &= ~bit;
+                state->boxes[b] &= ~bit;
+
+                if (__atomic_load_n(&search->stop, __ATOMIC_RELAXED)) {
+                        return;
+                }
+        }
+}
+
+/********** run_job ********
+ *
+ * Use:
+ *      Taskpool task that searches below one split-off state.
+ * Parameters:
+ *      Taskpool_T pool: The pool running the job (not used).
+ *      int worker:      Index of the worker running the job.
+ *      void *arg:       The Job; freed by this function.
+ * Return:
+ *      None.
+ * Expects:
+ *      None.
+ * Notes:
+ *      None.
+ *
+ ************************/
+static void run_job(Taskpool_T pool, int worker, void *arg)
+{
+        (void) pool;
+        Job *job = arg;
+        search_tree(job->search, &job->state, worker);
+        FREE(job);
+}
+
+/********** record_solution ********
+ *
+ * Use:
+ *      Counts a solution, keeps it if it is the first one, and stops the
+ *      search once the limit has been reached.
+ * Parameters:
+ *      Search *search: The search that found the solution.
+ *      State *state:   The solved state.
+ * Return:
+ *      None.
+ * Expects:
+ *      None.
+ * Notes:
+ *      Exactly one thread sees a count of 1, so only that thread writes the
+ *      stored solution. Taskpool_wait orders that write before the caller
+ *      reads it.
+ *
+ ************************/
+static void record_solution(Search *search, State *state)
+{
+        long count = __atomic_add_fetch(&search->count, 1, __ATOMIC_SEQ_CST);
+        if (count == 1) {
+                memcpy(search->solution, state->cells,
+                       (size_t)(search->n * search->n));
+        }
+        if (search->limit > 0 && count >= search->limit) {
+                __atomic_store_n(&search->stop, 1, __ATOMIC_RELAXED);
+        }
+}
+
+/********** store_solution ********
+ *
+ * Use:
+ *      Copies the stored solution into the client's board.
+ * Parameters:
+ *      Search *search:     The finished search.
+ *      UArray2_T solution: Board receiving the solution.
+ * Return:
+ *      None.
+ * Expects:
+ *      solution is n by n (throws a CRE if not).
+ * Notes:
+ *      None.
+ *
+ ************************/
+static void store_solution(Search *search, UArray2_T solution)
+{
+        int n = search->n;
+        assert(UArray2_width(solution) == n && UArray2_height(solution) == n);
+        for (int row = 0; row < n; row++) {
+                for (int col = 0; col < n; col++) {
+                        *(int *)UArray2_at(solution, col, row) =
+                                search->solution[row * n + col];
+                }
+        }
+}
@@ -0,0 +1,37 @@
+/*
+ *     solver.h
+ *     by nozden01 & bdioni01, 2/12/2024
+ *     iii
+ *
+ *     Function declarations for the sudoku solving engine. Boards are square
+ *     UArray2s of ints with side box * box, where 0 marks an empty cell and
+ *     1 through box * box are digits. The search is a bitmask backtracking
+ *     search that splits its tree at branch points onto a work-stealing
+ *     Taskpool when more than one thread is requested.
+ */
+
+#ifndef SOLVER_INCLUDED
+#define SOLVER_INCLUDED
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <assert.h>
+#include "uarray2.h"
+#include "taskpool.h"
+
+#define SOLVER_MAX_BOX 6
+
+long Solver_solve(UArray2_T board, int box, long limit, int threads,
+                  UArray2_T solution);
+int Solver_unique(UArray2_T board, int box, int threads, UArray2_T solution);
+long Solver_solve_pool(UArray2_T board, int box, long limit, Taskpool_T pool,
+                       UArray2_T solution);
+long Solver_solve_cells(int box,
+                        int cell(int col, int row, void *closure),
+                        void *closure,
+                        long limit,
+                        Taskpool_T pool,
+                        UArray2_T solution);
+
+#endif
@@ -0,0 +1,1428 @@
+/*
+ *     sparse2.c
+ *     by nozden01 & bdioni01, 2/12/2024
+ *     iii
+ *
+ *     Function implementations for compressed 2D bitmaps.
+ */
+
+#include "sparse2.h"
+
+/* Tiles are TILE_SIDE pixels square. Within its tile, pixel (col, row) is
+ * at position (row % TILE_SIDE) * TILE_SIDE + col % TILE_SIDE, so a tile's
+ * positions fit in 16 bits and each tile row is four bitset words. */
+#define TILE_SHIFT 8
+#define TILE_SIDE (1 << TILE_SHIFT)
+#define TILE_BITS (TILE_SIDE * TILE_SIDE)
+#define BITSET_WORDS (TILE_BITS / 64)
+
+/* An array of more than ARRAY_MAX positions is larger than a bitset. A
+ * bitset that drops to ARRAY_MAX / 2 bits becomes an array again; the gap
+ * keeps a tile near the limit from converting on every put. */
+#define ARRAY_MAX 4096
+
+/* A tile has at most RUNS_MAX runs, every other bit. */
+#define RUNS_MAX (TILE_BITS / 2)
+
+/* Truth tables of the boolean operations: bit 2 * a + b is the result for
+ * input bits a and b. */
+#define OP_AND 0x8
+#define OP_OR  0xE
+#define OP_XOR 0x6
+
+/* How a tile is stored; ARRAY < BITSET < RUNS orders the pairs of forms
+ * combine_tiles handles. */
+enum { EMPTY, FULL, ARRAY, BITSET, RUNS };
+
+/* The 1 bits at positions [start, last] of a tile. */
+typedef struct Run {
+        uint16_t start;
+        uint16_t last;
+} Run;
+
+/* One tile. count is the number of positions of an array, of which there
+ * is room for 1 << shift, or the number of runs; card is the number of 1
+ * bits in any form. */
+typedef struct Tile {
+        void *data;
+        uint32_t card;
+        uint16_t count;
+        uint8_t kind;
+        uint8_t shift;
+} Tile;
+
+struct Sparse2_T {
+        int width;
+        int height;
+        int across;
+        int down;
+        Tile *tiles;
+};
+
+/* A tile's stored form as read by the conversions and operations; full
+ * tiles are read as their runs, which they do not store. */
+typedef struct Contents {
+        int kind;
+        const void *data;
+        int count;
+} Contents;
+
+/* Room for the operations' intermediate tiles, allocated once per
+ * operation: each input as runs, and the result in any form. */
+typedef struct Scratch {
+        Run a[ARRAY_MAX];
+        Run b[ARRAY_MAX];
+        union {
+                Run runs[RUNS_MAX];
+                uint16_t array[2 * ARRAY_MAX];
+                uint64_t words[BITSET_WORDS];
+        } out;
+} Scratch;
+
+static long tile_area(Sparse2_T bitmap, long index);
+static int full_runs(Sparse2_T bitmap, long index, Run *runs);
+static Contents contents(Sparse2_T bitmap, long index, Run *scratch);
+static int tile_get(const Tile *tile, unsigned pos);
+static int lower_array(const uint16_t *array, int count, unsigned pos);
+static int lower_run(const Run *runs, int count, unsigned pos);
+static void replace(Tile *tile, int kind, void *data, int count, int shift);
+static void install(Tile *tile, Contents from, long area);
+static long count_card(Contents from);
+static long count_runs(Contents from);
+static uint16_t *make_array(Contents from, long card, int *shift);
+static uint64_t *make_bitset(Contents from);
+static Run *make_runs(Contents from, long nruns);
+static int runs_of_array(const uint16_t *array, int count, Run *runs);
+static void range_op(uint64_t *words, unsigned start, unsigned last,
+                     int table);
+static Sparse2_T combine(Sparse2_T a, Sparse2_T b, int table);
+static Contents combine_tiles(Contents a, Contents b, int table,
+                              Scratch *scratch);
+static int append_run(Run *runs, int count, unsigned start, unsigned last);
+static uint64_t word_at(const uint64_t *words, long words_per_row, long bit);
+static void put_range(Bit2_T bitmap, int row, int col, int last);
+
+/************** Sparse2_new ************
+ *
+ * Use:
+ *      Creates an all-zero compressed bitmap.
+ * Parameters:
+ *      int col: The width of the bitmap.
+ *      int row: The height of the bitmap.
+ * Return:
+ *      The new bitmap, whose tiles are all empty.
+ * Expects:
+ *      col >= 0 and row >= 0 (throws a CRE if not).
+ * Notes:
+ *      Allocates one 16-byte tile per 256 x 256 pixels. The client
+ *      releases the bitmap with Sparse2_free.
+ *
+ ************************/
+Sparse2_T Sparse2_new(int col, int row)
+{
+        assert(col >= 0 && row >= 0);
+        Sparse2_T bitmap;
+        NEW(bitmap);
+        bitmap->width = col;
+        bitmap->height = row;
+        bitmap->across = (int)(((long)col + TILE_SIDE - 1) >> TILE_SHIFT);
+        bitmap->down = (int)(((long)row + TILE_SIDE - 1) >> TILE_SHIFT);
+        bitmap->tiles = NULL;
+        long ntiles = (long)bitmap->across * bitmap->down;
+        if (ntiles > 0) {
+                bitmap->tiles = CALLOC(ntiles, sizeof(Tile));
+        }
+        return bitmap;
+}
+
+/************** Sparse2_free ************
+ *
+ * Use:
+ *      Frees a compressed bitmap and all of its tiles.
+ * Parameters:
+ *      Sparse2_T *bitmap: Pointer to the bitmap; set to NULL.
+ * Return:
+ *      None.
+ * Expects:
+ *      bitmap and *bitmap are not NULL (throws a CRE if not).
+ * Notes:
+ *      None.
+ *
+ ************************/
+void Sparse2_free(Sparse2_T *bitmap)
+{
+        assert(bitmap != NULL && *bitmap != NULL);
+        long ntiles = (long)(*bitmap)->across * (*bitmap)->down;
+        for (long i = 0; i < ntiles; i++) {
+                FREE((*bitmap)->tiles[i].data);
+        }
+        FREE((*bitmap)->tiles);
+        FREE(*bitmap);
+}
+
+/************** Sparse2_width ************
+ *
+ * Use:
+ *      Returns the width of the bitmap.
+ * Parameters:
+ *      Sparse2_T bitmap: The bitmap.
+ * Return:
+ *      The width.
+ * Expects:
+ *      bitmap is not NULL (throws a CRE if not).
+ * Notes:
+ *      Sparse2_height follows the same pattern.
+ *
+ ************************/
+int Sparse2_width(Sparse2_T bitmap)
+{
+        assert(bitmap != NULL);
+        return bitmap->width;
+}
+
+int Sparse2_height(Sparse2_T bitmap)
+{
+        assert(bitmap != NULL);
+        return bitmap->height;
+}
+
+/************** Sparse2_put ************
+ *
+ * Use:
+ *      Sets one bit of the bitmap.
+ * Parameters:
+ *      Sparse2_T bitmap: The bitmap.
+ *      int col, int row: Position of the bit.
+ *      int bit:          The new value, 0 or 1.
+ * Return:
+ *      The previous value of the bit.
+ * Expects:
+ *      bitmap is not NULL, (col, row) is in the bitmap and bit is 0 or 1
+ *      (throws a CRE if not).
+ * Notes:
+ *      A full or runs tile that changes is rewritten as an array or
+ *      bitset, which take single bits cheaply; Sparse2_optimize turns it
+ *      back into runs if that is smaller. A tile whose bits become all 0
+ *      or all 1 frees its storage.
+ *
+ ************************/
+int Sparse2_put(Sparse2_T bitmap, int col, int row, int bit)
+{
+        assert(bitmap != NULL);
+        assert(col >= 0 && col < bitmap->width);
+        assert(row >= 0 && row < bitmap->height);
+        assert(bit == 0 || bit == 1);
+        long index = (long)(row >> TILE_SHIFT) * bitmap->across +
+                     (col >> TILE_SHIFT);
+        Tile *tile = &bitmap->tiles[index];
+        unsigned pos = (unsigned)(row & (TILE_SIDE - 1)) << TILE_SHIFT |
+                       (unsigned)(col & (TILE_SIDE - 1));
+        int old = tile_get(tile, pos);
+        if (old == bit) {
+                return old;
+        }
+        long area = tile_area(bitmap, index);
+
+        if (tile->kind == FULL || tile->kind == RUNS) {
+                Run scratch[TILE_SIDE];
+                Contents from = contents(bitmap, index, scratch);
+                int shift = 0;
+                if (tile->card <= ARRAY_MAX) {
+                        uint16_t *array = make_array(from, tile->card,
+                                                     &shift);
+                        replace(tile, ARRAY, array, tile->card, shift);
+                } else {
+                        replace(tile, BITSET, make_bitset(from), 0, 0);
+                }
+        }
+        if (tile->kind == EMPTY) {
+                replace(tile, ARRAY, ALLOC(4 * sizeof(uint16_t)), 0, 2);
+        }
+        if (bit == 1 && tile->kind == ARRAY && tile->count == ARRAY_MAX) {
+                Contents from = { ARRAY, tile->data, tile->count };
+                replace(tile, BITSET, make_bitset(from), 0, 0);
+        }
+
+        if (tile->kind == ARRAY) {
+                uint16_t *array = tile->data;
+                int i = lower_array(array, tile->count, pos);
+                if (bit == 1) {
+                        if (tile->count == 1 << tile->shift) {
+                                tile->shift++;
+                                RESIZE(array, (1L << tile->shift) *
+                                              (long)sizeof(uint16_t));
+                                tile->data = array;
+                        }
+                        memmove(&array[i + 1], &array[i],
+                                (tile->count - i) * sizeof(uint16_t));
+                        array[i] = (uint16_t)pos;
+                        tile->count++;
+                } else {
+                        memmove(&array[i], &array[i + 1],
+                                (tile->count - i - 1) * sizeof(uint16_t));
+                        tile->count--;
+                }
+        } else {
+                uint64_t *words = tile->data;
+                words[pos / 64] ^= (uint64_t)1 << (pos % 64);
+        }
+        tile->card += bit == 1 ? 1 : -1;
+
+        if (tile->card == 0) {
+                replace(tile, EMPTY, NULL, 0, 0);
+        } else if (tile->card == area) {
+                replace(tile, FULL, NULL, 0, 0);
+        } else if (tile->kind == BITSET && tile->card <= ARRAY_MAX / 2) {
+                Contents from = { BITSET, tile->data, 0 };
+                int shift = 0;
+                uint16_t *array = make_array(from, tile->card, &shift);
+                replace(tile, ARRAY, array, tile->card, shift);
+        }
+        return old;
+}
+
+/************** Sparse2_get ************
+ *
+ * Use:
+ *      Returns one bit of the bitmap.
+ * Parameters:
+ *      Sparse2_T bitmap: The bitmap.
+ *      int col, int row: Position of the bit.
+ * Return:
+ *      The bit, 0 or 1.
+ * Expects:
+ *      bitmap is not NULL and (col, row) is in the bitmap (throws a CRE if
+ *      not).
+ * Notes:
+ *      Constant time for empty, full and bitset tiles; a binary search
+ *      for arrays and runs.
+ *
+ ************************/
+int Sparse2_get(Sparse2_T bitmap, int col, int row)
+{
+        assert(bitmap != NULL);
+        assert(col >= 0 && col < bitmap->width);
+        assert(row >= 0 && row < bitmap->height);
+        const Tile *tile = &bitmap->tiles[(long)(row >> TILE_SHIFT) *
+                                          bitmap->across +
+                                          (col >> TILE_SHIFT)];
+        unsigned pos = (unsigned)(row & (TILE_SIDE - 1)) << TILE_SHIFT |
+                       (unsigned)(col & (TILE_SIDE - 1));
+        return tile_get(tile, pos);
+}
+
+/************** Sparse2_map_col_major ************
+ *
+ * Use:
+ *      Calls apply on every bit of the bitmap, column by column.
+ * Parameters:
+ *      Sparse2_T bitmap: The bitmap.
+ *      void apply(int col, int row, Sparse2_T bitmap, int bit,
+ *                 void *closure):
+ *                        Called with each bit and its position.
+ *      void *closure:    Passed to apply.
+ * Return:
+ *      None.
+ * Expects:
+ *      bitmap and apply are not NULL (throws a CRE if not).
+ * Notes:
+ *      Visits every pixel, as Bit2_map_col_major does; Sparse2_map_set
+ *      visits only the 1 bits. Sparse2_map_row_major follows the same
+ *      pattern row by row.
+ *
+ ************************/
+void Sparse2_map_col_major(Sparse2_T bitmap,
+                           void apply(int col, int row, Sparse2_T bitmap,
+                                      int bit, void *closure),
+                           void *closure)
+{
+        assert(bitmap != NULL && apply != NULL);
+        for (int col = 0; col < bitmap->width; col++) {
+                for (int row = 0; row < bitmap->height; row++) {
+                        apply(col, row, bitmap,
+                              Sparse2_get(bitmap, col, row), closure);
+                }
+        }
+}
+
+void Sparse2_map_row_major(Sparse2_T bitmap,
+                           void apply(int col, int row, Sparse2_T bitmap,
+                                      int bit, void *closure),
+                           void *closure)
+{
+        assert(bitmap != NULL && apply != NULL);
+        for (int row = 0; row < bitmap->height; row++) {
+                for (int col = 0; col < bitmap->width; col++) {
+                        apply(col, row, bitmap,
+                              Sparse2_get(bitmap, col, row), closure);
+                }
+        }
+}
+
+/************** Sparse2_map_set ************
+ *
+ * Use:
+ *      Calls apply on the position of every 1 bit of the bitmap.
+ * Parameters:
+ *      Sparse2_T bitmap: The bitmap.
+ *      void apply(int col, int row, void *closure):
+ *                        Called with each 1 bit's position.
+ *      void *closure:    Passed to apply.
+ * Return:
+ *      None.
+ * Expects:
+ *      bitmap and apply are not NULL (throws a CRE if not).
+ * Notes:
+ *      Tiles are visited in row-major order and the bits within a tile in
+ *      row-major order, so the whole visit is not row-major. Empty tiles
+ *      cost one test each.
+ *
+ ************************/
+void Sparse2_map_set(Sparse2_T bitmap,
+                     void apply(int col, int row, void *closure),
+                     void *closure)
+{
+        assert(bitmap != NULL && apply != NULL);
+        long ntiles = (long)bitmap->across * bitmap->down;
+        for (long index = 0; index < ntiles; index++) {
+                if (bitmap->tiles[index].kind == EMPTY) {
+                        continue;
+                }
+                int left = (int)(index % bitmap->across) << TILE_SHIFT;
+                int top = (int)(index / bitmap->across) << TILE_SHIFT;
+                Run scratch[TILE_SIDE];
+                Contents from = contents(bitmap, index, scratch);
+                if (from.kind == ARRAY) {
+                        const uint16_t *array = from.data;
+                        for (int i = 0; i < from.count; i++) {
+                                apply(left + (array[i] & (TILE_SIDE - 1)),
+                                      top + (array[i] >> TILE_SHIFT),
+                                      closure);
+                        }
+                } else if (from.kind == BITSET) {
+                        const uint64_t *words = from.data;
+                        for (int w = 0; w < BITSET_WORDS; w++) {
+                                uint64_t word = words[w];
+                                while (word != 0) {
+                                        unsigned pos = w * 64 +
+                                                __builtin_ctzll(word);
+                                        apply(left + (pos & (TILE_SIDE - 1)),
+                                              top + (pos >> TILE_SHIFT),
+                                              closure);
+                                        word &= word - 1;
+                                }
+                        }
+                } else {
+                        const Run *runs = from.data;
+                        for (int i = 0; i < from.count; i++) {
+                                for (unsigned pos = runs[i].start;
+                                     pos <= runs[i].last; pos++) {
+                                        apply(left + (pos & (TILE_SIDE - 1)),
+                                              top + (pos >> TILE_SHIFT),
+                                              closure);
+                                }
+                        }
+                }
+        }
+}
+
+/************** Sparse2_count ************
+ *
+ * Use:
+ *      Counts the 1 bits of the bitmap.
+ * Parameters:
+ *      Sparse2_T bitmap: The bitmap.
+ * Return:
+ *      The number of 1 bits.
+ * Expects:
+ *      bitmap is not NULL (throws a CRE if not).
+ * Notes:
+ *      Every tile keeps its count, so this reads one number per tile.
+ *
+ ************************/
+long Sparse2_count(Sparse2_T bitmap)
+{
+        assert(bitmap != NULL);
+        long ntiles = (long)bitmap->across * bitmap->down;
+        long count = 0;
+        for (long i = 0; i < ntiles; i++) {
+                count += bitmap->tiles[i].card;
+        }
+        return count;
+}
+
+/************** Sparse2_bytes ************
+ *
+ * Use:
+ *      Measures the memory the bitmap uses.
+ * Parameters:
+ *      Sparse2_T bitmap: The bitmap.
+ * Return:
+ *      The bytes allocated for the bitmap, its tiles and their contents.
+ * Expects:
+ *      bitmap is not NULL (throws a CRE if not).
+ * Notes:
+ *      Does not count the allocator's own overhead.
+ *
+ ************************/
+long Sparse2_bytes(Sparse2_T bitmap)
+{
+        assert(bitmap != NULL);
+        long ntiles = (long)bitmap->across * bitmap->down;
+        long bytes = sizeof(*bitmap) + ntiles * (long)sizeof(Tile);
+        for (long i = 0; i < ntiles; i++) {
+                const Tile *tile = &bitmap->tiles[i];
+                if (tile->kind == ARRAY) {
+                        bytes += (1L << tile->shift) * sizeof(uint16_t);
+                } else if (tile->kind == BITSET) {
+                        bytes += BITSET_WORDS * sizeof(uint64_t);
+                } else if (tile->kind == RUNS) {
+                        bytes += tile->count * (long)sizeof(Run);
+                }
+        }
+        return bytes;
+}
+
+/************** Sparse2_optimize ************
+ *
+ * Use:
+ *      Stores every tile in its smallest form.
+ * Parameters:
+ *      Sparse2_T bitmap: The bitmap.
+ * Return:
+ *      None.
+ * Expects:
+ *      bitmap is not NULL (throws a CRE if not).
+ * Notes:
+ *      Only Sparse2_put leaves tiles in a larger form than they need, so
+ *      this is worth calling after a batch of puts.
+ *
+ ************************/
+void Sparse2_optimize(Sparse2_T bitmap)
+{
+        assert(bitmap != NULL);
+        long ntiles = (long)bitmap->across * bitmap->down;
+        for (long i = 0; i < ntiles; i++) {
+                Tile *tile = &bitmap->tiles[i];
+                if (tile->kind != EMPTY && tile->kind != FULL) {
+                        Contents from = { tile->kind, tile->data,
+                                          tile->count };
+                        install(tile, from, tile_area(bitmap, i));
+                }
+        }
+}
+
+/************** Sparse2_and ************
+ *
+ * Use:
+ *      Computes the bitwise and of two bitmaps of the same size.
+ * Parameters:
+ *      Sparse2_T a, Sparse2_T b: The bitmaps.
+ * Return:
+ *      A new bitmap with the result, every tile in its smallest form.
+ * Expects:
+ *      a and b are not NULL and have the same dimensions (throws a CRE if
+ *      not).
+ * Notes:
+ *      Sparse2_or and Sparse2_xor follow the same pattern. Tiles are
+ *      combined in their stored forms: arrays by merging, bitsets a word
+ *      at a time, runs by their boundaries.
+ *
+ ************************/
+Sparse2_T Sparse2_and(Sparse2_T a, Sparse2_T b)
+{
+        return combine(a, b, OP_AND);
+}
+
+Sparse2_T Sparse2_or(Sparse2_T a, Sparse2_T b)
+{
+        return combine(a, b, OP_OR);
+}
+
+Sparse2_T Sparse2_xor(Sparse2_T a, Sparse2_T b)
+{
+        return combine(a, b, OP_XOR);
+}
+
+/************** Sparse2_from_bit2 ************
+ *
+ * Use:
+ *      Compresses a dense bitmap.
+ * Parameters:
+ *      Bit2_T bitmap: The bitmap, which may be a view.
+ * Return:
+ *      A new compressed bitmap with the same bits, every tile in its
+ *      smallest form.
+ * Expects:
+ *      bitmap is not NULL (throws a CRE if not).
+ * Notes:
+ *      Copies each tile into a bitset a word at a time and then compresses
+ *      it.
+ *
+ ************************/
+Sparse2_T Sparse2_from_bit2(Bit2_T bitmap)
+{
+        assert(bitmap != NULL);
+        int width = Bit2_width(bitmap);
+        int height = Bit2_height(bitmap);
+        Sparse2_T sparse = Sparse2_new(width, height);
+        uint64_t *words = ALLOC(BITSET_WORDS * sizeof(uint64_t));
+        long ntiles = (long)sparse->across * sparse->down;
+        for (long index = 0; index < ntiles; index++) {
+                int left = (int)(index % sparse->across) << TILE_SHIFT;
+                int top = (int)(index / sparse->across) << TILE_SHIFT;
+                memset(words, 0, BITSET_WORDS * sizeof(uint64_t));
+                for (int r = 0; r < TILE_SIDE && top + r < height; r++) {
+                        const uint64_t *row = &bitmap->words[(top + r) *
+                                                bitmap->words_per_row];
+                        for (int k = 0; k < TILE_SIDE / 64; k++) {
+                                long col = left + 64L * k;
+                                if (col >= width) {
+                                        break;
+                                }
+                                uint64_t word = word_at(row,
+                                        bitmap->words_per_row,
+                                        col + bitmap->offset);
+                                if (width - col < 64) {
+                                        word &= ~(uint64_t)0 >>
+                                                (64 - (width - col));
+                                }
+                                words[r * (TILE_SIDE / 64) + k] = word;
+                        }
+                }
+                Contents from = { BITSET, words, 0 };
+                install(&sparse->tiles[index], from,
+                        tile_area(sparse, index));
+        }
+        FREE(words);
+        return sparse;
+}
+
+/************** Sparse2_to_bit2 ************
+ *
+ * Use:
+ *      Expands a compressed bitmap into a dense one.
+ * Parameters:
+ *      Sparse2_T bitmap: The bitmap.
+ * Return:
+ *      A new Bit2_T with the same bits.
+ * Expects:
+ *      bitmap is not NULL (throws a CRE if not).
+ * Notes:
+ *      The client releases the result with Bit2_free.
+ *
+ ************************/
+Bit2_T Sparse2_to_bit2(Sparse2_T bitmap)
+{
+        assert(bitmap != NULL);
+        Bit2_T dense = Bit2_new(bitmap->width, bitmap->height);
+        long ntiles = (long)bitmap->across * bitmap->down;
+        for (long index = 0; index < ntiles; index++) {
+                if (bitmap->tiles[index].kind == EMPTY) {
+                        continue;
+                }
+                int left = (int)(index % bitmap->across) << TILE_SHIFT;
+                int top = (int)(index / bitmap->across) << TILE_SHIFT;
+                Run scratch[TILE_SIDE];
+                Contents from = contents(bitmap, index, scratch);
+                if (from.kind == ARRAY) {
+                        const uint16_t *array = from.data;
+                        for (int i = 0; i < from.count; i++) {
+                                Bit2_put_fast(dense,
+                                        left + (array[i] & (TILE_SIDE - 1)),
+                                        top + (array[i] >> TILE_SHIFT), 1);
+                        }
+                } else if (from.kind == BITSET) {
+                        const uint64_t *words = from.data;
+                        for (int r = 0; r < TILE_SIDE &&
+                                        top + r < bitmap->height; r++) {
+                                uint64_t *row = &dense->words[(top + r) *
+                                                dense->words_per_row];
+                                for (int k = 0; k < TILE_SIDE / 64 &&
+                                        left / 64 + k < dense->words_per_row;
+                                     k++) {
+                                        row[left / 64 + k] =
+                                                words[r * (TILE_SIDE / 64) +
+                                                      k];
+                                }
+                        }
+                } else {
+                        const Run *runs = from.data;
+                        for (int i = 0; i < from.count; i++) {
+                                unsigned pos = runs[i].start;
+                                while (pos <= runs[i].last) {
+                                        unsigned end = pos | (TILE_SIDE - 1);
+                                        if (end > runs[i].last) {
+                                                end = runs[i].last;
+                                        }
+                                        put_range(dense,
+                                                  top + (pos >> TILE_SHIFT),
+                                                  left + (pos &
+                                                          (TILE_SIDE - 1)),
+                                                  left + (end &
+                                                          (TILE_SIDE - 1)));
+                                        pos = end + 1;
+                                }
+                        }
+                }
+        }
+        return dense;
+}
+
+/************** tile_area ************
+ *
+ * Use:
+ *      Returns the number of pixels of a tile that lie in the bitmap.
+ * Parameters:
+ *      Sparse2_T bitmap: The bitmap.
+ *      long index:       The tile.
+ * Return:
+ *      TILE_BITS, or less for tiles on the right and bottom edges.
+ * Expects:
+ *      None.
+ * Notes:
+ *      None.
+ *
+ ************************/
+static long tile_area(Sparse2_T bitmap, long index)
+{
+        long left = (index % bitmap->across) << TILE_SHIFT;
+        long top = (index / bitmap->across) << TILE_SHIFT;
+        long width = bitmap->width - left < TILE_SIDE ? bitmap->width - left
+                                                      : TILE_SIDE;
+        long height = bitmap->height - top < TILE_SIDE ? bitmap->height - top
+                                                       : TILE_SIDE;
+        return width * height;
+}
+
+/************** full_runs ************
+ *
+ * Use:
+ *      Writes the runs of a full tile.
+ * Parameters:
+ *      Sparse2_T bitmap: The bitmap.
+ *      long index:       The tile.
+ *      Run *runs:        Room for TILE_SIDE runs.
+ * Return:
+ *      The number of runs: one for a tile the full width of TILE_SIDE,
+ *      otherwise one per row.
+ * Expects:
+ *      None.
+ * Notes:
+ *      None.
+ *
+ ************************/
+static int full_runs(Sparse2_T bitmap, long index, Run *runs)
+{
+        long left = (index % bitmap->across) << TILE_SHIFT;
+        long top = (index / bitmap->across) << TILE_SHIFT;
+        int width = bitmap->width - left < TILE_SIDE
+                    ? (int)(bitmap->width - left) : TILE_SIDE;
+        int height = bitmap->height - top < TILE_SIDE
+                     ? (int)(bitmap->height - top) : TILE_SIDE;
+        if (width == TILE_SIDE) {
+                runs[0].start = 0;
+                runs[0].last = (uint16_t)(height * TILE_SIDE - 1);
+                return 1;
+        }
+        for (int r = 0; r < height; r++) {
+                runs[r].start = (uint16_t)(r * TILE_SIDE);
+                runs[r].last = (uint16_t)(r * TILE_SIDE + width - 1);
+        }
+        return height;
+}
+
+/************** contents ************
+ *
+ * Use:
+ *      Reads a tile's stored form.
+ * Parameters:
+ *      Sparse2_T bitmap: The bitmap.
+ *      long index:       The tile.
+ *      Run *scratch:     Room for TILE_SIDE runs, used for full tiles.
+ * Return:
+ *      The tile's contents; EMPTY, ARRAY, BITSET or RUNS.
+ * Expects:
+ *      None.
+ * Notes:
+ *      None.
+ *
+ ************************/
+static Contents contents(Sparse2_T bitmap, long index, Run *scratch)
+{
+        const Tile *tile = &bitmap->tiles[index];
+        Contents from = { tile->kind, tile->data, tile->count };
+        if (tile->kind == FULL) {
+                from.kind = RUNS;
+                from.data = scratch;
+                from.count = full_runs(bitmap, index, scratch);
+        }
+        return from;
+}
+
+/************** tile_get ************
+ *
+ * Use:
+ *      Returns the bit at a position of a tile.
+ * Parameters:
+ *      const Tile *tile: The tile.
+ *      unsigned pos:     The position, which lies in the bitmap.
+ * Return:
+ *      The bit, 0 or 1.
+ * Expects:
+ *      None.
+ * Notes:
+ *      None.
+ *
+ ************************/
+static int tile_get(const Tile *tile, unsigned pos)
+{
+        switch (tile->kind) {
+        case EMPTY:
+                return 0;
+        case FULL:
+                return 1;
+        case ARRAY: {
+                const uint16_t *array = tile->data;
+                int i = lower_array(array, tile->count, pos);
+                return i < tile->count && array[i] == pos;
+        }
+        case BITSET: {
+                const uint64_t *words = tile->data;
+                return (int)((words[pos / 64] >> (pos % 64)) & 1);
+        }
+        default: {
+                const Run *runs = tile->data;
+                int i = lower_run(runs, tile->count, pos);
+                return i < tile->count && runs[i].start <= pos;
+        }
+        }
+}
+
+/************** lower_array ************
+ *
+ * Use:
+ *      Binary searches an array tile.
+ * Parameters:
+ *      const uint16_t *array: The sorted positions.
+ *      int count:             Their number.
+ *      unsigned pos:          The position sought.
+ * Return:
+ *      The index of the first position not less than pos, or count.
+ * Expects:
+ *      None.
+ * Notes:
+ *      lower_run follows the same pattern, returning the first run that
+ *      does not end before pos.
+ *
+ ************************/
+static int lower_array(const uint16_t *array, int count, unsigned pos)
+{
+        int lo = 0;
+        int hi = count;
+        while (lo < hi) {
+                int mid = lo + (hi - lo) / 2;
+                if (array[mid] < pos) {
+                        lo = mid + 1;
+                } else {
+                        hi = mid;
+                }
+        }
+        return lo;
+}
+
+static int lower_run(const Run *runs, int count, unsigned pos)
+{
+        int lo = 0;
+        int hi = count;
+        while (lo < hi) {
+                int mid = lo + (hi - lo) / 2;
+                if (runs[mid].last < pos) {
+                        lo = mid + 1;
+                } else {
+                        hi = mid;
+                }
+        }
+        return lo;
+}
+
+/************** replace ************
+ *
+ * Use:
+ *      Gives a tile new storage, freeing the old.
+ * Parameters:
+ *      Tile *tile: The tile.
+ *      int kind:   Its new form.
+ *      void *data: Its new storage, or NULL for EMPTY and FULL.
+ *      int count:  Its new count.
+ *      int shift:  Log2 of an array's capacity.
+ * Return:
+ *      None.
+ * Expects:
+ *      None.
+ * Notes:
+ *      Leaves card alone; callers set it when it changes.
+ *
+ ************************/
+static void replace(Tile *tile, int kind, void *data, int count, int shift)
+{
+        FREE(tile->data);
+        tile->data = data;
+        tile->kind = (uint8_t)kind;
+        tile->count = (uint16_t)count;
+        tile->shift = (uint8_t)shift;
+}
+
+/************** install ************
+ *
+ * Use:
+ *      Stores contents into a tile in their smallest form.
+ * Parameters:
+ *      Tile *tile:    The tile, whose old storage is freed.
+ *      Contents from: The new contents, which may be the tile's own.
+ *      long area:     The tile's area, to recognize full tiles.
+ * Return:
+ *      None.
+ * Expects:
+ *      None.
+ * Notes:
+ *      An array wins ties, then runs; a bitset is used only when it is
+ *      strictly smaller than both.
+ *
+ ************************/
+static void install(Tile *tile, Contents from, long area)
+{
+        long card = from.kind == EMPTY ? 0 : count_card(from);
+        if (card == 0) {
+                replace(tile, EMPTY, NULL, 0, 0);
+        } else if (card == area) {
+                replace(tile, FULL, NULL, 0, 0);
+        } else {
+                long nruns = count_runs(from);
+                long array_bytes = card <= ARRAY_MAX
+                                   ? card * (long)sizeof(uint16_t)
+                                   : TILE_BITS;
+                long runs_bytes = nruns * (long)sizeof(Run);
+                long bitset_bytes = BITSET_WORDS * sizeof(uint64_t);
+                if (array_bytes <= runs_bytes &&
+                    array_bytes <= bitset_bytes) {
+                        int shift = 0;
+                        uint16_t *array = make_array(from, card, &shift);
+                        replace(tile, ARRAY, array, (int)card, shift);
+                } else if (runs_bytes < bitset_bytes) {
+                        Run *runs = make_runs(from, nruns);
+                        replace(tile, RUNS, runs, (int)nruns, 0);
+                } else {
+                        replace(tile, BITSET, make_bitset(from), 0, 0);
+                }
+        }
+        tile->card = (uint32_t)card;
+}
+
+/************** count_card ************
+ *
+ * Use:
+ *      Counts the 1 bits of tile contents.
+ * Parameters:
+ *      Contents from: ARRAY, BITSET or RUNS contents.
+ * Return:
+ *      The number of 1 bits.
+ * Expects:
+ *      None.
+ * Notes:
+ *      count_runs follows the same pattern, counting the runs; a run
+ *      starts at every 1 bit whose predecessor is 0.
+ *
+ ************************/
+static long count_card(Contents from)
+{
+        long card = 0;
+        if (from.kind == ARRAY) {
+                card = from.count;
+        } else if (from.kind == BITSET) {
+                const uint64_t *words = from.data;
+                for (int w = 0; w < BITSET_WORDS; w++) {
+                        card += Bit2_count_word(words[w]);
+                }
+        } else {
+                const Run *runs = from.data;
+                for (int i = 0; i < from.count; i++) {
+                        card += runs[i].last - runs[i].start + 1;
+                }
+        }
+        return card;
+}
+
+static long count_runs(Contents from)
+{
+        long nruns = 0;
+        if (from.kind == ARRAY) {
+                const uint16_t *array = from.data;
+                for (int i = 0; i < from.count; i++) {
+                        nruns += i == 0 || array[i] != array[i - 1] + 1;
+                }
+        } else if (from.kind == BITSET) {
+                const uint64_t *words = from.data;
+                uint64_t carry = 0;
+                for (int w = 0; w < BITSET_WORDS; w++) {
+                        uint64_t word = words[w];
+                        nruns += Bit2_count_word(word &
+                                                 ~(word << 1 | carry));
+                        carry = word >> 63;
+                }
+        } else {
+                nruns = from.count;
+        }
+        return nruns;
+}
+
+/************** make_array ************
+ *
+ * Use:
+ *      Converts tile contents into a new array.
+ * Parameters:
+ *      Contents from: ARRAY, BITSET or RUNS contents.
+ *      long card:     Their number of 1 bits, at most ARRAY_MAX.
+ *      int *shift:    Set to log2 of the array's capacity.
+ * Return:
+ *      The array, with room for the next power of two positions.
+ * Expects:
+ *      None.
+ * Notes:
+ *      make_bitset and make_runs follow the same pattern; make_runs takes
+ *      the number of runs instead.
+ *
+ ************************/
+static uint16_t *make_array(Contents from, long card, int *shift)
+{
+        *shift = 2;
+        while ((1L << *shift) < card) {
+                (*shift)++;
+        }
+        uint16_t *array = ALLOC((1L << *shift) * (long)sizeof(uint16_t));
+        int n = 0;
+        if (from.kind == ARRAY) {
+                memcpy(array, from.data, card * sizeof(uint16_t));
+        } else if (from.kind == BITSET) {
+                const uint64_t *words = from.data;
+                for (int w = 0; w < BITSET_WORDS; w++) {
+                        uint64_t word = words[w];
+                        while (word != 0) {
+                                array[n++] = (uint16_t)(w * 64 +
+                                                __builtin_ctzll(word));
+                                word &= word - 1;
+                        }
+                }
+        } else {
+                const Run *runs = from.data;
+                for (int i = 0; i < from.count; i++) {
+                        for (unsigned pos = runs[i].start;
+                             pos <= runs[i].last; pos++) {
+                                array[n++] = (uint16_t)pos;
+                        }
+                }
+        }
+        return array;
+}
+
+static uint64_t *make_bitset(Contents from)
+{
+        uint64_t *words = CALLOC(BITSET_WORDS, sizeof(uint64_t));
+        if (from.kind == ARRAY) {
+                const uint16_t *array = from.data;
+                for (int i = 0; i < from.count; i++) {
+                        words[array[i] / 64] |= (uint64_t)1 <<
+                                                (array[i] % 64);
+                }
+        } else if (from.kind == BITSET) {
+                memcpy(words, from.data, BITSET_WORDS * sizeof(uint64_t));
+        } else {
+                const Run *runs = from.data;
+                for (int i = 0; i < from.count; i++) {
+                        range_op(words, runs[i].start, runs[i].last, OP_OR);
+                }
+        }
+        return words;
+}
+
+static Run *make_runs(Contents from, long nruns)
+{
+        Run *runs = ALLOC(nruns * (long)sizeof(Run));
+        if (from.kind == ARRAY) {
+                runs_of_array(from.data, from.count, runs);
+        } else if (from.kind == BITSET) {
+                const uint64_t *words = from.data;
+                int n = 0;
+                bool in_run = false;
+                unsigned start = 0;
+                for (int w = 0; w < BITSET_WORDS; w++) {
+                        uint64_t word = words[w];
+                        int pos = 0;
+                        while (pos < 64) {
+                                uint64_t rest = (in_run ? ~word : word) &
+                                                (~(uint64_t)0 << pos);
+                                if (rest == 0) {
+                                        break;
+                                }
+                                int bit = __builtin_ctzll(rest);
+                                if (in_run) {
+                                        n = append_run(runs, n, start,
+                                                       w * 64 + bit - 1);
+                                } else {
+                                        start = w * 64 + bit;
+                                }
+                                in_run = !in_run;
+                                pos = bit + 1;
+                        }
+                }
+                if (in_run) {
+                        append_run(runs, n, start, TILE_BITS - 1);
+                }
+        } else {
+                memcpy(runs, from.data, nruns * sizeof(Run));
+        }
+        return runs;
+}
+
+/************** runs_of_array ************
+ *
+ * Use:
+ *      Groups the positions of an array into runs.
+ * Parameters:
+ *      const uint16_t *array: The sorted positions.
+ *      int count:             Their number.
+ *      Run *runs:             Room for count runs.
+ * Return:
+ *      The number of runs written.
+ * Expects:
+ *      None.
+ * Notes:
+ *      None.
+ *
+ ************************/
+static int runs_of_array(const uint16_t *array, int count, Run *runs)
+{
+        int n = 0;
+        for (int i = 0; i < count; i++) {
+                n = append_run(runs, n, array[i], array[i]);
+        }
+        return n;
+}
+
+/************** range_op ************
+ *
+ * Use:
+ *      Sets, clears or flips the bits [start, last] of a bitset.
+ * Parameters:
+ *      uint64_t *words:     The bitset.
+ *      unsigned start:      First position.
+ *      unsigned last:       Last position.
+ *      int table:           OP_OR to set, OP_AND to clear, OP_XOR to flip.
+ * Return:
+ *      None.
+ * Expects:
+ *      start <= last < TILE_BITS.
+ * Notes:
+ *      Whole words inside the range take one store each.
+ *
+ ************************/
+static void range_op(uint64_t *words, unsigned start, unsigned last,
+                     int table)
+{
+        for (unsigned w = start / 64; w <= last / 64; w++) {
+                uint64_t mask = ~(uint64_t)0;
+                if (w == start / 64) {
+                        mask &= ~(uint64_t)0 << (start % 64);
+                }
+                if (w == last / 64) {
+                        mask &= ~(uint64_t)0 >> (63 - last % 64);
+                }
+                if (table == OP_OR) {
+                        words[w] |= mask;
+                } else if (table == OP_AND) {
+                        words[w] &= ~mask;
+                } else {
+                        words[w] ^= mask;
+                }
+        }
+}
+
+/************** combine ************
+ *
+ * Use:
+ *      Does the work of the boolean operations.
+ * Parameters:
+ *      Sparse2_T a, Sparse2_T b: The bitmaps.
+ *      int table:                OP_AND, OP_OR or OP_XOR.
+ * Return:
+ *      A new bitmap with the result.
+ * Expects:
+ *      a and b are not NULL and have the same dimensions (throws a CRE if
+ *      not).
+ * Notes:
+ *      None.
+ *
+ ************************/
+static Sparse2_T combine(Sparse2_T a, Sparse2_T b, int table)
+{
+        assert(a != NULL && b != NULL);
+        assert(a->width == b->width && a->height == b->height);
+        Sparse2_T result = Sparse2_new(a->width, a->height);
+        Scratch *scratch;
+        NEW(scratch);
+        long ntiles = (long)a->across * a->down;
+        for (long index = 0; index < ntiles; index++) {
+                Contents from = combine_tiles(contents(a, index, scratch->a),
+                                              contents(b, index, scratch->b),
+                                              table, scratch);
+                install(&result->tiles[index], from,
+                        tile_area(result, index));
+        }
+        FREE(scratch);
+        return result;
+}
+
+/************** combine_tiles ************
+ *
+ * Use:
+ *      Combines two tiles without expanding them to pixels.
+ * Parameters:
+ *      Contents a, Contents b: The tiles' contents.
+ *      int table:              OP_AND, OP_OR or OP_XOR.
+ *      Scratch *scratch:       Room for the result; a and b may already
+ *                              use its a and b.
+ * Return:
+ *      The result, in scratch->out or one of the inputs.
+ * Expects:
+ *      None.
+ * Notes:
+ *      The operations are commutative, so the pair is put in ARRAY <
+ *      BITSET < RUNS order and six cases remain; an array meeting runs is
+ *      turned into runs first.
+ *
+ ************************/
+static Contents combine_tiles(Contents a, Contents b, int table,
+                              Scratch *scratch)
+{
+        Contents out = { EMPTY, NULL, 0 };
+        if (a.kind == EMPTY || b.kind == EMPTY) {
+                if (table == OP_AND) {
+                        return out;
+                }
+                return a.kind == EMPTY ? b : a;
+        }
+        if (a.kind > b.kind) {
+                Contents swap = a;
+                a = b;
+                b = swap;
+        }
+        if (a.kind == ARRAY && b.kind == RUNS) {
+                Run *runs = b.data == scratch->a ? scratch->b : scratch->a;
+                a.count = runs_of_array(a.data, a.count, runs);
+                a.data = runs;
+                a.kind = RUNS;
+        }
+
+        if (a.kind == ARRAY && b.kind == ARRAY) {
+                const uint16_t *x = a.data;
+                const uint16_t *y = b.data;
+                int i = 0;
+                int j = 0;
+                out.kind = ARRAY;
+                out.data = scratch->out.array;
+                while (i < a.count || j < b.count) {
+                        unsigned pos = j >= b.count ||
+                                       (i < a.count && x[i] < y[j])
+                                       ? x[i] : y[j];
+                        int in_a = i < a.count && x[i] == pos;
+                        int in_b = j < b.count && y[j] == pos;
+                        if ((table >> (2 * in_a + in_b)) & 1) {
+                                scratch->out.array[out.count++] =
+                                        (uint16_t)pos;
+                        }
+                        i += in_a;
+                        j += in_b;
+                }
+        } else if (a.kind == ARRAY && b.kind == BITSET) {
+                const uint16_t *x = a.data;
+                const uint64_t *words = b.data;
+                if (table == OP_AND) {
+                        out.kind = ARRAY;
+                        out.data = scratch->out.array;
+                        for (int i = 0; i < a.count; i++) {
+                                if ((words[x[i] / 64] >> (x[i] % 64)) & 1) {
+                                        scratch->out.array[out.count++] =
+                                                x[i];
+                                }
+                        }
+                } else {
+                        out.kind = BITSET;
+                        out.data = scratch->out.words;
+                        memcpy(scratch->out.words, words,
+                               BITSET_WORDS * sizeof(uint64_t));
+                        for (int i = 0; i < a.count; i++) {
+                                range_op(scratch->out.words, x[i], x[i],
+                                         table);
+                        }
+                }
+        } else if (a.kind == BITSET) {
+                out.kind = BITSET;
+                out.data = scratch->out.words;
+                memcpy(scratch->out.words, a.data,
+                       BITSET_WORDS * sizeof(uint64_t));
+                if (b.kind == BITSET) {
+                        const uint64_t *y = b.data;
+                        for (int w = 0; w < BITSET_WORDS; w++) {
+                                if (table == OP_AND) {
+                                        scratch->out.words[w] &= y[w];
+                                } else if (table == OP_OR) {
+                                        scratch->out.words[w] |= y[w];
+                                } else {
+                                        scratch->out.words[w] ^= y[w];
+                                }
+                        }
+                } else {
+                        /* And clears the gaps between runs; or and xor
+                         * set or flip the runs themselves. */
+                        const Run *runs = b.data;
+                        unsigned next = 0;
+                        for (int i = 0; i < b.count; i++) {
+                                if (table != OP_AND) {
+                                        range_op(scratch->out.words,
+                                                 runs[i].start, runs[i].last,
+                                                 table);
+                                } else if (runs[i].start > next) {
+                                        range_op(scratch->out.words, next,
+                                                 runs[i].start - 1, OP_AND);
+                                }
+                                next = runs[i].last + 1u;
+                        }
+                        if (table == OP_AND && next < TILE_BITS) {
+                                range_op(scratch->out.words, next,
+                                         TILE_BITS - 1, OP_AND);
+                        }
+                }
+        } else {
+                const Run *x = a.data;
+                const Run *y = b.data;
+                int i = 0;
+                int j = 0;
+                unsigned pos = 0;
+                out.kind = RUNS;
+                out.data = scratch->out.runs;
+                while (i < a.count || j < b.count) {
+                        int in_a = i < a.count && x[i].start <= pos;
+                        int in_b = j < b.count && y[j].start <= pos;
+                        unsigned next = TILE_BITS;
+                        if (i < a.count) {
+                                next = in_a ? x[i].last + 1u : x[i].start;
+                        }
+                        if (j < b.count) {
+                                unsigned edge = in_b ? y[j].last + 1u
+                                                     : y[j].start;
+                                next = edge < next ? edge : next;
+                        }
+                        if ((table >> (2 * in_a + in_b)) & 1) {
+                                out.count = append_run(scratch->out.runs,
+                                                       out.count, pos,
+                                                       next - 1);
+                        }
+                        pos = next;
+                        if (i < a.count && x[i].last < pos) {
+                                i++;
+                        }
+                        if (j < b.count && y[j].last < pos) {
+                                j++;
+                        }
+                }
+        }
+        return out;
+}
+
+/************** append_run ************
+ *
+ * Use:
+ *      Appends the run [start, last] to a list of runs, extending the last
+ *      run instead when they touch.
+ * Parameters:
+ *      Run *runs:      The runs.
+ *      int count:      Their number.
+ *      unsigned start: First position of the new run, after the last run.
+ *      unsigned last:  Its last position.
+ * Return:
+ *      The new number of runs.
+ * Expects:
+ *      None.
+ * Notes:
+ *      None.
+ *
+ ************************/
+static int append_run(Run *runs, int count, unsigned start, unsigned last)
+{
+        if (count > 0 && runs[count - 1].last + 1u == start) {
+                runs[count - 1].last = (uint16_t)last;
+                return count;
+        }
+        runs[count].start = (uint16_t)start;
+        runs[count].last = (uint16_t)last;
+        return count + 1;
+}
+
+/************** word_at ************
+ *
+ * Use:
+ *      Reads 64 bits of a Bit2 row starting at any bit.
+ * Parameters:
+ *      const uint64_t *words: The row's words.
+ *      long words_per_row:    Their number.
+ *      long bit:              The first bit.
+ * Return:
+ *      The bits, with bit as bit 0; bits past the row are 0.
+ * Expects:
+ *      bit lies in the row.
+ * Notes:
+ *      None.
+ *
+ ************************/
+static uint64_t word_at(const uint64_t *words, long words_per_row, long bit)
+{
+        long w = bit / 64;
+        int shift = (int)(bit % 64);
+        uint64_t word = words[w] >> shift;
+        if (shift != 0 && w + 1 < words_per_row) {
+                word |= words[w + 1] << (64 - shift);
+        }
+        return word;
+}
+
+/************** put_range ************
+ *
+ * Use:
+ *      Sets columns [col, last] of one row of a dense bitmap to 1.
+ * Parameters:
+ *      Bit2_T bitmap: The bitmap, which is not a view.
+ *      int row:       The row.
+ *      int col:       First column.
+ *      int last:      Last column.
+ * Return:
+ *      None.
+ * Expects:
+ *      col <= last and both lie in the bitmap.
+ * Notes:
+ *      None.
+ *
+ ************************/
+static void put_range(Bit2_T bitmap, int row, int col, int last)
+{
+        uint64_t *words = &bitmap->words[row * bitmap->words_per_row];
+        for (int w = col / 64; w <= last / 64; w++) {
+                uint64_t mask = ~(uint64_t)0;
+                if (w == col / 64) {
+                        mask &= ~(uint64_t)0 << (col % 64);
+                }
+                if (w == last / 64) {
+                        mask &= ~(uint64_t)0 >> (63 - last % 64);
+                }
+                words[w] |= mask;
+        }
+}
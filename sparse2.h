@@ -0,0 +1,67 @@
+/*
+ *     sparse2.h
+ *     by nozden01 & bdioni01, 2/12/2024
+ *     iii
+ *
+ *     Struct and function declarations for compressed 2D bitmaps in the
+ *     style of roaring bitmaps. The bitmap is cut into 256 x 256 tiles and
+ *     each tile is stored in whichever of five forms is smallest:
+ *
+ *         empty    no 1 bits, no storage
+ *         full     no 0 bits, no storage
+ *         array    sorted 16-bit positions of the 1 bits
+ *         bitset   a dense 8 KiB bitmap
+ *         runs     sorted runs of 1 bits
+ *
+ *     so a large, mostly blank mask costs 16 bytes per tile plus a few
+ *     bytes per set bit or run. The Sparse2_ functions that share a name
+ *     with a Bit2_ function take the same arguments and mean the same
+ *     thing, so a client switches by changing the prefix. The boolean
+ *     operations combine tiles in their stored forms without expanding
+ *     them to pixels.
+ */
+
+#ifndef SPARSE2_INCLUDED
+#define SPARSE2_INCLUDED
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <assert.h>
+#include "mem.h"
+#include "bit2.h"
+
+typedef struct Sparse2_T *Sparse2_T;
+
+Sparse2_T Sparse2_new(int col, int row);
+void Sparse2_free(Sparse2_T *bitmap);
+int Sparse2_width(Sparse2_T bitmap);
+int Sparse2_height(Sparse2_T bitmap);
+int Sparse2_put(Sparse2_T bitmap, int col, int row, int bit);
+int Sparse2_get(Sparse2_T bitmap, int col, int row);
+void Sparse2_map_col_major(Sparse2_T bitmap,
+                           void apply(int col, int row, Sparse2_T bitmap,
+                                      int bit, void *closure),
+                           void *closure);
+void Sparse2_map_row_major(Sparse2_T bitmap,
+                           void apply(int col, int row, Sparse2_T bitmap,
+                                      int bit, void *closure),
+                           void *closure);
+
+void Sparse2_map_set(Sparse2_T bitmap,
+                     void apply(int col, int row, void *closure),
+                     void *closure);
+long Sparse2_count(Sparse2_T bitmap);
+long Sparse2_bytes(Sparse2_T bitmap);
+void Sparse2_optimize(Sparse2_T bitmap);
+
+Sparse2_T Sparse2_and(Sparse2_T a, Sparse2_T b);
+Sparse2_T Sparse2_or(Sparse2_T a, Sparse2_T b);
+Sparse2_T Sparse2_xor(Sparse2_T a, Sparse2_T b);
+
+Sparse2_T Sparse2_from_bit2(Bit2_T bitmap);
+Bit2_T Sparse2_to_bit2(Sparse2_T bitmap);
+
+#endif
@@ -0,0 +1,263 @@
+/*
+ *     sudoku_bulk.c
+ *     by nozden01 & bdioni01, 2/12/2024
+ *     iii
+ *
+ *     Function implementations for the sudoku_bulk program.
+ *     Validates, and optionally solves, every board of a binary corpus
+ *     written by sudoku_pack. The corpus is memory-mapped and boards are
+ *     read in place, so the cost is the checking, not the parsing.
+ *
+ *     Usage: sudoku_bulk [-s] [-d] [-j threads] corpus.sdk
+ *            -s          also check every board for a unique solution
+ *            -d          with -s, solve only one 9x9 puzzle per symmetry
+ *                        class
+ *            -j threads  number of threads, 0 for all CPUs (the default)
+ */
+
+#include "sudoku_bulk.h"
+
+/* Boards per task; large enough to hide the cost of scheduling. */
+#define BATCH_BOARDS 4096
+
+/********** main ********
+ *
+ * Use:
+ *      Runs the sudoku_bulk program and prints the totals to stdout.
+ * Parameters:
+ *      int argc:     The number of arguments on the command line.
+ *      char *argv[]: Pointer to an array of arguments from the command line.
+ * Return:
+ *      EXIT_SUCCESS if the corpus could be read, EXIT_FAILURE otherwise.
+ * Expects:
+ *      Valid options and a corpus path (prints usage and returns
+ *      EXIT_FAILURE if not).
+ * Notes:
+ *      Prints one "name count" line for boards and valid boards, and with
+ *      -s for boards with at least one and with exactly one solution.
+ *      With -s and -d, a 9x9 puzzle (a board with empty cells) that is
+ *      equivalent to one already sent to the solver is counted as a
+ *      duplicate and not solved, so puzzles are counted per class, and
+ *      the number of distinct 9x9 puzzle classes is printed as well.
+ *      Finding a puzzle's class costs a few microseconds, a fraction of
+ *      solving it, but validating a board, or rejecting a full one, is
+ *      cheaper still, so only puzzles are deduplicated, and -d does
+ *      nothing without -s.
+ *
+ ************************/
+int main(int argc, char *argv[])
+{
+        bool solve = false;
+        bool dedup = false;
+        int threads = 0;
+        const char *path = NULL;
+        for (int i = 1; i < argc; i++) {
+                if (strcmp(argv[i], "-s") == 0) {
+                        solve = true;
+                } else if (strcmp(argv[i], "-d") == 0) {
+                        dedup = true;
+                } else if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+                        threads = atoi(argv[++i]);
+                } else if (argv[i][0] != '-' && path == NULL) {
+                        path = argv[i];
+                } else {
+                        path = NULL;
+                        break;
+                }
+        }
+        if (path == NULL || threads < 0) {
+                fprintf(stderr, "Usage: %s [-s] [-d] [-j threads] "
+                        "corpus.sdk\n", argv[0]);
+                return EXIT_FAILURE;
+        }
+
+        Corpus_T corpus = Corpus_open(path);
+        if (corpus == NULL) {
+                fprintf(stderr, "%s: cannot read corpus %s\n", argv[0], path);
+                return EXIT_FAILURE;
+        }
+
+        struct Tally tally = { 0, 0, 0, 0 };
+        long count = Corpus_count(corpus);
+        Canonset_T classes = (dedup && solve) ? Canonset_new(count) : NULL;
+        Taskpool_T pool = NULL;
+        if (threads != 1) {
+                pool = Taskpool_new(threads);
+        }
+        for (long first = 0; first < count; first += BATCH_BOARDS) {
+                Batch batch;
+                NEW(batch);
+                batch->corpus = corpus;
+                batch->first = first;
+                batch->last = (count - first > BATCH_BOARDS)
+                              ? first + BATCH_BOARDS : count;
+                batch->solve = solve;
+                batch->classes = classes;
+                batch->tally = &tally;
+                if (pool == NULL) {
+                        run_batch(NULL, 0, batch);
+                } else {
+                        Taskpool_submit(pool, run_batch, batch);
+                }
+        }
+        if (pool != NULL) {
+                Taskpool_free(&pool);
+        }
+
+        printf("boards %ld\nvalid %ld\n", count, tally.valid);
+        if (solve) {
+                printf("solvable %ld\nunique %ld\n", tally.solvable,
+                       tally.unique);
+        }
+        if (classes != NULL) {
+                printf("classes %ld\nduplicates %ld\n",
+                       Canonset_size(classes), tally.duplicates);
+                Canonset_free(&classes);
+        }
+        Corpus_close(&corpus);
+        return EXIT_SUCCESS;
+}
+
+/********** run_batch ********
+ *
+ * Use:
+ *      Taskpool task that checks one range of boards and adds its counts to
+ *      the shared tally.
+ * Parameters:
+ *      Taskpool_T pool: The pool running the task (not used).
+ *      int worker:      Index of the worker (not used).
+ *      void *arg:       The Batch; freed by this function.
+ * Return:
+ *      None.
+ * Expects:
+ *      None.
+ * Notes:
+ *      Counts are kept locally and published once per batch, so workers do
+ *      not contend on the tally.
+ *
+ ************************/
+void run_batch(Taskpool_T pool, int worker, void *arg)
+{
+        (void) pool;
+        (void) worker;
+        Batch batch = arg;
+        struct Tally local = { 0, 0, 0, 0 };
+        for (long i = batch->first; i < batch->last; i++) {
+                check_board(batch->corpus, i, batch->solve, batch->classes,
+                            &local);
+        }
+        __atomic_add_fetch(&batch->tally->valid, local.valid,
+                           __ATOMIC_RELAXED);
+        __atomic_add_fetch(&batch->tally->solvable, local.solvable,
+                           __ATOMIC_RELAXED);
+        __atomic_add_fetch(&batch->tally->unique, local.unique,
+                           __ATOMIC_RELAXED);
+        __atomic_add_fetch(&batch->tally->duplicates, local.duplicates,
+                           __ATOMIC_RELAXED);
+        FREE(batch);
+}
+
+/********** first_of_class ********
+ *
+ * Use:
+ *      Records the symmetry class of board i and reports whether it is the
+ *      first board of that class to be seen.
+ * Parameters:
+ *      Corpus_T corpus:    The corpus holding the board.
+ *      long i:             Index of the board.
+ *      Canonset_T classes: Classes seen so far.
+ * Return:
+ *      False if an equivalent board was seen before, true otherwise.
+ * Expects:
+ *      None.
+ * Notes:
+ *      Only 9x9 boards with an empty cell have classes; boards of any
+ *      other size, full boards (which the solver rejects at once, so
+ *      finding their class would cost more than solving them) and damaged
+ *      records always count as new. Canonset_insert only canonicalizes
+ *      boards that share a cheap invariant with an earlier one.
+ *
+ ************************/
+bool first_of_class(Corpus_T corpus, long i, Canonset_T classes)
+{
+        if (Corpus_box(corpus, i) != 3) {
+                return true;
+        }
+        unsigned char cells[CANON_CELLS];
+        bool empty = false;
+        for (int row = 0; row < 9; row++) {
+                for (int col = 0; col < 9; col++) {
+                        int value = Corpus_cell(corpus, i, col, row);
+                        cells[row * 9 + col] = (unsigned char)value;
+                        empty |= value == 0;
+                }
+        }
+        return !empty || Canonset_insert(classes, cells);
+}
+
+/********** check_board ********
+ *
+ * Use:
+ *      Validates board i and, if asked, counts its solutions up to two.
+ * Parameters:
+ *      Corpus_T corpus:     The corpus holding the board.
+ *      long i:              Index of the board.
+ *      bool solve:          Whether to run the solver.
+ *      Canonset_T classes:  Classes already sent to the solver, or NULL to
+ *                           solve every board.
+ *      struct Tally *local: Counts being accumulated.
+ * Return:
+ *      None.
+ * Expects:
+ *      None.
+ * Notes:
+ *      A valid board is its own unique solution, so the solver only runs
+ *      on boards that fail validation, and only those are looked up in
+ *      classes. Boards larger than the solver supports are not solved.
+ *
+ ************************/
+void check_board(Corpus_T corpus, long i, bool solve, Canonset_T classes,
+                 struct Tally *local)
+{
+        if (Corpus_check(corpus, i)) {
+                local->valid++;
+                local->solvable++;
+                local->unique++;
+                return;
+        }
+        int box = Corpus_box(corpus, i);
+        if (!solve || box == 0 || box > SOLVER_MAX_BOX) {
+                return;
+        }
+        if (classes != NULL && !first_of_class(corpus, i, classes)) {
+                local->duplicates++;
+                return;
+        }
+        Board_ref ref = { corpus, i };
+        long solutions = Solver_solve_cells(box, record_cell, &ref, 2, NULL,
+                                            NULL);
+        local->solvable += (solutions > 0);
+        local->unique += (solutions == 1);
+}
+
+/********** record_cell ********
+ *
+ * Use:
+ *      Solver cell function that reads a cell straight from a corpus record.
+ * Parameters:
+ *      int col:       Column of the cell.
+ *      int row:       Row of the cell.
+ *      void *closure: The Board_ref naming the board.
+ * Return:
+ *      The value of the cell.
+ * Expects:
+ *      None.
+ * Notes:
+ *      None.
+ *
+ ************************/
+int record_cell(int col, int row, void *closure)
+{
+        Board_ref *ref = closure;
+        return Corpus_cell(ref->corpus, ref->index, col, row);
+}
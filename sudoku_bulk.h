@@ -0,0 +1,45 @@
+/*
+ *     sudoku_bulk.h
+ *     by nozden01 & bdioni01, 2/12/2024
+ *     iii
+ *
+ *     Contains struct and function declarations for the sudoku_bulk program.
+ *     Includes libraries and files necessary for this program to function.
+ */
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "corpus.h"
+#include "solver.h"
+#include "taskpool.h"
+#include "canon.h"
+
+/* Totals over the whole corpus, updated atomically by every batch. */
+typedef struct Tally {
+        long valid;
+        long solvable;
+        long unique;
+        long duplicates;
+} *Tally;
+
+typedef struct Batch {
+        Corpus_T corpus;
+        long first;
+        long last;
+        bool solve;
+        Canonset_T classes;
+        Tally tally;
+} *Batch;
+
+typedef struct Board_ref {
+        Corpus_T corpus;
+        long index;
+} Board_ref;
+
+void run_batch(Taskpool_T pool, int worker, void *arg);
+bool first_of_class(Corpus_T corpus, long i, Canonset_T classes);
+void check_board(Corpus_T corpus, long i, bool solve, Canonset_T classes,
+                 struct Tally *local);
+int record_cell(int col, int row, void *closure);
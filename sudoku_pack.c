@@ -0,0 +1,247 @@
+/*
+ *     sudoku_pack.c
+ *     by nozden01 & bdioni01, 2/12/2024
+ *     iii
+ *
+ *     Function implementations for the sudoku_pack program.
+ *     Converts sudoku boards to the binary corpus format read by
+ *     sudoku_bulk. Input is either pgm boards (P2 or P5, any number of them
+ *     back to back in each file) or, with -l, text with one 9x9 board per
+ *     line as 81 characters, where '0' or '.' marks an empty cell.
+ *
+ *     Usage: sudoku_pack [-l] [-m] output.sdk [input ...]
+ *            -l  inputs hold 81-character lines instead of pgm boards
+ *            -m  allow boards other than 9x9, of mixed sizes (adds a record
+ *                index)
+ *     With no inputs, boards are read from stdin.
+ */
+
+#include "sudoku_pack.h"
+
+/********** main ********
+ *
+ * Use:
+ *      Runs the sudoku_pack program.
+ * Parameters:
+ *      int argc:     The number of arguments on the command line.
+ *      char *argv[]: Pointer to an array of arguments from the command line.
+ * Return:
+ *      EXIT_SUCCESS if every board was packed, EXIT_FAILURE if an input
+ *      could not be read, some boards had to be skipped or the corpus
+ *      could not be written.
+ * Expects:
+ *      An output path (prints usage and returns EXIT_FAILURE if not).
+ * Notes:
+ *      The number of boards written is printed to stderr.
+ *
+ ************************/
+int main(int argc, char *argv[])
+{
+        bool lines = false;
+        bool mixed = false;
+        int i = 1;
+        for (; i < argc && argv[i][0] == '-'; i++) {
+                if (strcmp(argv[i], "-l") == 0) {
+                        lines = true;
+                } else if (strcmp(argv[i], "-m") == 0) {
+                        mixed = true;
+                } else {
+                        break;
+                }
+        }
+        if (i >= argc || argv[i][0] == '-') {
+                fprintf(stderr,
+                        "Usage: %s [-l] [-m] output.sdk [input ...]\n",
+                        argv[0]);
+                return EXIT_FAILURE;
+        }
+
+        /* Line input is always 9x9, so only pgm input can be mixed. */
+        Corpus_writer writer = Corpus_create(argv[i], mixed ? 0 : 3);
+        if (writer == NULL) {
+                fprintf(stderr, "%s: cannot create %s\n", argv[0], argv[i]);
+                return EXIT_FAILURE;
+        }
+
+        long packed = 0;
+        long skipped = 0;
+        bool ok = true;
+        int first = i + 1;
+        for (int j = first; j < argc || (j == first && first == argc); j++) {
+                FILE *fp = stdin;
+                if (j < argc) {
+                        fp = fopen(argv[j], "rb");
+                        if (fp == NULL) {
+                                fprintf(stderr, "%s: cannot open %s\n",
+                                        argv[0], argv[j]);
+                                ok = false;
+                                continue;
+                        }
+                }
+                if (lines) {
+                        packed += pack_line_stream(fp, writer, &skipped);
+                } else {
+                        packed += pack_pgm_stream(fp, writer, &skipped);
+                }
+                if (fp != stdin) {
+                        fclose(fp);
+                }
+        }
+        if (!Corpus_finish(&writer)) {
+                fprintf(stderr, "%s: cannot write %s\n", argv[0],
+                        argv[first - 1]);
+                ok = false;
+        }
+
+        fprintf(stderr, "%ld boards packed, %ld skipped\n", packed, skipped);
+        return (ok && skipped == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/********** pack_pgm_stream ********
+ *
+ * Use:
+ *      Packs every pgm board in a file into the corpus.
+ * Parameters:
+ *      FILE *inputfd:        The file holding the boards.
+ *      Corpus_writer writer: The corpus being written.
+ *      long *skipped:        Incremented for every board that could not be
+ *                            packed.
+ * Return:
+ *      The number of boards packed.
+ * Expects:
+ *      None.
+ * Notes:
+ *      A board must be square with side box * box, box in
+ *      [2, CORPUS_MAX_BOX]. Reading stops at the first malformed header or
+ *      truncated board, since the rest of the file cannot be trusted.
+ *
+ ************************/
+long pack_pgm_stream(FILE *inputfd, Corpus_writer writer, long *skipped)
+{
+        int maxn = CORPUS_MAX_BOX * CORPUS_MAX_BOX;
+        unsigned char *cells = ALLOC(maxn * maxn);
+        long packed = 0;
+
+        while (next_board(inputfd)) {
+                Pnmscan_info header;
+                if (!Pnmscan_header(inputfd, &header) ||
+                    (header.format != 2 && header.format != 5)) {
+                        (*skipped)++;
+                        break;
+                }
+                int n = (int) header.width;
+                int box = 2;
+                while (box < CORPUS_MAX_BOX && box * box < n) {
+                        box++;
+                }
+                if ((int) header.height != n || box * box != n) {
+                        (*skipped)++;
+                        break;
+                }
+
+                bool complete = true;
+                for (int k = 0; k < n * n && complete; k++) {
+                        long value = Pnmscan_gray(inputfd, &header);
+                        complete = value >= 0;
+                        cells[k] = (unsigned char)(value > 255 ? 255 : value);
+                }
+                if (!complete || !Corpus_append(writer, cells, box)) {
+                        (*skipped)++;
+                        if (!complete) {
+                                break;
+                        }
+                        continue;
+                }
+                packed++;
+        }
+        FREE(cells);
+        return packed;
+}
+
+/********** pack_line_stream ********
+ *
+ * Use:
+ *      Packs every 81-character board line in a file into the corpus.
+ * Parameters:
+ *      FILE *inputfd:        The file holding the boards.
+ *      Corpus_writer writer: The corpus being written.
+ *      long *skipped:        Incremented for every line that is not a board.
+ * Return:
+ *      The number of boards packed.
+ * Expects:
+ *      None.
+ * Notes:
+ *      Blank lines are ignored. Trailing whitespace (including "\r") is
+ *      allowed.
+ *
+ ************************/
+long pack_line_stream(FILE *inputfd, Corpus_writer writer, long *skipped)
+{
+        unsigned char cells[81];
+        char line[256];
+        long packed = 0;
+
+        while (fgets(line, sizeof(line), inputfd) != NULL) {
+                size_t len = strlen(line);
+                bool whole = len > 0 && line[len - 1] == '\n';
+                while (len > 0 && isspace((unsigned char)line[len - 1])) {
+                        len--;
+                }
+                if (!whole && !feof(inputfd)) {
+                        /* Too long to be a board: skip the rest of it. */
+                        int c;
+                        while ((c = getc(inputfd)) != '\n' && c != EOF) {
+                        }
+                        (*skipped)++;
+                        continue;
+                }
+                if (len == 0) {
+                        continue;
+                }
+
+                bool ok = len == 81;
+                for (size_t k = 0; k < len && ok; k++) {
+                        char c = line[k];
+                        if (c == '.' || c == '0') {
+                                cells[k] = 0;
+                        } else if (c >= '1' && c <= '9') {
+                                cells[k] = (unsigned char)(c - '0');
+                        } else {
+                                ok = false;
+                        }
+                }
+                if (ok && Corpus_append(writer, cells, 3)) {
+                        packed++;
+                } else {
+                        (*skipped)++;
+                }
+        }
+        return packed;
+}
+
+/********** next_board ********
+ *
+ * Use:
+ *      Skips whitespace between concatenated pgm boards.
+ * Parameters:
+ *      FILE *inputfd: The file holding the boards.
+ * Return:
+ *      True if another board follows, false at end of file.
+ * Expects:
+ *      None.
+ * Notes:
+ *      None.
+ *
+ ************************/
+bool next_board(FILE *inputfd)
+{
+        int c = getc(inputfd);
+        while (c != EOF && isspace(c)) {
+                c = getc(inputfd);
+        }
+        if (c == EOF) {
+                return false;
+        }
+        ungetc(c, inputfd);
+        return true;
+}
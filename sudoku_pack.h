@@ -0,0 +1,20 @@
+/*
+ *     sudoku_pack.h
+ *     by nozden01 & bdioni01, 2/12/2024
+ *     iii
+ *
+ *     Contains function declarations for the sudoku_pack program.
+ *     Includes libraries and files necessary for this program to function.
+ */
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include "corpus.h"
+#include "pnmscan.h"
+
+long pack_pgm_stream(FILE *inputfd, Corpus_writer writer, long *skipped);
+long pack_line_stream(FILE *inputfd, Corpus_writer writer, long *skipped);
+bool next_board(FILE *inputfd);
@@ -0,0 +1,274 @@
+/*
+ *     sudoku_solve.c
+ *     by nozden01 & bdioni01, 2/12/2024
+ *     iii
+ *
+ *     Function implementations for the sudoku_solve program.
+ *     Reads a sudoku puzzle in pgm format, where 0 marks an empty cell, and
+ *     solves it, counts its solutions, or checks that its solution is unique.
+ *     Boards may be any size box * box up to SOLVER_MAX_BOX, so 9x9, 16x16
+ *     and 25x25 puzzles are all accepted.
+ *
+ *     Usage: sudoku_solve [-j threads] [-c limit | -u] [puzzle.pgm]
+ *            -j threads  number of search threads, 0 for all CPUs (default 1)
+ *            -c limit    print the number of solutions, stopping at limit
+ *                        (0 counts them all)
+ *            -u          succeed only if the solution is unique
+ */
+
+#include "sudoku_solve.h"
+
+/********** main ********
+ *
+ * Use:
+ *      Runs the sudoku_solve program. Prints the solution (or the number of
+ *      solutions with -c) to stdout.
+ * Parameters:
+ *      int argc:     The number of arguments on the command line.
+ *      char *argv[]: Pointer to an array of arguments from the command line.
+ * Return:
+ *      EXIT_SUCCESS if a solution was found (a unique one with -u, or at
+ *      least one with -c), EXIT_FAILURE otherwise.
+ * Expects:
+ *      Valid options and at most one file name (prints usage and returns
+ *      EXIT_FAILURE if not).
+ *      That the file can be opened (throws a CRE if not).
+ * Notes:
+ *      Clashing givens are listed on stderr and the program fails without
+ *      searching.
+ *
+ ************************/
+int main(int argc, char *argv[])
+{
+        int threads = 1;
+        long limit = 1;
+        bool count_mode = false;
+        bool unique_mode = false;
+        const char *filename = NULL;
+
+        for (int i = 1; i < argc; i++) {
+                if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+                        threads = atoi(argv[++i]);
+                } else if (strcmp(argv[i], "-c") == 0 && i + 1 < argc) {
+                        limit = atol(argv[++i]);
+                        count_mode = true;
+                } else if (strcmp(argv[i], "-u") == 0) {
+                        unique_mode = true;
+                } else if (argv[i][0] != '-' && filename == NULL) {
+                        filename = argv[i];
+                } else {
+                        usage(argv[0]);
+                        return EXIT_FAILURE;
+                }
+        }
+        if (threads < 0 || limit < 0 || (count_mode && unique_mode)) {
+                usage(argv[0]);
+                return EXIT_FAILURE;
+        }
+
+        FILE *fp = stdin;
+        if (filename != NULL) {
+                fp = fopen(filename, "r");
+                assert(fp != NULL);
+        }
+        int box;
+        UArray2_T puzzle = read_puzzle(fp, &box);
+        if (fp != stdin) {
+                fclose(fp);
+        }
+        if (puzzle == NULL) {
+                return EXIT_FAILURE;
+        }
+
+        /* Givens that already clash are reported rather than searched. */
+        Validator_T givens = Validator_from_board(puzzle, box);
+        bool clash = !Validator_valid(givens);
+        if (clash) {
+                Validator_conflicts(givens, report_conflict, NULL);
+        }
+        Validator_free(&givens);
+        if (clash) {
+                UArray2_free(&puzzle);
+                return EXIT_FAILURE;
+        }
+
+        int n = box * box;
+        UArray2_T solution = UArray2_new(n, n, sizeof(int));
+        bool solved;
+        if (unique_mode) {
+                solved = Solver_unique(puzzle, box, threads, solution) == 1;
+        } else {
+                long count = Solver_solve(puzzle, box, limit, threads,
+                                          solution);
+                if (count_mode) {
+                        printf("%ld\n", count);
+                }
+                solved = count > 0;
+        }
+        if (solved && !count_mode) {
+                print_board(solution, box);
+        }
+
+        UArray2_free(&solution);
+        UArray2_free(&puzzle);
+        return solved ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/********** read_puzzle ********
+ *
+ * Use:
+ *      Reads a puzzle from a pgm file. The board must be square with a side
+ *      that is a perfect square, and the denominator must equal that side.
+ * Parameters:
+ *      FILE *inputfd: The file holding the puzzle.
+ *      int *box:      Set to the side of one box of the board.
+ * Return:
+ *      A new board of ints, or NULL if the input is not a valid puzzle.
+ * Expects:
+ *      The Pnmrdr is able to read from the given file (throws a CRE if not).
+ * Notes:
+ *      The client frees the board with UArray2_free.
+ *
+ ************************/
+UArray2_T read_puzzle(FILE *inputfd, int *box)
+{
+        Pnmrdr_T p2 = Pnmrdr_new(inputfd);
+        assert(p2 != NULL);
+        Pnmrdr_mapdata header = Pnmrdr_data(p2);
+        int n = (int) header.width;
+
+        int b = 2;
+        while (b < SOLVER_MAX_BOX && b * b < n) {
+                b++;
+        }
+        bool shape_ok = (header.type == Pnmrdr_gray) &&
+                        ((int) header.height == n) && (b * b == n) &&
+                        ((int) header.denominator == n);
+
+        UArray2_T board = NULL;
+        if (shape_ok) {
+                board = UArray2_new(n, n, sizeof(int));
+        }
+        bool values_ok = true;
+        for (int row = 0; row < (int) header.height; row++) {
+                for (int col = 0; col < (int) header.width; col++) {
+                        /* Every pixel is read so that Pnmrdr_free succeeds. */
+                        int value = (int) Pnmrdr_get(p2);
+                        if (board == NULL || value > n) {
+                                values_ok = false;
+                        } else {
+                                *(int *)UArray2_at(board, col, row) = value;
+                        }
+                }
+        }
+        Pnmrdr_free(&p2);
+
+        if (board == NULL) {
+                return NULL;
+        }
+        if (!values_ok) {
+                UArray2_free(&board);
+                return NULL;
+        }
+        *box = b;
+        return board;
+}
+
+/********** print_board ********
+ *
+ * Use:
+ *      Prints a board to stdout as a plain pgm file.
+ * Parameters:
+ *      UArray2_T board: The board being printed.
+ *      int box:         Side of one box of the board.
+ * Return:
+ *      None.
+ * Expects:
+ *      board is not NULL (throws a CRE if not).
+ * Notes:
+ *      None.
+ *
+ ************************/
+void print_board(UArray2_T board, int box)
+{
+        assert(board != NULL);
+        int n = box * box;
+        printf("P2\n%d %d\n%d\n", n, n, n);
+        UArray2_map_row_major(board, print_cell, NULL);
+}
+
+/********** print_cell ********
+ *
+ * Use:
+ *      Apply function that prints one cell, ending the line after the last
+ *      column.
+ * Parameters:
+ *      int col:       Column of the cell.
+ *      int row:       Row of the cell (not used).
+ *      UArray2_T arr: The board being printed.
+ *      void *elem:    Pointer to the int in the cell.
+ *      void *closure: Not used.
+ * Return:
+ *      None.
+ * Expects:
+ *      None.
+ * Notes:
+ *      None.
+ *
+ ************************/
+void print_cell(int col, int row, UArray2_T arr, void *elem, void *closure)
+{
+        (void) row;
+        (void) closure;
+        if (col != UArray2_width(arr) - 1) {
+                printf("%d ", *(int *)elem);
+        } else {
+                printf("%d\n", *(int *)elem);
+        }
+}
+
+/********** report_conflict ********
+ *
+ * Use:
+ *      Validator_conflicts apply function that reports one clashing given on
+ *      stderr.
+ * Parameters:
+ *      int col:       Column of the cell.
+ *      int row:       Row of the cell.
+ *      int digit:     The digit that appears more than once.
+ *      void *closure: Not used.
+ * Return:
+ *      None.
+ * Expects:
+ *      None.
+ * Notes:
+ *      None.
+ *
+ ************************/
+void report_conflict(int col, int row, int digit, void *closure)
+{
+        (void) closure;
+        fprintf(stderr, "conflicting given %d at column %d, row %d\n",
+                digit, col, row);
+}
+
+/********** usage ********
+ *
+ * Use:
+ *      Prints the usage message to stderr.
+ * Parameters:
+ *      const char *progname: Name the program was run as.
+ * Return:
+ *      None.
+ * Expects:
+ *      None.
+ * Notes:
+ *      None.
+ *
+ ************************/
+void usage(const char *progname)
+{
+        fprintf(stderr,
+                "Usage: %s [-j threads] [-c limit | -u] [puzzle.pgm]\n",
+                progname);
+}
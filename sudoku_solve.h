@@ -0,0 +1,23 @@
+/*
+ *     sudoku_solve.h
+ *     by nozden01 & bdioni01, 2/12/2024
+ *     iii
+ *
+ *     Contains function declarations for the sudoku_solve program.
+ *     Includes libraries and files necessary for this program to function.
+ */
+
+#include <stdbool.h>
+#include <pnmrdr.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "uarray2.h"
+#include "solver.h"
+#include "validator.h"
+
+UArray2_T read_puzzle(FILE *inputfd, int *box);
+void print_board(UArray2_T board, int box);
+void print_cell(int col, int row, UArray2_T arr, void *elem, void *closure);
+void report_conflict(int col, int row, int digit, void *closure);
+void usage(const char *progname);
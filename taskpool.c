@@ -0,0 +1,504 @@
+/*
+ *     taskpool.c
+ *     by nozden01 & bdioni01, 2/12/2024
+ *     iii
+ *
+ *     Function implementations for the work-stealing thread pool.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <unistd.h>
+#include "taskpool.h"
+
+#define DEQUE_HINT 64
+
+typedef struct Task {
+        void (*run)(Taskpool_T pool, int worker, void *arg);
+        void *arg;
+} Task;
+
+/* Circular buffer of tasks. The owner works at the bottom and thieves take
+ * from the top, so the oldest (and usually largest) subtrees get stolen. */
+typedef struct Deque {
+        pthread_mutex_t lock;
+        Task *tasks;
+        long capacity;
+        long top;
+        long bottom;
+} Deque;
+
+typedef struct Worker {
+        Taskpool_T pool;
+        int id;
+} Worker;
+
+struct Taskpool_T {
+        int nworkers;
+        pthread_t *threads;
+        Worker *workers;
+        Deque *deques;
+        pthread_mutex_t lock;
+        pthread_cond_t work;
+        pthread_cond_t done;
+        long pending;
+        long queued;
+        int sleeping;
+        int shutdown;
+        unsigned next;
+};
+
+static void *worker_loop(void *closure);
+static void deque_push(Deque *deque, Task task);
+static bool deque_pop(Deque *deque, Task *task);
+static bool deque_steal(Deque *deque, Task *task);
+static bool find_task(Taskpool_T pool, int id, Task *task);
+static void enqueue(Taskpool_T pool, int worker, Task task);
+
+/********** Taskpool_new ********
+ *
+ * Use:
+ *      Creates a pool of worker threads, each with its own task deque, and
+ *      starts the workers. Workers sleep until tasks are submitted.
+ * Parameters:
+ *      int nthreads: Number of worker threads, or 0 to use one worker per
+ *                    online CPU.
+ * Return:
+ *      The new pool.
+ * Expects:
+ *      nthreads >= 0 (throws a CRE if not).
+ *      That the threads can be created (throws a CRE if not).
+ * Notes:
+ *      Allocates memory that the client must release with Taskpool_free.
+ *
+ ************************/
+Taskpool_T Taskpool_new(int nthreads)
+{
+        assert(nthreads >= 0);
+        if (nthreads == 0) {
+                nthreads = Taskpool_online_cpus();
+        }
+
+        Taskpool_T pool;
+        NEW(pool);
+        pool->nworkers = nthreads;
+        pool->pending = 0;
+        pool->queued = 0;
+        pool->sleeping = 0;
+        pool->shutdown = 0;
+        pool->next = 0;
+        pthread_mutex_init(&pool->lock, NULL);
+        pthread_cond_init(&pool->work, NULL);
+        pthread_cond_init(&pool->done, NULL);
+
+        pool->threads = ALLOC(nthreads * (long)sizeof(pthread_t));
+        pool->workers = ALLOC(nthreads * (long)sizeof(Worker));
+        pool->deques = ALLOC(nthreads * (long)sizeof(Deque));
+        for (int i = 0; i < nthreads; i++) {
+                Deque *deque = &pool->deques[i];
+                pthread_mutex_init(&deque->lock, NULL);
+                deque->capacity = DEQUE_HINT;
+                deque->tasks = ALLOC(DEQUE_HINT * (long)sizeof(Task));
+                deque->top = 0;
+                deque->bottom = 0;
+        }
+        for (int i = 0; i < nthreads; i++) {
+                pool->workers[i].pool = pool;
+                pool->workers[i].id = i;
+                int err = pthread_create(&pool->threads[i], NULL,
+                                         worker_loop, &pool->workers[i]);
+                assert(err == 0);
+        }
+        return pool;
+}
+
+/********** Taskpool_workers ********
+ *
+ * Use:
+ *      Returns the number of worker threads in the pool.
+ * Parameters:
+ *      Taskpool_T pool: The pool being queried.
+ * Return:
+ *      The number of workers.
+ * Expects:
+ *      pool is not NULL (throws a CRE if not).
+ * Notes:
+ *      None.
+ *
+ ************************/
+int Taskpool_workers(Taskpool_T pool)
+{
+        assert(pool != NULL);
+        return pool->nworkers;
+}
+
+/********** Taskpool_submit ********
+ *
+ * Use:
+ *      Submits a task from outside the pool. Tasks are spread round-robin
+ *      over the worker deques.
+ * Parameters:
+ *      Taskpool_T pool: The pool that will run the task.
+ *      void run(...):   The task function. It receives the pool, the index of
+ *                       the worker running it, and arg.
+ *      void *arg:       The argument passed to run.
+ * Return:
+ *      None.
+ * Expects:
+ *      pool and run are not NULL (throws a CRE if not).
+ * Notes:
+ *      Every task is run exactly once, so it is responsible for releasing
+ *      arg. Tasks that want to stop early share their own stop flag.
+ *
+ ************************/
+void Taskpool_submit(Taskpool_T pool,
+                     void run(Taskpool_T pool, int worker, void *arg),
+                     void *arg)
+{
+        assert(pool != NULL && run != NULL);
+        unsigned slot = __atomic_fetch_add(&pool->next, 1, __ATOMIC_RELAXED);
+        Task task = { run, arg };
+        enqueue(pool, (int)(slot % (unsigned)pool->nworkers), task);
+}
+
+/********** Taskpool_spawn ********
+ *
+ * Use:
+ *      Pushes a task onto the deque of the given worker. Running tasks use
+ *      this to split their work, passing the worker index they were given.
+ * Parameters:
+ *      Taskpool_T pool: The pool that will run the task.
+ *      int worker:      Index of the worker whose deque receives the task.
+ *      void run(...):   The task function.
+ *      void *arg:       The argument passed to run.
+ * Return:
+ *      None.
+ * Expects:
+ *      pool and run are not NULL, and worker is in [0, workers) (throws a CRE
+ *      if not).
+ * Notes:
+ *      None.
+ *
+ ************************/
+void Taskpool_spawn(Taskpool_T pool,
+                    int worker,
+                    void run(Taskpool_T pool, int worker, void *arg),
+                    void *arg)
+{
+        assert(pool != NULL && run != NULL);
+        assert(worker >= 0 && worker < pool->nworkers);
+        Task task = { run, arg };
+        enqueue(pool, worker, task);
+}
+
+/********** Taskpool_wait ********
+ *
+ * Use:
+ *      Blocks until every task that has been submitted or spawned, including
+ *      tasks spawned while waiting, has finished.
+ * Parameters:
+ *      Taskpool_T pool: The pool being waited on.
+ * Return:
+ *      None.
+ * Expects:
+ *      pool is not NULL (throws a CRE if not).
+ *      That it is not called from inside a task.
+ * Notes:
+ *      None.
+ *
+ ************************/
+void Taskpool_wait(Taskpool_T pool)
+{
+        assert(pool != NULL);
+        pthread_mutex_lock(&pool->lock);
+        while (__atomic_load_n(&pool->pending, __ATOMIC_SEQ_CST) > 0) {
+                pthread_cond_wait(&pool->done, &pool->lock);
+        }
+        pthread_mutex_unlock(&pool->lock);
+}
+
+/********** Taskpool_idle ********
+ *
+ * Use:
+ *      Returns the number of workers that are currently asleep waiting for
+ *      work. Searches use this to decide whether splitting off a subtree is
+ *      worth the copy.
+ * Parameters:
+ *      Taskpool_T pool: The pool being queried.
+ * Return:
+ *      The number of idle workers.
+ * Expects:
+ *      pool is not NULL (throws a CRE if not).
+ * Notes:
+ *      The answer is a hint and may be stale by the time it is used.
+ *
+ ************************/
+int Taskpool_idle(Taskpool_T pool)
+{
+        assert(pool != NULL);
+        return __atomic_load_n(&pool->sleeping, __ATOMIC_RELAXED);
+}
+
+/********** Taskpool_online_cpus ********
+ *
+ * Use:
+ *      Returns the number of CPUs that are online.
+ * Parameters:
+ *      None.
+ * Return:
+ *      The number of online CPUs, at least 1.
+ * Expects:
+ *      None.
+ * Notes:
+ *      None.
+ *
+ ************************/
+int Taskpool_online_cpus(void)
+{
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        return (cpus < 1) ? 1 : (int)cpus;
+}
+
+/********** Taskpool_free ********
+ *
+ * Use:
+ *      Waits for all pending tasks, stops the workers and frees the pool.
+ * Parameters:
+ *      Taskpool_T *pool: Pointer to the pool to be freed.
+ * Return:
+ *      None.
+ * Expects:
+ *      pool and *pool are not NULL (throws a CRE if not).
+ * Notes:
+ *      Sets *pool to NULL.
+ *
+ ************************/
+void Taskpool_free(Taskpool_T *pool)
+{
+        assert(pool != NULL && *pool != NULL);
+        Taskpool_T p = *pool;
+        Taskpool_wait(p);
+
+        pthread_mutex_lock(&p->lock);
+        p->shutdown = 1;
+        pthread_cond_broadcast(&p->work);
+        pthread_mutex_unlock(&p->lock);
+        for (int i = 0; i < p->nworkers; i++) {
+                pthread_join(p->threads[i], NULL);
+        }
+
+        for (int i = 0; i < p->nworkers; i++) {
+                pthread_mutex_destroy(&p->deques[i].lock);
+                FREE(p->deques[i].tasks);
+        }
+        pthread_mutex_destroy(&p->lock);
+        pthread_cond_destroy(&p->work);
+        pthread_cond_destroy(&p->done);
+        FREE(p->deques);
+        FREE(p->workers);
+        FREE(p->threads);
+        FREE(*pool);
+}
+
+/********** enqueue ********
+ *
+ * Use:
+ *      Pushes a task onto a worker's deque and wakes a sleeping worker.
+ * Parameters:
+ *      Taskpool_T pool: The pool that owns the deque.
+ *      int worker:      Index of the deque.
+ *      Task task:       The task being added.
+ * Return:
+ *      None.
+ * Expects:
+ *      None.
+ * Notes:
+ *      The queued count is raised before sleeping is read, and a worker
+ *      raises sleeping before it reads queued, so one of the two always
+ *      sees the other and no wakeup is lost.
+ *
+ ************************/
+static void enqueue(Taskpool_T pool, int worker, Task task)
+{
+        __atomic_add_fetch(&pool->pending, 1, __ATOMIC_SEQ_CST);
+        deque_push(&pool->deques[worker], task);
+        __atomic_add_fetch(&pool->queued, 1, __ATOMIC_SEQ_CST);
+        if (__atomic_load_n(&pool->sleeping, __ATOMIC_SEQ_CST) > 0) {
+                pthread_mutex_lock(&pool->lock);
+                pthread_cond_signal(&pool->work);
+                pthread_mutex_unlock(&pool->lock);
+        }
+}
+
+/********** worker_loop ********
+ *
+ * Use:
+ *      Body of every worker thread. Runs tasks from its own deque, steals
+ *      when that is empty, and sleeps when there is nothing to steal.
+ * Parameters:
+ *      void *closure: The Worker record of this thread.
+ * Return:
+ *      NULL.
+ * Expects:
+ *      None.
+ * Notes:
+ *      None.
+ *
+ ************************/
+static void *worker_loop(void *closure)
+{
+        Worker *self = closure;
+        Taskpool_T pool = self->pool;
+        Task task;
+
+        for (;;) {
+                if (find_task(pool, self->id, &task)) {
+                        __atomic_sub_fetch(&pool->queued, 1,
+                                           __ATOMIC_SEQ_CST);
+                        task.run(pool, self->id, task.arg);
+                        if (__atomic_sub_fetch(&pool->pending, 1,
+                                               __ATOMIC_SEQ_CST) == 0) {
+                                pthread_mutex_lock(&pool->lock);
+                                pthread_cond_broadcast(&pool->done);
+                                pthread_mutex_unlock(&pool->lock);
+                        }
+                        continue;
+                }
+
+                pthread_mutex_lock(&pool->lock);
+                if (pool->shutdown) {
+                        pthread_mutex_unlock(&pool->lock);
+                        break;
+                }
+                __atomic_add_fetch(&pool->sleeping, 1, __ATOMIC_SEQ_CST);
+                if (__atomic_load_n(&pool->queued, __ATOMIC_SEQ_CST) == 0) {
+                        pthread_cond_wait(&pool->work, &pool->lock);
+                }
+                __atomic_sub_fetch(&pool->sleeping, 1, __ATOMIC_SEQ_CST);
+                pthread_mutex_unlock(&pool->lock);
+        }
+        return NULL;
+}
+
+/********** find_task ********
+ *
+ * Use:
+ *      Pops a task from the worker's own deque, or steals one from the other
+ *      deques, starting with the next worker along.
+ * Parameters:
+ *      Taskpool_T pool: The pool being searched.
+ *      int id:          Index of the worker looking for work.
+ *      Task *task:      Set to the task that was found.
+ * Return:
+ *      True if a task was found.
+ * Expects:
+ *      None.
+ * Notes:
+ *      None.
+ *
+ ************************/
+static bool find_task(Taskpool_T pool, int id, Task *task)
+{
+        if (deque_pop(&pool->deques[id], task)) {
+                return true;
+        }
+        for (int i = 1; i < pool->nworkers; i++) {
+                int victim = (id + i) % pool->nworkers;
+                if (deque_steal(&pool->deques[victim], task)) {
+                        return true;
+                }
+        }
+        return false;
+}
+
+/********** deque_push ********
+ *
+ * Use:
+ *      Pushes a task at the bottom of a deque, doubling it when full.
+ * Parameters:
+ *      Deque *deque: The deque being pushed onto.
+ *      Task task:    The task being added.
+ * Return:
+ *      None.
+ * Expects:
+ *      None.
+ * Notes:
+ *      None.
+ *
+ ************************/
+static void deque_push(Deque *deque, Task task)
+{
+        pthread_mutex_lock(&deque->lock);
+        if (deque->bottom - deque->top == deque->capacity) {
+                Task *tasks = ALLOC(2 * deque->capacity * (long)sizeof(Task));
+                for (long i = deque->top; i < deque->bottom; i++) {
+                        tasks[i % (2 * deque->capacity)] =
+                                deque->tasks[i % deque->capacity];
+                }
+                FREE(deque->tasks);
+                deque->tasks = tasks;
+                deque->capacity *= 2;
+        }
+        deque->tasks[deque->bottom % deque->capacity] = task;
+        deque->bottom++;
+        pthread_mutex_unlock(&deque->lock);
+}
+
+/********** deque_pop ********
+ *
+ * Use:
+ *      Pops the newest task from the bottom of a deque.
+ * Parameters:
+ *      Deque *deque: The deque being popped.
+ *      Task *task:   Set to the popped task.
+ * Return:
+ *      True if the deque was not empty.
+ * Expects:
+ *      None.
+ * Notes:
+ *      None.
+ *
+ ************************/
+static bool deque_pop(Deque *deque, Task *task)
+{
+        bool found = false;
+        pthread_mutex_lock(&deque->lock);
+        if (deque->bottom > deque->top) {
+                deque->bottom--;
+                *task = deque->tasks[deque->bottom % deque->capacity];
+                found = true;
+        }
+        pthread_mutex_unlock(&deque->lock);
+        return found;
+}
+
+/********** deque_steal ********
+ *
+ * Use:
+ *      Takes the oldest task from the top of another worker's deque.
+ * Parameters:
+ *      Deque *deque: The deque being stolen from.
+ *      Task *task:   Set to the stolen task.
+ * Return:
+ *      True if a task was stolen.
+ * Expects:
+ *      None.
+ * Notes:
+ *      Uses trylock so that a thief never blocks the owner for long; a busy
+ *      deque is simply skipped this round.
+ *
+ ************************/
+static bool deque_steal(Deque *deque, Task *task)
+{
+        bool found = false;
+        if (pthread_mutex_trylock(&deque->lock) != 0) {
+                return false;
+        }
+        if (deque->bottom > deque->top) {
+                *task = deque->tasks[deque->top % deque->capacity];
+                deque->top++;
+                found = true;
+        }
+        pthread_mutex_unlock(&deque->lock);
+        return found;
+}
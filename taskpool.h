@@ -0,0 +1,39 @@
+/*
+ *     taskpool.h
+ *     by nozden01 & bdioni01, 2/12/2024
+ *     iii
+ *
+ *     Struct and function declarations for a work-stealing thread pool.
+ *     Every worker owns a deque of tasks: it pushes and pops at the bottom of
+ *     its own deque, and idle workers steal from the top of other workers'
+ *     deques. Tasks may spawn more tasks onto the deque of the worker that
+ *     runs them, which is how recursive searches split their trees.
+ */
+
+#ifndef TASKPOOL_INCLUDED
+#define TASKPOOL_INCLUDED
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <assert.h>
+#include <pthread.h>
+#include "mem.h"
+
+typedef struct Taskpool_T *Taskpool_T;
+
+Taskpool_T Taskpool_new(int nthreads);
+int Taskpool_workers(Taskpool_T pool);
+void Taskpool_submit(Taskpool_T pool,
+                     void run(Taskpool_T pool, int worker, void *arg),
+                     void *arg);
+void Taskpool_spawn(Taskpool_T pool,
+                    int worker,
+                    void run(Taskpool_T pool, int worker, void *arg),
+                    void *arg);
+void Taskpool_wait(Taskpool_T pool);
+int Taskpool_idle(Taskpool_T pool);
+int Taskpool_online_cpus(void);
+void Taskpool_free(Taskpool_T *pool);
+
+#endif
@@ -0,0 +1,56 @@
+/*
+ *     timing.c
+ *     by nozden01 & bdioni01, 2/12/2024
+ *     iii
+ *
+ *     Function implementations for the shared timing helpers.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <time.h>
+#include "timing.h"
+
+/********** seconds ********
+ *
+ * Use:
+ *      Reads the monotonic clock.
+ * Parameters:
+ *      None.
+ * Return:
+ *      The time in seconds from an arbitrary start.
+ * Expects:
+ *      None.
+ * Notes:
+ *      None.
+ *
+ ************************/
+double seconds(void)
+{
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        return now.tv_sec + now.tv_nsec * 1e-9;
+}
+
+/********** compare_doubles ********
+ *
+ * Use:
+ *      qsort comparison for doubles in increasing order.
+ * Parameters:
+ *      const void *a: Pointer to the first double.
+ *      const void *b: Pointer to the second double.
+ * Return:
+ *      Negative, zero or positive as *a is less than, equal to or greater
+ *      than *b.
+ * Expects:
+ *      None.
+ * Notes:
+ *      None.
+ *
+ ************************/
+int compare_doubles(const void *a, const void *b)
+{
+        double x = *(const double *)a;
+        double y = *(const double *)b;
+        return (x > y) - (x < y);
+}
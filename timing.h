@@ -0,0 +1,16 @@
+/*
+ *     timing.h
+ *     by nozden01 & bdioni01, 2/12/2024
+ *     iii
+ *
+ *     Function declarations for the clock and sorting helpers shared by
+ *     the programs that time things: benchmark, bench_run and iii_client.
+ */
+
+#ifndef TIMING_INCLUDED
+#define TIMING_INCLUDED
+
+double seconds(void);
+int compare_doubles(const void *a, const void *b);
+
+#endif
@@ -44,12 +44,11 @@ void UArray2_map_col_major(UArray2_T arr,
                            void *closure)
 {
     assert(arr != NULL);
-    int height = UArray2_height(arr);
-    int width = UArray2_width(arr);
+    int height = arr->height;
+    int width = arr->width;
     for (int i = 0; i < width; i++) {
         for (int j = 0; j < height; j++) {
-            int *elem = (int *)UArray2_at(arr, i, j);
-            apply(i, j, arr, elem, closure);
+            apply(i, j, arr, UArray2_at_fast(arr, i, j), closure);
         }
     }
 }
@@ -90,16 +89,65 @@ void UArray2_map_row_major(UArray2_T arr,
                            void *closure)
 {
     assert(arr != NULL);
-    int height = UArray2_height(arr);
-    int width = UArray2_width(arr);
+    int height = arr->height;
+    int width = arr->width;
     for (int i = 0; i < height; i++) {
+        char *elem = arr->elems + i * arr->stride;
         for (int j = 0; j < width; j++) {
-            int *elem = (int *)UArray2_at(arr, j, i);
             apply(j, i, arr, elem, closure);
+            elem += arr->size;
         }
     }
 }
 
+/********** UArray2_fold ********
+ *
+ * Use: 
+ *      Folds over a rectangle of the given 2D array one row at a time. The
+ *      apply function is called once per row of the rectangle, in row
+ *      order, with a pointer to the first element of that row of the
+ *      rectangle and the number of elements that follow it contiguously.
+ *      Whole arrays, single rows, single columns and rectangles are all
+ *      folded this way, and apply can run a tight loop over each row
+ *      instead of being called once per element.
+ * Parameters:
+ *      UArray2_T arr:         A 2D Uarray that will be folded over.
+ *      int col, int row:      Top-left corner of the rectangle.
+ *      int width, int height: Size of the rectangle.
+ *      void apply(int col, int row, UArray2_T arr, void *elems, int count,
+ *                 void *closure): Called on each row of the rectangle;
+ *                                 col and row locate elems[0].
+ *      void *closure:         The accumulator, passed into apply.
+ * Return: 
+ *      None.
+ * Expects: 
+ *      That arr is not NULL, and that the rectangle lies within the array.
+ *      Throws CRE if any of these cases are not met.
+ * Notes: 
+ *      An empty rectangle calls apply zero times.
+ *
+ ************************/
+void UArray2_fold(UArray2_T arr, int col, int row, int width, int height,
+                  void apply(int col,
+                             int row,
+                             UArray2_T arr,
+                             void *elems,
+                             int count,
+                             void *closure),
+                  void *closure)
+{
+    assert(arr != NULL);
+    assert((col >= 0) && (row >= 0) && (width >= 0) && (height >= 0));
+    assert(((long)col + width <= arr->width) &&
+           ((long)row + height <= arr->height));
+    if (width == 0) {
+        return;
+    }
+    for (int i = row; i < row + height; i++) {
+        apply(col, i, arr, UArray2_at_fast(arr, col, i), width, closure);
+    }
+}
+
 /********** UArray2_at ********
  *
  * Use: 
@@ -125,10 +173,9 @@ void *UArray2_at(UArray2_T arr, int col, int row)
 {
     assert(arr != NULL);
     assert((col >= 0) && (row >= 0));
-    assert((UArray2_width(arr) > col) && (UArray2_height(arr) > row));
+    assert((arr->width > col) && (arr->height > row));
 
-    UArray_T column = *(UArray_T *)UArray_at(arr->uarr2, row);
-    return UArray_at(column, col);
+    return arr->elems + row * arr->stride + (long)col * arr->size;
 }
 
 /********** UArray2_new ********
@@ -150,7 +197,8 @@ void *UArray2_at(UArray2_T arr, int col, int row)
  *      any of these cases are not met. 
  * Notes: 
  *      This function allocates memory for the new 2D UArray and expects the
- *      client to free the memory with UArray2_free.
+ *      client to free the memory with UArray2_free. The elements are
+ *      zeroed and stored row-major in a single block.
  *
  ************************/
 UArray2_T UArray2_new(int col, int row, int size)
@@ -162,14 +210,104 @@ UArray2_T UArray2_new(int col, int row, int size)
     /* Checking for a successful memory allocation. */
     assert(UArray2 != NULL);
 
-    UArray_T rows = UArray_new(row, size);
-    for (int i = 0; i < row; i++) { 
-        *(UArray_T *)(UArray_at(rows, i)) = UArray_new(col, sizeof(int));
+    UArray2->width = col;
+    UArray2->height = row;
+    UArray2->size = size;
+    UArray2->stride = (long)col * size;
+    UArray2->elems = NULL;
+    if (col > 0 && row > 0) {
+        UArray2->elems = CALLOC(row, UArray2->stride);
     }
-    UArray2->uarr2 = rows;
     return UArray2;
 }
 
+/********** UArray2_init ********
+ *
+ * Use: 
+ *      Builds a 2D array in caller-provided storage, taking the memory for
+ *      its elements from the given allocation function, so that arrays can
+ *      live in a region or any other allocator.
+ * Parameters:
+ *      struct UArray2_T *storage: Storage for the array itself.
+ *      int col:                   The number of columns.
+ *      int row:                   The number of rows.
+ *      int size:                  The size in bytes of an element.
+ *      void *alloc(long nbytes, void *closure):
+ *                                 Returns nbytes of zeroed memory, aligned
+ *                                 for the element type.
+ *      void *closure:             The closure argument passed to alloc.
+ * Return: 
+ *      The array, which is storage.
+ * Expects: 
+ *      That storage and alloc are not NULL, that col and row are greater
+ *      than or equal to 0, and that size is greater than 0. Throws CRE if
+ *      any of these cases are not met. 
+ * Notes: 
+ *      alloc is called once, and not at all for an empty array. The array
+ *      is released along with the memory alloc gave it, and must not be
+ *      passed to UArray2_free.
+ *
+ ************************/
+UArray2_T UArray2_init(struct UArray2_T *storage, int col, int row, int size,
+                       void *alloc(long nbytes, void *closure),
+                       void *closure)
+{
+    assert((storage != NULL) && (alloc != NULL));
+    assert((col >= 0) && (row >= 0) && (size > 0));
+
+    storage->width = col;
+    storage->height = row;
+    storage->size = size;
+    storage->stride = (long)col * size;
+    storage->elems = NULL;
+    if (col > 0 && row > 0) {
+        storage->elems = alloc(row * storage->stride, closure);
+    }
+    return storage;
+}
+
+/********** UArray2_view ********
+ *
+ * Use: 
+ *      Makes a view of a rectangle of the given 2D array. The view shares
+ *      the parent's elements and stride: it is indexed from (0, 0) at the
+ *      rectangle's top-left corner, and every UArray2 function except
+ *      UArray2_free works on it, reading and writing the parent directly.
+ * Parameters:
+ *      UArray2_T parent:          The 2D Uarray (or view) being viewed.
+ *      int col, int row:          Top-left corner of the rectangle.
+ *      int width, int height:     Size of the rectangle.
+ *      struct UArray2_T *storage: Caller-provided storage for the view, for
+ *                                 example a local variable.
+ * Return: 
+ *      The view, which is storage.
+ * Expects: 
+ *      That parent and storage are not NULL, and that the rectangle lies
+ *      within the parent. Throws CRE if any of these cases are not met.
+ * Notes: 
+ *      Allocates nothing and copies no elements. The view is valid only
+ *      while the parent is, and must not be passed to UArray2_free.
+ *
+ ************************/
+UArray2_T UArray2_view(UArray2_T parent, int col, int row, int width,
+                       int height, struct UArray2_T *storage)
+{
+    assert((parent != NULL) && (storage != NULL));
+    assert((col >= 0) && (row >= 0) && (width >= 0) && (height >= 0));
+    assert(((long)col + width <= parent->width) &&
+           ((long)row + height <= parent->height));
+
+    storage->width = width;
+    storage->height = height;
+    storage->size = parent->size;
+    storage->stride = parent->stride;
+    storage->elems = NULL;
+    if (width > 0 && height > 0) {
+        storage->elems = UArray2_at_fast(parent, col, row);
+    }
+    return storage;
+}
+
 /********** UArray2_height ********
  *
  * Use: 
@@ -187,7 +325,7 @@ UArray2_T UArray2_new(int col, int row, int size)
 int UArray2_height(UArray2_T arr)
 {
     assert(arr != NULL);
-    return UArray_length(arr->uarr2);
+    return arr->height;
 }
 
 /********** UArray2_width ********
@@ -207,7 +345,7 @@ int UArray2_height(UArray2_T arr)
 int UArray2_width(UArray2_T arr)
 {
     assert(arr != NULL);
-    return UArray_length(*(UArray_T *)UArray_at(arr->uarr2, 0));
+    return arr->width;
 }
 
 /********** UArray2_size ********
@@ -228,7 +366,7 @@ int UArray2_width(UArray2_T arr)
 int UArray2_size(UArray2_T arr)
 {
     assert(arr != NULL);
-    return UArray_size(arr->uarr2);
+    return arr->size;
 }
 
 /********** UArray2_free ********
@@ -245,17 +383,12 @@ int UArray2_size(UArray2_T arr)
  *      these cases are not met. 
  * Notes: 
  *      This function deals with the deallocation of a Uarray2 object made in 
- *      passed in. 
+ *      passed in. It must not be called on a view made by UArray2_view.
  *
  ************************/
 void UArray2_free(UArray2_T *arr)
 {
     assert((arr != NULL) && (*arr != NULL));
-    int length = UArray_length((*arr)->uarr2);
-    for (int i = 0; i < length; i++) {
-        UArray_free((UArray_T *)(UArray_at((*arr)->uarr2, i)));
-    }
-
-    UArray_free(&((*arr)->uarr2));
+    FREE((*arr)->elems);
     FREE(*arr);
 }
\ No newline at end of file
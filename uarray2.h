@@ -14,12 +14,22 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <assert.h>
-#include "uarray.h"
 #include "mem.h"
 
+/* Elements are stored row-major in one block; element (col, row) is at
+ * elems + row * stride + col * size. A view shares its parent's block and
+ * stride, with elems pointing at the view's top-left element. Each
+ * dimension is an int, but stride and offsets are longs, so an array may
+ * hold more than 2^31 elements. The fields are public so that the _fast
+ * accessors below can be inlined, but only this interface should change
+ * them. */
 typedef struct UArray2_T
 {
-        UArray_T uarr2;
+        int width;
+        int height;
+        int size;
+        long stride;
+        char *elems;
 } *UArray2_T;
 
 void UArray2_map_col_major(UArray2_T arr,
@@ -36,11 +46,40 @@ void UArray2_map_row_major(UArray2_T arr,
                                       void *elem,
                                       void *closure),
                            void *closure);
+void UArray2_fold(UArray2_T arr, int col, int row, int width, int height,
+                  void apply(int col,
+                             int row,
+                             UArray2_T arr,
+                             void *elems,
+                             int count,
+                             void *closure),
+                  void *closure);
 void *UArray2_at(UArray2_T arr, int col, int row);
 UArray2_T UArray2_new(int col, int row, int size);
+UArray2_T UArray2_init(struct UArray2_T *storage, int col, int row, int size,
+                       void *alloc(long nbytes, void *closure),
+                       void *closure);
+UArray2_T UArray2_view(UArray2_T parent, int col, int row, int width,
+                       int height, struct UArray2_T *storage);
 int UArray2_width(UArray2_T arr);
 int UArray2_height(UArray2_T arr);
 int UArray2_size(UArray2_T arr);
 void UArray2_free(UArray2_T *arr);
 
-#endif
\ No newline at end of file
+/*
+ * Unchecked accessors for hot loops whose indices are already known to be
+ * in bounds. They do no checking at all and compile to a multiply-add, so
+ * loops that use them can be inlined and vectorized. Building with
+ * III_CHECKED defined (make CHECKED=1) turns them back into calls to the
+ * checked functions, for debugging.
+ */
+#ifdef III_CHECKED
+#define UArray2_at_fast(arr, col, row) UArray2_at((arr), (col), (row))
+#else
+static inline void *UArray2_at_fast(UArray2_T arr, int col, int row)
+{
+        return arr->elems + row * arr->stride + (long)col * arr->size;
+}
+#endif
+
+#endif
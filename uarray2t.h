@@ -0,0 +1,260 @@
+/*
+ *     uarray2t.h
+ *     by nozden01 & bdioni01, 2/12/2024
+ *     iii
+ *
+ *     Typed 2D arrays generated for concrete element types.
+ *
+ *     UARRAY2_DECLARE(name, type, sum) declares UArray2_name, a 2D array of
+ *     type, with typed accessors, typed map callbacks and reductions over
+ *     rectangles, all inline; sums are accumulated in the sum type. Because
+ *     the element size is a compile-time constant, loops over a typed array
+ *     (fills, copies, reductions) can be unrolled and vectorized, which the
+ *     void * interface of UArray2_T does not allow. fold.h runs the
+ *     reductions across threads.
+ *
+ *     A typed array holds a UArray2_T in the same layout, and
+ *     UArray2_name_generic returns it, so the generic interface (maps,
+ *     UArray2_at, and anything written against UArray2_T) works on typed
+ *     arrays too. Free a typed array only with UArray2_name_free.
+ *     UArray2_name_view makes a view of a rectangle in caller-provided
+ *     storage, as UArray2_view does; it must not be freed.
+ *
+ *     UArray2_int, UArray2_u8 and UArray2_double are declared below; other
+ *     types can be declared the same way in any source file.
+ */
+
+#ifndef UARRAY2T_INCLUDED
+#define UARRAY2T_INCLUDED
+
+#include <stdint.h>
+#include <string.h>
+#include "uarray2.h"
+
+/* The _fast accessors check their indices only in the checked build. */
+#ifdef III_CHECKED
+#define UARRAY2_FAST_ASSERT(cond) assert(cond)
+#else
+#define UARRAY2_FAST_ASSERT(cond) ((void)0)
+#endif
+
+/* Reductions take a rectangle, which must lie within the array. */
+#define UARRAY2_ASSERT_RECT(arr, col, row, width, height)                    \
+        do {                                                                 \
+                assert((arr) != NULL);                                       \
+                assert((col) >= 0 && (row) >= 0);                            \
+                assert((width) >= 0 && (height) >= 0);                       \
+                assert((long)(col) + (width) <= (arr)->generic.width);       \
+                assert((long)(row) + (height) <= (arr)->generic.height);     \
+        } while (0)
+
+#define UARRAY2_DECLARE(NAME, TYPE, SUM)                                     \
+typedef struct UArray2_##NAME {                                              \
+        struct UArray2_T generic;                                            \
+} *UArray2_##NAME;                                                           \
+                                                                             \
+static inline UArray2_##NAME UArray2_##NAME##_new(int width, int height)     \
+{                                                                            \
+        assert(width >= 0 && height >= 0);                                   \
+        UArray2_##NAME arr;                                                  \
+        NEW(arr);                                                            \
+        arr->generic.width = width;                                          \
+        arr->generic.height = height;                                        \
+        arr->generic.size = sizeof(TYPE);                                    \
+        arr->generic.stride = (long)width * sizeof(TYPE);                    \
+        arr->generic.elems = NULL;                                           \
+        if (width > 0 && height > 0) {                                       \
+                arr->generic.elems = CALLOC(height, arr->generic.stride);    \
+        }                                                                    \
+        return arr;                                                          \
+}                                                                            \
+                                                                             \
+static inline void UArray2_##NAME##_free(UArray2_##NAME *arr)                \
+{                                                                            \
+        assert(arr != NULL && *arr != NULL);                                 \
+        FREE((*arr)->generic.elems);                                         \
+        FREE(*arr);                                                          \
+}                                                                            \
+                                                                             \
+static inline UArray2_##NAME UArray2_##NAME##_view(UArray2_##NAME parent,    \
+        int col, int row, int width, int height,                             \
+        struct UArray2_##NAME *storage)                                      \
+{                                                                            \
+        assert(parent != NULL && storage != NULL);                           \
+        UArray2_view(&parent->generic, col, row, width, height,              \
+                     &storage->generic);                                     \
+        return storage;                                                      \
+}                                                                            \
+                                                                             \
+static inline UArray2_T UArray2_##NAME##_generic(UArray2_##NAME arr)         \
+{                                                                            \
+        assert(arr != NULL);                                                 \
+        return &arr->generic;                                                \
+}                                                                            \
+                                                                             \
+static inline int UArray2_##NAME##_width(UArray2_##NAME arr)                 \
+{                                                                            \
+        assert(arr != NULL);                                                 \
+        return arr->generic.width;                                           \
+}                                                                            \
+                                                                             \
+static inline int UArray2_##NAME##_height(UArray2_##NAME arr)                \
+{                                                                            \
+        assert(arr != NULL);                                                 \
+        return arr->generic.height;                                          \
+}                                                                            \
+                                                                             \
+static inline TYPE *UArray2_##NAME##_row(UArray2_##NAME arr, int row)        \
+{                                                                            \
+        UARRAY2_FAST_ASSERT(arr != NULL);                                    \
+        UARRAY2_FAST_ASSERT(row >= 0 && row < arr->generic.height);          \
+        return (TYPE *)(arr->generic.elems + row * arr->generic.stride);     \
+}                                                                            \
+                                                                             \
+static inline TYPE *UArray2_##NAME##_at(UArray2_##NAME arr, int col,         \
+                                        int row)                             \
+{                                                                            \
+        assert(arr != NULL);                                                 \
+        assert(col >= 0 && col < arr->generic.width);                        \
+        assert(row >= 0 && row < arr->generic.height);                       \
+        return UArray2_##NAME##_row(arr, row) + col;                         \
+}                                                                            \
+                                                                             \
+static inline TYPE *UArray2_##NAME##_at_fast(UArray2_##NAME arr, int col,    \
+                                             int row)                        \
+{                                                                            \
+        UARRAY2_FAST_ASSERT(col >= 0 && col < arr->generic.width);           \
+        return UArray2_##NAME##_row(arr, row) + col;                         \
+}                                                                            \
+                                                                             \
+static inline void UArray2_##NAME##_fill(UArray2_##NAME arr, TYPE value)    \
+{                                                                            \
+        assert(arr != NULL);                                                 \
+        int width = arr->generic.width;                                      \
+        for (int row = 0; row < arr->generic.height; row++) {                \
+                TYPE *elems = UArray2_##NAME##_row(arr, row);                \
+                for (int col = 0; col < width; col++) {                      \
+                        elems[col] = value;                                  \
+                }                                                            \
+        }                                                                    \
+}                                                                            \
+                                                                             \
+static inline void UArray2_##NAME##_copy(UArray2_##NAME dest,                \
+                                         UArray2_##NAME src)                 \
+{                                                                            \
+        assert(dest != NULL && src != NULL);                                 \
+        assert(dest->generic.width == src->generic.width);                   \
+        assert(dest->generic.height == src->generic.height);                 \
+        size_t bytes = (size_t)src->generic.width * sizeof(TYPE);            \
+        for (int row = 0; row < src->generic.height; row++) {                \
+                memcpy(UArray2_##NAME##_row(dest, row),                      \
+                       UArray2_##NAME##_row(src, row), bytes);               \
+        }                                                                    \
+}                                                                            \
+                                                                             \
+static inline SUM UArray2_##NAME##_sum(UArray2_##NAME arr, int col,         \
+                                       int row, int width, int height)       \
+{                                                                            \
+        UARRAY2_ASSERT_RECT(arr, col, row, width, height);                   \
+        SUM sums[4] = { 0, 0, 0, 0 };                                        \
+        for (int i = row; i < row + height; i++) {                           \
+                const TYPE *elems = UArray2_##NAME##_row(arr, i) + col;      \
+                int j = 0;                                                   \
+                for (; j + 4 <= width; j += 4) {                             \
+                        sums[0] += elems[j];                                 \
+                        sums[1] += elems[j + 1];                             \
+                        sums[2] += elems[j + 2];                             \
+                        sums[3] += elems[j + 3];                             \
+                }                                                            \
+                for (; j < width; j++) {                                     \
+                        sums[0] += elems[j];                                 \
+                }                                                            \
+        }                                                                    \
+        return (sums[0] + sums[1]) + (sums[2] + sums[3]);                    \
+}                                                                            \
+                                                                             \
+static inline TYPE UArray2_##NAME##_min(UArray2_##NAME arr, int col,         \
+                                        int row, int width, int height)      \
+{                                                                            \
+        UARRAY2_ASSERT_RECT(arr, col, row, width, height);                   \
+        assert(width > 0 && height > 0);                                     \
+        TYPE least = UArray2_##NAME##_row(arr, row)[col];                    \
+        for (int i = row; i < row + height; i++) {                           \
+                const TYPE *elems = UArray2_##NAME##_row(arr, i) + col;      \
+                for (int j = 0; j < width; j++) {                            \
+                        least = elems[j] < least ? elems[j] : least;         \
+                }                                                            \
+        }                                                                    \
+        return least;                                                        \
+}                                                                            \
+                                                                             \
+static inline TYPE UArray2_##NAME##_max(UArray2_##NAME arr, int col,         \
+                                        int row, int width, int height)      \
+{                                                                            \
+        UARRAY2_ASSERT_RECT(arr, col, row, width, height);                   \
+        assert(width > 0 && height > 0);                                     \
+        TYPE most = UArray2_##NAME##_row(arr, row)[col];                     \
+        for (int i = row; i < row + height; i++) {                           \
+                const TYPE *elems = UArray2_##NAME##_row(arr, i) + col;      \
+                for (int j = 0; j < width; j++) {                            \
+                        most = elems[j] > most ? elems[j] : most;            \
+                }                                                            \
+        }                                                                    \
+        return most;                                                         \
+}                                                                            \
+                                                                             \
+static inline void UArray2_##NAME##_map_row_major(                           \
+        UArray2_##NAME arr,                                                  \
+        void apply(int col, int row, UArray2_##NAME arr, TYPE *elem,         \
+                   void *closure),                                           \
+        void *closure)                                                       \
+{                                                                            \
+        assert(arr != NULL);                                                 \
+        for (int row = 0; row < arr->generic.height; row++) {                \
+                TYPE *elems = UArray2_##NAME##_row(arr, row);                \
+                for (int col = 0; col < arr->generic.width; col++) {         \
+                        apply(col, row, arr, &elems[col], closure);          \
+                }                                                            \
+        }                                                                    \
+}                                                                            \
+                                                                             \
+static inline void UArray2_##NAME##_map_col_major(                           \
+        UArray2_##NAME arr,                                                  \
+        void apply(int col, int row, UArray2_##NAME arr, TYPE *elem,         \
+                   void *closure),                                           \
+        void *closure)                                                       \
+{                                                                            \
+        assert(arr != NULL);                                                 \
+        for (int col = 0; col < arr->generic.width; col++) {                 \
+                for (int row = 0; row < arr->generic.height; row++) {        \
+                        apply(col, row, arr,                                 \
+                              UArray2_##NAME##_row(arr, row) + col,          \
+                              closure);                                      \
+                }                                                            \
+        }                                                                    \
+}
+
+UARRAY2_DECLARE(int, int, long)
+UARRAY2_DECLARE(u8, uint8_t, unsigned long)
+UARRAY2_DECLARE(double, double, double)
+
+/*
+ * Adds the number of times each value occurs in a rectangle of arr to
+ * counts[value]; counts is not cleared first, so histograms of several
+ * rectangles can be summed.
+ */
+static inline void UArray2_u8_histogram(UArray2_u8 arr, int col, int row,
+                                        int width, int height,
+                                        unsigned long counts[256])
+{
+        UARRAY2_ASSERT_RECT(arr, col, row, width, height);
+        assert(counts != NULL);
+        for (int i = row; i < row + height; i++) {
+                const uint8_t *elems = UArray2_u8_row(arr, i) + col;
+                for (int j = 0; j < width; j++) {
+                        counts[elems[j]]++;
+                }
+        }
+}
+
+#endif
@@ -6,8 +6,27 @@
  *     Function implementations for the unblackedges program.
  *     Handles arguments, reads bits in from the file, unblacks the black
  *     edge pixels, outputs the new pbm file.
+ *
+ *     Usage: unblackedges [-r | -l | -t level] [file]
+ *            unblackedges -i file
+ *            -r    work on runs (rle2.h) instead of a dense bitmap; memory
+ *                  and unblacking time then scale with the number of black
+ *                  runs rather than the number of pixels
+ *            -l    work on runs, but label every black component (label2.h)
+ *                  and drop the ones that touch the border
+ *            -i    clean a raw (P4) file in place through a shared mapping
+ *                  instead of printing a plain copy; only the pages that
+ *                  hold border-connected black pixels are written back
+ *            -t    read a graymap (P2 or P5) instead, taking the samples
+ *                  below level as black, in the same pass that packs them
  */
 
+#define _POSIX_C_SOURCE 200809L
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include "unblackedges.h"
 
 /*************** main ***************
@@ -21,10 +40,11 @@
  *      int argc:     Number of arguments in program call.
  *      char *argv[]: Pointer to an array of arguments.
  * Expects:
- *      Two arguments or less.
+ *      An optional -r, -l or -t level followed by an optional file name, or
+ *      -i followed by a file name.
  *      File that exists.
  * Notes:
- *      Will throw a CRE if more than 2 arguments are provided
+ *      Will throw a CRE if more arguments are provided
  *      Will throw a CRE if the given file is NULL.
  *      Will return EXIT_SUCCESS if the program runs to completion
  *
@@ -32,21 +52,56 @@
 int main(int argc, char *argv[])
 {
         FILE *fp;
+        int arg = 1;
+        bool runs = argc > 1 && strcmp(argv[1], "-r") == 0;
+        bool labels = argc > 1 && strcmp(argv[1], "-l") == 0;
+        bool in_place = argc > 1 && strcmp(argv[1], "-i") == 0;
+        bool gray = argc > 2 && strcmp(argv[1], "-t") == 0;
+        long level = 0;
+        if (runs || labels || in_place) {
+                arg++;
+        } else if (gray) {
+                char *end;
+                level = strtol(argv[2], &end, 10);
+                assert(*end == '\0' && level >= 0);
+                arg += 2;
+        }
         /* Asserting that there are not too many args. */
-        assert(argc < 3);
+        assert(argc - arg < 2);
+        if (in_place) {
+                assert(arg < argc);
+                pbmclean_mapped(argv[arg]);
+                INSTR_REPORT("unblackedges", EXIT_SUCCESS);
+                return EXIT_SUCCESS;
+        }
         
         /* Opens the file and calls necessary functions. */
-        if (argc == 1) {
+        if (arg == argc) {
                 fp = stdin;
         } else {
-                fp = fopen(argv[1], "r");
+                fp = fopen(argv[arg], "r");
                 assert(fp != NULL);
         }
-        Bit2_T bitmap = pbmread(fp);
-        pbmwrite(bitmap);
+        if (runs || labels) {
+                INSTR_BEGIN(INSTR_READ);
+                Rle2_T image = pbmread_runs(fp);
+                INSTR_END(INSTR_READ);
+                if (labels) {
+                        pbmwrite_labels(image);
+                } else {
+                        pbmwrite_runs(image);
+                }
+        } else {
+                INSTR_BEGIN(INSTR_READ);
+                Bit2_T bitmap = gray ? pgmread_threshold(fp, level)
+                                     : pbmread(fp);
+                INSTR_END(INSTR_READ);
+                pbmwrite(bitmap);
+        }
 
         fclose(fp);
 
+        INSTR_REPORT("unblackedges", EXIT_SUCCESS);
         return EXIT_SUCCESS;
 }
 
@@ -63,7 +118,8 @@ int main(int argc, char *argv[])
  *      Inputfp is a portable bitmap file.
  *      The Pnmrdr is able to read in from the given file properly.
  *      The P1 header read in from inputfp has a height greater than 0 and
- *      and a width greater than 0.
+ *      and a width greater than 0, neither more than INT_MAX. The image
+ *      itself may have more than 2^31 pixels.
  * Notes:
  *      Throws a CRE if the Pnmrdr is not allocated correctly.
  *      All memory allocation and deallocation is contained within this 
@@ -78,6 +134,8 @@ Bit2_T pbmread(FILE *inputfp)
         Pnmrdr_mapdata p1HeaderInfo = Pnmrdr_data(p1);
 
         assert((p1HeaderInfo.height > 0) && (p1HeaderInfo.width > 0));
+        assert((p1HeaderInfo.height <= INT_MAX) &&
+               (p1HeaderInfo.width <= INT_MAX));
 
         Bit2_T ourBitmap = Bit2_new(p1HeaderInfo.width, p1HeaderInfo.height);
 
@@ -89,16 +147,124 @@ Bit2_T pbmread(FILE *inputfp)
                 }
         }
         Pnmrdr_free(&p1);
+        INSTR_COUNT(INSTR_PIXELS_READ,
+                    (int64_t)p1HeaderInfo.width * p1HeaderInfo.height);
 
         return ourBitmap;
 }
 
+/*************** pgmread_threshold ***************
+ *
+ * Use:
+ *      Reads a graymap and returns the bitmap of its samples below a
+ *      level, so that dark pixels are black.
+ * Return:
+ *      A 2-D bitmap.
+ * Parameters:
+ *      FILE *inputfp: input file from which we read in the graymap.
+ *      long level:    Samples below level become 1 bits.
+ * Expects:
+ *      Inputfp is a plain (P2) or raw (P5) graymap with every sample
+ *      present and at most maxval (throws a CRE if not).
+ *      level >= 0.
+ * Notes:
+ *      Raw graymaps with one-byte samples are read a row at a time and
+ *      thresholded eight samples at a time by threshold_bytes, whose bits
+ *      are ORed straight into the bitmap's words. Plain and two-byte
+ *      graymaps are read a sample at a time with Pnmscan_gray. Either way
+ *      no bitmap file is written and read back, and no sample goes
+ *      through Pnmrdr.
+ *
+ ************************/
+Bit2_T pgmread_threshold(FILE *inputfp, long level)
+{
+        Pnmscan_info info;
+        bool ok = Pnmscan_header(inputfp, &info);
+        assert(ok && (info.format == 2 || info.format == 5));
+        int width = info.width;
+        int height = info.height;
+        Bit2_T bitmap = Bit2_new(width, height);
+
+        if (info.format == 5 && info.maxval < 256) {
+                unsigned char *line = ALLOC(width);
+                uint64_t levels = 0x0101010101010101ULL *
+                                  (uint64_t)(level > 255 ? 255 : level);
+                for (int row = 0; row < height; row++) {
+                        size_t got = fread(line, 1, width, inputfp);
+                        assert(got == (size_t)width);
+                        uint64_t *words = &bitmap->words[
+                                row * bitmap->words_per_row];
+                        int col = 0;
+                        for (; col + 8 <= width; col += 8) {
+                                uint64_t samples;
+                                memcpy(&samples, line + col, 8);
+                                uint64_t bits = level > 255
+                                        ? 0xff
+                                        : threshold_bytes(samples, levels);
+                                words[col / 64] |= bits << (col % 64);
+                        }
+                        for (; col < width; col++) {
+                                Bit2_put_fast(bitmap, col, row,
+                                              line[col] < level);
+                        }
+                }
+                FREE(line);
+        } else {
+                for (int row = 0; row < height; row++) {
+                        for (int col = 0; col < width; col++) {
+                                long sample = Pnmscan_gray(inputfp, &info);
+                                assert(sample >= 0 &&
+                                       sample <= (long)info.maxval);
+                                Bit2_put_fast(bitmap, col, row,
+                                              sample < level);
+                        }
+                }
+        }
+        INSTR_COUNT(INSTR_PIXELS_READ, (int64_t)width * height);
+        return bitmap;
+}
+
+/*************** threshold_bytes ***************
+ *
+ * Use:
+ *      Compares eight one-byte samples with a level at once.
+ * Return:
+ *      Eight bits, bit i set if sample i is below the level.
+ * Parameters:
+ *      uint64_t samples: The samples, in file order.
+ *      uint64_t levels:  The level, in every byte.
+ * Expects:
+ *      None.
+ * Notes:
+ *      Works within one 64-bit register. Subtracting the low seven bits of
+ *      each level from its sample with the sample's high bit set compares
+ *      the low bits without a borrow crossing bytes, and the high bits
+ *      settle the rest. A multiply then gathers the eight comparison bits
+ *      into the top byte: each is shifted by a different amount, so no two
+ *      meet and nothing carries. Levels above 255 must be handled by the
+ *      caller; every one-byte sample is below them.
+ *
+ ************************/
+uint64_t threshold_bytes(uint64_t samples, uint64_t levels)
+{
+        const uint64_t high = 0x8080808080808080ULL;
+        const uint64_t low = 0x7f7f7f7f7f7f7f7fULL;
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+        samples = __builtin_bswap64(samples);
+#endif
+        uint64_t low_at_least = (samples | high) - (levels & low);
+        uint64_t at_least = ((samples & ~levels) |
+                             (~(samples ^ levels) & low_at_least)) & high;
+        uint64_t below = ~at_least & high;
+        return ((below >> 7) * 0x0102040810204080ULL) >> 56;
+}
+
 /************** pbmwrite *****************
  *
  * Use:
- *      With a given bitmap, creates a new stack, unblacks all black edges,
- *      and prints out the PBM file contents to stdout. Frees all memory
- *      associated with the stack and the given bitmap.
+ *      With a given bitmap, creates a new worklist, unblacks all black
+ *      edges, and prints out the PBM file contents to stdout. Frees all
+ *      memory associated with the worklist and the given bitmap.
  * Return:
  *      None.
  * Parameters:
@@ -110,47 +276,294 @@ Bit2_T pbmread(FILE *inputfp)
  *      Main runner of the unblackedges program.
  *      Relies heavily on the call of other functions in this file.
  *      All memory allocation and deallocation is contained within this 
- *      function.
+ *      function; the worklist's blocks are released with its region.
  *
  ************************/
 void pbmwrite(Bit2_T bitmap)
 {
-        Stack_T neighbors = Stack_new();
-        Bit2_map_row_major(bitmap, check_pixels, neighbors);
+        struct Worklist neighbors = { Region_new(sizeof(Block)), NULL, NULL };
+        INSTR_BEGIN(INSTR_FILL);
+        Bit2_map_row_major(bitmap, check_pixels, &neighbors);
+        INSTR_END(INSTR_FILL);
+        INSTR_BEGIN(INSTR_WRITE);
         printf("P1\n%d %d\n", Bit2_width(bitmap), Bit2_height(bitmap));
         Bit2_map_row_major(bitmap, print_bitmap, NULL);
-        Stack_free(&neighbors);
+        INSTR_END(INSTR_WRITE);
+        Region_free(&neighbors.region);
         Bit2_free(&bitmap);
 }
 
+/*************** pbmread_runs ***************
+ *
+ * Use:
+ *      Reads a bitmap from the given input file as runs of black pixels.
+ * Return:
+ *      A run-length encoded bitmap.
+ * Parameters:
+ *      FILE *inputfp: input file from which we read in the bitmap.
+ * Expects:
+ *      The same as pbmread.
+ * Notes:
+ *      Runs are appended as they end, so no dense bitmap is ever built.
+ *
+ ************************/
+Rle2_T pbmread_runs(FILE *inputfp)
+{
+        Pnmrdr_T p1 = Pnmrdr_new(inputfp);
+        assert(p1 != NULL);
+        Pnmrdr_mapdata p1HeaderInfo = Pnmrdr_data(p1);
+
+        assert((p1HeaderInfo.height > 0) && (p1HeaderInfo.width > 0));
+        assert((p1HeaderInfo.height <= INT_MAX) &&
+               (p1HeaderInfo.width <= INT_MAX));
+        int width = p1HeaderInfo.width;
+        int height = p1HeaderInfo.height;
+
+        Rle2_T image = Rle2_new(width, height);
+        for (int row = 0; row < height; row++) {
+                int start = -1;
+                for (int col = 0; col < width; col++) {
+                        int bit = Pnmrdr_get(p1);
+                        if (bit == 1 && start < 0) {
+                                start = col;
+                        } else if (bit != 1 && start >= 0) {
+                                Rle2_append(image, row, start, col);
+                                start = -1;
+                        }
+                }
+                if (start >= 0) {
+                        Rle2_append(image, row, start, width);
+                }
+        }
+        Pnmrdr_free(&p1);
+        INSTR_COUNT(INSTR_PIXELS_READ, (int64_t)width * height);
+
+        return image;
+}
+
+/************** pbmwrite_runs *****************
+ *
+ * Use:
+ *      The run-based pbmwrite: removes the black runs connected to the
+ *      edges and prints the plain PBM file to stdout. Frees the given
+ *      bitmap.
+ * Return:
+ *      None.
+ * Parameters:
+ *      Rle2_T image: Run-length encoded bitmap read from the input.
+ * Expects:
+ *      image is not NULL.
+ * Notes:
+ *      pbmwrite_labels follows the same pattern, but finds the components
+ *      that touch the edges by labeling all of them with Label2_new and
+ *      keeps the rest with Label2_filter; the output is the same.
+ *
+ ************************/
+void pbmwrite_runs(Rle2_T image)
+{
+        INSTR_BEGIN(INSTR_FILL);
+        Rle2_T cleared = Rle2_clear_border(image);
+        INSTR_END(INSTR_FILL);
+        Rle2_free(&image);
+        print_runs(cleared);
+        Rle2_free(&cleared);
+}
+
+void pbmwrite_labels(Rle2_T image)
+{
+        INSTR_BEGIN(INSTR_FILL);
+        Label2_T labels = Label2_new(image, 4);
+        Rle2_T cleared = Label2_filter(labels, Label2_inside, NULL);
+        Label2_free(&labels);
+        INSTR_END(INSTR_FILL);
+        Rle2_free(&image);
+        print_runs(cleared);
+        Rle2_free(&cleared);
+}
+
+/************** print_runs *****************
+ *
+ * Use:
+ *      Prints a run-length encoded bitmap to stdout as a plain PBM file.
+ * Return:
+ *      None.
+ * Parameters:
+ *      Rle2_T image: The bitmap.
+ * Expects:
+ *      image is not NULL.
+ * Notes:
+ *      Each row is formatted into one line buffer that only the row's runs
+ *      write to, so the output is byte for byte that of pbmwrite.
+ *
+ ************************/
+void print_runs(Rle2_T image)
+{
+        INSTR_BEGIN(INSTR_WRITE);
+        int width = Rle2_width(image);
+        int height = Rle2_height(image);
+        printf("P1\n%d %d\n", width, height);
+        char *line = ALLOC(2 * (long)width);
+        for (long i = 0; i < width; i++) {
+                line[2 * i] = '0';
+                line[2 * i + 1] = ' ';
+        }
+        line[2 * (long)width - 1] = '\n';
+        for (int row = 0; row < height; row++) {
+                const Rle2_run *runs;
+                int count = Rle2_row(image, row, &runs);
+                for (int i = 0; i < count; i++) {
+                        for (long col = runs[i].start; col < runs[i].end;
+                             col++) {
+                                line[2 * col] = '1';
+                        }
+                }
+                fwrite(line, 1, 2 * (long)width, stdout);
+                for (int i = 0; i < count; i++) {
+                        for (long col = runs[i].start; col < runs[i].end;
+                             col++) {
+                                line[2 * col] = '0';
+                        }
+                }
+                INSTR_COUNT(INSTR_PIXELS_WRITTEN, width);
+        }
+        INSTR_END(INSTR_WRITE);
+        FREE(line);
+}
+
+/************** pbmclean_mapped *****************
+ *
+ * Use:
+ *      Removes the black pixels connected to the edges of a raw PBM file,
+ *      in place.
+ * Return:
+ *      None.
+ * Parameters:
+ *      const char *path: Name of the P4 file.
+ * Expects:
+ *      The file exists, is writable, and holds a P4 header followed by at
+ *      least height rows of (width + 7) / 8 bytes (throws a CRE if not).
+ * Notes:
+ *      The file is mapped shared, and its packed rows are read where they
+ *      lie: Rle2_from_packed finds the black runs, Label2_new labels them,
+ *      and the runs of the components Label2_on_border keeps are cleared
+ *      in the mapping, a byte at a time. No other byte is stored to, so
+ *      only the pages that hold border components become dirty and get
+ *      written back; a page whose margins are white is never written at
+ *      all.
+ *
+ ************************/
+void pbmclean_mapped(const char *path)
+{
+        INSTR_BEGIN(INSTR_READ);
+        FILE *fp = fopen(path, "r");
+        assert(fp != NULL);
+        Pnmscan_info info;
+        bool ok = Pnmscan_header(fp, &info);
+        assert(ok && info.format == 4);
+        long offset = ftell(fp);
+        fclose(fp);
+
+        int fd = open(path, O_RDWR);
+        assert(fd >= 0);
+        struct stat status;
+        ok = fstat(fd, &status) == 0;
+        assert(ok);
+        int width = info.width;
+        int height = info.height;
+        long row_bytes = ((long)width + 7) / 8;
+        assert(status.st_size - offset >= row_bytes * height);
+        unsigned char *map = mmap(NULL, status.st_size,
+                                  PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        close(fd);
+        assert(map != MAP_FAILED);
+        unsigned char *data = map + offset;
+        Rle2_T image = Rle2_from_packed(data, width, height);
+        INSTR_COUNT(INSTR_PIXELS_READ, (int64_t)width * height);
+        INSTR_END(INSTR_READ);
+
+        INSTR_BEGIN(INSTR_FILL);
+        Label2_T labels = Label2_new(image, 4);
+        Rle2_T edges = Label2_filter(labels, Label2_on_border, NULL);
+        Label2_free(&labels);
+        Rle2_free(&image);
+        for (int row = 0; row < height; row++) {
+                const Rle2_run *runs;
+                int count = Rle2_row(edges, row, &runs);
+                for (int i = 0; i < count; i++) {
+                        clear_packed(data + row * row_bytes, runs[i].start,
+                                     runs[i].end);
+                }
+        }
+        Rle2_free(&edges);
+        INSTR_END(INSTR_FILL);
+
+        INSTR_BEGIN(INSTR_WRITE);
+        ok = msync(map, status.st_size, MS_SYNC) == 0;
+        assert(ok);
+        munmap(map, status.st_size);
+        INSTR_END(INSTR_WRITE);
+}
+
+/************** clear_packed *****************
+ *
+ * Use:
+ *      Clears columns [start, end) of one raw PBM row.
+ * Return:
+ *      None.
+ * Parameters:
+ *      unsigned char *bytes: The row, the first column in the high bit.
+ *      int start:            First column.
+ *      int end:              One past the last column.
+ * Expects:
+ *      start < end, both within the row.
+ * Notes:
+ *      Stores only to the bytes the columns lie in.
+ *
+ ************************/
+void clear_packed(unsigned char *bytes, int start, int end)
+{
+        long first = start / 8;
+        long last = (end - 1) / 8;
+        for (long k = first; k <= last; k++) {
+                unsigned mask = 0xff;
+                if (k == first) {
+                        mask &= 0xffu >> (start % 8);
+                }
+                if (k == last) {
+                        mask &= (0xffu << (7 - (end - 1) % 8)) & 0xff;
+                }
+                bytes[k] &= (unsigned char)~mask;
+        }
+}
+
 /************** check_pixels *****************
  *
  * Use:
  *      Apply function for unblacking all the black edges associated with
  *      a given bitmap. Given information on a certain bit in the given
- *      bitmap, checks if that pixel is a black edge and uses a stack to
+ *      bitmap, checks if that pixel is a black edge and uses a worklist to
  *      unblack all adjacent black pixels.
  * Return:
  *      None.
  * Parameters:
- *      int col:       Integer of the column index of a bit.
- *      int row:       Integer of a row index of a bit.
- *      Bit2_T bitmap: 2-D bitmap which was read in from the input file.
- *      int bit:       Integer representing the value of a bit.
- *      void *stack:   Void pointer of a closure which expects a stack.
- *                     that will hold the neighbors to be checked.
+ *      int col:        Integer of the column index of a bit.
+ *      int row:        Integer of a row index of a bit.
+ *      Bit2_T bitmap:  2-D bitmap which was read in from the input file.
+ *      int bit:        Integer representing the value of a bit.
+ *      void *worklist: Void pointer of a closure which expects the
+ *                      Worklist that will hold the neighbors to be checked.
  * Expects:
- *      Closure is a Hanson stack.
+ *      Closure is a Worklist.
  *      [0 < col < bitmap width).
  *      [0 < row < bitmap height).
  * Notes:
- *      All memory allocation and deallocation is contained within this 
- *      function.
+ *      None.
  *
  ************************/
-void check_pixels(int col, int row, Bit2_T bitmap, int bit, void *stack)
+void check_pixels(int col, int row, Bit2_T bitmap, int bit, void *worklist)
 {
-        Stack_T neighbor_stack = stack;
+        Worklist neighbors = worklist;
+        INSTR_COUNT(INSTR_PIXELS_VISITED, 1);
         if ((bit == 1) && (col == 0 ||
                            row == 0 ||
                            row == Bit2_height(bitmap) - 1 ||
@@ -160,15 +573,15 @@ void check_pixels(int col, int row, Bit2_T bitmap, int bit, void *stack)
                 int num = Bit2_put(bitmap, col, row, 0);
                 (void) num;
 
-                /* Add neighbors to stack. */
-                push_neighbors(col, row, bitmap, neighbor_stack);
+                /* Add neighbors to the worklist. */
+                push_neighbors(col, row, bitmap, neighbors);
 
-                while (!Stack_empty(neighbor_stack)) {
-                        Index topbit = (Index)Stack_pop(neighbor_stack);
-                        Bit2_put(bitmap, topbit->col, topbit->row, 0);
-                        push_neighbors(topbit->col, topbit->row,
-                                       bitmap, neighbor_stack);
-                        free(topbit);
+                struct Index topbit;
+                while (pop_pixel(neighbors, &topbit)) {
+                        INSTR_COUNT(INSTR_POPS, 1);
+                        Bit2_put_fast(bitmap, topbit.col, topbit.row, 0);
+                        push_neighbors(topbit.col, topbit.row,
+                                       bitmap, neighbors);
                 }
         }
 }
@@ -177,45 +590,41 @@ void check_pixels(int col, int row, Bit2_T bitmap, int bit, void *stack)
  *
  * Use:
  *      Given a column and row index of a bit from the given bitmap, pushes
- *      all the possible neighbors of that bit onto the given stack. The
- *      neighbors are represented as pointers to structs of column and row
- *      integers and are allocated in this function using malloc.
+ *      all the black neighbors of that bit onto the given worklist.
  * Return:
  *      None.
  * Parameters:
- *      int col:                Integer of the column index of a bit.
- *      int row:                Integer of a row index of a bit.
- *      Bit2_T bitmap:          2-D bitmap that was read in from the input file.
- *      Stack_T neighbor_stack: Void pointer of a closure which expects a stack
- *                              that will hold the neighbors to be checked.
+ *      int col:           Integer of the column index of a bit.
+ *      int row:           Integer of a row index of a bit.
+ *      Bit2_T bitmap:     2-D bitmap that was read in from the input file.
+ *      Worklist worklist: The worklist that holds the neighbors to be
+ *                         checked.
  * Expects:
  *      [0 < col < bitmap width)
  *      [0 < row < bitmap height)
  * Notes:
- *      May CRE if malloc of bit index structs fail.
- *      All memory allocation and deallocation is contained within this 
- *      function.
+ *      None.
  *
  ************************/
-void push_neighbors(int col, int row, Bit2_T bitmap, Stack_T neighbor_stack)
+void push_neighbors(int col, int row, Bit2_T bitmap, Worklist worklist)
 {
-        if ((row != 0) && (Bit2_get(bitmap, col, row - 1) == 1)) {
+        if ((row != 0) && (Bit2_get_fast(bitmap, col, row - 1) == 1)) {
                 /* Add the top neighbor. */
-                push_neighbors_helper(col, row - 1, neighbor_stack);
+                push_neighbors_helper(col, row - 1, worklist);
         }
         if ((col != Bit2_width(bitmap) - 1) &&
-            (Bit2_get(bitmap, col + 1, row) == 1)) {
+            (Bit2_get_fast(bitmap, col + 1, row) == 1)) {
                 /* Add the right neighbor. */
-                push_neighbors_helper(col + 1, row, neighbor_stack);
+                push_neighbors_helper(col + 1, row, worklist);
         }
         if ((row != Bit2_height(bitmap) - 1) &&
-            (Bit2_get(bitmap, col, row + 1) == 1)) {
+            (Bit2_get_fast(bitmap, col, row + 1) == 1)) {
                 /* Add the bottom neighbor. */
-                push_neighbors_helper(col, row + 1, neighbor_stack);
+                push_neighbors_helper(col, row + 1, worklist);
         }
-        if ((col != 0) && (Bit2_get(bitmap, col - 1, row) == 1)) {
+        if ((col != 0) && (Bit2_get_fast(bitmap, col - 1, row) == 1)) {
                 /* Add the left neighbor. */
-                push_neighbors_helper(col - 1, row, neighbor_stack);
+                push_neighbors_helper(col - 1, row, worklist);
         }
 }
 
@@ -223,33 +632,76 @@ void push_neighbors(int col, int row, Bit2_T bitmap, Stack_T neighbor_stack)
  *
  * Use:
  *      Given a column and row index of a neighbor bit from the given bitmap,
- *      pushes the struct containing the column and row index of the bit onto
- *      the given stack.
+ *      pushes the bit's indices onto the given worklist.
  * Return:
  *      None.
  * Parameters:
- *      int col:                Integer of the column index of a bit.
- *      int row:                Integer of a row index of a bit.
- *      Bit2_T bitmap:          2-D bitmap that was read in from the input file.
- *      Stack_T neighbor_stack: Void pointer of a closure which expects a stack
- *                              that will hold the neighbors to be checked.
+ *      int col:           Integer of the column index of a bit.
+ *      int row:           Integer of a row index of a bit.
+ *      Worklist worklist: The worklist that holds the neighbors to be
+ *                         checked.
  * Expects:
- *      Neighbor_stack is not NULL (throws a CRE if not).
+ *      worklist is not NULL (throws a CRE if not).
  *      [0 < col < bitmap width)
  *      [0 < row < bitmap height)
  *      The bit at the given indices is an edge black pixel.
  * Notes:
- *      May throw a CRE if malloc of bit index structs fail.
+ *      Takes a block from the spare list, or from the worklist's region,
+ *      when the top block is full.
+ *
+ ************************/
+void push_neighbors_helper(int col, int row, Worklist worklist)
+{
+        assert(worklist != NULL);
+        Block *top = worklist->top;
+        if (top == NULL || top->count == BLOCK_PIXELS) {
+                Block *block = worklist->spare;
+                if (block != NULL) {
+                        worklist->spare = block->prev;
+                } else {
+                        block = Region_alloc(worklist->region,
+                                             sizeof(*block));
+                }
+                block->prev = top;
+                block->count = 0;
+                worklist->top = top = block;
+        }
+        top->pixels[top->count].col = col;
+        top->pixels[top->count].row = row;
+        top->count++;
+        INSTR_COUNT(INSTR_PUSHES, 1);
+        INSTR_MAX(INSTR_WORKLIST_MAX,
+                  INSTR_GET(INSTR_PUSHES) - INSTR_GET(INSTR_POPS));
+}
+
+/************** pop_pixel ***************
+ *
+ * Use:
+ *      Pops the most recently pushed pixel off the given worklist.
+ * Return:
+ *      True if a pixel was popped, false if the worklist was empty.
+ * Parameters:
+ *      Worklist worklist: The worklist.
+ *      Index pixel:       Set to the popped pixel's indices.
+ * Expects:
+ *      worklist and pixel are not NULL.
+ * Notes:
+ *      A block that empties moves to the spare list for the next push.
  *
  ************************/
-void push_neighbors_helper(int col, int row, Stack_T neighbor_stack)
+bool pop_pixel(Worklist worklist, Index pixel)
 {
-        assert(neighbor_stack != NULL);
-        Index bitindex = malloc(sizeof(*bitindex));
-        assert (bitindex != NULL);
-        bitindex->col = col;
-        bitindex->row = row;
-        Stack_push(neighbor_stack, bitindex);
+        Block *top = worklist->top;
+        if (top == NULL) {
+                return false;
+        }
+        *pixel = top->pixels[--top->count];
+        if (top->count == 0) {
+                worklist->top = top->prev;
+                top->prev = worklist->spare;
+                worklist->spare = top;
+        }
+        return true;
 }
 
 /************** print_bitmap *****************
@@ -277,6 +729,7 @@ void print_bitmap(int col, int row, Bit2_T bitmap, int bit, void *closure)
 {
         (void) row;
         (void) closure;
+        INSTR_COUNT(INSTR_PIXELS_WRITTEN, 1);
         if (col != Bit2_width(bitmap) - 1) {
                 printf("%d ", bit);
         } else {
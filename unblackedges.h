@@ -12,16 +12,50 @@
 #include <pnmrdr.h>
 #include <stdio.h>
 #include <stdlib.h>
-#include "stack.h"
+#include <limits.h>
+#include <string.h>
+#include "region.h"
+#include "rle2.h"
+#include "label2.h"
+#include "pnmscan.h"
+#include "instrument.h"
+
+/* Pixels per worklist block. */
+#define BLOCK_PIXELS 4096
 
 typedef struct Index {
         int col;
         int row;
 } *Index;
 
+/* A block of pending pixels; blocks are stacked through prev. */
+typedef struct Block {
+        struct Block *prev;
+        int count;
+        struct Index pixels[BLOCK_PIXELS];
+} Block;
+
+/* Stack of pixels still to be unblacked. Its blocks come from region and
+ * are kept on spare once emptied, so the worklist allocates only when it
+ * grows past its largest size so far. */
+typedef struct Worklist {
+        Region_T region;
+        Block *top;
+        Block *spare;
+} *Worklist;
+
 Bit2_T pbmread(FILE *inputfp);
 void pbmwrite(Bit2_T bitmap);
-void check_pixels(int col, int row, Bit2_T bitmap, int bit, void *stack);
-void push_neighbors(int col, int row, Bit2_T bitmap, Stack_T neighbor_stack);
-void push_neighbors_helper(int col, int row, Stack_T neighbor_stack);
+Rle2_T pbmread_runs(FILE *inputfp);
+Bit2_T pgmread_threshold(FILE *inputfp, long level);
+uint64_t threshold_bytes(uint64_t samples, uint64_t levels);
+void pbmwrite_runs(Rle2_T image);
+void pbmwrite_labels(Rle2_T image);
+void print_runs(Rle2_T image);
+void pbmclean_mapped(const char *path);
+void clear_packed(unsigned char *bytes, int start, int end);
+void check_pixels(int col, int row, Bit2_T bitmap, int bit, void *worklist);
+void push_neighbors(int col, int row, Bit2_T bitmap, Worklist worklist);
+void push_neighbors_helper(int col, int row, Worklist worklist);
+bool pop_pixel(Worklist worklist, Index pixel);
 void print_bitmap(int col, int row, Bit2_T bitmap, int bit, void *closure);
\ No newline at end of file
@@ -0,0 +1,415 @@
+/*
+ *     validator.c
+ *     by nozden01 & bdioni01, 2/12/2024
+ *     iii
+ *
+ *     Function implementations for the incremental sudoku validator.
+ */
+
+#include "validator.h"
+
+/* A unit is one row, column or box. Every (unit, digit) pair has a count,
+ * and the pairs whose count is 2 or more are kept in an unordered list so
+ * that conflicts can be listed without looking at the rest of the board. */
+enum { ROW_UNIT = 0, COL_UNIT = 1, BOX_UNIT = 2, UNIT_KINDS = 3 };
+
+struct Validator_T {
+        int box;
+        int n;
+        int filled;
+        unsigned char *cells;
+        unsigned char *counts;
+        int *conflicts;
+        int nconflicts;
+        int *where;
+};
+
+static void add_digit(Validator_T validator, int kind, int unit, int digit);
+static void remove_digit(Validator_T validator, int kind, int unit,
+                         int digit);
+static void unit_cell(Validator_T validator, int kind, int unit, int i,
+                      int *col, int *row);
+
+/********** Validator_new ********
+ *
+ * Use:
+ *      Creates a validator for an empty board with side box * box.
+ * Parameters:
+ *      int box: Side of one box (3 for a 9x9 board).
+ * Return:
+ *      The new validator.
+ * Expects:
+ *      1 < box <= 15 (throws a CRE if not).
+ * Notes:
+ *      Allocates memory that the client must release with Validator_free.
+ *
+ ************************/
+Validator_T Validator_new(int box)
+{
+        assert(box > 1 && box <= 15);
+        int n = box * box;
+        long pairs = (long)UNIT_KINDS * n * n;
+
+        Validator_T validator;
+        NEW(validator);
+        validator->box = box;
+        validator->n = n;
+        validator->filled = 0;
+        validator->cells = CALLOC((long)n * n, sizeof(unsigned char));
+        validator->counts = CALLOC(pairs, sizeof(unsigned char));
+        validator->conflicts = ALLOC(pairs * (long)sizeof(int));
+        validator->nconflicts = 0;
+        validator->where = ALLOC(pairs * (long)sizeof(int));
+        for (long i = 0; i < pairs; i++) {
+                validator->where[i] = -1;
+        }
+        return validator;
+}
+
+/********** Validator_from_board ********
+ *
+ * Use:
+ *      Creates a validator and loads every cell of the given board into it.
+ * Parameters:
+ *      UArray2_T board: Board of ints with side box * box, 0 for empty.
+ *      int box:         Side of one box.
+ * Return:
+ *      The new validator.
+ * Expects:
+ *      board is box * box on each side and holds values in [0, box * box]
+ *      (throws a CRE if not).
+ * Notes:
+ *      This is the only operation that looks at every cell; later updates
+ *      go through Validator_set and Validator_clear.
+ *
+ ************************/
+Validator_T Validator_from_board(UArray2_T board, int box)
+{
+        assert(board != NULL);
+        Validator_T validator = Validator_new(box);
+        int n = validator->n;
+        assert(UArray2_width(board) == n && UArray2_height(board) == n);
+        for (int row = 0; row < n; row++) {
+                for (int col = 0; col < n; col++) {
+                        int digit = *(int *)UArray2_at(board, col, row);
+                        if (digit != 0) {
+                                Validator_set(validator, col, row, digit);
+                        }
+                }
+        }
+        return validator;
+}
+
+/********** Validator_set ********
+ *
+ * Use:
+ *      Puts a digit in a cell, replacing whatever was there, and updates the
+ *      row, column and box counts in O(1).
+ * Parameters:
+ *      Validator_T validator: The validator being updated.
+ *      int col:               Column of the cell.
+ *      int row:               Row of the cell.
+ *      int digit:             Digit in [1, n], or 0 to clear the cell.
+ * Return:
+ *      The digit that was in the cell before, or 0 if it was empty.
+ * Expects:
+ *      validator is not NULL, col and row are in [0, n), and digit is in
+ *      [0, n] (throws a CRE if not).
+ * Notes:
+ *      None.
+ *
+ ************************/
+int Validator_set(Validator_T validator, int col, int row, int digit)
+{
+        assert(validator != NULL);
+        int n = validator->n;
+        assert(col >= 0 && col < n && row >= 0 && row < n);
+        assert(digit >= 0 && digit <= n);
+
+        int old = Validator_clear(validator, col, row);
+        if (digit == 0) {
+                return old;
+        }
+
+        int box = validator->box;
+        validator->cells[row * n + col] = (unsigned char)digit;
+        validator->filled++;
+        add_digit(validator, ROW_UNIT, row, digit);
+        add_digit(validator, COL_UNIT, col, digit);
+        add_digit(validator, BOX_UNIT, (row / box) * box + col / box, digit);
+        return old;
+}
+
+/********** Validator_clear ********
+ *
+ * Use:
+ *      Empties a cell and updates the row, column and box counts in O(1).
+ * Parameters:
+ *      Validator_T validator: The validator being updated.
+ *      int col:               Column of the cell.
+ *      int row:               Row of the cell.
+ * Return:
+ *      The digit that was in the cell, or 0 if it was already empty.
+ * Expects:
+ *      validator is not NULL and col and row are in [0, n) (throws a CRE if
+ *      not).
+ * Notes:
+ *      None.
+ *
+ ************************/
+int Validator_clear(Validator_T validator, int col, int row)
+{
+        assert(validator != NULL);
+        int n = validator->n;
+        assert(col >= 0 && col < n && row >= 0 && row < n);
+
+        int old = validator->cells[row * n + col];
+        if (old == 0) {
+                return 0;
+        }
+
+        int box = validator->box;
+        validator->cells[row * n + col] = 0;
+        validator->filled--;
+        remove_digit(validator, ROW_UNIT, row, old);
+        remove_digit(validator, COL_UNIT, col, old);
+        remove_digit(validator, BOX_UNIT, (row / box) * box + col / box, old);
+        return old;
+}
+
+/********** Validator_get ********
+ *
+ * Use:
+ *      Returns the digit in a cell.
+ * Parameters:
+ *      Validator_T validator: The validator being queried.
+ *      int col:               Column of the cell.
+ *      int row:               Row of the cell.
+ * Return:
+ *      The digit in the cell, or 0 if it is empty.
+ * Expects:
+ *      validator is not NULL and col and row are in [0, n) (throws a CRE if
+ *      not).
+ * Notes:
+ *      None.
+ *
+ ************************/
+int Validator_get(Validator_T validator, int col, int row)
+{
+        assert(validator != NULL);
+        int n = validator->n;
+        assert(col >= 0 && col < n && row >= 0 && row < n);
+        return validator->cells[row * n + col];
+}
+
+/********** Validator_valid ********
+ *
+ * Use:
+ *      Returns whether no digit appears twice in any row, column or box.
+ * Parameters:
+ *      Validator_T validator: The validator being queried.
+ * Return:
+ *      True if the board has no conflicts. Empty cells are allowed.
+ * Expects:
+ *      validator is not NULL (throws a CRE if not).
+ * Notes:
+ *      O(1).
+ *
+ ************************/
+bool Validator_valid(Validator_T validator)
+{
+        assert(validator != NULL);
+        return validator->nconflicts == 0;
+}
+
+/********** Validator_complete ********
+ *
+ * Use:
+ *      Returns whether the board is a solved sudoku: every cell is filled
+ *      and there are no conflicts.
+ * Parameters:
+ *      Validator_T validator: The validator being queried.
+ * Return:
+ *      True if the board is solved.
+ * Expects:
+ *      validator is not NULL (throws a CRE if not).
+ * Notes:
+ *      O(1). A full board without conflicts has every digit exactly once in
+ *      every unit, which is what stream_check_cells checks.
+ *
+ ************************/
+bool Validator_complete(Validator_T validator)
+{
+        assert(validator != NULL);
+        return validator->nconflicts == 0 &&
+               validator->filled == validator->n * validator->n;
+}
+
+/********** Validator_conflicts ********
+ *
+ * Use:
+ *      Lists the cells that are in conflict. For every row, column or box
+ *      that holds some digit more than once, apply is called on each cell of
+ *      that unit holding the digit.
+ * Parameters:
+ *      Validator_T validator: The validator being queried.
+ *      void apply(int col, int row, int digit, void *closure):
+ *                             Function called on each conflicting cell, or
+ *                             NULL to only count the conflicts.
+ *      void *closure:         The closure argument passed to apply.
+ * Return:
+ *      The number of (unit, digit) pairs that are in conflict.
+ * Expects:
+ *      validator is not NULL (throws a CRE if not).
+ * Notes:
+ *      Only the units in conflict are visited, never the whole board. A cell
+ *      that clashes in more than one unit is reported once per unit.
+ *
+ ************************/
+int Validator_conflicts(Validator_T validator,
+                        void apply(int col,
+                                   int row,
+                                   int digit,
+                                   void *closure),
+                        void *closure)
+{
+        assert(validator != NULL);
+        int n = validator->n;
+        if (apply == NULL) {
+                return validator->nconflicts;
+        }
+        for (int i = 0; i < validator->nconflicts; i++) {
+                int pair = validator->conflicts[i];
+                int digit = pair % n + 1;
+                int unit = (pair / n) % n;
+                int kind = pair / (n * n);
+                for (int k = 0; k < n; k++) {
+                        int col, row;
+                        unit_cell(validator, kind, unit, k, &col, &row);
+                        if (validator->cells[row * n + col] == digit) {
+                                apply(col, row, digit, closure);
+                        }
+                }
+        }
+        return validator->nconflicts;
+}
+
+/********** Validator_free ********
+ *
+ * Use:
+ *      Frees the memory associated with the given validator.
+ * Parameters:
+ *      Validator_T *validator: Pointer to the validator to be freed.
+ * Return:
+ *      None.
+ * Expects:
+ *      validator and *validator are not NULL (throws a CRE if not).
+ * Notes:
+ *      Sets *validator to NULL.
+ *
+ ************************/
+void Validator_free(Validator_T *validator)
+{
+        assert(validator != NULL && *validator != NULL);
+        FREE((*validator)->cells);
+        FREE((*validator)->counts);
+        FREE((*validator)->conflicts);
+        FREE((*validator)->where);
+        FREE(*validator);
+}
+
+/********** add_digit ********
+ *
+ * Use:
+ *      Counts one more copy of a digit in a unit, recording the pair as a
+ *      conflict when the count reaches 2.
+ * Parameters:
+ *      Validator_T validator: The validator being updated.
+ *      int kind:              ROW_UNIT, COL_UNIT or BOX_UNIT.
+ *      int unit:              Index of the unit.
+ *      int digit:             The digit being added.
+ * Return:
+ *      None.
+ * Expects:
+ *      None.
+ * Notes:
+ *      None.
+ *
+ ************************/
+static void add_digit(Validator_T validator, int kind, int unit, int digit)
+{
+        int n = validator->n;
+        int pair = (kind * n + unit) * n + (digit - 1);
+        if (++validator->counts[pair] == 2) {
+                validator->where[pair] = validator->nconflicts;
+                validator->conflicts[validator->nconflicts++] = pair;
+        }
+}
+
+/********** remove_digit ********
+ *
+ * Use:
+ *      Counts one less copy of a digit in a unit, dropping the pair from the
+ *      conflict list when the count falls back to 1.
+ * Parameters:
+ *      Validator_T validator: The validator being updated.
+ *      int kind:              ROW_UNIT, COL_UNIT or BOX_UNIT.
+ *      int unit:              Index of the unit.
+ *      int digit:             The digit being removed.
+ * Return:
+ *      None.
+ * Expects:
+ *      None.
+ * Notes:
+ *      The last pair in the list is moved into the freed slot, so removal is
+ *      O(1).
+ *
+ ************************/
+static void remove_digit(Validator_T validator, int kind, int unit,
+                         int digit)
+{
+        int n = validator->n;
+        int pair = (kind * n + unit) * n + (digit - 1);
+        if (--validator->counts[pair] == 1) {
+                int slot = validator->where[pair];
+                int last = validator->conflicts[--validator->nconflicts];
+                validator->conflicts[slot] = last;
+                validator->where[last] = slot;
+                validator->where[pair] = -1;
+        }
+}
+
+/********** unit_cell ********
+ *
+ * Use:
+ *      Finds the coordinates of the i-th cell of a unit.
+ * Parameters:
+ *      Validator_T validator: The validator holding the board.
+ *      int kind:              ROW_UNIT, COL_UNIT or BOX_UNIT.
+ *      int unit:              Index of the unit.
+ *      int i:                 Index of the cell within the unit.
+ *      int *col:              Set to the column of the cell.
+ *      int *row:              Set to the row of the cell.
+ * Return:
+ *      None.
+ * Expects:
+ *      None.
+ * Notes:
+ *      Boxes are numbered in row-major order, and so are their cells.
+ *
+ ************************/
+static void unit_cell(Validator_T validator, int kind, int unit, int i,
+                      int *col, int *row)
+{
+        int box = validator->box;
+        if (kind == ROW_UNIT) {
+                *col = i;
+                *row = unit;
+        } else if (kind == COL_UNIT) {
+                *col = unit;
+                *row = i;
+        } else {
+                *col = (unit % box) * box + i % box;
+                *row = (unit / box) * box + i / box;
+        }
+}
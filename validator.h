@@ -0,0 +1,39 @@
+/*
+ *     validator.h
+ *     by nozden01 & bdioni01, 2/12/2024
+ *     iii
+ *
+ *     Struct and function declarations for the incremental sudoku validator.
+ *     A Validator_T tracks how many times every digit appears in every row,
+ *     column and box of a board, so single-cell updates and the questions
+ *     "is the board valid" and "is the board complete" all take O(1) time.
+ */
+
+#ifndef VALIDATOR_INCLUDED
+#define VALIDATOR_INCLUDED
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <assert.h>
+#include "uarray2.h"
+#include "mem.h"
+
+typedef struct Validator_T *Validator_T;
+
+Validator_T Validator_new(int box);
+Validator_T Validator_from_board(UArray2_T board, int box);
+int Validator_set(Validator_T validator, int col, int row, int digit);
+int Validator_clear(Validator_T validator, int col, int row);
+int Validator_get(Validator_T validator, int col, int row);
+bool Validator_valid(Validator_T validator);
+bool Validator_complete(Validator_T validator);
+int Validator_conflicts(Validator_T validator,
+                        void apply(int col,
+                                   int row,
+                                   int digit,
+                                   void *closure),
+                        void *closure);
+void Validator_free(Validator_T *validator);
+
+#endif